@@ -1,12 +0,0 @@
-/*
- * ==========================
- *   FILE: ./alarmlib.h
- * ==========================
- * Purpose: Header file for alarmlib.c
- *
- * Note: All the following code and comments are copied from the
- *		 CSCI-28 course website, without modification.
- */
-
-int set_ticker(int);
-void millisleep(int);
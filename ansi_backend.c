@@ -0,0 +1,317 @@
+/*
+ * ===========================================================================
+ *   FILE: ./ansi_backend.c
+ * ===========================================================================
+ * Purpose: Show frames on the terminal with raw ANSI escape sequences, one
+ *          write() per frame, without going through curses.
+ *
+ * Interface:
+ *      ansi_backend        -- backend operations, see backend.h
+ *
+ * Internal functions:
+ *      ab_open()           -- allocate the output buffer
+ *      ab_put()            -- add a changed cell to the buffer
+ *      ab_update()         -- park the cursor and write the buffer out
+ *      ab_resize()         -- size the buffer again, and clear the screen
+ *      ab_close()          -- put the terminal's attributes back, free
+ *      ab_alloc()          -- (re)allocate the buffer for a screen size
+ *      move_to()           -- the shortest cursor move to a cell
+ *      put_num()           -- a number in decimal
+ *      num_len()           -- how many chars put_num() takes for it
+ *
+ * Notes:
+ *      curses still starts and stops the terminal and reads the keyboard
+ *      (see set_up() and wrap_up() in pong.c); only the drawing comes
+ *      here. Since curses never draws, it never gets in its way.
+ *
+ *      The frame (frame.c) already hands over only the cells that
+ *      changed, so there is nothing left to diff: each cell is appended
+ *      to the buffer as it comes, with a cursor move only if the cursor
+ *      isn't already there, and a mode change only if it is in the wrong
+ *      one. The move is the shortest that will do: none after the cell
+ *      just written, forward along a row or to a column of it, or else to
+ *      a row and column. The whole frame then goes out in one write().
+ *
+ *      The buffer is allocated when the backend is opened or resized, with
+ *      room for every cell on the screen to change at once, so a frame
+ *      never allocates or writes more than once, however much changed.
+ *      The bytes written are always known, so they are always reported.
+ */
+
+/* INCLUDES */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "backend.h"
+#include "pong.h"
+
+/* CONSTANTS */
+#define CSI "\033["             // starts a control sequence
+#define CSI_LEN 2
+#define MOVE_MAX 14             // longest move: CSI 65535;65535H
+#define SGR_MAX 4               // longest mode change: CSI 7m
+#define CELL_MAX (MOVE_MAX + SGR_MAX + 1)   // move, mode and the char
+#define CLEAR CSI "m" CSI "H" CSI "2J"      // normal mode, home, clear
+#define CLEAR_LEN 10
+
+/* OUTPUT STATE */
+static char * buf;              // the frame being built
+static size_t len;              // bytes in it so far
+static int rows, cols;          // size of the screen
+static int cur_y = -1, cur_x;   // where the cursor is, cur_y -1 if unknown
+static int standout;            // reverse video is on
+
+/*
+ * ===========================================================================
+ * INTERNAL FUNCTIONS
+ * ===========================================================================
+ */
+static void ab_open(int, int, int);
+static void ab_put(int, int, unsigned short);
+static long ab_update();
+static void ab_resize(int, int);
+static void ab_close();
+static void ab_alloc(int, int);
+static char * move_to(char *, int, int);
+static char * put_num(char *, int);
+static int num_len(int);
+
+/*
+ *  ab_open()
+ *  Purpose: Get ready to show frames
+ *    Input: lines, columns, the size of the screen
+ *           count_bytes, ignored: the bytes are always counted
+ *     Note: The screen is taken to be blank, as initscr() leaves it, with
+ *           the cursor somewhere unknown.
+ */
+void ab_open(int lines, int columns, int count_bytes)
+{
+    ab_alloc(lines, columns);
+    cur_y = -1;
+    standout = 0;
+
+    return;
+}
+
+/*
+ *  ab_put()
+ *  Purpose: Add one changed cell to the frame being built
+ *    Input: y, x, the row and column
+ *           cell, the cell to show
+ *     Note: After a char in the last column, where the cursor is depends
+ *           on the terminal, so it is taken to be unknown.
+ */
+void ab_put(int y, int x, unsigned short cell)
+{
+    char * p = buf + len;
+    int want = (cell & CELL_STANDOUT) != 0;
+
+    if(y != cur_y || x != cur_x)
+        p = move_to(p, y, x);
+
+    if(want != standout)
+    {
+        memcpy(p, want ? CSI "7m" : CSI "m", want ? 4 : 3);
+        p += want ? 4 : 3;
+        standout = want;
+    }
+
+    *p++ = CELL_CHAR(cell);
+    len = p - buf;
+
+    cur_y = (x + 1 < cols) ? y : -1;
+    cur_x = x + 1;
+
+    return;
+}
+
+/*
+ *  ab_update()
+ *  Purpose: Send the frame to the terminal
+ *   Return: the bytes written
+ *   Method: Park the cursor in the bottom-right corner, as curses_backend
+ *           does, then write the buffer. Only if the terminal takes part
+ *           of it (or a signal interrupts) is write() called again, for
+ *           the rest.
+ */
+long ab_update()
+{
+    size_t off;
+    ssize_t n;
+
+    if(cur_y != rows - 1 || cur_x != cols - 1)
+        len = move_to(buf + len, rows - 1, cols - 1) - buf;
+    cur_y = rows - 1;
+    cur_x = cols - 1;
+
+    for(off = 0; off < len; off += n)
+        if( (n = write(STDOUT_FILENO, buf + off, len - off)) == -1 )
+        {
+            if(errno != EINTR)
+                break;
+            n = 0;
+        }
+
+    n = len;
+    len = 0;
+    return n;
+}
+
+/*
+ *  ab_resize()
+ *  Purpose: Take the screen's new size, and clear it
+ *    Input: lines, columns, the new size
+ *     Note: The clear goes at the start of the next frame, so it is sent
+ *           in the same write() as what is drawn after it.
+ */
+void ab_resize(int lines, int columns)
+{
+    ab_alloc(lines, columns);
+
+    memcpy(buf, CLEAR, CLEAR_LEN);
+    len = CLEAR_LEN;
+    cur_y = 0;
+    cur_x = 0;
+    standout = 0;
+
+    return;
+}
+
+/*
+ *  ab_close()
+ *  Purpose: Stop showing frames
+ *     Note: curses doesn't know reverse video may be on, so it is turned
+ *           off here, before endwin().
+ */
+void ab_close()
+{
+    if(standout && write(STDOUT_FILENO, CSI "m", 3) == -1)
+        standout = 0;                   // nothing more to be done
+
+    free(buf);
+    buf = NULL;
+    len = 0;
+    standout = 0;
+
+    return;
+}
+
+/*
+ *  ab_alloc()
+ *  Purpose: Allocate the buffer for a screen of the given size
+ *    Input: lines, columns, the size of the screen
+ *     Note: Room for every cell at its longest, a clear before them and
+ *           the parked cursor after.
+ *    Error: If malloc fails, close curses, print a message and exit.
+ */
+void ab_alloc(int lines, int columns)
+{
+    free(buf);
+    rows = lines;
+    cols = columns;
+    len = 0;
+    buf = malloc(((size_t) lines * columns * CELL_MAX) + CLEAR_LEN +
+                 MOVE_MAX);
+
+    if(buf == NULL)
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Couldn't allocate memory for the output "
+                        "buffer.\n");
+        exit(1);
+    }
+
+    return;
+}
+
+/*
+ *  move_to()
+ *  Purpose: Write the shortest sequence that moves the cursor to a cell
+ *    Input: p, where to write it
+ *           y, x, the row and column, from 0
+ *   Return: the end of what was written
+ *   Method: Along the row the cursor is on, either forward so many
+ *           columns (CUF) or to a column (CHA), whichever is shorter;
+ *           otherwise to the row and column (CUP). A count or position of
+ *           1 is left out, as the terminal takes that by default.
+ */
+char * move_to(char * p, int y, int x)
+{
+    memcpy(p, CSI, CSI_LEN);
+    p += CSI_LEN;
+
+    if( y == cur_y && x > cur_x &&
+        (x - cur_x == 1 || num_len(x - cur_x) <= num_len(x + 1)) )
+    {
+        if(x - cur_x > 1)                       // forward: CSI n C
+            p = put_num(p, x - cur_x);
+        *p++ = 'C';
+    }
+    else if(y == cur_y)                         // to a column: CSI x G
+    {
+        if(x > 0)
+            p = put_num(p, x + 1);
+        *p++ = 'G';
+    }
+    else                                        // anywhere: CSI y;x H
+    {
+        if(y > 0)
+            p = put_num(p, y + 1);
+        if(x > 0)
+        {
+            *p++ = ';';
+            p = put_num(p, x + 1);
+        }
+        *p++ = 'H';
+    }
+
+    return p;
+}
+
+/*
+ *  put_num()
+ *  Purpose: Write a positive number in decimal
+ *    Input: p, where to write it
+ *           n, the number
+ *   Return: the end of what was written
+ */
+char * put_num(char * p, int n)
+{
+    char digits[10];
+    int i = 0;
+
+    do
+        digits[i++] = '0' + (n % 10);
+    while( (n /= 10) > 0 );
+
+    while(i > 0)
+        *p++ = digits[--i];
+
+    return p;
+}
+
+/*
+ *  num_len()
+ *  Purpose: Count the digits of a positive number
+ */
+int num_len(int n)
+{
+    int i = 1;
+
+    while( (n /= 10) > 0 )
+        i++;
+
+    return i;
+}
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+const struct backend ansi_backend = {
+    "ansi", ab_open, ab_put, ab_update, ab_resize, ab_close
+};
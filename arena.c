@@ -0,0 +1,231 @@
+/*
+ * ===========================================================================
+ *   FILE: ./arena.c
+ * ===========================================================================
+ * Purpose: Hand out memory for a game's objects from one block, and take it
+ *          all back at once.
+ *
+ * Interface:
+ *      new_arena()         -- an empty arena, with a first block of a size
+ *      arena_alloc()       -- the next piece of the arena (or a malloc())
+ *      arena_reset()       -- take every piece back at once
+ *      arena_used()        -- how much has been handed out since the reset
+ *      arena_free()        -- free the arena and everything in it
+ *
+ * Internal functions:
+ *      add_block()         -- get another block from malloc()
+ *
+ * Notes:
+ *      Every object of a game (the game itself, its court, clock, paddles,
+ *      balls and grid) comes from the game's arena, one after another, so
+ *      the whole game is a few contiguous kilobytes and setting one up is
+ *      a few pointer bumps. Nothing is freed piece by piece: game_end()
+ *      resets the arena or frees it, and a run of games (headless.c,
+ *      pool.c) resets one arena per thread between games, so after the
+ *      first game no more memory is asked of malloc() at all.
+ *
+ *      When a piece doesn't fit in the block, another block is added, at
+ *      least twice as big. A reset then swaps all the blocks for a single
+ *      one as big as all of them, so from the next game on everything is
+ *      in one block again. Each piece starts on a new ALIGN boundary, a
+ *      cache line, so two objects never share one.
+ *
+ *      An arena is for one thread at a time, as a game is. The arena given
+ *      to a constructor may be NULL, for an object of its own that is never
+ *      freed, and then arena_alloc() is just malloc().
+ */
+
+/* INCLUDES */
+#include <stdio.h>
+#include <stdlib.h>
+#include "arena.h"
+#include "pong.h"
+
+/* CONSTANTS */
+#define ALIGN 64                // every piece starts on a cache line
+#define DFL_BLOCK 16384         // first block when no size is given
+#define ROUND_UP(n) (((n) + ALIGN - 1) & ~(size_t) (ALIGN - 1))
+#define HEAD ROUND_UP(sizeof(struct block))     // a block's header, padded
+
+/* STRUCTS */
+struct block {
+    struct block * prev;        // the block filled before this one
+    size_t size;                // bytes after the header
+};
+
+/* ARENA STRUCT */
+struct pparena {
+    struct block * top;         // the block being handed out from
+    size_t used;                // bytes of it handed out
+    size_t total;               // bytes in all the blocks
+    size_t handed;              // bytes handed out since the last reset
+};
+
+/*
+ * ===========================================================================
+ * INTERNAL FUNCTIONS
+ * ===========================================================================
+ */
+static struct block * add_block(struct pparena *, size_t);
+
+/*
+ *  add_block()
+ *  Purpose: Add a block to the arena and start handing out from it
+ *    Input: ap, the arena
+ *           size, the least it must hold, after its header
+ *   Return: the block, or NULL if malloc() failed
+ *     Note: The header is padded to ALIGN, and the block itself is aligned
+ *           to it, so the first piece is too.
+ */
+struct block * add_block(struct pparena * ap, size_t size)
+{
+    void * p;
+    struct block * bp;
+
+    if( posix_memalign(&p, ALIGN, HEAD + size) != 0 )
+        return NULL;
+
+    bp = p;
+    bp->prev = ap->top;
+    bp->size = size;
+    ap->top = bp;
+    ap->used = HEAD;
+    ap->total += size;
+    return bp;
+}
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  new_arena()
+ *  Purpose: Make an empty arena
+ *    Input: size, bytes for the first block; 0 for DFL_BLOCK
+ *   Return: a pointer to the arena
+ *    Error: If malloc fails, close curses, print a message and exit.
+ */
+struct pparena * new_arena(size_t size)
+{
+    struct pparena * ap = malloc(sizeof(struct pparena));
+
+    if( ap != NULL )
+    {
+        ap->top = NULL;
+        ap->total = ap->handed = 0;
+    }
+
+    if( ap == NULL || add_block(ap, size ? size : DFL_BLOCK) == NULL )
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Couldn't allocate memory for an arena.\n");
+        exit(1);
+    }
+
+    return ap;
+}
+
+/*
+ *  arena_alloc()
+ *  Purpose: Hand out the next piece of an arena
+ *    Input: ap, the arena, or NULL to malloc() the piece instead
+ *           size, bytes wanted
+ *   Return: the piece, aligned to ALIGN, or NULL if there is no memory
+ *     Note: Like malloc() it returns NULL rather than exit, so each
+ *           constructor can still say what it couldn't allocate.
+ */
+void * arena_alloc(struct pparena * ap, size_t size)
+{
+    size_t at, grow;
+
+    if(ap == NULL)
+        return malloc(size);
+
+    at = ROUND_UP(ap->used);
+    if(at + size > HEAD + ap->top->size)
+    {
+        grow = (size > 2 * ap->top->size) ? size : 2 * ap->top->size;
+        if(add_block(ap, grow) == NULL)
+            return NULL;
+        at = ap->used;
+    }
+
+    ap->used = at + size;
+    ap->handed += size;
+    return (char *) ap->top + at;
+}
+
+/*
+ *  arena_reset()
+ *  Purpose: Take back everything the arena has handed out, at once
+ *    Input: ap, the arena
+ *   Method: With one block, only the count of what is used goes back to
+ *           the start. With more, they are all freed and a single block
+ *           as big as all of them is put in their place (or, if that can't
+ *           be had, a DFL_BLOCK one).
+ *     Note: Nothing handed out before may be used after.
+ *    Error: If not even that can be had, close curses, print a message and
+ *           exit.
+ */
+void arena_reset(struct pparena * ap)
+{
+    struct block * bp;
+    size_t total = ap->total;
+
+    if(ap->top->prev != NULL)
+    {
+        while( (bp = ap->top) != NULL )
+        {
+            ap->top = bp->prev;
+            free(bp);
+        }
+        ap->total = 0;
+
+        if( add_block(ap, total) == NULL && add_block(ap, DFL_BLOCK) == NULL )
+        {
+            wrap_up();
+            fprintf(stderr, "./pong: Couldn't allocate memory for an "
+                            "arena.\n");
+            exit(1);
+        }
+    }
+
+    ap->used = HEAD;
+    ap->handed = 0;
+    return;
+}
+
+/*
+ *  arena_used()
+ *  Purpose: Say how much an arena has handed out
+ *   Return: bytes handed out since it was made or last reset, not counting
+ *           what was skipped to align them
+ */
+size_t arena_used(struct pparena * ap)
+{
+    return ap->handed;
+}
+
+/*
+ *  arena_free()
+ *  Purpose: Free an arena, and everything handed out from it
+ *    Input: ap, the arena; NULL is ignored
+ */
+void arena_free(struct pparena * ap)
+{
+    struct block * bp;
+
+    if(ap == NULL)
+        return;
+
+    while( (bp = ap->top) != NULL )
+    {
+        ap->top = bp->prev;
+        free(bp);
+    }
+
+    free(ap);
+    return;
+}
@@ -0,0 +1,19 @@
+/*
+ * ==========================
+ *   FILE: ./arena.h
+ * ==========================
+ * Purpose: Header file for arena.c
+ */
+
+/* INCLUDES */
+#include <stddef.h>
+
+/* OPAQUE STRUCTS */
+struct pparena;
+
+/* EXTERNAL INTERFACE */
+struct pparena * new_arena(size_t);
+void * arena_alloc(struct pparena *, size_t);
+void arena_reset(struct pparena *);
+size_t arena_used(struct pparena *);
+void arena_free(struct pparena *);
\ No newline at end of file
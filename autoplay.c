@@ -0,0 +1,171 @@
+/*
+ * ===========================================================================
+ *   FILE: ./autoplay.c
+ * ===========================================================================
+ * Purpose: Play games with a computer player on the paddle, and add up how
+ *          they went. Shared by pong-headless, pong-sim and pong-sweep.
+ *
+ * Interface:
+ *      autoplay_game()     -- play one game of a run and add it to totals
+ *      autoplay_merge()    -- add one set of totals to another
+ *      autoplay_report()   -- print a summary of a run
+ *
+ *  Player: Each tick, the computer player moves the paddle one row
+ *          towards the ball with a fixed chance (the skill, a percentage).
+ *          With more than one ball in play, it goes for whichever ball
+ *          will reach the paddle next. At 100 it never misses, so each
+ *          game is also capped at a number of ticks.
+ *
+ * Predict: With 'predict' set, the player goes for the row where that
+ *          ball will meet the paddle, worked out from its velocity and
+ *          the bounces off the walls on the way (see game_predict()),
+ *          rather than the row it is on now. That is as cheap a decision
+ *          as the other, so it plays just as fast, but it needs to move
+ *          far fewer times to be there in time.
+ *
+ *   Seeds: Every game is played from its own random number stream, drawn
+ *          from the run's seed and the game's number, so a run is the same
+ *          every time for the same seed, and any one game plays out the
+ *          same whatever else is run alongside it, or on whichever thread.
+ *
+ * Notes:
+ *      Nothing here is shared between calls: each game is a struct ppgame
+ *      of its own, in the caller's arena, and the totals are the caller's.
+ *      Totals only ever add up and take the larger, so they come out the
+ *      same in whatever order the games are played and merged.
+ */
+
+/* INCLUDES */
+#include <stdio.h>
+#include "autoplay.h"
+#include "ball_kernel.h"
+#include "clock.h"
+#include "court.h"
+#include "game.h"
+#include "preset.h"
+#include "rng.h"
+
+/* CONSTANTS */
+#define MINUTE 60
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  autoplay_game()
+ *  Purpose: Play one game with the computer player on the paddle
+ *    Input: ap, the settings for the run
+ *           g, which game of the run this is
+ *           arena, to play the game in; it is reset when the game is over,
+ *           ready for the next
+ *   Output: tp, totals the game is added to
+ *   Return: how long the game lasted, in whole seconds of play
+ *     Note: The court is laid out exactly as pong would lay it out on a
+ *           terminal of the same size.
+ *     Note: Stream g of the run's seed first gives the seed for the game
+ *           itself, then decides when the player moves.
+ */
+long autoplay_game(const struct autoplay * ap, int g,
+                   struct pparena * arena, struct autoplay_totals * tp)
+{
+    struct ppgame * game;
+    struct pprng player;
+    long ticks = 0, secs, served;
+    int state = GAME_ON;
+
+    rng_seed(&player, ap->seed, g);
+    game = new_game(arena, BORDER, ap->cols - BORDER - 1,
+                    ap->lines - BORDER - 1, BORDER, ap->tick_rate, ap->balls,
+                    rng_seed_from(&player), 1);
+
+    while(state == GAME_ON && ticks < ap->max_ticks)
+    {
+        if( rng_range(&player, 0, 100) < ap->skill )
+            state = game_paddle(game, ap->predict ? game_predict(game) :
+                                                    game_aim(game));
+
+        if(state == GAME_ON)
+        {
+            tp->ball_ticks += game_balls_in_play(game);
+            state = game_tick(game);
+        }
+
+        ticks++;
+    }
+
+    secs = (get_mins(game_clock(game)) * MINUTE) +
+           get_secs(game_clock(game));
+    tp->hits += game_hits(game, &served);
+    tp->served += served;
+    game_end(game);
+
+    tp->games++;
+    if(ticks >= ap->max_ticks)
+        tp->capped++;
+
+    tp->ticks += ticks;
+    tp->secs += secs;
+    if(secs > tp->longest)
+        tp->longest = secs;
+
+    return secs;
+}
+
+/*
+ *  autoplay_merge()
+ *  Purpose: Add the totals from one batch of games to another
+ *    Input: to, the totals to add to
+ *           from, the totals to add
+ */
+void autoplay_merge(struct autoplay_totals * to,
+                    const struct autoplay_totals * from)
+{
+    to->games += from->games;
+    to->capped += from->capped;
+    to->ticks += from->ticks;
+    to->ball_ticks += from->ball_ticks;
+    to->secs += from->secs;
+    to->hits += from->hits;
+    to->served += from->served;
+    if(from->longest > to->longest)
+        to->longest = from->longest;
+
+    return;
+}
+
+/*
+ *  autoplay_report()
+ *  Purpose: Print a summary of a run to stdout
+ *    Input: ap, the settings for the run
+ *           tp, what the games added up to
+ *           time, the seconds the run took, for the rates; never 0
+ *     Note: Only the last two lines depend on the machine. The first two
+ *           are the same for the same settings and seed.
+ */
+void autoplay_report(const struct autoplay * ap,
+                     const struct autoplay_totals * tp, double time)
+{
+    long average = (tp->games > 0) ? tp->secs / tp->games : 0;
+
+    printf("games: %ld (%ld hit the tick cap)  court: %dx%d  balls: %d  "
+           "seed: %llu  player: %s\n", tp->games, tp->capped, ap->cols,
+           ap->lines, ap->balls, (unsigned long long) ap->seed,
+           ap->predict ? "predict" : "chase");
+    printf("average game: %.2ld:%.2ld  longest: %.2ld:%.2ld  "
+           "returns per ball: %.2f\n", average / MINUTE, average % MINUTE,
+           tp->longest / MINUTE, tp->longest % MINUTE,
+           (tp->served > 0) ? (double) tp->hits / tp->served : 0.0);
+    printf("ticks: %ld in %.3fs (%.0f ticks/sec, %.0fx real time)\n",
+           tp->ticks, time, tp->ticks / time,
+           tp->ticks / time / ap->tick_rate);
+    printf("ball updates: %ld (%.0f/sec, %s kernel, %s tick)\n",
+           tp->ball_ticks, tp->ball_ticks / time, ball_kernel_name(),
+           preset_name(preset_match(BORDER, ap->cols - BORDER - 1,
+                                    ap->lines - BORDER - 1, BORDER,
+                                    ap->balls, 1)));
+
+    return;
+}
@@ -0,0 +1,37 @@
+/*
+ * ==========================
+ *   FILE: ./autoplay.h
+ * ==========================
+ * Purpose: Header file for autoplay.c
+ */
+
+/* INCLUDES */
+#include <stdint.h>
+
+/* STRUCTS */
+struct autoplay {               // settings for every game of a run
+    int lines, cols;            // size of the pretend terminal
+    int balls;                  // balls in play per serve
+    int skill;                  // % chance per tick the paddle moves
+    int predict;                // aim where the ball will meet the paddle
+    int tick_rate;              // ticks in one second of play
+    long max_ticks;             // most ticks any one game may run
+    uint64_t seed;              // seed for the whole run
+};
+
+struct autoplay_totals {        // what a run of games added up to
+    long games, capped;         // games played, and how many hit the cap
+    long ticks, ball_ticks;     // ticks, and ball updates, over all games
+    long secs, longest;         // seconds of play, in total and at most
+    long hits, served;          // paddle returns, and balls put in play
+};
+
+/* OPAQUE STRUCTS */
+struct pparena;
+
+/* EXTERNAL INTERFACE */
+long autoplay_game(const struct autoplay *, int, struct pparena *,
+                   struct autoplay_totals *);
+void autoplay_merge(struct autoplay_totals *, const struct autoplay_totals *);
+void autoplay_report(const struct autoplay *, const struct autoplay_totals *,
+                     double);
\ No newline at end of file
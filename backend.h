@@ -0,0 +1,34 @@
+/*
+ * ==========================
+ *   FILE: ./backend.h
+ * ==========================
+ * Purpose: Interface between the frame (frame.c) and whatever actually
+ *          puts the cells on a screen.
+ *
+ * Note: A backend only ever sees cells that changed. put() is called for
+ *       each of them, then update() once to make the frame visible.
+ * Note: resize() is called when the frame changes size (frame_resize()).
+ *       The screen is to be cleared then, as the frame is.
+ */
+
+/* CELLS */
+#define CELL_STANDOUT 0x100                 // reverse-video flag
+#define CELL_CHAR(cell) ((cell) & 0xff)     // the char in a cell
+
+/* BACKEND OPERATIONS */
+struct backend {
+    const char * name;
+    void (*open)(int, int, int);            // lines, columns, and
+                                            // non-zero to count bytes
+    void (*put)(int, int, unsigned short);  // row, column, cell
+    long (*update)();                       // bytes written, 0 if unknown
+    void (*resize)(int, int);               // lines, columns; clears it
+    void (*close)();
+};
+
+/* AVAILABLE BACKENDS */
+extern const struct backend curses_backend;     // curses_backend.c
+extern const struct backend ansi_backend;       // ansi_backend.c
+extern const struct backend null_backend;       // frame.c; draws nothing
+extern const struct backend render_backend;     // render.c; another one,
+                                                // from a thread of its own
\ No newline at end of file
@@ -2,128 +2,723 @@
  * ==========================
  *   FILE: ./ball.c
  * ==========================
- * Purpose: Create and operate a ball object for a game of pong
+ * Purpose: Create and operate the balls for a game of pong
  *
  * Internal functions:
- *      ball_init()         -- (re-)initializes balls vars
- *      draw_ball()         -- draws the ball in a new position
+ *      ball_init()         -- (re-)initializes one ball's vars
+ *      ball_remove()       -- takes a ball out of play
+ *      collide()           -- turns round balls that run into each other
+ *      deflect()           -- sends a ball back off a paddle
+ *      face_in()           -- turns balls next to a wall away from it
+ *      pick_tick()         -- chooses the preset's tick, or the generic one
+ *      tick_in()           -- one whole tick, for walls and balls given
+ *      meet_paddles()      -- checks the balls on a paddle's wall
+ *      generic_tick()      -- tick_in() for any court, read from it
+ *      classic_tick() ...  -- tick_in() for each preset, as constants
+ *      arrival()           -- ticks until a ball reaches the paddle's column
+ *      fold()              -- where a ball will be on one axis, off the walls
+ *      turn_lo()           -- where a ball turns round off the low wall
+ *      crossing()          -- ticks until a ball leaves its cell on one axis
  *      rand_number()       -- generates random number between a min and max
+ *      rand_speed()        -- generates random speed
  *      start_dir()         -- generates random starting direction
  *
  * Interface:
- *      new_ball()          -- allocates memory for a new ball
- *      ball_move()         -- move ball if enough time has passed
- *      bounce_or_lose()    -- detect when ball hits walls/paddle or misses
- *      serve()             -- inits new values for a ball and draws it
+ *      new_ball()          -- allocates memory for a set of balls
+ *      ball_move()         -- move balls if enough time has passed
+ *      ball_tick()         -- move the balls, then bounce_or_lose()
+ *      ball_tick_name()    -- which tick the balls take
+ *      ball_draw()         -- redraws the balls where they are now
+ *      ball_relayout()     -- moves the balls onto a resized court
+ *      bounce_or_lose()    -- detect when balls hit walls/paddle or miss
+ *      serve()             -- puts a fresh set of balls into play
  *      get_balls_left()    -- returns the number of balls (lives) left
+ *      get_balls_in_play() -- returns the number of balls on the court
+ *      get_ball_y()        -- returns the row of the ball nearest the paddle
+ *      get_ball_intercept()-- the row the next ball will meet the paddle on
+ *      ball_next_move()    -- ticks until the balls may do anything new
+ *      get_ball_hits()     -- how many times the paddles sent a ball back
+ *      get_balls_served()  -- how many balls have been put in play
+ *      ball_use_delay()    -- sets the slowest speed balls are given
+ *      get_ball_positions()-- where every ball in play is
+ *      ball_save()         -- copies the balls into a snapshot
+ *      ball_load()         -- sets the balls back to a snapshot
  *
+ * Notes:
+ *      Moving and drawing are separate. ball_move() and bounce_or_lose()
+ *      only change the balls' state, once per simulation tick; ball_draw()
+ *      is called once per frame and puts the balls wherever they are by
+ *      then.
+ *
+ *      One ppball holds every ball in play, as a structure of arrays: all
+ *      the x positions together, all the y positions together, and so on.
+ *      The arrays come from the same allocation as the struct, in the
+ *      game's arena (see arena.c), and the balls in play are always the
+ *      first 'count' entries, so a tick is a single pass over contiguous
+ *      memory however many balls there are. A ball that goes out of play
+ *      is replaced by the last one in the arrays.
+ *
+ *      Each ball's position and velocity are 16.16 fixed point (see
+ *      ball_kernel.h): where it is within its cell, and how much of a cell
+ *      it goes each tick on each axis, up to a whole one. So any speed and
+ *      any angle can be had, with nothing but int adds and shifts, and
+ *      the same on every CPU. The cell it is in (x_pos, y_pos) is what the
+ *      walls, the paddle, the grid and the screen go by.
+ *
+ *      Where a ball hits a paddle decides which way it goes back: straight
+ *      back off the middle, and up to 45 degrees off either end, faster or
+ *      slower at random.
+ *
+ *      The per-ball arithmetic of moving and bouncing is done by the
+ *      kernels in ball_kernel.c, one axis at a time, with SIMD if the CPU
+ *      has it. What is left here is the paddle: only the balls the kernel
+ *      reports on the right-hand wall are looked at one by one.
+ *
+ *      Balls bounce off each other as well as the walls. Two balls that
+ *      come to share a spot each turn round on any axis where they were
+ *      heading opposite ways, just as they would off a wall there. The
+ *      pairs are found with a uniform grid (grid.c), kept up to date as
+ *      the balls move, so only balls that moved this tick, and only
+ *      against the balls near them, are ever compared.
+ *
+ *      Every ball slot has its own random number stream (see rng.c), all
+ *      seeded from the one seed given to new_ball(), and a stream stays
+ *      with its ball when it changes slot. So the same seed always serves
+ *      the same balls and gives them the same bounces off the paddle,
+ *      however they are later shuffled by ball_remove().
+ *
+ *      A game's tick (ball_tick()) is ball_move() and bounce_or_lose() in
+ *      one, written once, in tick_in(), with the walls, the balls per
+ *      serve and the players as arguments. For each preset (preset.h)
+ *      it is compiled again with those as constants, so the bounds are
+ *      folded in, no edge has to be fetched from the court, and for one
+ *      ball the collisions and the second paddle drop out altogether.
+ *      Every other game runs the same code with them read at run time.
+ *      With a few balls, each ball is stepped and bounced on both axes in
+ *      one pass, with no calls; with many, the SIMD kernels do it. Either
+ *      way the results are exactly those of ball_move() then
+ *      bounce_or_lose().
+ *
+ *      Each serve() puts 'per_serve' balls on the court and costs one life.
+ *      The round is lost once every one of them has gone past the paddle.
+ *      With one ball per serve this is the classic game.
  */
 
 /* INCLUDES */
-#include <curses.h>
-#include <signal.h>
+#include <limits.h>
+#include <stdio.h>
 #include <stdlib.h>
-#include <unistd.h>
+#include <string.h>
+#include "arena.h"
 #include "clock.h"
+#include "frame.h"
 #include "paddle.h"
 #include "court.h"
 #include "ball.h"
+#include "ball_kernel.h"
+#include "grid.h"
 #include "pong.h"
+#include "preset.h"
+#include "rng.h"
 
 /* CONSTANTS */
 #define DFL_SYMBOL  'O'
-#define MAX_DELAY   10
+#define MIN_SPEED   (FIX_ONE / max_delay)   // slowest off a paddle, up
+                                            // or down
+#define BALL_ARRAYS 8       // int arrays kept per ball, see struct ppball
+#define SAVED_ARRAYS 6      // of those, the ones in a snapshot: not 'drawn'
+#define FUSE_MAX 16         // most balls per serve stepped in one pass
+
+#if defined(__GNUC__)
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define ALWAYS_INLINE inline
+#endif
 
 /* BALL STRUCT */
 struct ppball {
-    int remain,             // number of balls left
-        x_pos, y_pos,       // positions
-        x_dir, y_dir,       // directions
-        x_delay, y_delay,   // ticker count
-        x_count, y_count;   // delay
+    int remain;             // number of balls (lives) left
+    int per_serve;          // balls put in play by each serve
+    int count;              // balls in play now
+    int drawn;              // balls shown on screen
+    int * x_pos, * y_pos,       // the cells the balls are in
+        * x_fix, * y_fix,       // positions, fixed point
+        * x_vel, * y_vel,       // cells a tick, fixed point, signed
+        * x_drawn, * y_drawn;   // where each shown ball is on screen
     char symbol;            // ball representation
+    struct ppcourt * court; // the court the balls are in
+    struct ppgrid * grid;   // where the balls are, for collisions
+    struct pprng * rng;     // each ball's random number stream
+    int (*tick)(struct ppball *, struct pppaddle *, struct pppaddle *);
+    int preset;             // the preset 'tick' is for, or -1 if generic
+    long hits, served;      // paddle returns, and balls put in play
 };
 
+/* LOCAL VARIABLES -- SETTINGS */
+static int max_delay = MAX_DELAY;   // see ball_use_delay()
+
 /*
  * ===========================================================================
  * INTERNAL FUNCTIONS
  * ===========================================================================
  */
-static void ball_init(struct ppball *);
-static void draw_ball(struct ppball *);
-static int start_dir();
-static int rand_number(int, int);
+static void ball_init(struct ppball *, int);
+static void ball_remove(struct ppball *, int);
+static void collide(struct ppball *);
+static void deflect(struct ppball *, int, struct pppaddle *);
+static void face_in(struct ppball *);
+static void pick_tick(struct ppball *);
+static ALWAYS_INLINE int tick_in(struct ppball *, struct pppaddle *,
+                                 struct pppaddle *, int, int, int, int, int,
+                                 int);
+static ALWAYS_INLINE int meet_paddles(struct ppball *, struct pppaddle *,
+                                      struct pppaddle *, int, int, int, int,
+                                      int);
+static int generic_tick(struct ppball *, struct pppaddle *,
+                        struct pppaddle *);
+static int arrival(struct ppball *, int, int, int);
+static int fold(int, int, int, int, int);
+static int64_t turn_lo(int, int, int);
+static int crossing(int, int);
+static int start_dir(struct pprng *);
+static int rand_number(struct pprng *, int, int);
+static int rand_speed(struct pprng *, int);
 
 /*
  *  ball_init()
- *  Purpose: Initialize a ball struct's values
- *    Input: bp, pointer to the ball struct to initialize
+ *  Purpose: Initialize one ball's values
+ *    Input: bp, pointer to the balls
+ *           i, which ball to initialize
  *     Note: For the position values, +/- 1 keeps the ball within the court
  *           boundaries. The functions to retrieve the edge values return
  *           the column or row the borders are drawn; the ball should start
  *           *within* those boundaries.
- *     Note: The x_count and x_delay start with a random value between 1 and
- *           half the MAX_DELAY. A default terminal window will often be
- *           wider than it is tall, so the default will have a faster
- *           horizontal speed.
+ *     Note: The ball starts in the middle of its cell.
+ *     Note: The horizontal speed is at least a cell every half max_delay
+ *           ticks, the vertical one every max_delay. A default terminal
+ *           window will often be wider than it is tall, so the default
+ *           will have a faster horizontal speed.
  */
-void ball_init(struct ppball * bp)
+void ball_init(struct ppball * bp, int i)
 {
+    struct pprng * rp = &bp->rng[i];
+
     // positions
-    bp->y_pos = rand_number(get_top_edge() + 1, get_bot_edge() - 1);
-    bp->x_pos = rand_number(get_left_edge() + 1, get_right_edge() - 1);
+    bp->y_pos[i] = rand_number(rp, get_top_edge(bp->court) + 1,
+                               get_bot_edge(bp->court) - 1);
+    bp->x_pos[i] = rand_number(rp, get_left_edge(bp->court) + 1,
+                               get_right_edge(bp->court) - 1);
+    bp->y_fix[i] = (bp->y_pos[i] << FIX_SHIFT) + FIX_HALF;
+    bp->x_fix[i] = (bp->x_pos[i] << FIX_SHIFT) + FIX_HALF;
 
-    // directions
-    bp->y_dir = start_dir();
-    bp->x_dir = start_dir();
+    // directions, then speeds
+    bp->y_vel[i] = start_dir(rp);
+    bp->x_vel[i] = start_dir(rp);
+    bp->y_vel[i] *= rand_speed(rp, max_delay);
+    bp->x_vel[i] *= rand_speed(rp, (max_delay / 2));
 
-    // delay
-    bp->y_count = bp->y_delay = rand_number(1, MAX_DELAY);
-    bp->x_count = bp->x_delay = rand_number(1, (MAX_DELAY / 2));
+    return;
+}
 
-    // assign symbol ('O' by default)
-    bp->symbol = DFL_SYMBOL;
+/*
+ *  ball_remove()
+ *  Purpose: Take a ball out of play
+ *    Input: bp, pointer to the balls
+ *           i, which ball to remove
+ *   Method: Move the last ball in play into slot i, so the balls in play
+ *           stay packed at the front of the arrays. Its old spot on screen
+ *           is blanked by the next ball_draw(). The grid follows the move.
+ *     Note: The random streams are swapped rather than copied, so no two
+ *           slots ever share one.
+ */
+void ball_remove(struct ppball * bp, int i)
+{
+    int last = --bp->count;
+    struct pprng rng = bp->rng[i];
 
-    // lose one ball (life) every initialization
-    bp->remain--;
+    grid_move(bp->grid, last, i);
+
+    bp->x_pos[i] = bp->x_pos[last];
+    bp->y_pos[i] = bp->y_pos[last];
+    bp->x_fix[i] = bp->x_fix[last];
+    bp->y_fix[i] = bp->y_fix[last];
+    bp->x_vel[i] = bp->x_vel[last];
+    bp->y_vel[i] = bp->y_vel[last];
+    bp->rng[i] = bp->rng[last];
+    bp->rng[last] = rng;
+
+    return;
+}
+
+/*
+ *  collide()
+ *  Purpose: Bounce balls that have run into each other
+ *    Input: bp, pointer to the balls
+ *   Method: Update the grid with the balls' new positions, then, for each
+ *           pair of balls it finds on one spot, reverse both balls on
+ *           each axis where their velocities have different signs. Balls
+ *           heading the same way on an axis carry on.
+ *     Note: With one ball in play there is nothing to hit, and the grid
+ *           is left alone; the count only goes up again at a serve,
+ *           which clears it.
+ */
+void collide(struct ppball * bp)
+{
+    int a, b;
+
+    if(bp->count < 2)
+        return;
+
+    if(grid_update(bp->grid, bp->x_pos, bp->y_pos, bp->count) == 0)
+        return;
+
+    while( grid_next_pair(bp->grid, &a, &b) )
+    {
+        if( (bp->x_vel[a] ^ bp->x_vel[b]) < 0 )
+        {
+            bp->x_vel[a] = -bp->x_vel[a];
+            bp->x_vel[b] = -bp->x_vel[b];
+        }
+
+        if( (bp->y_vel[a] ^ bp->y_vel[b]) < 0 )
+        {
+            bp->y_vel[a] = -bp->y_vel[a];
+            bp->y_vel[b] = -bp->y_vel[b];
+        }
+    }
 
     return;
 }
 
 /*
- *  draw_ball()
- *  Purpose: Print a ball at the current location.
- *    Input: bp, pointer to the ball struct to draw
+ *  deflect()
+ *  Purpose: Send a ball that hit a paddle back into the court
+ *    Input: bp, pointer to the balls
+ *           i, the ball, on the paddle's wall and already turned round
+ *           (see bounce_or_lose())
+ *           pp, the paddle it hit
+ *   Method: A new horizontal speed is drawn, as at a serve. The vertical
+ *           velocity is that speed, scaled by how far from the middle of
+ *           the paddle it hit: none in the middle, all of it (45 degrees)
+ *           at either end, and down off the bottom half. A ball that
+ *           would go back (near) flat keeps going up or down as it was,
+ *           at MIN_SPEED, so a rally can't get stuck on one row.
+ *     Note: A one-row paddle has no ends to angle off, so only the speed
+ *           changes.
+ *     Note: The ball is put on the edge of its cell nearest the court, so
+ *           it leaves the wall on the next tick and meets the paddle once.
+ */
+void deflect(struct ppball * bp, int i, struct pppaddle * pp)
+{
+    int top = get_pad_top(pp), span = get_pad_bot(pp) - top;
+    int speed = rand_speed(&bp->rng[i], (max_delay / 2));
+    int off = (2 * (bp->y_pos[i] - top)) - span;    // -span to span
+    int vy;
+
+    bp->hits++;
+    if(bp->x_vel[i] < 0)                            // right-hand paddle
+    {
+        bp->x_vel[i] = -speed;
+        bp->x_fix[i] = bp->x_pos[i] << FIX_SHIFT;
+    }
+    else
+    {
+        bp->x_vel[i] = speed;
+        bp->x_fix[i] = ((bp->x_pos[i] + 1) << FIX_SHIFT) - 1;
+    }
+
+    if(span == 0)
+        return;
+
+    vy = (int) (((int64_t) speed * off) / span);
+    if(vy > -MIN_SPEED && vy < MIN_SPEED)
+        vy = (bp->y_vel[i] < 0) ? -MIN_SPEED : MIN_SPEED;
+    bp->y_vel[i] = vy;
+
+    return;
+}
+
+/*
+ *  face_in()
+ *  Purpose: Turn every ball next to a wall away from it, as
+ *           bounce_or_lose() would have
+ *    Input: bp, pointer to the balls
+ *     Note: For balls that were just put where they are (serve(),
+ *           ball_relayout()). Every other ball next to a wall was turned
+ *           by the last bounce_or_lose(); one that wasn't could step
+ *           into the wall before it is next checked.
+ */
+void face_in(struct ppball * bp)
+{
+    int at_hi;
+
+    ball_kernel_bounce(bp->y_pos, bp->y_vel, bp->count,
+                       get_top_edge(bp->court) + 1,
+                       get_bot_edge(bp->court) - 1, &at_hi);
+    ball_kernel_bounce(bp->x_pos, bp->x_vel, bp->count,
+                       get_left_edge(bp->court) + 1,
+                       get_right_edge(bp->court) - 1, &at_hi);
+
+    return;
+}
+
+/*
+ *  tick_in()
+ *  Purpose: Move the balls one tick and bounce them, as ball_move() then
+ *           bounce_or_lose() would
+ *    Input: bp, pointer to the balls
+ *           pp, the right-hand paddle
+ *           left_pp, the left-hand paddle, or NULL if it is a wall
+ *           top, right, bot, left, the rows and columns of the walls
+ *           per_serve, at most this many balls are in play
+ *           players, 2 if there is a left-hand paddle, otherwise 1
+ *   Return: as bounce_or_lose()
+ *   Method: Up to FUSE_MAX balls per serve, each ball is moved down and
+ *           across, then (after any collisions) bounced off the walls, in
+ *           one loop each with no calls; beyond that, ball_kernel_step()
+ *           and ball_kernel_bounce() do each axis. Then the balls on a
+ *           paddle's wall are checked against it (see meet_paddles()).
+ *     Note: Always inlined, so each preset's tick gets its own copy with
+ *           the arguments as constants.
+ */
+ALWAYS_INLINE int tick_in(struct ppball * bp, struct pppaddle * pp,
+                          struct pppaddle * left_pp, int top, int right,
+                          int bot, int left, int per_serve, int players)
+{
+    int n = bp->count, return_val = NO_CONTACT;
+    int i, y_walls = 0, walls = 0, at_right = 0, at_bot;
+
+    if(n == 0)                                          // nothing in play
+        return NO_CONTACT;
+
+    if(per_serve <= FUSE_MAX)
+        for(i = 0; i < n; i++)
+        {
+            bp->y_fix[i] += bp->y_vel[i];
+            bp->y_pos[i] = bp->y_fix[i] >> FIX_SHIFT;
+            bp->x_fix[i] += bp->x_vel[i];
+            bp->x_pos[i] = bp->x_fix[i] >> FIX_SHIFT;
+        }
+    else
+    {
+        ball_kernel_step(bp->y_fix, bp->y_pos, bp->y_vel, n);
+        ball_kernel_step(bp->x_fix, bp->x_pos, bp->x_vel, n);
+    }
+
+    if(per_serve > 1)
+        collide(bp);
+
+    if(per_serve <= FUSE_MAX)
+        for(i = 0; i < n; i++)
+        {
+            if(bp->y_pos[i] == top + 1)
+            {
+                if(bp->y_vel[i] < 0)
+                    bp->y_vel[i] = -bp->y_vel[i];
+                y_walls++;
+            }
+            else if(bp->y_pos[i] == bot - 1)
+            {
+                if(bp->y_vel[i] > 0)
+                    bp->y_vel[i] = -bp->y_vel[i];
+                y_walls++;
+            }
+
+            if(bp->x_pos[i] == left + 1)
+            {
+                if(bp->x_vel[i] < 0)
+                    bp->x_vel[i] = -bp->x_vel[i];
+                walls++;
+            }
+            else if(bp->x_pos[i] == right - 1)
+            {
+                if(bp->x_vel[i] > 0)
+                    bp->x_vel[i] = -bp->x_vel[i];
+                walls++;
+                at_right++;
+            }
+        }
+    else
+    {
+        y_walls = ball_kernel_bounce(bp->y_pos, bp->y_vel, n, top + 1,
+                                     bot - 1, &at_bot);
+        walls = ball_kernel_bounce(bp->x_pos, bp->x_vel, n, left + 1,
+                                   right - 1, &at_right);
+    }
+
+    if(y_walls > 0)
+        return_val = BOUNCE;
+
+    return meet_paddles(bp, pp, (players == 2) ? left_pp : NULL, left + 1,
+                        right - 1, walls, at_right, return_val);
+}
+
+/*
+ *  meet_paddles()
+ *  Purpose: Check the balls on a paddle's wall against the paddle
+ *    Input: bp, pointer to the balls, already bounced off the walls
+ *           pp, left_pp, the right-hand and left-hand paddles; left_pp is
+ *           NULL if there is a wall on the left
+ *           left, right, the columns just inside the walls
+ *           walls, how many balls were on the left or right walls
+ *           at_right, how many of them were on the right
+ *           return_val, BOUNCE if any ball has bounced already, otherwise
+ *           NO_CONTACT
+ *   Return: as bounce_or_lose()
+ *     Note: A ball that misses is removed straight away, and the ball
+ *           moved into its slot is checked next, so 'i' only advances
+ *           past balls that are still in play. Each ball on the right is
+ *           seen exactly once, so the search stops after the last one.
+ *     Note: With a left paddle (two players), the balls on the left are
+ *           checked against it the same way. The kernel counts every
+ *           ball on either wall, so those on the left are the difference.
+ */
+ALWAYS_INLINE int meet_paddles(struct ppball * bp, struct pppaddle * pp,
+                               struct pppaddle * left_pp, int left,
+                               int right, int walls, int at_right,
+                               int return_val)
+{
+    int i = 0, at_left = (left_pp != NULL) ? walls - at_right : 0;
+    struct pppaddle * side;
+
+    if(walls > at_right + at_left)
+        return_val = BOUNCE;
+
+    while( (at_right > 0 || at_left > 0) && i < bp->count )
+    {
+        if ( bp->x_pos[i] == right )                    // right
+        {
+            at_right--;
+            side = pp;
+        }
+        else if ( at_left > 0 && bp->x_pos[i] == left ) // left
+        {
+            at_left--;
+            side = left_pp;
+        }
+        else
+        {
+            i++;
+            continue;
+        }
+
+        if( paddle_contact(bp->y_pos[i], side) == CONTACT ) // hit paddle
+        {
+            deflect(bp, i, side);                       // angle off it
+            return_val = BOUNCE;
+        }
+        else
+        {
+            ball_remove(bp, i);                         // out of play
+            continue;
+        }
+
+        i++;
+    }
+
+    return (bp->count == 0) ? LOSE : return_val;
+}
+
+/*
+ *  generic_tick(), classic_tick() and the other presets' ticks
+ *  Purpose: tick_in(), for any court, or just for one preset's
+ *    Input: bp, pp, left_pp, as for ball_tick()
+ *     Note: The presets' ticks are made from PRESETS in preset.h, and are
+ *           listed in the same order in preset_ticks[].
+ */
+int generic_tick(struct ppball * bp, struct pppaddle * pp,
+                 struct pppaddle * left_pp)
+{
+    return tick_in(bp, pp, left_pp, get_top_edge(bp->court),
+                   get_right_edge(bp->court), get_bot_edge(bp->court),
+                   get_left_edge(bp->court), bp->per_serve,
+                   (left_pp != NULL) ? 2 : 1);
+}
+
+#define PRESET_TICK(name, lines, cols, balls, players)                      \
+    static int name##_tick(struct ppball * bp, struct pppaddle * pp,       \
+                           struct pppaddle * left_pp)                      \
+    {                                                                       \
+        return tick_in(bp, pp, left_pp, BORDER, (cols) - BORDER - 1,        \
+                       (lines) - BORDER - 1, BORDER, (balls), (players));   \
+    }
+PRESETS(PRESET_TICK)
+
+#define PRESET_TICK_ENTRY(name, lines, cols, balls, players) name##_tick,
+static int (* const preset_ticks[])(struct ppball *, struct pppaddle *,
+                                    struct pppaddle *) = {
+    PRESETS(PRESET_TICK_ENTRY)
+};
+
+/*
+ *  pick_tick()
+ *  Purpose: Give the balls the tick compiled for their preset, if their
+ *           court and balls are one, or else the generic tick
+ *    Input: bp, pointer to the balls
+ *     Note: For when the balls are made, and whenever the court moves.
  */
-void draw_ball(struct ppball * bp)
+void pick_tick(struct ppball * bp)
 {
-    mvaddch(bp->y_pos, bp->x_pos, bp->symbol);  //print new ball
-    park_cursor();
-    refresh();
+    bp->preset = preset_match(get_top_edge(bp->court),
+                              get_right_edge(bp->court),
+                              get_bot_edge(bp->court),
+                              get_left_edge(bp->court), bp->per_serve,
+                              get_paddles(bp->court));
+    bp->tick = (bp->preset >= 0) ? preset_ticks[bp->preset] : generic_tick;
 
     return;
 }
 
+/*
+ *  arrival()
+ *  Purpose: Work out how soon a ball will reach the paddle's column
+ *    Input: bp, pointer to the balls
+ *           i, the ball
+ *           left, right, the columns just inside the two side walls
+ *   Return: the ticks until it is in column 'right', 0 if it is there now
+ *           (even just sent back: until it has left, moving the paddle
+ *           off it loses it, see bounce_or_lose())
+ *   Method: A ball heading right has that far to go at its speed. One
+ *           heading left goes to where it will turn off the left wall (see
+ *           turn_lo()) and comes back, so it has that far again. The
+ *           horizontal speed is never 0.
+ *     Note: With two players the left paddle sends a ball back at a new
+ *           speed, so for one heading left this is only a guess.
+ */
+int arrival(struct ppball * bp, int i, int left, int right)
+{
+    int64_t goal = (int64_t) right << FIX_SHIFT, dist;
+    int speed = abs(bp->x_vel[i]);
+
+    if(bp->x_pos[i] >= right)
+        return 0;
+    else if(bp->x_vel[i] > 0)
+        dist = goal - bp->x_fix[i];
+    else
+    {
+        int64_t turn = turn_lo(bp->x_fix[i], speed, left);
+
+        dist = (bp->x_fix[i] - turn) + (goal - turn);
+    }
+
+    return (int) ((dist + speed - 1) / speed);
+}
+
+/*
+ *  fold()
+ *  Purpose: Work out which cell a ball will be in on one axis after some
+ *           ticks, bouncing off the walls on the way
+ *    Input: fix, vel, the ball's position and velocity on the axis
+ *           t, the ticks ahead
+ *           lo, hi, the cells just inside the two walls
+ *   Return: the cell, from lo to hi
+ *   Method: Turning round only flips the sign of the velocity, so the ball
+ *           is only ever where it is now give or take a whole number of
+ *           ticks' travel, and it turns at the same two positions every
+ *           time (see turn_lo()): the first of those steps into hi, and
+ *           the last before lo. Between the two its path is a straight
+ *           line folded back and forth: the position it would have with no
+ *           walls, taken modulo twice the distance between them, and
+ *           mirrored if it is on the way back. So any number of bounces
+ *           costs the same few operations, and the answer is exact.
+ */
+int fold(int fix, int vel, int t, int lo, int hi)
+{
+    int speed = abs(vel);
+    int64_t a, b, u;
+
+    if(speed == 0)
+        return fix >> FIX_SHIFT;
+
+    a = turn_lo(fix, speed, lo);
+    b = (int64_t) hi << FIX_SHIFT;
+    b += (((fix - b) % speed) + speed) % speed;     // first step into hi
+    u = (fix + ((int64_t) vel * t) - a) % (2 * (b - a));
+    if(u < 0)
+        u += 2 * (b - a);
+    if(u > b - a)
+        u = (2 * (b - a)) - u;                      // on the way back
+
+    return (int) ((a + u) >> FIX_SHIFT);
+}
+
+/*
+ *  turn_lo()
+ *  Purpose: Work out where a ball will turn round off the low wall
+ *    Input: fix, the ball's position on the axis
+ *           speed, how far it goes a tick on it, more than 0
+ *           lo, the cell just inside the wall
+ *   Return: the position, fixed point: the last one before the ball
+ *           leaves cell lo+1 that is a whole number of ticks from 'fix'
+ */
+int64_t turn_lo(int fix, int speed, int lo)
+{
+    int64_t edge = ((int64_t) (lo + 1) << FIX_SHIFT) - 1;
+
+    return edge - ((((edge - fix) % speed) + speed) % speed);
+}
+
+/*
+ *  crossing()
+ *  Purpose: Work out how soon a ball will move into another cell along
+ *           one axis
+ *    Input: fix, the ball's position on the axis
+ *           vel, how far it goes a tick on it, signed
+ *   Return: the ticks until it is in another cell, counting the tick it
+ *           gets there on, or INT_MAX if it isn't moving on this axis
+ */
+int crossing(int fix, int vel)
+{
+    int start = fix & ~(FIX_ONE - 1);       // where its cell starts
+
+    if(vel > 0)
+        return ((start + FIX_ONE - fix) + vel - 1) / vel;
+    else if(vel < 0)
+        return ((fix - start) / -vel) + 1;
+
+    return INT_MAX;
+}
+
 /*
  *  random_number()
  *  Purpose: generate a random number between min and max
- *    Input: min, the lowest possible value
+ *    Input: rp, the ball's random number stream
+ *           min, the lowest possible value
  *           max, the highest possible value
  *   Return: the randomly generated number
  */
-int rand_number(int min, int max)
+int rand_number(struct pprng * rp, int min, int max)
+{
+    return rng_range(rp, min, max);
+}
+
+/*
+ *  rand_speed()
+ *  Purpose: Randomly pick a speed
+ *    Input: rp, the ball's random number stream
+ *           slowest, the most ticks a cell may take
+ *   Return: a speed in cells a tick, fixed point, from 1/slowest of a cell
+ *           up to a whole one
+ *   Method: Draw how many ticks a cell takes, to 1/FIX_ONE of a tick, and
+ *           turn it round. The speeds come out spread as the old whole
+ *           delays of 1 to slowest were, but any of them can come up.
+ */
+int rand_speed(struct pprng * rp, int slowest)
 {
-    return ( (rand() % (max - min)) + min );
+    int ticks = rand_number(rp, FIX_ONE, slowest * FIX_ONE);
+
+    return (int) (((int64_t) FIX_ONE << FIX_SHIFT) / ticks);
 }
 
 /*
  *  start_dir()
  *  Purpose: Randomly pick starting direction
+ *    Input: rp, the ball's random number stream
  *   Return: Either -1 or 1
  */
-int start_dir()
+int start_dir(struct pprng * rp)
 {
-    if( (rand() % 2) == 0)
+    if( (rng_next(rp) & 1) == 0)
         return -1;
     else
         return 1;
@@ -137,13 +732,29 @@ int start_dir()
 
 /*
  *  new_ball()
- *  Purpose: allocate memory for a new ball struct
- *   Return: a pointer to the struct allocated, NULL if malloc
- *           fails.
+ *  Purpose: allocate memory for a new set of balls
+ *    Input: arena, to allocate from (see arena.c), or NULL for malloc()
+ *           court, the court the balls play in
+ *           per_serve, how many balls each serve puts in play
+ *           seed, seeds every ball's random number stream (ball slot i
+ *           gets stream i)
+ *   Return: a pointer to the struct allocated
+ *     Note: The struct and all its arrays are one allocation. The random
+ *           streams come right after the struct, then the int arrays,
+ *           each 'per_serve' long. The collision grid is allocated
+ *           separately, from the same arena.
+ *    Error: If malloc fails, close curses, print a message and exit.
  */
-struct ppball * new_ball()
+struct ppball * new_ball(struct pparena * arena, struct ppcourt * court,
+                         int per_serve, uint64_t seed)
 {
-    struct ppball * ball = malloc(sizeof(struct ppball));
+    struct ppball * ball;
+    int * p;
+    int i;
+
+    ball = arena_alloc(arena, sizeof(struct ppball) +
+                              (per_serve * sizeof(struct pprng)) +
+                              (BALL_ARRAYS * per_serve * sizeof(int)));
 
     if(ball == NULL)
     {
@@ -155,61 +766,131 @@ struct ppball * new_ball()
         exit(1);
     }
 
+    ball->rng = (struct pprng *) (ball + 1);
+    for(i = 0; i < per_serve; i++)
+        rng_seed(&ball->rng[i], seed, i);
+
+    p = (int *) (ball->rng + per_serve);
+    ball->x_pos = p;    p += per_serve;
+    ball->y_pos = p;    p += per_serve;
+    ball->x_fix = p;    p += per_serve;
+    ball->y_fix = p;    p += per_serve;
+    ball->x_vel = p;    p += per_serve;
+    ball->y_vel = p;    p += per_serve;
+    ball->x_drawn = p;  p += per_serve;
+    ball->y_drawn = p;
+
     ball->remain = NUM_BALLS;       //start with NUM_BALLS remaining
+    ball->per_serve = per_serve;
+    ball->count = 0;
+    ball->drawn = 0;
+    ball->symbol = DFL_SYMBOL;      // 'O' by default
+    ball->court = court;
+    ball->grid = new_grid(arena, court, per_serve);
+    ball->hits = 0;
+    ball->served = 0;
+    pick_tick(ball);
     return ball;
 }
 
 /*
  *  ball_move()
- *  Purpose: Move ball if enough time has passed
- *    Input: bp, pointer to a ball struct
- *   Method: The ball has a given delay and a count to keep track when to
- *           refresh next. If the counter reaches 0, that indicates it is
- *           time to move the x or y position of the ball. After updating
- *           the struct values, the counter is reset to the delay and will
- *           move again after the next delay period.
- *     Note: Most of the main logic in this function was copied, unchanged,
- *           from the bounce2d.c file on the course site.
+ *  Purpose: Move the balls one tick
+ *    Input: bp, pointer to the balls
+ *   Method: Every ball's velocity is added to its position, and the cell
+ *           it is in is taken from that: ball_kernel_step() does this for
+ *           every ball in play, vertical then horizontal. A ball moves a
+ *           fraction of a cell most ticks, and into the next cell on the
+ *           ticks that add up to one. Then any balls that ran into each
+ *           other are bounced.
+ *     Note: This used to count down a delay per axis, as in the bounce2d.c
+ *           file on the course site, which only allowed a speed of one
+ *           cell every whole number of ticks.
  */
 void ball_move(struct ppball * bp)
 {
-    int moved = 0 ;
-    int y_cur = bp->y_pos;              // old spot
-    int x_cur = bp->x_pos;              // old spot
+    ball_kernel_step(bp->y_fix, bp->y_pos, bp->y_vel, bp->count);  // down
+    ball_kernel_step(bp->x_fix, bp->x_pos, bp->x_vel, bp->count);  // across
+    collide(bp);                                        // ball on ball
+    return;
+}
 
-    // Check vertical counters
-    if ( bp->y_delay > 0 && --bp->y_count == 0 )
-    {
-        bp->y_pos += bp->y_dir;         // move ball
-        bp->y_count = bp->y_delay;      // reset counter
-        moved = 1;
-    }
+/*
+ *  ball_draw()
+ *  Purpose: Show the balls at their current positions
+ *    Input: bp, pointer to the balls
+ *   Method: Erase every spot a ball was shown at last frame, then print
+ *           each ball in play where it is now, and remember those spots.
+ *           The frame only counts cells that end up different as damage,
+ *           so a ball that hasn't moved costs nothing, and balls that were
+ *           removed since the last frame are erased along with the rest.
+ *           Erasing puts back the frame's static layer, so a ball that was
+ *           over a wall or a label leaves it as it was.
+ */
+void ball_draw(struct ppball * bp)
+{
+    int i;
 
-    // Check horizontal counters
-    if ( bp->x_delay > 0 && --bp->x_count == 0 )
+    for(i = 0; i < bp->drawn; i++)
+        frame_erase(bp->y_drawn[i], bp->x_drawn[i]);        // remove old
+
+    for(i = 0; i < bp->count; i++)
     {
-        bp->x_pos += bp->x_dir;         // move ball
-        bp->x_count = bp->x_delay;      // reset counter
-        moved = 1;
+        frame_put(bp->y_pos[i], bp->x_pos[i], bp->symbol);  // print new
+        bp->y_drawn[i] = bp->y_pos[i];
+        bp->x_drawn[i] = bp->x_pos[i];
     }
+    bp->drawn = bp->count;
 
-    if (moved)
+    return;
+}
+
+/*
+ *  ball_relayout()
+ *  Purpose: Move the balls onto their court after it was resized
+ *    Input: bp, pointer to the balls
+ *           top, right, bot, left, where the walls were before
+ *           court_relayout()
+ *     Note: Each ball keeps the same fraction of the way across and down
+ *           the inside of the court, and its direction and speed. The
+ *           screen is taken to have been cleared (see frame_resize()), so
+ *           nothing is blanked; the next ball_draw() just prints them.
+ */
+void ball_relayout(struct ppball * bp, int top, int right, int bot,
+                   int left)
+{
+    int new_top = get_top_edge(bp->court), new_bot = get_bot_edge(bp->court);
+    int new_left = get_left_edge(bp->court);
+    int new_right = get_right_edge(bp->court);
+    int i;
+
+    for(i = 0; i < bp->count; i++)
     {
-        mvaddch(y_cur, x_cur, BLANK);   // remove old ball
-        draw_ball(bp);                  // draw new one
+        bp->x_pos[i] = rescale(bp->x_pos[i], left + 1, right - 1,
+                               new_left + 1, new_right - 1);
+        bp->y_pos[i] = rescale(bp->y_pos[i], top + 1, bot - 1,
+                               new_top + 1, new_bot - 1);
+        bp->x_fix[i] = (bp->x_pos[i] << FIX_SHIFT) + FIX_HALF;
+        bp->y_fix[i] = (bp->y_pos[i] << FIX_SHIFT) + FIX_HALF;
     }
 
+    bp->drawn = 0;
+    grid_relayout(bp->grid, bp->court);
+    face_in(bp);
+    pick_tick(bp);
+
     return;
 }
 
 /*
  *  bounce_or_lose()
- *  Purpose: Detect when a ball hits outer walls/paddle, or misses
- *    Input: bp, pointer to a ball struct
+ *  Purpose: Detect when balls hit outer walls/paddle, or miss
+ *    Input: bp, pointer to the balls
  *           pp, pointer to a paddle struct
- *   Return: BOUNCE, if hits walls or paddle
+ *           left, the paddle on the left wall, or NULL if it is a wall
+ *   Return: LOSE, if the last ball in play went out of play
+ *           BOUNCE, if any ball hit the walls or paddle
  *           NO_CONTACT, if no bounce/contact
- *           LOSE, if goes out of play
  *     Note: Values are +/- 1 from the edges to account for where the border
  *           is, and what will cause this function to return BOUNCE of LOSE.
  *           We want to detect when the ball is just inside the borders and
@@ -220,51 +901,70 @@ void ball_move(struct ppball * bp)
  *           from the bounce2d.c file on the course site. Changes were made
  *           for detecting bounces on the right-side of the court (where
  *           the paddle is).
+ *   Method: The walls are done for every ball by ball_kernel_bounce(),
+ *           top/bottom then left/right. That also turns round the balls on
+ *           the right, which is harmless: a ball there either hits the
+ *           paddle, and goes left anyway, or is taken out of play. Then,
+ *           only if the kernel saw any, those balls are found and checked
+ *           against the paddle (see meet_paddles()).
  */
-int bounce_or_lose(struct ppball *bp, struct pppaddle *pp)
+int bounce_or_lose(struct ppball *bp, struct pppaddle *pp,
+                   struct pppaddle *left_pp)
 {
     int return_val = NO_CONTACT;
+    int top = get_top_edge(bp->court) + 1, bot = get_bot_edge(bp->court) - 1;
+    int left = get_left_edge(bp->court) + 1;
+    int right = get_right_edge(bp->court) - 1;
+    int walls, at_bot, at_right;
 
-    if ( bp->y_pos == (get_top_edge() + 1) )            // top
-    {
-        bp->y_dir = 1;
-        return_val = BOUNCE;
-    }
-    else if ( bp->y_pos == (get_bot_edge() - 1) )       // bottom
-    {
-        bp->y_dir = -1;
-        return_val = BOUNCE;
-    }
+    if(bp->count == 0)                                  // nothing in play
+        return NO_CONTACT;
 
-    if ( bp->x_pos == (get_left_edge() + 1) )           // left
-    {
-        bp->x_dir = 1;
+    // top and bottom
+    if( ball_kernel_bounce(bp->y_pos, bp->y_vel, bp->count, top, bot,
+                           &at_bot) > 0 )
         return_val = BOUNCE;
-    }
-    else if ( bp->x_pos == (get_right_edge() - 1) )     // right
-    {
-        if( paddle_contact(bp->y_pos, pp) == CONTACT )  // it hit the paddle
-        {
-            // new, random, delay (keep horizontal movement faster)
-            bp->x_delay = rand_number(1, (MAX_DELAY / 2));
-            bp->y_delay = rand_number(1, MAX_DELAY);
-            bp->x_dir = -1;
-            return_val = BOUNCE;
-        }
-        else
-        {
-            mvaddch(bp->y_pos, bp->x_pos, BLANK);       // remove old ball
-            return_val = LOSE;
-        }
-    }
 
-    return return_val;
+    // left, and which are on the right
+    walls = ball_kernel_bounce(bp->x_pos, bp->x_vel, bp->count, left, right,
+                               &at_right);
+
+    return meet_paddles(bp, pp, left_pp, left, right, walls, at_right,
+                        return_val);
+}
+
+/*
+ *  ball_tick()
+ *  Purpose: Play one tick of the balls: ball_move(), then bounce_or_lose()
+ *    Input: bp, pointer to the balls
+ *           pp, pointer to a paddle struct
+ *           left_pp, the paddle on the left wall, or NULL if it is a wall
+ *   Return: as bounce_or_lose()
+ *     Note: Done by the tick compiled for the balls' preset, if they are
+ *           one, or else the generic tick (see tick_in()). It is the same
+ *           game either way.
+ */
+int ball_tick(struct ppball * bp, struct pppaddle * pp,
+              struct pppaddle * left_pp)
+{
+    return bp->tick(bp, pp, left_pp);
+}
+
+/*
+ *  ball_tick_name()
+ *  Purpose: Say which tick the balls take
+ *    Input: bp, pointer to the balls
+ *   Return: the name of their preset, or "generic"
+ */
+const char * ball_tick_name(struct ppball * bp)
+{
+    return preset_name(bp->preset);
 }
 
 /*
  *  get_balls()
  *  Purpose: Public function to access number of balls remaining
- *    Input: bp, pointer to a ball struct
+ *    Input: bp, pointer to the balls
  *   Return: Number of balls remaining in ball pointed to by 'bp'
  */
 int get_balls_left(struct ppball * bp)
@@ -272,16 +972,259 @@ int get_balls_left(struct ppball * bp)
     return bp->remain;
 }
 
+/*
+ *  get_balls_in_play()
+ *  Purpose: Public function to access number of balls on the court
+ *    Input: bp, pointer to the balls
+ *   Return: how many of this serve's balls are still in play
+ */
+int get_balls_in_play(struct ppball * bp)
+{
+    return bp->count;
+}
+
+/*
+ *  get_ball_y()
+ *  Purpose: Public function to access the row of the most urgent ball
+ *    Input: bp, pointer to the balls
+ *   Return: the vertical position of the ball nearest the paddle that is
+ *           heading towards it; if none are, of the first ball in play.
+ *           -1 if there are no balls in play.
+ */
+int get_ball_y(struct ppball * bp)
+{
+    int i, best = -1;
+
+    for(i = 0; i < bp->count; i++)
+        if(bp->x_vel[i] > 0 && (best == -1 || bp->x_pos[i] > bp->x_pos[best]))
+            best = i;
+
+    if(best == -1)
+        best = 0;
+
+    return (bp->count > 0) ? bp->y_pos[best] : -1;
+}
+
+/*
+ *  get_ball_intercept()
+ *  Purpose: Public function to tell where the next ball will meet the
+ *           paddle, for a computer player
+ *    Input: bp, pointer to the balls
+ *   Return: the row the ball that will reach the paddle's column first
+ *           will be on when it gets there, or -1 if there are no balls in
+ *           play
+ *   Method: For each ball, how many ticks it needs to get there
+ *           (arrival()), and where it will be by then going up and down
+ *           off the top and bottom walls (fold()): a few operations per
+ *           ball, however far away it is, and no ticks are played.
+ *     Note: Balls can still run into one another on the way, so with more
+ *           than one this is where they would meet the paddle if none do.
+ */
+int get_ball_intercept(struct ppball * bp)
+{
+    int left = get_left_edge(bp->court) + 1;
+    int right = get_right_edge(bp->court) - 1;
+    int i, t, best = -1, soonest = 0;
+
+    for(i = 0; i < bp->count; i++)
+        if( (t = arrival(bp, i, left, right)) < soonest || best == -1 )
+        {
+            best = i;
+            soonest = t;
+        }
+
+    if(best == -1)
+        return -1;
+
+    return fold(bp->y_fix[best], bp->y_vel[best], soonest,
+                get_top_edge(bp->court) + 1, get_bot_edge(bp->court) - 1);
+}
+
+/*
+ *  ball_next_move()
+ *  Purpose: Work out how many ticks will go by before the balls do
+ *           anything but move on inside the cells they are in
+ *    Input: bp, pointer to the balls
+ *   Return: how many ticks away the first one that may change anything is:
+ *           1 for the next tick. Every tick before it only moves the balls'
+ *           fixed-point positions, so it makes no difference to how the
+ *           game plays out whether those ticks are run one at a time or
+ *           all at once.
+ *   Method: For one ball, the ticks until it crosses into another cell on
+ *           either axis (crossing()). A ball on a paddle's column is checked
+ *           against the paddle every tick until it leaves, so it may be
+ *           sent back (or lost) on any tick, and with more than one ball in
+ *           play two may turn each other round on any tick they share a
+ *           cell; so for those the answer is 1, as it is, to be safe, for a
+ *           ball in any cell next to a wall.
+ */
+int ball_next_move(struct ppball * bp)
+{
+    int x, y, n;
+
+    if(bp->count != 1)
+        return 1;
+
+    x = bp->x_pos[0];
+    y = bp->y_pos[0];
+    if( y <= get_top_edge(bp->court) + 1 ||
+        y >= get_bot_edge(bp->court) - 1 ||
+        x <= get_left_edge(bp->court) + 1 ||
+        x >= get_right_edge(bp->court) - 1 )
+        return 1;
+
+    n = crossing(bp->x_fix[0], bp->x_vel[0]);
+    y = crossing(bp->y_fix[0], bp->y_vel[0]);
+
+    return (y < n) ? y : n;
+}
+
+/*
+ *  get_ball_hits()
+ *  Purpose: Public function to count the paddles' returns
+ *    Input: bp, pointer to the balls
+ *   Return: how many times a paddle has sent a ball back since new_ball()
+ *     Note: This and get_balls_served() are only counts, for reports (see
+ *           autoplay.c); they aren't part of the game, or of a snapshot.
+ */
+long get_ball_hits(struct ppball * bp)
+{
+    return bp->hits;
+}
+
+/*
+ *  get_balls_served()
+ *  Purpose: Public function to count the balls put in play
+ *    Input: bp, pointer to the balls
+ *   Return: how many balls every serve() since new_ball() has put in play
+ */
+long get_balls_served(struct ppball * bp)
+{
+    return bp->served;
+}
+
+/*
+ *  get_ball_positions()
+ *  Purpose: Public function to see where all the balls in play are, to
+ *           show them somewhere other than the frame (see spectate.c)
+ *    Input: bp, pointer to the balls
+ *   Output: x, y, set to the columns and rows of the balls in play; they
+ *           stay good until the balls next move
+ *   Return: the number of balls in play
+ */
+int get_ball_positions(struct ppball * bp, const int ** x, const int ** y)
+{
+    *x = bp->x_pos;
+    *y = bp->y_pos;
+    return bp->count;
+}
+
 /*
  *  serve()
- *  Purpose: Initialize a ball with new values and draw it
- *    Input: bp, pointer to the ball struct to serve
+ *  Purpose: Put a fresh set of balls in play
+ *    Input: bp, pointer to the balls to serve
+ *     Note: Serving costs one life, however many balls it puts in play.
+ *     Note: The balls appear in their new spots (and the old ones are
+ *           blanked) the next time ball_draw() is called.
+ *     Note: A ball served next to a wall is turned away from it before
+ *           it moves (see face_in()).
  */
 void serve(struct ppball * bp)
 {
-    ball_init(bp);
-    draw_ball(bp);
-    print_balls(bp->remain);
+    int i;
+
+    for(i = 0; i < bp->per_serve; i++)
+        ball_init(bp, i);
+
+    bp->count = bp->per_serve;
+    grid_clear(bp->grid);
+
+    face_in(bp);
+
+    // lose one ball (life) every serve
+    bp->remain--;
+    bp->served += bp->per_serve;
 
     return;
 }
+
+/*
+ *  ball_use_delay()
+ *  Purpose: Set how slow a ball may be given, for every game from now on
+ *    Input: ticks, the most ticks a ball may take to cross a cell up or
+ *           down; across it is half that, and off a paddle too. 0 for the
+ *           usual MAX_DELAY.
+ *   Return: 0, or -1 if ticks is not 0 or from DELAY_LEAST to DELAY_LIMIT
+ *     Note: Across, and off a paddle, a ball may take up to half of ticks
+ *           to cross a cell, so below DELAY_LEAST that would be 1 and leave
+ *           rand_speed() nothing to choose from.
+ *     Note: For tuning how hard the game is, with no terminal (see
+ *           sweep.c). Not while any game is being played: the balls are
+ *           given speeds from it at every serve and every return. A game
+ *           played with anything but MAX_DELAY plays out differently than
+ *           pong, or a recording, would have it.
+ */
+int ball_use_delay(int ticks)
+{
+    if(ticks == 0)
+        ticks = MAX_DELAY;
+    else if(ticks < DELAY_LEAST || ticks > DELAY_LIMIT)
+        return -1;
+
+    max_delay = ticks;
+    return 0;
+}
+
+/*
+ *  ball_save()
+ *  Purpose: Copy the balls into a snapshot (see replay.c)
+ *    Input: bp, pointer to the balls
+ *           buf, where to copy them, or NULL just to ask the size
+ *   Return: the number of bytes it takes
+ *   Method: The lives left and the count in play, then, for every slot
+ *           (in play or not), its random stream, its cell, and its
+ *           fixed-point position and velocity, then the grid. The streams
+ *           and the six arrays are side by side in memory (see
+ *           new_ball()), so they are one copy. Where the balls were drawn
+ *           is left out.
+ */
+int ball_save(struct ppball * bp, unsigned char * buf)
+{
+    int state[2] = { bp->remain, bp->count };
+    int slots = bp->per_serve * (sizeof(struct pprng) +
+                                 (SAVED_ARRAYS * sizeof(int)));
+
+    if(buf != NULL)
+    {
+        memcpy(buf, state, sizeof(state));
+        memcpy(buf + sizeof(state), bp->rng, slots);
+        grid_save(bp->grid, buf + sizeof(state) + slots);
+    }
+
+    return sizeof(state) + slots + grid_save(bp->grid, NULL);
+}
+
+/*
+ *  ball_load()
+ *  Purpose: Set the balls back to a snapshot
+ *    Input: bp, balls on the same court with the same balls per serve
+ *           buf, what ball_save() wrote
+ *   Return: the number of bytes read
+ *     Note: Where the balls are shown is left alone: it belongs to the
+ *           screen, not the game. So the next ball_draw() blanks them and
+ *           draws the loaded balls, and a game can be loaded mid-play.
+ */
+int ball_load(struct ppball * bp, const unsigned char * buf)
+{
+    int state[2];
+    int slots = bp->per_serve * (sizeof(struct pprng) +
+                                 (SAVED_ARRAYS * sizeof(int)));
+
+    memcpy(state, buf, sizeof(state));
+    bp->remain = state[0];
+    bp->count = state[1];
+
+    memcpy(bp->rng, buf + sizeof(state), slots);
+    return sizeof(state) + slots +
+           grid_load(bp->grid, buf + sizeof(state) + slots);
+}
@@ -5,19 +5,41 @@
  * Purpose: Header file for ball.c
  */
 
+/* INCLUDES */
+#include <stdint.h>
+
 /* CONSTANTS */
 #define LOSE -1
 #define NO_CONTACT 0
 #define CONTACT 1
 #define BOUNCE 1
+#define MAX_DELAY 10        // slowest speed: a cell every this many ticks
+#define DELAY_LEAST 4       // fastest ball_use_delay() takes
+#define DELAY_LIMIT 1000    // slowest ball_use_delay() takes
 
 /* OPAQUE STRUCTS */
+struct pparena;
 struct ppball;
+struct ppcourt;
 struct pppaddle;
 
 /* EXTERNAL INTERFACE */
-struct ppball * new_ball();
+struct ppball * new_ball(struct pparena *, struct ppcourt *, int, uint64_t);
 void ball_move(struct ppball *);
-int bounce_or_lose(struct ppball *, struct pppaddle *);
+void ball_draw(struct ppball *);
+void ball_relayout(struct ppball *, int, int, int, int);
+int bounce_or_lose(struct ppball *, struct pppaddle *, struct pppaddle *);
+int ball_tick(struct ppball *, struct pppaddle *, struct pppaddle *);
+const char * ball_tick_name(struct ppball *);
 int get_balls_left(struct ppball *);
-void serve(struct ppball *);
\ No newline at end of file
+int get_balls_in_play(struct ppball *);
+int get_ball_y(struct ppball *);
+int get_ball_intercept(struct ppball *);
+int ball_next_move(struct ppball *);
+long get_ball_hits(struct ppball *);
+long get_balls_served(struct ppball *);
+int get_ball_positions(struct ppball *, const int **, const int **);
+void serve(struct ppball *);
+int ball_save(struct ppball *, unsigned char *);
+int ball_load(struct ppball *, const unsigned char *);
+int ball_use_delay(int);
\ No newline at end of file
@@ -0,0 +1,463 @@
+/*
+ * ===========================================================================
+ *   FILE: ./ball_kernel.c
+ * ===========================================================================
+ * Purpose: Step and reflect whole arrays of balls at once, with SIMD where
+ *          the CPU has it.
+ *
+ * Interface:
+ *      ball_kernel_use()       -- pick a kernel by name, or the best one
+ *      ball_kernel_name()      -- name of the kernel in use
+ *      ball_kernel_step()      -- advance one axis by its velocities
+ *      ball_kernel_bounce()    -- reflect one axis off its two walls
+ *
+ * Internal functions:
+ *      scalar_step(), scalar_bounce()  -- plain C, any CPU
+ *      sse2_step(), sse2_bounce()      -- 4 balls at a time (x86)
+ *      avx2_step(), avx2_bounce()      -- 8 balls at a time (x86)
+ *      neon_step(), neon_bounce()      -- 4 balls at a time (ARM)
+ *      cpu_has_avx2()                  -- whether AVX2 can be used here
+ *      always()                        -- for kernels every build can run
+ *
+ * Notes:
+ *      ball.c keeps each axis of every ball in its own array (see struct
+ *      ppball), and both jobs done every tick work on one axis at a time,
+ *      so the same two kernels serve x and y:
+ *
+ *      step:   add the velocity to the fixed-point position, and take
+ *              the cell it is now in from its whole part.
+ *      bounce: where the cell is on the low wall, the velocity is made
+ *              positive; otherwise, where it is on the high wall,
+ *              negative.
+ *
+ *      Positions and velocities are 16.16 fixed point (FIX_SHIFT), so
+ *      they are plain int adds and shifts, exact on every CPU. A velocity
+ *      is never more than a cell a tick, so a ball can't skip over the
+ *      cell next to a wall.
+ *
+ *      There are no branches per ball: the step is the same add and shift
+ *      for all of them, and the SIMD bounce builds masks from compares
+ *      and selects with them. Whatever doesn't fill a whole vector at the
+ *      end is finished by the scalar kernel. Every kernel gives exactly
+ *      the same results as the scalar one, so a game plays the same
+ *      whichever one runs it.
+ *
+ *      Anything that isn't a pure function of one ball's own values (the
+ *      paddle, random numbers, taking a ball out of play) stays in ball.c,
+ *      which only visits the balls the bounce kernel reports on the high
+ *      wall.
+ *
+ *      The SSE2 kernel is always there on x86-64, and NEON on AArch64.
+ *      AVX2 is compiled in with a target attribute, so the rest of the
+ *      program doesn't need -mavx2, and only picked if the CPU has it.
+ */
+
+/* INCLUDES */
+#include <stddef.h>
+#include <string.h>
+#include "ball_kernel.h"
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define HAVE_SSE2 1
+#include <immintrin.h>
+#endif
+
+#if defined(HAVE_SSE2) && defined(__GNUC__)
+#define HAVE_AVX2 1
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* KERNEL STRUCT */
+struct kernel {
+    const char * name;
+    int (*usable)();
+    void (*step)(int *, int *, const int *, int);
+    int (*bounce)(const int *, int *, int, int, int, int *);
+};
+
+/*
+ * ===========================================================================
+ * INTERNAL FUNCTIONS
+ * ===========================================================================
+ */
+static int always();
+static void scalar_step(int *, int *, const int *, int);
+static int scalar_bounce(const int *, int *, int, int, int, int *);
+#ifdef HAVE_SSE2
+static void sse2_step(int *, int *, const int *, int);
+static int sse2_bounce(const int *, int *, int, int, int, int *);
+#endif
+#ifdef HAVE_AVX2
+static int cpu_has_avx2();
+static void avx2_step(int *, int *, const int *, int);
+static int avx2_bounce(const int *, int *, int, int, int, int *);
+#endif
+#ifdef HAVE_NEON
+static void neon_step(int *, int *, const int *, int);
+static int neon_bounce(const int *, int *, int, int, int, int *);
+#endif
+
+/* LOCAL VARIABLES -- KERNELS, BEST FIRST */
+static const struct kernel kernels[] = {
+#ifdef HAVE_AVX2
+    { "avx2", cpu_has_avx2, avx2_step, avx2_bounce },
+#endif
+#ifdef HAVE_SSE2
+    { "sse2", always, sse2_step, sse2_bounce },
+#endif
+#ifdef HAVE_NEON
+    { "neon", always, neon_step, neon_bounce },
+#endif
+    { "scalar", always, scalar_step, scalar_bounce }
+};
+
+#define NUM_KERNELS (sizeof(kernels) / sizeof(kernels[0]))
+
+static const struct kernel * kernel = NULL;     // picked on first use
+
+/*
+ *  always()
+ *  Purpose: Say a kernel can run on any CPU this was built for
+ */
+int always()
+{
+    return 1;
+}
+
+/*
+ *  scalar_step()
+ *  Purpose: Advance one axis for n balls
+ *    Input: fix, the fixed-point positions to update
+ *           pos, set to the cell each position is in
+ *           vel, each ball's velocity on this axis
+ *           n, how many balls
+ */
+void scalar_step(int * fix, int * pos, const int * vel, int n)
+{
+    int i;
+
+    for(i = 0; i < n; i++)
+    {
+        fix[i] += vel[i];                       // move ball
+        pos[i] = fix[i] >> FIX_SHIFT;           // the cell it is in
+    }
+
+    return;
+}
+
+/*
+ *  scalar_bounce()
+ *  Purpose: Reflect one axis for n balls off the walls at lo and hi
+ *    Input: pos, the cells the balls are in
+ *           vel, the velocities, turned away from the wall for any ball
+ *           on one
+ *           n, how many balls
+ *           lo, hi, the positions just inside the two walls
+ *   Output: at_hi, set to how many balls are on the high wall
+ *   Return: how many balls are on either wall
+ */
+int scalar_bounce(const int * pos, int * vel, int n, int lo, int hi,
+                  int * at_hi)
+{
+    int i, hits = 0, highs = 0;
+
+    for(i = 0; i < n; i++)
+    {
+        if( pos[i] == lo )
+        {
+            if(vel[i] < 0)
+                vel[i] = -vel[i];
+            hits++;
+        }
+        else if( pos[i] == hi )
+        {
+            if(vel[i] > 0)
+                vel[i] = -vel[i];
+            hits++;
+            highs++;
+        }
+    }
+
+    *at_hi = highs;
+    return hits;
+}
+
+#ifdef HAVE_SSE2
+/*
+ *  sse2_step(), sse2_bounce()
+ *  Purpose: As scalar_step() and scalar_bounce(), 4 balls per vector
+ *     Note: A compare gives -1 in every lane where it is true, so
+ *           subtracting a mask counts the lanes it is set in. SSE2 has no
+ *           abs, so |v| is (v ^ s) - s, with s the sign of v in every bit.
+ */
+void sse2_step(int * fix, int * pos, const int * vel, int n)
+{
+    __m128i f, v;
+    int i;
+
+    for(i = 0; i + 4 <= n; i += 4)
+    {
+        f = _mm_loadu_si128((const __m128i *) (fix + i));
+        v = _mm_loadu_si128((const __m128i *) (vel + i));
+
+        f = _mm_add_epi32(f, v);
+
+        _mm_storeu_si128((__m128i *) (fix + i), f);
+        _mm_storeu_si128((__m128i *) (pos + i),
+                         _mm_srai_epi32(f, FIX_SHIFT));
+    }
+
+    scalar_step(fix + i, pos + i, vel + i, n - i);
+    return;
+}
+
+int sse2_bounce(const int * pos, int * vel, int n, int lo, int hi,
+                int * at_hi)
+{
+    __m128i vlo = _mm_set1_epi32(lo), vhi = _mm_set1_epi32(hi);
+    __m128i zero = _mm_setzero_si128();
+    __m128i hits = _mm_setzero_si128(), highs = _mm_setzero_si128();
+    __m128i p, r, s, m_lo, m_hi;
+    int i, sum[4], sum_hi[4], tail_hi, total;
+
+    for(i = 0; i + 4 <= n; i += 4)
+    {
+        p = _mm_loadu_si128((const __m128i *) (pos + i));
+        r = _mm_loadu_si128((const __m128i *) (vel + i));
+
+        m_lo = _mm_cmpeq_epi32(p, vlo);
+        m_hi = _mm_andnot_si128(m_lo, _mm_cmpeq_epi32(p, vhi));
+
+        s = _mm_srai_epi32(r, 31);
+        s = _mm_sub_epi32(_mm_xor_si128(r, s), s);      // |v|
+        r = _mm_andnot_si128(_mm_or_si128(m_lo, m_hi), r);
+        r = _mm_or_si128(r, _mm_and_si128(m_lo, s));
+        r = _mm_or_si128(r, _mm_and_si128(m_hi, _mm_sub_epi32(zero, s)));
+
+        _mm_storeu_si128((__m128i *) (vel + i), r);
+
+        hits = _mm_sub_epi32(hits, _mm_or_si128(m_lo, m_hi));
+        highs = _mm_sub_epi32(highs, m_hi);
+    }
+
+    _mm_storeu_si128((__m128i *) sum, hits);
+    _mm_storeu_si128((__m128i *) sum_hi, highs);
+
+    total = scalar_bounce(pos + i, vel + i, n - i, lo, hi, &tail_hi);
+    *at_hi = tail_hi + sum_hi[0] + sum_hi[1] + sum_hi[2] + sum_hi[3];
+    return total + sum[0] + sum[1] + sum[2] + sum[3];
+}
+#endif
+
+#ifdef HAVE_AVX2
+/*
+ *  cpu_has_avx2()
+ *  Purpose: Check, at run time, that this CPU can run the AVX2 kernel
+ */
+int cpu_has_avx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+/*
+ *  avx2_step(), avx2_bounce()
+ *  Purpose: As sse2_step() and sse2_bounce(), 8 balls per vector
+ */
+__attribute__((target("avx2")))
+void avx2_step(int * fix, int * pos, const int * vel, int n)
+{
+    __m256i f, v;
+    int i;
+
+    for(i = 0; i + 8 <= n; i += 8)
+    {
+        f = _mm256_loadu_si256((const __m256i *) (fix + i));
+        v = _mm256_loadu_si256((const __m256i *) (vel + i));
+
+        f = _mm256_add_epi32(f, v);
+
+        _mm256_storeu_si256((__m256i *) (fix + i), f);
+        _mm256_storeu_si256((__m256i *) (pos + i),
+                            _mm256_srai_epi32(f, FIX_SHIFT));
+    }
+
+    scalar_step(fix + i, pos + i, vel + i, n - i);
+    return;
+}
+
+__attribute__((target("avx2")))
+int avx2_bounce(const int * pos, int * vel, int n, int lo, int hi,
+                int * at_hi)
+{
+    __m256i vlo = _mm256_set1_epi32(lo), vhi = _mm256_set1_epi32(hi);
+    __m256i zero = _mm256_setzero_si256();
+    __m256i hits = _mm256_setzero_si256(), highs = _mm256_setzero_si256();
+    __m256i p, r, a, m_lo, m_hi;
+    int i, j, sum[8], sum_hi[8], tail_hi, total;
+
+    for(i = 0; i + 8 <= n; i += 8)
+    {
+        p = _mm256_loadu_si256((const __m256i *) (pos + i));
+        r = _mm256_loadu_si256((const __m256i *) (vel + i));
+
+        m_lo = _mm256_cmpeq_epi32(p, vlo);
+        m_hi = _mm256_andnot_si256(m_lo, _mm256_cmpeq_epi32(p, vhi));
+
+        a = _mm256_abs_epi32(r);
+        r = _mm256_blendv_epi8(r, a, m_lo);
+        r = _mm256_blendv_epi8(r, _mm256_sub_epi32(zero, a), m_hi);
+
+        _mm256_storeu_si256((__m256i *) (vel + i), r);
+
+        hits = _mm256_sub_epi32(hits, _mm256_or_si256(m_lo, m_hi));
+        highs = _mm256_sub_epi32(highs, m_hi);
+    }
+
+    _mm256_storeu_si256((__m256i *) sum, hits);
+    _mm256_storeu_si256((__m256i *) sum_hi, highs);
+
+    total = scalar_bounce(pos + i, vel + i, n - i, lo, hi, &tail_hi);
+    for(j = 0; j < 8; j++)
+    {
+        total += sum[j];
+        tail_hi += sum_hi[j];
+    }
+
+    *at_hi = tail_hi;
+    return total;
+}
+#endif
+
+#ifdef HAVE_NEON
+/*
+ *  neon_step(), neon_bounce()
+ *  Purpose: As scalar_step() and scalar_bounce(), 4 balls per vector
+ */
+void neon_step(int * fix, int * pos, const int * vel, int n)
+{
+    int32x4_t f;
+    int i;
+
+    for(i = 0; i + 4 <= n; i += 4)
+    {
+        f = vaddq_s32(vld1q_s32(fix + i), vld1q_s32(vel + i));
+
+        vst1q_s32(fix + i, f);
+        vst1q_s32(pos + i, vshrq_n_s32(f, FIX_SHIFT));
+    }
+
+    scalar_step(fix + i, pos + i, vel + i, n - i);
+    return;
+}
+
+int neon_bounce(const int * pos, int * vel, int n, int lo, int hi,
+                int * at_hi)
+{
+    int32x4_t vlo = vdupq_n_s32(lo), vhi = vdupq_n_s32(hi);
+    uint32x4_t hits = vdupq_n_u32(0), highs = vdupq_n_u32(0);
+    uint32x4_t m_lo, m_hi;
+    int32x4_t p, r, a;
+    int i, tail_hi, total;
+
+    for(i = 0; i + 4 <= n; i += 4)
+    {
+        p = vld1q_s32(pos + i);
+        r = vld1q_s32(vel + i);
+
+        m_lo = vceqq_s32(p, vlo);
+        m_hi = vbicq_u32(vceqq_s32(p, vhi), m_lo);
+
+        a = vabsq_s32(r);
+        r = vbslq_s32(m_lo, a, r);
+        r = vbslq_s32(m_hi, vnegq_s32(a), r);
+
+        vst1q_s32(vel + i, r);
+
+        hits = vsubq_u32(hits, vorrq_u32(m_lo, m_hi));
+        highs = vsubq_u32(highs, m_hi);
+    }
+
+    total = scalar_bounce(pos + i, vel + i, n - i, lo, hi, &tail_hi);
+    *at_hi = tail_hi + (int) vaddvq_u32(highs);
+    return total + (int) vaddvq_u32(hits);
+}
+#endif
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  ball_kernel_use()
+ *  Purpose: Choose which kernel steps the balls
+ *    Input: name, one of KERNEL_NAMES, or NULL for the best this CPU runs
+ *   Return: 0 on success, -1 if that kernel isn't built in or can't run
+ *           on this CPU (the kernel in use is left as it was)
+ */
+int ball_kernel_use(const char * name)
+{
+    size_t i;
+
+    for(i = 0; i < NUM_KERNELS; i++)
+    {
+        if(name != NULL && strcmp(name, kernels[i].name) != 0)
+            continue;
+
+        if(kernels[i].usable())
+        {
+            kernel = &kernels[i];
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ *  ball_kernel_name()
+ *  Purpose: Public function to access the name of the kernel in use
+ */
+const char * ball_kernel_name()
+{
+    if(kernel == NULL)
+        ball_kernel_use(NULL);
+
+    return kernel->name;
+}
+
+/*
+ *  ball_kernel_step()
+ *  Purpose: Advance one axis for a run of balls
+ *    Input: fix, pos, vel, n, see scalar_step()
+ */
+void ball_kernel_step(int * fix, int * pos, const int * vel, int n)
+{
+    if(kernel == NULL)
+        ball_kernel_use(NULL);
+
+    kernel->step(fix, pos, vel, n);
+    return;
+}
+
+/*
+ *  ball_kernel_bounce()
+ *  Purpose: Reflect one axis for a run of balls off two walls
+ *    Input: pos, vel, n, lo, hi, see scalar_bounce()
+ *   Output: at_hi, set to how many balls are on the high wall
+ *   Return: how many balls are on either wall
+ */
+int ball_kernel_bounce(const int * pos, int * vel, int n, int lo, int hi,
+                       int * at_hi)
+{
+    if(kernel == NULL)
+        ball_kernel_use(NULL);
+
+    return kernel->bounce(pos, vel, n, lo, hi, at_hi);
+}
@@ -0,0 +1,18 @@
+/*
+ * ==========================
+ *   FILE: ./ball_kernel.h
+ * ==========================
+ * Purpose: Header file for ball_kernel.c
+ */
+
+/* CONSTANTS */
+#define KERNEL_NAMES "scalar, sse2, avx2, neon"
+#define FIX_SHIFT 16                    // fraction bits: 16.16 fixed point
+#define FIX_ONE (1 << FIX_SHIFT)        // one cell
+#define FIX_HALF (FIX_ONE / 2)          // the middle of a cell
+
+/* EXTERNAL INTERFACE */
+int ball_kernel_use(const char *);
+const char * ball_kernel_name();
+void ball_kernel_step(int *, int *, const int *, int);
+int ball_kernel_bounce(const int *, int *, int, int, int, int *);
\ No newline at end of file
@@ -0,0 +1,678 @@
+/*
+ * ==========================================================================
+ *   FILE: ./bench.c
+ * ==========================================================================
+ * Purpose: Time the hot paths of the game, to catch them getting slower.
+ *
+ * Outline: pong-bench (make bench) times, one after another, the calls the
+ *          game makes every tick or every frame: moving the balls, bouncing
+ *          them, checking the paddle, drawing the court, and drawing and
+ *          flushing a whole frame, and a whole game tick, once with the
+ *          tick compiled for the game's preset (see preset.h) and once
+ *          with the generic tick, to show what the constants save. The
+ *          frame goes to null_backend, so the
+ *          drawing and the diffing are timed but no terminal is; then the
+ *          same frame is timed again through curses_backend and through
+ *          ansi_backend, to compare what the two cost to get it out. For
+ *          each, it prints the mean time per call, the median (p50) and
+ *          the 99th percentile (p99) of the samples, how many times a call
+ *          allocated memory, and how many bytes of output it wrote.
+ *
+ * Samples: A sample is one timed run of a call, or of a batch of them for
+ *          the calls too quick for the clock to see on their own. Calls
+ *          that change the game (ball_move() and bounce_or_lose()) can't be
+ *          batched, as the balls must be bounced between moves; they are
+ *          timed one at a time, with the other call made between them, off
+ *          the clock. What it costs to read the clock is measured first and
+ *          taken off every sample.
+ *
+ * Allocs:  pong-bench is linked with malloc(), calloc(), realloc() and
+ *          posix_memalign() (which the arena's blocks come from) wrapped
+ *          (-Wl,--wrap), so every allocation the timed calls make is
+ *          counted. None of them should make any.
+ *
+ *  Output: The curses and ansi frames are written to /dev/null: curses is
+ *          started with newterm() on it, sized to the pretend terminal, and
+ *          stdout is pointed at it while ansi_backend runs. The bytes are
+ *          read from the 'wchar' count in /proc/self/io before and after
+ *          the timed samples (Linux only; 0 elsewhere), so counting them
+ *          costs the calls nothing. If curses can't be started (no
+ *          terminfo for $TERM) its benchmark is left out.
+ *
+ * Options: -H and -W the size of the pretend terminal, -b the balls in
+ *          play, or -p a preset for all three (and the players), -n the
+ *          samples per benchmark, -r the seed, -k the ball kernel, and -c
+ *          to print CSV (one line per benchmark, with the settings)
+ *          instead of a table, for keeping runs to compare. The defaults
+ *          are the headless preset; anything else times the generic tick
+ *          twice over.
+ *
+ * Interface:
+ *      wrap_up()       -- called by the game objects on fatal errors
+ *      __wrap_malloc(), __wrap_calloc(), __wrap_realloc(),
+ *      __wrap_posix_memalign()
+ *                      -- count allocations, then make them
+ *
+ * Internal functions:
+ *      main()          -- set the game up, run every benchmark, report
+ *      get_options()   -- read settings from the command line
+ *      now_ns()        -- the monotonic clock in nanoseconds
+ *      timer_cost()    -- what it costs to read the clock
+ *      calibrate()     -- how many calls to batch into one sample
+ *      run_bench()     -- take the samples for one benchmark
+ *      cmp_double()    -- order samples for qsort()
+ *      report()        -- print one benchmark's line
+ *      use_backend()   -- send the frame to a benchmark's backend
+ *      written()       -- bytes this process has written so far
+ *      op_*(), step_*()
+ *                      -- the calls timed, and the untimed steps between
+ */
+
+/* INCLUDES */
+#include <curses.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "backend.h"
+#include "ball.h"
+#include "ball_kernel.h"
+#include "clock.h"
+#include "court.h"
+#include "frame.h"
+#include "game.h"
+#include "paddle.h"
+#include "pong.h"
+#include "preset.h"
+
+/* CONSTANTS */
+#define DFL_LINES 24        // size of the pretend terminal
+#define DFL_COLS 80
+#define DFL_BALLS 100
+#define DFL_SAMPLES 10000
+#define DFL_SEED 1
+#define BATCH_NS 2000       // batch quick calls up to this long a sample
+#define MAX_BATCH (1 << 20)
+#define PROC_IO "/proc/self/io"
+#define WCHAR_KEY "wchar:"
+
+/* STRUCTS */
+struct bench {
+    const char * name;
+    void (*op)();           // the call timed
+    void (*step)();         // made between samples, off the clock, or NULL
+    const struct backend * be;  // where the frame goes
+};
+
+struct result {
+    double mean;            // nanoseconds per call
+    double p50;
+    double p99;
+    double allocs;          // allocations per call
+    double bytes;           // bytes of output per call
+};
+
+/* LOCAL VARIABLES -- SETTINGS */
+static int lines = DFL_LINES;
+static int cols = DFL_COLS;
+static int balls = DFL_BALLS;
+static int players = 1;
+static int samples = DFL_SAMPLES;
+static uint64_t seed = DFL_SEED;
+static int csv = 0;
+
+/* LOCAL VARIABLES -- WHAT IS TIMED */
+static struct ppcourt * court;
+static struct ppclock * timer;
+static struct pppaddle * paddle;
+static struct ppball * ball;        // the balls moved and bounced
+static unsigned char * ball_start;  // ... as first served
+static struct ppgame * game;        // the game drawn, and ticked
+static struct ppgame * generic;     // ... again, on the generic tick
+static unsigned char * game_start;  // both as first served
+static volatile int sink;           // keeps results the compiler could drop
+static int row;                     // next row paddle_contact() checks
+static const struct backend * shown;    // the frame's backend now
+static SCREEN * screen;             // curses, on /dev/null, or NULL
+static int null_fd = -1;            // /dev/null, for stdout under ansi
+
+static long allocs;                 // allocations made so far
+
+/*
+ * ===========================================================================
+ * INTERNAL FUNCTIONS
+ * ===========================================================================
+ */
+static void get_options(int, char **);
+static int64_t now_ns();
+static double timer_cost();
+static int calibrate(const struct bench *);
+static void run_bench(const struct bench *, double *, double,
+                      struct result *);
+static int cmp_double(const void *, const void *);
+static void report(const struct bench *, const struct result *);
+static void use_backend(const struct bench *);
+static long written();
+static void op_ball_move();
+static void op_bounce();
+static void op_paddle_contact();
+static void op_print_court();
+static void op_frame();
+static void op_tick();
+static void op_tick_generic();
+static void step_bounce();
+static void step_move();
+static void step_tick();
+
+void * __real_malloc(size_t);
+void * __real_calloc(size_t, size_t);
+void * __real_realloc(void *, size_t);
+int __real_posix_memalign(void **, size_t, size_t);
+
+static const struct bench benches[] = {
+    { "ball_move", op_ball_move, step_bounce, &null_backend },
+    { "bounce_or_lose", op_bounce, step_move, &null_backend },
+    { "paddle_contact", op_paddle_contact, NULL, &null_backend },
+    { "print_court", op_print_court, NULL, &null_backend },
+    { "frame", op_frame, step_tick, &null_backend },
+    { "tick", op_tick, NULL, &null_backend },
+    { "tick_generic", op_tick_generic, NULL, &null_backend },
+    { "frame_curses", op_frame, step_tick, &curses_backend },
+    { "frame_ansi", op_frame, step_tick, &ansi_backend },
+};
+
+/*
+ *  main()
+ *  Purpose: Set up the objects to time, run each benchmark and report it
+ *    Input: argc, argv, the command line (see get_options())
+ *   Return: 0 on success, exit non-zero on error
+ */
+int main(int argc, char * argv[])
+{
+    int top, right, bot, left, i, out;
+    double * times, cost;
+    struct result res;
+    const char * term = getenv("TERM");
+    FILE * null_fp;
+
+    get_options(argc, argv);
+
+    top = BORDER;
+    right = cols - BORDER - 1;
+    bot = lines - BORDER - 1;
+    left = BORDER;
+
+    shown = &null_backend;
+    frame_init(lines, cols, shown, 0);
+    court = new_court(NULL, top, right, bot, left, 1);
+    timer = new_clock(NULL, TICKS_PER_SEC);
+    paddle = new_paddle(NULL, court, RIGHT_SIDE);
+    ball = new_ball(NULL, court, balls, seed);
+    game = new_game(NULL, top, right, bot, left, TICKS_PER_SEC, balls, seed,
+                    players);
+    preset_use(0);
+    generic = new_game(NULL, top, right, bot, left, TICKS_PER_SEC, balls,
+                       seed, players);
+    preset_use(1);
+
+    times = malloc(samples * sizeof(double));
+    ball_start = malloc(ball_save(ball, NULL));
+    game_start = malloc(game_save(game, NULL));
+    if(times == NULL || ball_start == NULL || game_start == NULL)
+    {
+        fprintf(stderr, "./pong: Couldn't allocate memory for samples.\n");
+        exit(1);
+    }
+
+    null_fd = open("/dev/null", O_WRONLY);
+    null_fp = fdopen(dup(null_fd), "w");
+    if(null_fp != NULL)
+        screen = newterm(term != NULL ? term : "xterm", null_fp, stdin);
+    if(screen != NULL)
+        resizeterm(lines, cols);
+
+    serve(ball);
+    ball_save(ball, ball_start);
+    game_save(game, game_start);
+
+    cost = timer_cost();
+    if(csv)
+        printf("benchmark,lines,cols,balls,players,kernel,tick,ns_op,p50,"
+               "p99,allocs_op,bytes_op\n");
+    else
+    {
+        printf("pong-bench: %dx%d court, %d balls, %d players, %s kernel, "
+               "%s tick, %d samples (%.0f ns clock read taken off)\n", cols,
+               lines, balls, players, ball_kernel_name(),
+               game_tick_name(game), samples, cost);
+        printf("%-16s %10s %10s %10s %10s %10s\n", "benchmark", "ns/op",
+               "p50", "p99", "allocs/op", "bytes/op");
+    }
+
+    for(i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+    {
+        if( (benches[i].be == &curses_backend && screen == NULL) ||
+            (benches[i].be == &ansi_backend && null_fd == -1) )
+            continue;
+
+        fflush(stdout);
+        out = dup(STDOUT_FILENO);
+        if(benches[i].be == &ansi_backend)
+            dup2(null_fd, STDOUT_FILENO);
+
+        use_backend(&benches[i]);
+        run_bench(&benches[i], times, cost, &res);
+
+        dup2(out, STDOUT_FILENO);
+        close(out);
+        report(&benches[i], &res);
+    }
+
+    frame_end();
+    if(screen != NULL)
+        endwin();
+    return 0;
+}
+
+/*
+ *  get_options()
+ *  Purpose: Read settings from the command line
+ *    Input: argc, argv, as passed to main()
+ *   Method: -H and -W the size of the pretend terminal, -b balls in play,
+ *           -p a preset's size, balls and players, -n samples per
+ *           benchmark, -r (or --seed) the seed, -k the ball kernel to use,
+ *           -c for CSV.
+ *    Error: On an unknown option or a bad value, or a kernel this CPU can't
+ *           run, print a usage message and exit.
+ */
+void get_options(int argc, char * argv[])
+{
+    static const struct option longopts[] = {
+        { "seed", required_argument, NULL, 'r' },
+        { NULL, 0, NULL, 0 }
+    };
+    const struct preset * pp;
+    int opt, bad = 0;
+
+    while( (opt = getopt_long(argc, argv, "H:W:b:p:n:r:k:c", longopts,
+                              NULL)) != -1 )
+    {
+        if(opt == 'H')
+            lines = atoi(optarg);
+        else if(opt == 'W')
+            cols = atoi(optarg);
+        else if(opt == 'b')
+            balls = atoi(optarg);
+        else if(opt == 'p' && (pp = preset_find(optarg)) != NULL)
+        {
+            lines = pp->lines;
+            cols = pp->cols;
+            balls = pp->balls;
+            players = pp->players;
+        }
+        else if(opt == 'n')
+            samples = atoi(optarg);
+        else if(opt == 'r')
+            seed = strtoull(optarg, NULL, 0);
+        else if(opt == 'k')
+            bad = (ball_kernel_use(optarg) == -1);
+        else if(opt == 'c')
+            csv = 1;
+        else
+            bad = 1;
+    }
+
+    if( bad || optind < argc || samples < 1 ||
+        balls < 1 || balls > MAX_BALLS ||
+        lines < MIN_LINES || cols < MIN_COLS )
+    {
+        fprintf(stderr, "usage: %s [-H lines] [-W cols] [-b balls] "
+                        "[-p preset] [-n samples] [-r seed] [-k kernel] "
+                        "[-c]\n", argv[0]);
+        fprintf(stderr, "       (kernels: %s)\n", KERNEL_NAMES);
+        fprintf(stderr, "       (presets: %s)\n", PRESET_NAMES);
+        fprintf(stderr, "       (court must be at least %dx%d)\n",
+                        MIN_COLS, MIN_LINES);
+        exit(2);
+    }
+
+    return;
+}
+
+/*
+ *  now_ns()
+ *  Purpose: Read the monotonic clock
+ *   Return: nanoseconds since some fixed point
+ */
+int64_t now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ *  timer_cost()
+ *  Purpose: Measure what one sample's pair of clock reads costs
+ *   Return: the median, in nanoseconds, of many back-to-back pairs
+ */
+double timer_cost()
+{
+    double pairs[1001];
+    int64_t t0;
+    int i;
+
+    for(i = 0; i < 1001; i++)
+    {
+        t0 = now_ns();
+        pairs[i] = (double) (now_ns() - t0);
+    }
+
+    qsort(pairs, 1001, sizeof(double), cmp_double);
+    return pairs[500];
+}
+
+/*
+ *  calibrate()
+ *  Purpose: Choose how many calls make one sample of a benchmark
+ *    Input: bp, the benchmark
+ *   Return: 1 for a benchmark with a step between calls, otherwise the
+ *           smallest power of two that takes at least BATCH_NS
+ */
+int calibrate(const struct bench * bp)
+{
+    int64_t t0;
+    int n, i;
+
+    if(bp->step != NULL)
+        return 1;
+
+    for(n = 1; n < MAX_BATCH; n *= 2)
+    {
+        t0 = now_ns();
+        for(i = 0; i < n; i++)
+            bp->op();
+        if(now_ns() - t0 >= BATCH_NS)
+            break;
+    }
+
+    return n;
+}
+
+/*
+ *  run_bench()
+ *  Purpose: Take the samples for one benchmark and sum them up
+ *    Input: bp, the benchmark
+ *           times, room for a time per sample
+ *           cost, nanoseconds to take off each sample for reading the clock
+ *           res, where to put the result
+ *   Method: A tenth as many untimed samples first, to warm the caches and
+ *           the branch predictors, then the timed ones. Allocations are
+ *           counted only inside the timed part, and bytes written between
+ *           its start and end.
+ */
+void run_bench(const struct bench * bp, double * times, double cost,
+               struct result * res)
+{
+    int batch = calibrate(bp);
+    int s, i;
+    int64_t t0, t1;
+    long a0, made = 0, w0;
+    double total = 0;
+
+    for(s = 0; s < samples / 10; s++)
+    {
+        for(i = 0; i < batch; i++)
+            bp->op();
+        if(bp->step != NULL)
+            bp->step();
+    }
+
+    w0 = written();
+    for(s = 0; s < samples; s++)
+    {
+        a0 = allocs;
+        t0 = now_ns();
+        for(i = 0; i < batch; i++)
+            bp->op();
+        t1 = now_ns();
+        made += allocs - a0;
+
+        times[s] = ((double) (t1 - t0) - cost) / batch;
+        if(times[s] < 0)
+            times[s] = 0;
+        total += times[s];
+
+        if(bp->step != NULL)
+            bp->step();
+    }
+
+    res->bytes = (double) (written() - w0) / ((double) samples * batch);
+
+    qsort(times, samples, sizeof(double), cmp_double);
+    res->mean = total / samples;
+    res->p50 = times[samples / 2];
+    res->p99 = times[(int) ((samples - 1) * 0.99)];
+    res->allocs = (double) made / ((double) samples * batch);
+
+    return;
+}
+
+/*
+ *  cmp_double()
+ *  Purpose: Compare two samples, for qsort()
+ */
+int cmp_double(const void * a, const void * b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+ *  report()
+ *  Purpose: Print one benchmark's result, as a table row or a CSV line
+ */
+void report(const struct bench * bp, const struct result * rp)
+{
+    if(csv)
+        printf("%s,%d,%d,%d,%d,%s,%s,%.1f,%.1f,%.1f,%.2f,%.1f\n",
+               bp->name, lines, cols, balls, players, ball_kernel_name(),
+               game_tick_name(bp->op == op_tick_generic ? generic : game),
+               rp->mean, rp->p50, rp->p99, rp->allocs, rp->bytes);
+    else
+        printf("%-16s %10.1f %10.1f %10.1f %10.2f %10.1f\n", bp->name,
+               rp->mean, rp->p50, rp->p99, rp->allocs, rp->bytes);
+
+    return;
+}
+
+/*
+ *  use_backend()
+ *  Purpose: Send the frame to the backend a benchmark times
+ *    Input: bp, the benchmark
+ *     Note: The frame is started again on a change, so it begins blank,
+ *           as the backend's screen does.
+ */
+void use_backend(const struct bench * bp)
+{
+    if(bp->be == shown)
+        return;
+
+    frame_end();
+    shown = bp->be;
+    frame_init(lines, cols, shown, 0);
+
+    return;
+}
+
+/*
+ *  written()
+ *  Purpose: Read how many bytes this process has written, in total
+ *   Return: the 'wchar' field of /proc/self/io, or 0 if it can't be read
+ */
+long written()
+{
+    char buf[512];
+    char * p;
+    ssize_t n;
+    int fd = open(PROC_IO, O_RDONLY);
+
+    if(fd == -1)
+        return 0;
+    n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if(n <= 0)
+        return 0;
+
+    buf[n] = '\0';
+    p = strstr(buf, WCHAR_KEY);
+    return (p != NULL) ? atol(p + strlen(WCHAR_KEY)) : 0;
+}
+
+/*
+ *  op_ball_move(), op_bounce(), op_paddle_contact(), op_print_court(),
+ *  op_frame(), op_tick(), op_tick_generic()
+ *  Purpose: The calls timed
+ *     Note: op_paddle_contact() checks a different row each call, top to
+ *           bottom of the court, so the answer isn't always the same.
+ *           op_frame() draws the moving parts of the game, as pong does
+ *           after every pass of ticks, and flushes them to the backend.
+ *           op_tick() and op_tick_generic() play one tick of the game,
+ *           on its preset's tick and on the generic one, and set it back
+ *           to its start as step_tick() does; that is rare enough to be
+ *           timed with the rest.
+ */
+void op_ball_move()
+{
+    ball_move(ball);
+    return;
+}
+
+void op_bounce()
+{
+    sink = bounce_or_lose(ball, paddle, NULL);
+    return;
+}
+
+void op_paddle_contact()
+{
+    sink = paddle_contact(row, paddle);
+    if(++row > get_bot_edge(court))
+        row = get_top_edge(court);
+    return;
+}
+
+void op_print_court()
+{
+    print_court(court, timer, balls);
+    return;
+}
+
+void op_frame()
+{
+    game_draw(game);
+    sink = frame_flush();
+    return;
+}
+
+void op_tick()
+{
+    if( game_tick(game) != GAME_ON || game_balls_in_play(game) * 2 < balls )
+        game_load(game, game_start);
+    return;
+}
+
+void op_tick_generic()
+{
+    if( game_tick(generic) != GAME_ON ||
+        game_balls_in_play(generic) * 2 < balls )
+        game_load(generic, game_start);
+    return;
+}
+
+/*
+ *  step_bounce(), step_move(), step_tick()
+ *  Purpose: Move the game on between samples, off the clock
+ *   Method: Each makes the part of a tick the benchmark doesn't time, and
+ *           puts the balls back as first served once half of them are lost
+ *           (the game back to its start), so the benchmark goes on timing
+ *           about as many balls in play as it was asked for.
+ */
+void step_bounce()
+{
+    bounce_or_lose(ball, paddle, NULL);
+    if(get_balls_in_play(ball) * 2 < balls)
+        ball_load(ball, ball_start);
+    return;
+}
+
+void step_move()
+{
+    ball_move(ball);
+    if(get_balls_in_play(ball) * 2 < balls)
+        ball_load(ball, ball_start);
+    return;
+}
+
+void step_tick()
+{
+    if( game_tick(game) != GAME_ON ||
+        game_balls_in_play(game) * 2 < balls )
+        game_load(game, game_start);
+    return;
+}
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  wrap_up()
+ *  Purpose: Get ready for a fatal error to exit
+ *     Note: As in pong-headless, there is no terminal to reset.
+ */
+void wrap_up()
+{
+    return;
+}
+
+/*
+ *  __wrap_malloc(), __wrap_calloc(), __wrap_realloc(),
+ *  __wrap_posix_memalign()
+ *  Purpose: Count an allocation, then make it
+ *     Note: The linker sends every call to malloc(), calloc(), realloc()
+ *           and posix_memalign() here instead (-Wl,--wrap=malloc and so
+ *           on, in the Makefile), and __real_malloc() and so on are the C
+ *           library's own.
+ */
+void * __wrap_malloc(size_t size)
+{
+    allocs++;
+    return __real_malloc(size);
+}
+
+void * __wrap_calloc(size_t n, size_t size)
+{
+    allocs++;
+    return __real_calloc(n, size);
+}
+
+void * __wrap_realloc(void * ptr, size_t size)
+{
+    allocs++;
+    return __real_realloc(ptr, size);
+}
+
+int __wrap_posix_memalign(void ** ptr, size_t align, size_t size)
+{
+    allocs++;
+    return __real_posix_memalign(ptr, align, size);
+}
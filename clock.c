@@ -2,36 +2,44 @@
  * ===========================================================================
  *   FILE: ./clock.c
  * ===========================================================================
- * Purpose: Create a static clock in the file, that is accessed via other
- *          files to print/update time.
+ * Purpose: Create a clock for a game, that is accessed via other files
+ *          to print/update time.
  *
  * Interface:
- *      clock_init()    -- Initialize clock struct to zeroes
+ *      new_clock()     -- Allocate a clock, at zero, for a tick rate
  *      clock_tick()    -- Update timer struct every second
+ *      clock_next_sec() -- Ticks until the time shown changes
  *      get_mins()      -- Access the 'mins' value in the clock
  *      get_secs()      -- Access the 'secs' value in the clock
+ *      clock_save()    -- Copy the clock into a snapshot
+ *      clock_load()    -- Set the clock back to a snapshot
  *
  * Notes:
- *      The clock is file-scoped to clock.c. It is updated via a call to
- *      clock_tick() every time a SIGALRM fires. The other functions are
- *      used to print a running clock, and an exit message with the final
- *      play time.
+ *      Each game has its own clock, so games can run side by side (see
+ *      sim.c). It is updated via a call to clock_tick() once per game
+ *      tick. The other functions are used to print a running clock, and an
+ *      exit message with the final play time. The clock only counts;
+ *      drawing the time is left to the caller, once per frame. How long
+ *      the ticks and frames really take is measured in telemetry.c.
  */
 
 /* INCLUDES */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
 #include "clock.h"
-#include "court.h"
+#include "pong.h"
 
 /* CONSTANTS */
 #define MINUTE 60
 
 /* CLOCK STRUCT */
-struct timer {
+struct ppclock {
     int mins, secs, ticks;
+    int rate;               // ticks in one second
 };
 
-static struct timer clock;
-
 /*
  * ===========================================================================
  * EXTERNAL INTERFACE
@@ -39,60 +47,123 @@ static struct timer clock;
  */
 
 /*
- *  clock_init()
- *  Purpose: Initialize clock struct to zeroes
+ *  new_clock()
+ *  Purpose: Allocate a clock struct, initialized to zeroes
+ *    Input: arena, to allocate from (see arena.c), or NULL for malloc()
+ *           rate, the number of clock_tick() calls that make one second
+ *   Return: a pointer to the clock
+ *    Error: If malloc fails, close curses, print a message and exit.
  */
-void clock_init()
+struct ppclock * new_clock(struct pparena * arena, int rate)
 {
-    clock.mins = 0;
-    clock.secs = 0;
-    clock.ticks = 0;
+    struct ppclock * clock = arena_alloc(arena, sizeof(struct ppclock));
 
-    return;
+    if(clock == NULL)
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Couldn't allocate memory for a clock.\n");
+        exit(1);
+    }
+
+    clock->mins = 0;
+    clock->secs = 0;
+    clock->ticks = 0;
+    clock->rate = rate;
+
+    return clock;
 }
 
 /*
  *  clock_tick()
  *  Purpose: Update timer struct every second
- *   Method: Once the number of ticks equals TICKS_PER_SEC, increment
+ *    Input: clock, the game's clock
+ *   Method: Once the number of ticks equals the clock's rate, increment
  *           the number of seconds. When it reaches 60 seconds, reset
  *           to 0 and increment the number of minutes.
  */
-void clock_tick()
+void clock_tick(struct ppclock * clock)
 {
     // enough ticks for a second
-    if(++clock.ticks == TICKS_PER_SEC)
+    if(++clock->ticks == clock->rate)
     {
         // enough seconds for a min
-        if(++clock.secs == MINUTE)
+        if(++clock->secs == MINUTE)
         {
-            clock.secs = 0;
-            clock.mins++;
+            clock->secs = 0;
+            clock->mins++;
         }
 
-        clock.ticks = 0;
-        print_time();
+        clock->ticks = 0;
     }
 
     return;
 }
 
+/*
+ *  clock_next_sec()
+ *  Purpose: Say how soon the clock will show another second
+ *    Input: clock, the game's clock
+ *   Return: how many clock_tick() calls away that is, from 1 to the rate
+ */
+int clock_next_sec(struct ppclock * clock)
+{
+    return clock->rate - clock->ticks;
+}
+
 /*
  *  get_mins()
  *  Purpose: Public function to access 'mins' value in timer struct
- *   Return: The current value of 'clock.mins'
+ *    Input: clock, the game's clock
+ *   Return: The current value of 'clock->mins'
  */
-int get_mins()
+int get_mins(struct ppclock * clock)
 {
-    return clock.mins;
+    return clock->mins;
 }
 
 /*
  *  get_secs()
  *  Purpose: Public function to access 'secs' value in timer struct
- *   Return: The current value of 'clock.secs'
+ *    Input: clock, the game's clock
+ *   Return: The current value of 'clock->secs'
  */
-int get_secs()
+int get_secs(struct ppclock * clock)
 {
-    return clock.secs;
+    return clock->secs;
+}
+
+/*
+ *  clock_save()
+ *  Purpose: Copy the time on the clock into a snapshot (see replay.c)
+ *    Input: clock, the game's clock
+ *           buf, where to copy it, or NULL just to ask the size
+ *   Return: the number of bytes it takes
+ */
+int clock_save(struct ppclock * clock, unsigned char * buf)
+{
+    int state[3] = { clock->mins, clock->secs, clock->ticks };
+
+    if(buf != NULL)
+        memcpy(buf, state, sizeof(state));
+
+    return sizeof(state);
+}
+
+/*
+ *  clock_load()
+ *  Purpose: Set the clock back to the time in a snapshot
+ *    Input: clock, the game's clock; its rate must be the one saved with
+ *           buf, what clock_save() wrote
+ *   Return: the number of bytes read
+ */
+int clock_load(struct ppclock * clock, const unsigned char * buf)
+{
+    int state[3];
+
+    memcpy(state, buf, sizeof(state));
+    clock->mins = state[0];
+    clock->secs = state[1];
+    clock->ticks = state[2];
+
+    return sizeof(state);
 }
@@ -7,9 +7,17 @@
 
 /* CONSTANTS */
 #define	TICKS_PER_SEC	50		// affects speed
+#define	FRAMES_PER_SEC	30		// affects smoothness
+
+/* OPAQUE STRUCTS */
+struct pparena;
+struct ppclock;
 
 /* EXTERNAL INTERFACE */
-void clock_init();
-void clock_tick();
-int get_mins();
-int get_secs();
\ No newline at end of file
+struct ppclock * new_clock(struct pparena *, int);
+void clock_tick(struct ppclock *);
+int clock_next_sec(struct ppclock *);
+int get_mins(struct ppclock *);
+int get_secs(struct ppclock *);
+int clock_save(struct ppclock *, unsigned char *);
+int clock_load(struct ppclock *, const unsigned char *);
\ No newline at end of file
@@ -5,33 +5,53 @@
  * Purpose: Create a court for pong, and print it to the screen.
  *
  * Interface:
- *      court_init()        -- Init the static court with row/col values
+ *      new_court()         -- Allocate a court with row/col values
+ *      court_relayout()    -- Move the walls
  *      print_court()       -- Print the # balls left, time, and walls
  *      print_balls()       -- Print the number of balls left to play
  *      print_time()        -- Print elapsed time
+ *      print_hud()         -- Print a line between the two headers
  *      get_top_edge()      -- Return the position of the top row
  *      get_right_edge()    -- Return the position of the right column
  *      get_bot_edge()      -- Return the position of the bottom row
  *      get_left_edge()     -- Return the position of the left column
+ *      get_cell_size()     -- Return the side of a collision grid cell
+ *      get_paddles()       -- Return 1, or 2 if the left wall is a paddle
+ *      rescale()           -- Move a position from one span to another
  *
  * Internal functions:
+ *      print_layer()       -- Draw the walls and labels into the layer
  *      print_row()         -- Print a row
  *      print_col()         -- Print a column
  *
  * Notes:
- *      The court is file-scoped to court.c. The clock is responsible for
+ *      Each game has its own court, and the paddle, balls and grid keep a
+ *      pointer to the one they play in. The court is responsible for
  *      storing where the borders to the game are, printing the borders,
  *      and updating the two headers tracking game progress -- BALLS LEFT
- *      and TOTAL TIME.
+ *      and TOTAL TIME. What room is left between them can hold one more
+ *      line (print_hud()), such as pong's telemetry (-D).
+ *
+ *      The walls and the labels of the headers never change while the
+ *      court stays where it is, so they are drawn once, into the frame's
+ *      static layer (see frame.c), and print_court() just blits the
+ *      court's rectangle of it. They are drawn again only when the court
+ *      moves or the layer starts blank (a new or resized frame).
+ *
+ *      It also sizes the cells of the collision grid (grid.c) to match:
+ *      the smallest square cell that covers the inside of the court in no
+ *      more than MAX_CELLS cells. On any ordinary terminal that is a
+ *      single char, so a cell holds just the balls on one spot.
  */
 
 /* INCLUDES */
-#include <curses.h>
+#include <stdio.h>
 #include <stdlib.h>
-#include <unistd.h>
-#include "ball.h"
+#include <string.h>
+#include "arena.h"
 #include "clock.h"
 #include "court.h"
+#include "frame.h"
 #include "pong.h"
 
 /* CONSTANTS */
@@ -39,53 +59,87 @@
 #define COL_SYMBOL '|'
 #define TIME_FORMAT "TOTAL TIME: %.2d:%.2d" // e.g. TOTAL TIME: 02:09
 #define TIME_LEN 17                         // length of outputted time string
+#define BALLS_LEN 14                        // and of the balls left
+#define TIME_LABEL "TOTAL TIME:"            // the parts that don't change
+#define BALLS_LABEL "BALLS LEFT:"
 
 /* COURT STRUCT */
 struct ppcourt {
     int top, right, bot, left;  //dimensions of court
+    int cell_size;              // side of a grid cell, in chars
+    int paddles;                // 2 if the left wall is a paddle too
+    int layer;                  // frame_layer_gen() drawn into, or -1
 };
 
-static struct ppcourt court;
-
 /*
  * ===========================================================================
  * INTERNAL FUNCTIONS
  * ===========================================================================
  */
-static void print_row(int, int, int);
-static void print_col(int, int, int);
+static void print_layer(struct ppcourt *, int);
+static void print_row(int, int, int, char);
+static void print_col(int, int, int, char);
+
+/*
+ *  print_layer()
+ *  Purpose: Draw the walls and the labels of the headers into the frame's
+ *           static layer, or blank them out of it
+ *    Input: court, the court to draw
+ *           show, 1 to draw them, 0 to blank them
+ *     Note: The column has +1 added to court->top so the column
+ *           doesn't overwrite the top row. With two paddles there is no
+ *           column: the left paddle stands where it would be.
+ */
+void print_layer(struct ppcourt * court, int show)
+{
+    print_row(court->top, court->left, court->right,
+              show ? ROW_SYMBOL : BLANK);
+    if(court->paddles < 2)
+        print_col(court->left, court->top + 1, court->bot,
+                  show ? COL_SYMBOL : BLANK);
+    print_row(court->bot, court->left, court->right,
+              show ? ROW_SYMBOL : BLANK);
+
+    frame_layer_print(court->top - 1, court->left, "%-*s",
+                      (int) strlen(BALLS_LABEL), show ? BALLS_LABEL : "");
+    frame_layer_print(court->top - 1, court->right - TIME_LEN, "%-*s",
+                      (int) strlen(TIME_LABEL), show ? TIME_LABEL : "");
+
+    return;
+}
 
 /*
  *  print_row()
- *  Purpose: print a row
+ *  Purpose: print a row into the static layer
  *    Input: row, the window row to print at
  *           start, the column to start at
  *           end, the column to end at
+ *           c, the char to print
  *     Note: The for loop goes until i <= end in order to print the
  *           right-most row symbol.
  */
-void print_row(int row, int start, int end)
+void print_row(int row, int start, int end, char c)
 {
     int i;
-    move(row, start);
     for(i = start; i <= end; i++)
-        addch(ROW_SYMBOL);
+        frame_layer_put(row, i, c);
 
     return;
 }
 
 /*
- *  print_row()
- *  Purpose: print a column
+ *  print_col()
+ *  Purpose: print a column into the static layer
  *    Input: col, the window column to print at
  *           start, the row to start at
  *           end, the row to end at
+ *           c, the char to print
  */
-void print_col(int col, int start, int end)
+void print_col(int col, int start, int end, char c)
 {
     int i;
     for(i = start; i < end; i++)
-        mvaddch(i, col, COL_SYMBOL);
+        frame_layer_put(i, col, c);
 
     return;
 }
@@ -97,15 +151,63 @@ void print_col(int col, int start, int end)
  */
 
 /*
- *  court_init()
- *  Purpose: Initialize the static court object with row/col values
+ *  new_court()
+ *  Purpose: Allocate a court object with row/col values
+ *    Input: arena, to allocate from (see arena.c), or NULL for malloc()
+ *           top, right, bot, left, the rows and columns of the walls
+ *           paddles, 1 for a paddle on the right only, or 2 for one on
+ *           each side, when there is no left wall
+ *   Return: a pointer to the court
+ *    Error: If malloc fails, close curses, print a message and exit.
  */
-void court_init(int top, int right, int bot, int left)
+struct ppcourt * new_court(struct pparena * arena, int top, int right,
+                           int bot, int left, int paddles)
 {
-    court.top = top;
-    court.right = right;
-    court.bot = bot;
-    court.left = left;
+    struct ppcourt * court = arena_alloc(arena, sizeof(struct ppcourt));
+
+    if(court == NULL)
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Couldn't allocate memory for a court.\n");
+        exit(1);
+    }
+
+    court->paddles = paddles;
+    court->layer = -1;
+    court_relayout(court, top, right, bot, left);
+
+    return court;
+}
+
+/*
+ *  court_relayout()
+ *  Purpose: Move the walls of a court, and size its grid cells to match
+ *    Input: court, the court
+ *           top, right, bot, left, the rows and columns of the new walls
+ *     Note: Only the court changes. Whatever plays in it must be laid out
+ *           again too (see game_relayout()), and nothing already drawn is
+ *           taken off the screen. The old walls are taken out of the static
+ *           layer, though, so the next print_court() shows only the new.
+ */
+void court_relayout(struct ppcourt * court, int top, int right, int bot,
+                    int left)
+{
+    int width = right - left - 1, height = bot - top - 1;
+    int size = 1;
+
+    if(court->layer == frame_layer_gen())
+        print_layer(court, 0);
+    court->layer = -1;
+
+    court->top = top;
+    court->right = right;
+    court->bot = bot;
+    court->left = left;
+
+    while( ((width + size - 1) / size) * ((height + size - 1) / size)
+           > MAX_CELLS )
+        size++;
+    court->cell_size = size;
 
     return;
 }
@@ -113,36 +215,41 @@ void court_init(int top, int right, int bot, int left)
 /*
  *  print_court()
  *  Purpose: print the # balls left, time, and walls
- *     Note: The column has +1 added to court.top so the column
- *           doesn't overwrite the top row.
- *     Note: There are no calls to park_cursor() or refresh() as
- *           these occur in both print_balls() and print_time()
- *           because those calls will happen more frequently than
- *           print_court(). As such, explicit calls to park_cursor()
- *           and refresh() are not necessary in this function as they
- *           will have already happened.
+ *    Input: court, the court to print
+ *           clock, the game's clock
+ *           balls, the number of balls left
+ *   Method: Draw the walls and labels into the static layer if they aren't
+ *           there yet, then blit the court's rectangle of it, from the
+ *           headers to the bottom wall, and print the numbers over it.
+ *     Note: Like the other print functions, this only draws into the
+ *           current frame. It reaches the terminal on the next call to
+ *           frame_flush(). The blit takes the paddles and balls off the
+ *           court too, so they have to be drawn again (see game_redraw()).
  */
-void print_court(int balls)
+void print_court(struct ppcourt * court, struct ppclock * clock, int balls)
 {
-    print_row(court.top, court.left, court.right);
-    print_col(court.left, court.top + 1, court.bot);
-    print_row(court.bot, court.left, court.right);
+    if(court->layer != frame_layer_gen())
+    {
+        print_layer(court, 1);
+        court->layer = frame_layer_gen();
+    }
+    frame_blit(court->top - 1, court->left, court->bot, court->right);
 
-    print_balls(balls);
-    print_time();
+    print_balls(court, balls);
+    print_time(court, clock);
     return;
 }
 
 /*
  *  print_time()
  *  Purpose: Print elapsed time, right-adjusted above top border
+ *    Input: court, the court to print above
+ *           clock, the game's clock
  */
-void print_time()
+void print_time(struct ppcourt * court, struct ppclock * clock)
 {
-    move((get_top_edge() - 1), (get_right_edge() - TIME_LEN));
-    printw(TIME_FORMAT, get_mins(), get_secs());
-    park_cursor();
-    refresh();
+    frame_print((court->top - 1), (court->right - TIME_LEN),
+                TIME_FORMAT, get_mins(clock), get_secs(clock));
     return;
 }
 
@@ -150,36 +257,95 @@ void print_time()
  *  print_balls()
  *  Purpose: Print the number of balls left to play, left-adjusted above
  *           top border
- *    Input: balls, the number of balls left
+ *    Input: court, the court to print above
+ *           balls, the number of balls left
  */
-void print_balls(int balls)
+void print_balls(struct ppcourt * court, int balls)
 {
-    mvprintw(court.top - 1, court.left, "BALLS LEFT: %2d", balls);
-    park_cursor();
-    refresh();
+    frame_print(court->top - 1, court->left, "BALLS LEFT: %2d", balls);
     return;
 }
 
+/*
+ *  print_hud()
+ *  Purpose: Print a line of text centered between the two headers
+ *    Input: court, the court to print above
+ *           text, what to print
+ *     Note: The text is cut short to leave a space either side of it, and
+ *           the whole gap is printed every time, so a shorter line leaves
+ *           nothing of a longer one behind. On a court too narrow for any
+ *           of it, nothing is printed.
+ */
+void print_hud(struct ppcourt * court, const char * text)
+{
+    int x = court->left + BALLS_LEN + 1;
+    int width = (court->right - TIME_LEN - 1) - x;
+    int len = (int) strlen(text), pad;
+
+    if(width <= 0)
+        return;
+
+    if(len > width)
+        len = width;
+    pad = (width - len) / 2;
+
+    frame_print(court->top - 1, x, "%*s%-*.*s", pad, "", width - pad, len,
+                text);
+    return;
+}
+
+/*
+ *  rescale()
+ *  Purpose: Find where a position between two walls goes when the walls
+ *           move
+ *    Input: pos, the row or column, from lo to hi
+ *           lo, hi, the first and last it could have been
+ *           new_lo, new_hi, the first and last it can be now
+ *   Return: the same fraction of the way from new_lo to new_hi, rounded
+ *           to the nearest
+ */
+int rescale(int pos, int lo, int hi, int new_lo, int new_hi)
+{
+    long span = hi - lo, new_span = new_hi - new_lo;
+
+    if(span <= 0)
+        return new_lo + (int) (new_span / 2);
+
+    return new_lo + (int) ((((pos - lo) * new_span * 2) + span) / (span * 2));
+}
+
 /* get_right_edge() -- return the position of the right column */
-int get_right_edge()
+int get_right_edge(struct ppcourt * court)
 {
-    return court.right;
+    return court->right;
 }
 
 /* get_left_edge() -- return the position of the left column */
-int get_left_edge()
+int get_left_edge(struct ppcourt * court)
 {
-    return court.left;
+    return court->left;
 }
 
 /* get_top_edge() -- return the position of the top row */
-int get_top_edge()
+int get_top_edge(struct ppcourt * court)
 {
-    return court.top;
+    return court->top;
 }
 
 /* get_bot_edge() -- return the position of the bottom row */
-int get_bot_edge()
+int get_bot_edge(struct ppcourt * court)
+{
+    return court->bot;
+}
+
+/* get_cell_size() -- return the side of a collision grid cell */
+int get_cell_size(struct ppcourt * court)
+{
+    return court->cell_size;
+}
+
+/* get_paddles() -- return 1, or 2 if the left wall is a paddle too */
+int get_paddles(struct ppcourt * court)
 {
-    return court.bot;
+    return court->paddles;
 }
@@ -6,18 +6,29 @@
  */
 
 /* Opaque structs */
+struct pparena;
 struct ppball;
+struct ppclock;
 struct ppcourt;
 
 /* CONSTANTS */
 #define BORDER 3
+#define MIN_LINES 11        // minimum terminal row size
+#define MIN_COLS 40         // minimum terminal column size
+#define MAX_BALLS 100000    // most balls in play at once
+#define MAX_CELLS 4096      // most cells in the collision grid
 
 /* EXTERNAL INTERFACE */
-void court_init(int, int, int, int);
-void print_court(int);
-void print_balls(int);
-void print_time();
-int get_top_edge();
-int get_right_edge();
-int get_bot_edge();
-int get_left_edge();
\ No newline at end of file
+struct ppcourt * new_court(struct pparena *, int, int, int, int, int);
+void court_relayout(struct ppcourt *, int, int, int, int);
+void print_court(struct ppcourt *, struct ppclock *, int);
+void print_balls(struct ppcourt *, int);
+void print_time(struct ppcourt *, struct ppclock *);
+void print_hud(struct ppcourt *, const char *);
+int get_top_edge(struct ppcourt *);
+int get_right_edge(struct ppcourt *);
+int get_bot_edge(struct ppcourt *);
+int get_left_edge(struct ppcourt *);
+int get_cell_size(struct ppcourt *);
+int get_paddles(struct ppcourt *);
+int rescale(int, int, int, int, int);
\ No newline at end of file
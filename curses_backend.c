@@ -0,0 +1,185 @@
+/*
+ * ===========================================================================
+ *   FILE: ./curses_backend.c
+ * ===========================================================================
+ * Purpose: Show frames on the terminal through curses.
+ *
+ * Interface:
+ *      curses_backend      -- backend operations, see backend.h
+ *
+ * Internal functions:
+ *      cb_open()           -- start counting tty bytes, if asked to
+ *      cb_put()            -- put a changed cell in the curses window
+ *      cb_update()         -- one wnoutrefresh()/doupdate() for the frame
+ *      cb_resize()         -- clear curses' screen after a resize
+ *      cb_close()          -- stop counting tty bytes
+ *      park_cursor()       -- park cursor in bottom-right of screen
+ *      tty_bytes()         -- bytes this process has written so far
+ *
+ * Notes:
+ *      Curses itself is started and stopped by the program (see set_up()
+ *      and wrap_up() in pong.c), since it also reads the keyboard; this
+ *      file only handles output.
+ *
+ *      curses writes straight to the terminal's descriptor, so there is no
+ *      stream to count bytes on. When asked to count them, they are read
+ *      from the 'wchar' count the kernel keeps in /proc/self/io after each
+ *      doupdate() (Linux only; reported as 0 elsewhere).
+ */
+
+/* INCLUDES */
+#include <curses.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "backend.h"
+
+/* CONSTANTS */
+#define PROC_IO "/proc/self/io"
+#define WCHAR_KEY "wchar:"
+
+/* OUTPUT STATE */
+static int io_fd = -1;          // /proc/self/io, or -1 if not counting
+static long io_last;            // last 'wchar' value read
+
+/*
+ * ===========================================================================
+ * INTERNAL FUNCTIONS
+ * ===========================================================================
+ */
+static void cb_open(int, int, int);
+static void cb_put(int, int, unsigned short);
+static long cb_update();
+static void cb_resize(int, int);
+static void cb_close();
+static void park_cursor();
+static long tty_bytes();
+
+/*
+ *  cb_open()
+ *  Purpose: Get ready to show frames
+ *    Input: lines, cols, the size of the screen, which curses knows
+ *           count_bytes, non-zero to count bytes written to the tty
+ */
+void cb_open(int lines, int cols, int count_bytes)
+{
+#ifdef __linux__
+    if(count_bytes)
+    {
+        io_fd = open(PROC_IO, O_RDONLY | O_CLOEXEC);
+        if(io_fd != -1)
+            io_last = tty_bytes();
+    }
+#endif
+
+    return;
+}
+
+/*
+ *  cb_put()
+ *  Purpose: Put one changed cell into the curses window
+ *    Input: y, x, the row and column
+ *           cell, the cell to show
+ */
+void cb_put(int y, int x, unsigned short cell)
+{
+    mvaddch(y, x, CELL_CHAR(cell) | ((cell & CELL_STANDOUT) ? A_STANDOUT : 0));
+    return;
+}
+
+/*
+ *  cb_update()
+ *  Purpose: Send the frame to the terminal
+ *   Return: the bytes written, or 0 if they aren't being counted
+ */
+long cb_update()
+{
+    long bytes, now;
+
+    park_cursor();
+    wnoutrefresh(stdscr);
+    doupdate();
+
+    if(io_fd == -1)
+        return 0;
+
+    now = tty_bytes();
+    bytes = now - io_last;
+    io_last = now;
+
+    return bytes;
+}
+
+/*
+ *  cb_resize()
+ *  Purpose: Clear the screen for a new size
+ *    Input: lines, cols, the new size, which curses has already taken
+ *           (resizeterm() in the program that started it)
+ *     Note: clearok() makes the next doupdate() repaint the whole screen,
+ *           rather than trust what curses thinks is on it.
+ */
+void cb_resize(int lines, int cols)
+{
+    erase();
+    clearok(stdscr, TRUE);
+
+    return;
+}
+
+/*
+ *  cb_close()
+ *  Purpose: Stop counting bytes
+ */
+void cb_close()
+{
+    if(io_fd != -1)
+        close(io_fd);
+
+    io_fd = -1;
+    return;
+}
+
+/*
+ *  park_cursor()
+ *  Purpose: Helper function to park the cursor in lower-right of screen
+ */
+void park_cursor()
+{
+    move(LINES - 1, COLS - 1);
+    return;
+}
+
+/*
+ *  tty_bytes()
+ *  Purpose: Read how many bytes this process has written, in total
+ *   Return: the 'wchar' field of /proc/self/io, or the last value read if
+ *           it can't be read this time
+ *     Note: pread() at offset 0 re-reads the file without reopening it.
+ */
+long tty_bytes()
+{
+    char buf[512];
+    char * p;
+    ssize_t n;
+
+    n = pread(io_fd, buf, sizeof(buf) - 1, 0);
+    if(n <= 0)
+        return io_last;
+
+    buf[n] = '\0';
+    p = strstr(buf, WCHAR_KEY);
+    if(p == NULL)
+        return io_last;
+
+    return atol(p + strlen(WCHAR_KEY));
+}
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+const struct backend curses_backend = {
+    "curses", cb_open, cb_put, cb_update, cb_resize, cb_close
+};
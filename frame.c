@@ -0,0 +1,557 @@
+/*
+ * ===========================================================================
+ *   FILE: ./frame.c
+ * ===========================================================================
+ * Purpose: Collect everything drawn during a frame, work out which cells
+ *          really changed, and hand only those to a backend in one
+ *          update.
+ *
+ * Interface:
+ *      frame_init()            -- size the frame and pick its backend
+ *      frame_resize()          -- size it again, for a resized screen
+ *      frame_put()             -- put a char at a row and column
+ *      frame_print()           -- print formatted text at a row and column
+ *      frame_print_standout()  -- print formatted text in reverse-video
+ *      frame_erase()           -- put back the static layer at a cell
+ *      frame_blit()            -- copy a rectangle of the static layer in
+ *      frame_layer_put()       -- put a char into the static layer
+ *      frame_layer_print()     -- print formatted text into the static layer
+ *      frame_layer_gen()       -- which static layer is current
+ *      frame_repaint()         -- have the whole screen sent again
+ *      frame_flush()           -- send the changed cells to the backend
+ *      frame_get_stats()       -- copy out the output counters
+ *      frame_end()             -- free the frame
+ *      null_backend            -- backend that shows nothing
+ *
+ * Internal functions:
+ *      put_cell()              -- store a cell and extend its row's damage
+ *      put_text()              -- store a string of cells
+ *      frame_alloc()           -- allocate the three copies, blank
+ *      null_open()             -- null backend: does nothing
+ *      null_put()              -- null backend: does nothing
+ *      null_update()           -- null backend: writes no bytes
+ *      null_resize()           -- null backend: does nothing
+ *      null_close()            -- null backend: does nothing
+ *
+ * Notes:
+ *      The frame is file-scoped to frame.c. The ball, paddle and court draw
+ *      through this interface rather than calling curses themselves, and
+ *      none of them refresh the screen. The frame doesn't know about
+ *      curses either: the cells that changed go to a backend (backend.h),
+ *      either curses_backend or, when there is no screen, null_backend.
+ *
+ *      The frame keeps two copies of the screen: 'back', what has been
+ *      drawn so far, and 'front', what was last sent on. Drawing
+ *      only changes 'back', and widens a damaged span for that row. When
+ *      the frame is flushed, just the cells inside each row's span are
+ *      compared, and those that differ from 'front' are handed to the
+ *      backend before a single update. So a HUD string that is reprinted
+ *      with the same text, or a ball that is erased and drawn again in the
+ *      same spot, never reaches the backend at all, and a frame in which
+ *      nothing changed costs no output.
+ *
+ *      A third copy, 'layer', holds what never moves: the court's walls
+ *      and labels, drawn into it once when the court is laid out. It is
+ *      never sent on by itself. frame_blit() copies it under whatever is
+ *      drawn next, so a whole court is redrawn in one call, and
+ *      frame_erase() puts back the one cell under a ball or paddle that
+ *      has moved on, so a wall or label it passed over isn't left blank.
+ *      The layer starts blank with every frame_init() and frame_resize();
+ *      frame_layer_gen() changes each time, so whatever drew into it knows
+ *      to draw again.
+ *
+ *      Counters are kept for frames, refreshes, cells drawn and cells
+ *      changed, along with the bytes written if the backend counts them.
+ */
+
+/* INCLUDES */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "backend.h"
+#include "frame.h"
+#include "pong.h"
+
+/* CONSTANTS */
+#define TEXT_MAX 256            // longest string frame_print() will draw
+
+/* FRAME STRUCT */
+struct frame {
+    int lines, cols;            // size of the screen
+    unsigned short * back;      // cells drawn for this frame
+    unsigned short * front;     // cells last sent to the backend
+    unsigned short * layer;     // the static layer, under what is drawn
+    int layer_gen;              // bumped each time the layer starts blank
+    int * dmg_lo, * dmg_hi;     // damaged span in each row; lo > hi if none
+    int damaged;                // any damage since the last flush
+    const struct backend * be;  // where changed cells are sent
+    struct frame_stats stats;
+};
+
+static struct frame frame = {
+    0, 0, NULL, NULL, NULL, 0, NULL, NULL, 0, &null_backend
+};
+
+/*
+ * ===========================================================================
+ * INTERNAL FUNCTIONS
+ * ===========================================================================
+ */
+static void put_cell(int, int, unsigned short);
+static void put_text(int, int, const char *, unsigned short);
+static void damage(int, int, int);
+static void frame_alloc(int, int);
+static void null_open(int, int, int);
+static void null_put(int, int, unsigned short);
+static long null_update();
+static void null_resize(int, int);
+static void null_close();
+
+/*
+ *  put_cell()
+ *  Purpose: Store a cell in the back copy and note the damage
+ *    Input: y, x, the row and column
+ *           cell, the char, plus CELL_STANDOUT if reverse-video
+ *     Note: Cells off the screen are ignored. A cell that already holds
+ *           the same value is counted as touched, but isn't damage.
+ */
+void put_cell(int y, int x, unsigned short cell)
+{
+    int i;
+
+    if(y < 0 || y >= frame.lines || x < 0 || x >= frame.cols)
+        return;
+
+    frame.stats.cells_touched++;
+
+    i = (y * frame.cols) + x;
+    if(frame.back[i] == cell)
+        return;
+
+    frame.back[i] = cell;
+    damage(y, x, x);
+
+    return;
+}
+
+/*
+ *  damage()
+ *  Purpose: Widen a row's damaged span to take in some columns
+ *    Input: y, the row
+ *           lo, hi, the first and last columns changed
+ */
+void damage(int y, int lo, int hi)
+{
+    if(lo < frame.dmg_lo[y])
+        frame.dmg_lo[y] = lo;
+    if(hi > frame.dmg_hi[y])
+        frame.dmg_hi[y] = hi;
+    frame.damaged = 1;
+
+    return;
+}
+
+/*
+ *  put_text()
+ *  Purpose: Store a string as a run of cells along one row
+ *    Input: y, x, where the string starts
+ *           s, the string
+ *           attr, 0 or CELL_STANDOUT
+ */
+void put_text(int y, int x, const char * s, unsigned short attr)
+{
+    for( ; *s != '\0'; s++, x++)
+        put_cell(y, x, (unsigned char) *s | attr);
+
+    return;
+}
+
+/*
+ *  frame_alloc()
+ *  Purpose: Allocate the frame for a screen of the given size, blank and
+ *           with no damage
+ *    Input: lines, cols, the size of the screen
+ *     Note: Any copies allocated before are freed, the static layer with
+ *           them, so it starts a new generation.
+ *    Error: If memory can't be allocated, close curses, print a message
+ *           to stderr and exit.
+ */
+void frame_alloc(int lines, int cols)
+{
+    int i, cells = lines * cols;
+
+    free(frame.back);
+    free(frame.dmg_lo);
+    frame.lines = lines;
+    frame.cols = cols;
+    frame.back = malloc(3 * cells * sizeof(unsigned short));
+    frame.dmg_lo = malloc(2 * lines * sizeof(int));
+
+    if(frame.back == NULL || frame.dmg_lo == NULL)
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Couldn't allocate memory for the frame.\n");
+        exit(1);
+    }
+
+    frame.front = frame.back + cells;
+    frame.layer = frame.front + cells;
+    frame.dmg_hi = frame.dmg_lo + lines;
+    frame.layer_gen++;
+
+    for(i = 0; i < 3 * cells; i++)
+        frame.back[i] = BLANK;
+
+    for(i = 0; i < lines; i++)
+    {
+        frame.dmg_lo[i] = cols;
+        frame.dmg_hi[i] = -1;
+    }
+
+    frame.damaged = 0;
+    return;
+}
+
+/*
+ *  null_open(), null_put(), null_update(), null_resize(), null_close()
+ *  Purpose: The null backend, for when there is nothing to draw on
+ */
+void null_open(int lines, int cols, int count_bytes)
+{
+    return;
+}
+
+void null_put(int y, int x, unsigned short cell)
+{
+    return;
+}
+
+long null_update()
+{
+    return 0;
+}
+
+void null_resize(int lines, int cols)
+{
+    return;
+}
+
+void null_close()
+{
+    return;
+}
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  frame_init()
+ *  Purpose: Allocate the frame for a screen of the given size
+ *    Input: lines, cols, the size of the screen
+ *           be, the backend to send changed cells to
+ *           count_bytes, non-zero to have the backend count its output
+ *     Note: Both copies start out blank, matching the cleared screen that
+ *           initscr() leaves.
+ *    Error: If memory can't be allocated, close curses, print a message
+ *           to stderr and exit.
+ */
+void frame_init(int lines, int cols, const struct backend * be,
+                int count_bytes)
+{
+    frame_alloc(lines, cols);
+    memset(&frame.stats, 0, sizeof(frame.stats));
+
+    frame.be = be;
+    frame.be->open(lines, cols, count_bytes);
+
+    return;
+}
+
+/*
+ *  frame_resize()
+ *  Purpose: Size the frame again, when the screen has changed size
+ *    Input: lines, cols, the new size of the screen
+ *   Method: Start again from blank copies, as frame_init() does, and have
+ *           the backend clear the screen to match. Whatever was drawn is
+ *           gone, so everything has to be drawn again; the counters are
+ *           kept.
+ *     Note: Anything drawn off the new screen is ignored, so a court
+ *           bigger than the screen is just cut short.
+ */
+void frame_resize(int lines, int cols)
+{
+    frame_alloc(lines, cols);
+    frame.be->resize(lines, cols);
+
+    return;
+}
+
+/*
+ *  frame_put()
+ *  Purpose: Draw a single char as part of the current frame
+ *    Input: y, x, the row and column to draw at
+ *           c, the char to draw
+ */
+void frame_put(int y, int x, char c)
+{
+    put_cell(y, x, (unsigned char) c);
+    return;
+}
+
+/*
+ *  frame_print()
+ *  Purpose: Draw printf-style text as part of the current frame
+ *    Input: y, x, the row and column the text starts at
+ *           fmt, ..., as for printf()
+ *     Note: The text is formatted every time, but only the chars that
+ *           differ from what is already in the frame count as damage.
+ */
+void frame_print(int y, int x, const char * fmt, ...)
+{
+    char buf[TEXT_MAX];
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+
+    put_text(y, x, buf, 0);
+    return;
+}
+
+/*
+ *  frame_print_standout()
+ *  Purpose: As frame_print(), but in reverse-text
+ */
+void frame_print_standout(int y, int x, const char * fmt, ...)
+{
+    char buf[TEXT_MAX];
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+
+    put_text(y, x, buf, CELL_STANDOUT);
+    return;
+}
+
+/*
+ *  frame_erase()
+ *  Purpose: Take whatever was drawn off a cell, leaving the static layer
+ *    Input: y, x, the row and column
+ */
+void frame_erase(int y, int x)
+{
+    if(y < 0 || y >= frame.lines || x < 0 || x >= frame.cols)
+        return;
+
+    put_cell(y, x, frame.layer[(y * frame.cols) + x]);
+    return;
+}
+
+/*
+ *  frame_blit()
+ *  Purpose: Copy a rectangle of the static layer into the frame, over
+ *           whatever was drawn there
+ *    Input: top, left, bot, right, the first and last rows and columns
+ *   Method: Row by row, memcmp() the run against the layer, and where it
+ *           differs find the first and last cells that do, copy the run
+ *           between them in one go and damage just that much. A rectangle
+ *           that already matches costs a memcmp() a row and no damage.
+ *     Note: The parts off the screen are left out. Whatever moves has to
+ *           be drawn again on top.
+ */
+void frame_blit(int top, int left, int bot, int right)
+{
+    unsigned short * back, * layer;
+    int y, lo, hi;
+
+    if(top < 0)
+        top = 0;
+    if(left < 0)
+        left = 0;
+    if(bot >= frame.lines)
+        bot = frame.lines - 1;
+    if(right >= frame.cols)
+        right = frame.cols - 1;
+
+    for(y = top; y <= bot && left <= right; y++)
+    {
+        frame.stats.cells_touched += right - left + 1;
+        back = frame.back + (y * frame.cols);
+        layer = frame.layer + (y * frame.cols);
+        if( memcmp(back + left, layer + left,
+                   (right - left + 1) * sizeof(*back)) == 0 )
+            continue;
+
+        for(lo = left; lo <= right && back[lo] == layer[lo]; lo++)
+            ;
+        if(lo > right)
+            continue;
+        for(hi = right; back[hi] == layer[hi]; hi--)
+            ;
+
+        memcpy(back + lo, layer + lo, (hi - lo + 1) * sizeof(*back));
+        damage(y, lo, hi);
+    }
+
+    return;
+}
+
+/*
+ *  frame_layer_put()
+ *  Purpose: Draw a single char into the static layer
+ *    Input: y, x, the row and column to draw at
+ *           c, the char to draw
+ *     Note: Nothing shows until the layer is blitted (or erased to).
+ */
+void frame_layer_put(int y, int x, char c)
+{
+    if(y < 0 || y >= frame.lines || x < 0 || x >= frame.cols)
+        return;
+
+    frame.layer[(y * frame.cols) + x] = (unsigned char) c;
+    return;
+}
+
+/*
+ *  frame_layer_print()
+ *  Purpose: As frame_print(), but into the static layer
+ */
+void frame_layer_print(int y, int x, const char * fmt, ...)
+{
+    char buf[TEXT_MAX];
+    const char * s;
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+
+    for(s = buf; *s != '\0'; s++, x++)
+        frame_layer_put(y, x, *s);
+    return;
+}
+
+/*
+ *  frame_layer_gen()
+ *  Purpose: Tell whether the static layer has started blank again
+ *   Return: a number that changes whenever it does, and never comes back
+ *     Note: 0 until the frame is first allocated.
+ */
+int frame_layer_gen()
+{
+    return frame.layer_gen;
+}
+
+/*
+ *  frame_repaint()
+ *  Purpose: Have the whole frame sent again, for a screen that was
+ *           overwritten behind the frame's back
+ *   Method: Have the backend clear the screen, take 'front' to be blank
+ *           to match, and damage every row, so the next frame_flush()
+ *           sends whatever isn't blank. Nothing has to be drawn again.
+ */
+void frame_repaint()
+{
+    int i, cells = frame.lines * frame.cols;
+
+    for(i = 0; i < cells; i++)
+        frame.front[i] = BLANK;
+    for(i = 0; i < frame.lines; i++)
+        damage(i, 0, frame.cols - 1);
+
+    frame.be->resize(frame.lines, frame.cols);
+    return;
+}
+
+/*
+ *  frame_flush()
+ *  Purpose: Send the cells that changed this frame to the terminal
+ *   Return: the number of cells sent; 0 if the terminal was left alone
+ *   Method: Walk each row's damaged span and hand the backend only the
+ *           cells that differ from 'front', updating 'front' as we go. If
+ *           any did, have the backend update the screen once. Then clear
+ *           the damage for the next frame.
+ */
+int frame_flush()
+{
+    int y, x, i, changed = 0;
+    unsigned short cell;
+    long bytes;
+
+    frame.stats.frames++;
+    if(!frame.damaged)
+        return 0;
+
+    for(y = 0; y < frame.lines; y++)
+    {
+        for(x = frame.dmg_lo[y]; x <= frame.dmg_hi[y]; x++)
+        {
+            i = (y * frame.cols) + x;
+            cell = frame.back[i];
+            if(cell == frame.front[i])
+                continue;
+
+            frame.be->put(y, x, cell);
+            frame.front[i] = cell;
+            changed++;
+        }
+
+        frame.dmg_lo[y] = frame.cols;
+        frame.dmg_hi[y] = -1;
+    }
+    frame.damaged = 0;
+
+    if(changed == 0)
+        return 0;
+
+    bytes = frame.be->update();
+
+    frame.stats.refreshes++;
+    frame.stats.cells_changed += changed;
+    frame.stats.bytes += bytes;
+    if(bytes > frame.stats.max_bytes)
+        frame.stats.max_bytes = bytes;
+
+    return changed;
+}
+
+/*
+ *  frame_get_stats()
+ *  Purpose: Public function to access the frame's output counters
+ *    Input: sp, pointer to a struct to copy the counters into
+ */
+void frame_get_stats(struct frame_stats * sp)
+{
+    *sp = frame.stats;
+    return;
+}
+
+/*
+ *  frame_end()
+ *  Purpose: Free the frame and close its backend
+ */
+void frame_end()
+{
+    if(frame.back != NULL)
+        frame.be->close();
+
+    free(frame.back);
+    free(frame.dmg_lo);
+    frame.back = frame.front = frame.layer = NULL;
+    frame.dmg_lo = frame.dmg_hi = NULL;
+    frame.lines = frame.cols = 0;
+    frame.be = &null_backend;
+
+    return;
+}
+
+const struct backend null_backend = {
+    "null", null_open, null_put, null_update, null_resize, null_close
+};
@@ -0,0 +1,35 @@
+/*
+ * ==========================
+ *   FILE: ./frame.h
+ * ==========================
+ * Purpose: Header file for frame.c
+ */
+
+/* OPAQUE STRUCT */
+struct backend;
+
+/* OUTPUT COUNTERS */
+struct frame_stats {
+    long frames;            // frame_flush() calls
+    long refreshes;         // flushes that updated the terminal
+    long cells_touched;     // cells drawn, whether changed or not
+    long cells_changed;     // cells that differed and were sent
+    long bytes;             // bytes written to the tty (if counting)
+    long max_bytes;         // most bytes written by a single flush
+};
+
+/* EXTERNAL INTERFACE */
+void frame_init(int, int, const struct backend *, int);
+void frame_resize(int, int);
+void frame_put(int, int, char);
+void frame_print(int, int, const char *, ...);
+void frame_print_standout(int, int, const char *, ...);
+void frame_erase(int, int);
+void frame_blit(int, int, int, int);
+void frame_layer_put(int, int, char);
+void frame_layer_print(int, int, const char *, ...);
+int frame_layer_gen();
+void frame_repaint();
+int frame_flush();
+void frame_get_stats(struct frame_stats *);
+void frame_end();
\ No newline at end of file
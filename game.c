@@ -0,0 +1,516 @@
+/*
+ * ===========================================================================
+ *   FILE: ./game.c
+ * ===========================================================================
+ * Purpose: The rules of one-player pong, with no terminal attached.
+ *
+ * Interface:
+ *      new_game()          -- set up the court, clock, paddle and balls
+ *      game_tick()         -- advance the game by one tick
+ *      game_tick_name()    -- the preset whose tick the game takes
+ *      game_paddle()       -- move the paddle up or down one row
+ *      game_left_paddle()  -- move the second player's paddle, on the left
+ *      game_aim()          -- which way the paddle must move to meet the ball
+ *      game_predict()      -- which way to move to where the ball will be
+ *      game_next_change()  -- ticks until anything can change but the time
+ *      game_draw()         -- draw whatever changed into the frame
+ *      game_redraw()       -- draw all of it again, from the court up
+ *      game_relayout()     -- move the walls, and everything with them
+ *      game_balls_left()   -- number of balls (lives) left
+ *      game_balls_in_play()-- number of balls on the court
+ *      game_hits()         -- paddle returns, and balls served, so far
+ *      game_ball_positions()-- where the balls in play are
+ *      game_paddle_rows()  -- the rows a paddle covers
+ *      game_court()        -- the game's court
+ *      game_clock()        -- the game's clock
+ *      game_save()         -- copy the state of the game into a snapshot
+ *      game_load()         -- set the game back to a snapshot
+ *      game_end()          -- free the game and everything in it
+ *
+ * Internal functions:
+ *      next_round()        -- after a move, check for a lost ball
+ *
+ * Notes:
+ *      Everything one game needs is in its struct ppgame: its own court,
+ *      clock, paddle and balls (with their random number streams), and no
+ *      game state is kept anywhere else. So any number of games can be
+ *      played at once, on any number of threads (see sim.c), as long as
+ *      each game is only used by one thread at a time.
+ *
+ *      All of a game's objects, and the game itself, are allocated one
+ *      after another from an arena (arena.c): one the caller gives
+ *      new_game(), or else one of its own. game_end() gives it all back
+ *      at once, so a run of games can play them in the same memory over
+ *      and over, with no malloc() or free() once the first has been set
+ *      up (and none between rounds: serve() only reuses the balls).
+ *
+ *      A game for two players (see net.c) has a second paddle on the left
+ *      edge of the court, where the wall would be, and a ball that gets
+ *      past either paddle is out of play. The two share the balls (lives)
+ *      and the clock: they last as long as they can together.
+ *
+ *      Nothing here (or in ball.c, paddle.c, court.c or clock.c) talks to
+ *      curses or reads the screen size: positions come from the court
+ *      edges given to new_game(), and drawing only goes into the frame
+ *      (frame.c), which passes it on to whichever backend it was given.
+ *      That lets the same rules run in the terminal (pong.c) or with no
+ *      screen at all and as fast as the CPU allows (headless.c, sim.c).
+ */
+
+/* INCLUDES */
+#include <stdio.h>
+#include <stdlib.h>
+#include "arena.h"
+#include "ball.h"
+#include "clock.h"
+#include "court.h"
+#include "game.h"
+#include "paddle.h"
+#include "pong.h"
+
+/* CONSTANTS */
+#define ARENA_BASE 20480    // an arena of its own: the grid's cells and the
+#define ARENA_PER_BALL 128  // small objects, and then this much per ball
+
+/* GAME STRUCT */
+struct ppgame {
+    struct pparena * arena;     // where all of it was allocated
+    int own_arena;              // 1 if the game made it, and frees it
+    struct ppcourt * court;
+    struct ppclock * clock;
+    struct pppaddle * paddle;
+    struct pppaddle * left;     // second player's paddle, or NULL
+    struct ppball * ball;
+};
+
+/*
+ * ===========================================================================
+ * INTERNAL FUNCTIONS
+ * ===========================================================================
+ */
+static int next_round(struct ppgame *, int);
+
+/*
+ *  next_round()
+ *  Purpose: After ball or paddle movement, see if it is LOSE. If yes,
+ *           start a new round.
+ *    Input: gp, the game
+ *           contact, what bounce_or_lose() (or ball_tick()) returned
+ *   Return: GAME_OVER if that was the last ball, otherwise GAME_ON
+ */
+int next_round(struct ppgame * gp, int contact)
+{
+    if(contact == LOSE)
+    {
+        if(get_balls_left(gp->ball) > 0)    // more balls left
+            serve(gp->ball);                // start again
+        else
+            return GAME_OVER;               // no more balls
+    }
+
+    return GAME_ON;
+}
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  new_game()
+ *  Purpose: Start a new game and serve the first ball
+ *    Input: arena, an empty arena for the game to be allocated from, or
+ *           NULL for the game to make one of its own
+ *           top, right, bot, left, the rows and columns of the walls
+ *           tick_rate, game ticks in one second of play
+ *           balls, how many balls each serve puts in play (1 is classic)
+ *           seed, for every random choice made in the game; the same seed
+ *           and the same moves always play out the same game
+ *           players, 1, or 2 for a paddle on the left as well
+ *   Return: a pointer to the game
+ *    Error: If malloc fails, close curses, print a message and exit.
+ */
+struct ppgame * new_game(struct pparena * arena, int top, int right,
+                         int bot, int left, int tick_rate, int balls,
+                         uint64_t seed, int players)
+{
+    struct ppgame * gp;
+    int own = (arena == NULL);
+
+    if(own)                             // sized to hold it all in one
+        arena = new_arena(ARENA_BASE + ((size_t) balls * ARENA_PER_BALL));
+
+    if( (gp = arena_alloc(arena, sizeof(struct ppgame))) == NULL )
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Couldn't allocate memory for a game.\n");
+        exit(1);
+    }
+
+    gp->arena = arena;
+    gp->own_arena = own;
+    gp->court = new_court(arena, top, right, bot, left, players);
+    gp->paddle = new_paddle(arena, gp->court, RIGHT_SIDE);  // a paddle
+    gp->left = (players == 2) ? new_paddle(arena, gp->court, LEFT_SIDE)
+                              : NULL;
+    gp->ball = new_ball(arena, gp->court, balls, seed);     // the balls
+    gp->clock = new_clock(arena, tick_rate);                // the clock
+    serve(gp->ball);                                        // first ball
+
+    return gp;
+}
+
+/*
+ *  game_tick()
+ *  Purpose: Advance the game by one tick
+ *    Input: gp, the game
+ *   Return: GAME_OVER once the last ball is lost, otherwise GAME_ON
+ *   Method: Update the clock, then move the balls and check them against
+ *           the walls and paddles, in one ball_tick().
+ *     Note: A game set up as one of the presets (preset.h) takes a tick
+ *           compiled for it; see game_tick_name().
+ */
+int game_tick(struct ppgame * gp)
+{
+    clock_tick(gp->clock);              // update clock
+    return next_round(gp, ball_tick(gp->ball, gp->paddle, gp->left));
+}
+
+/*
+ *  game_tick_name()
+ *  Purpose: Say which tick the game takes
+ *    Input: gp, the game
+ *   Return: the name of the preset it was set up as, or "generic"
+ */
+const char * game_tick_name(struct ppgame * gp)
+{
+    return ball_tick_name(gp->ball);
+}
+
+/*
+ *  game_paddle()
+ *  Purpose: Move the paddle and check if it made contact with ball
+ *    Input: gp, the game
+ *           dir, PADDLE_UP or PADDLE_DOWN; anything else is ignored
+ *   Return: GAME_OVER if moving the paddle lost the last ball
+ */
+int game_paddle(struct ppgame * gp, int dir)
+{
+    if(dir == PADDLE_UP)
+        paddle_up(gp->paddle);
+    else if(dir == PADDLE_DOWN)
+        paddle_down(gp->paddle);
+    else
+        return GAME_ON;
+
+    return next_round(gp, bounce_or_lose(gp->ball, gp->paddle, gp->left));
+}
+
+/*
+ *  game_left_paddle()
+ *  Purpose: Move the left paddle, as game_paddle() moves the right one
+ *    Input: gp, the game
+ *           dir, PADDLE_UP or PADDLE_DOWN; anything else is ignored, as is
+ *           a game with one player
+ *   Return: GAME_OVER if moving the paddle lost the last ball
+ */
+int game_left_paddle(struct ppgame * gp, int dir)
+{
+    if(gp->left == NULL)
+        return GAME_ON;
+    else if(dir == PADDLE_UP)
+        paddle_up(gp->left);
+    else if(dir == PADDLE_DOWN)
+        paddle_down(gp->left);
+    else
+        return GAME_ON;
+
+    return next_round(gp, bounce_or_lose(gp->ball, gp->paddle, gp->left));
+}
+
+/*
+ *  game_aim()
+ *  Purpose: Tell a computer player which way to move
+ *    Input: gp, the game
+ *   Return: PADDLE_UP or PADDLE_DOWN to move towards the row of the ball
+ *           that will reach the paddle first, or 0 if the paddle already
+ *           covers it (or there is no ball in play)
+ */
+int game_aim(struct ppgame * gp)
+{
+    int y = get_ball_y(gp->ball);
+
+    return (y == -1) ? 0 : paddle_aim(gp->paddle, y);
+}
+
+/*
+ *  game_next_change()
+ *  Purpose: Say how many ticks from now the first that can change anything
+ *           in the game, or on the screen, is
+ *    Input: gp, the game
+ *   Return: 1 for the next tick, or more if the ticks before that one only
+ *           move the balls on inside their cells and count towards the next
+ *           second, so they can be run together, later, with the one that
+ *           counts, and play out the same (see ticker_wake_after())
+ *   Method: Whichever comes first of the balls' next move (see
+ *           ball_next_move()) and the clock's next second.
+ *     Note: Only the ticks themselves are counted on: a paddle moved in
+ *           the meantime may change what they do, so the caller has to
+ *           wake for every tick while moves are waiting.
+ */
+int game_next_change(struct ppgame * gp)
+{
+    int balls = ball_next_move(gp->ball);
+    int secs = clock_next_sec(gp->clock);
+
+    return (secs < balls) ? secs : balls;
+}
+
+/*
+ *  game_predict()
+ *  Purpose: Tell a computer player which way to move to meet the ball
+ *           where it will reach the paddle, not where it is now
+ *    Input: gp, the game
+ *   Return: PADDLE_UP or PADDLE_DOWN to move towards the row the next ball
+ *           will meet the paddle on, or 0 if the paddle already covers it
+ *           (or there is no ball in play)
+ *     Note: Answers with the same moves as game_aim(), for game_paddle(),
+ *           and costs about as little: the row is worked out from the
+ *           balls' velocities (see get_ball_intercept()), without playing
+ *           any ticks ahead.
+ */
+int game_predict(struct ppgame * gp)
+{
+    int y = get_ball_intercept(gp->ball);
+
+    return (y == -1) ? 0 : paddle_aim(gp->paddle, y);
+}
+
+/*
+ *  game_draw()
+ *  Purpose: Draw the paddle, ball and headers into the frame
+ *    Input: gp, the game
+ *     Note: Nothing reaches the screen until frame_flush() is called.
+ *           There is one frame, so only one game should draw.
+ */
+void game_draw(struct ppgame * gp)
+{
+    paddle_draw(gp->paddle);
+    if(gp->left != NULL)
+        paddle_draw(gp->left);
+    ball_draw(gp->ball);
+    print_time(gp->court, gp->clock);
+    print_balls(gp->court, get_balls_left(gp->ball));
+
+    return;
+}
+
+/*
+ *  game_redraw()
+ *  Purpose: Draw the whole game into the frame again, court and all
+ *    Input: gp, the game
+ *   Method: print_court() blits the court from the frame's static layer,
+ *           over the paddles and balls, so the paddles are told to draw
+ *           all of themselves, and then everything is drawn as usual. The
+ *           balls are drawn in full every frame anyway.
+ *     Note: For after the frame was resized, or the game laid out again.
+ */
+void game_redraw(struct ppgame * gp)
+{
+    print_court(gp->court, gp->clock, get_balls_left(gp->ball));
+    paddle_redraw(gp->paddle);
+    if(gp->left != NULL)
+        paddle_redraw(gp->left);
+    game_draw(gp);
+
+    return;
+}
+
+/*
+ *  game_relayout()
+ *  Purpose: Move the walls of a game in play, as when the terminal is
+ *           resized
+ *    Input: gp, the game
+ *           top, right, bot, left, the rows and columns of the new walls
+ *   Method: The court is moved first, then the balls and paddles are put
+ *           the same fraction of the way across it as they were, with the
+ *           paddles sized again to a third of its height. The clock, the
+ *           lives and every ball's direction and speed are kept.
+ *     Note: The positions are the game's state, so a relaid game no
+ *           longer plays out as the same game would have on the old court.
+ *           The caller clears the screen and prints the court again (see
+ *           frame_resize()); the balls and paddles show on the next
+ *           game_draw().
+ */
+void game_relayout(struct ppgame * gp, int top, int right, int bot, int left)
+{
+    int old_top = get_top_edge(gp->court), old_bot = get_bot_edge(gp->court);
+    int old_left = get_left_edge(gp->court);
+    int old_right = get_right_edge(gp->court);
+
+    court_relayout(gp->court, top, right, bot, left);
+    ball_relayout(gp->ball, old_top, old_right, old_bot, old_left);
+    paddle_relayout(gp->paddle, gp->court);
+    if(gp->left != NULL)
+        paddle_relayout(gp->left, gp->court);
+
+    return;
+}
+
+/*
+ *  game_balls_left()
+ *  Purpose: Public function to access the balls left in this game
+ *    Input: gp, the game
+ *   Return: the number of balls (lives) left
+ */
+int game_balls_left(struct ppgame * gp)
+{
+    return get_balls_left(gp->ball);
+}
+
+/*
+ *  game_balls_in_play()
+ *  Purpose: Public function to access the balls on the court
+ *    Input: gp, the game
+ *   Return: the number of balls from this serve still in play
+ */
+int game_balls_in_play(struct ppgame * gp)
+{
+    return get_balls_in_play(gp->ball);
+}
+
+/*
+ *  game_hits()
+ *  Purpose: Count how many times the paddles sent a ball back
+ *    Input: gp, the game
+ *   Output: served, if not NULL, set to how many balls have been put in
+ *           play
+ *   Return: the paddle returns since new_game()
+ *     Note: Only counts, for reports: a snapshot doesn't keep them.
+ */
+long game_hits(struct ppgame * gp, long * served)
+{
+    if(served != NULL)
+        *served = get_balls_served(gp->ball);
+
+    return get_ball_hits(gp->ball);
+}
+
+/*
+ *  game_ball_positions()
+ *  Purpose: Public function to see where the balls in play are
+ *    Input: gp, the game
+ *   Output: x, y, their columns and rows (see get_ball_positions())
+ *   Return: the number of balls in play
+ */
+int game_ball_positions(struct ppgame * gp, const int ** x, const int ** y)
+{
+    return get_ball_positions(gp->ball, x, y);
+}
+
+/*
+ *  game_paddle_rows()
+ *  Purpose: Public function to see where a paddle is
+ *    Input: gp, the game
+ *           side, RIGHT_SIDE or LEFT_SIDE
+ *   Output: top, bot, the first and last rows it covers
+ *   Return: 0, or -1 if the game has no paddle on that side
+ */
+int game_paddle_rows(struct ppgame * gp, int side, int * top, int * bot)
+{
+    struct pppaddle * pp = (side == LEFT_SIDE) ? gp->left : gp->paddle;
+
+    if(pp == NULL)
+        return -1;
+
+    *top = get_pad_top(pp);
+    *bot = get_pad_bot(pp);
+    return 0;
+}
+
+/*
+ *  game_court()
+ *  Purpose: Public function to access the game's court, for drawing it
+ *    Input: gp, the game
+ */
+struct ppcourt * game_court(struct ppgame * gp)
+{
+    return gp->court;
+}
+
+/*
+ *  game_clock()
+ *  Purpose: Public function to access the game's clock, e.g. to read how
+ *           long it has lasted with get_mins() and get_secs()
+ *    Input: gp, the game
+ */
+struct ppclock * game_clock(struct ppgame * gp)
+{
+    return gp->clock;
+}
+
+/*
+ *  game_save()
+ *  Purpose: Copy everything that changes as the game is played into a
+ *           snapshot, to pick it up again later (see replay.c)
+ *    Input: gp, the game
+ *           buf, where to copy it, or NULL just to ask the size
+ *   Return: the number of bytes it takes; the same for every game with
+ *           the same balls per serve and court
+ *     Note: The court is fixed by new_game(), so it isn't saved. The bytes
+ *           are in the machine's own layout (they are only read back by
+ *           the same build), but there are no pointers in them.
+ */
+int game_save(struct ppgame * gp, unsigned char * buf)
+{
+    int n = clock_save(gp->clock, buf);
+
+    n += paddle_save(gp->paddle, (buf != NULL) ? buf + n : NULL);
+    if(gp->left != NULL)
+        n += paddle_save(gp->left, (buf != NULL) ? buf + n : NULL);
+    n += ball_save(gp->ball, (buf != NULL) ? buf + n : NULL);
+
+    return n;
+}
+
+/*
+ *  game_load()
+ *  Purpose: Set a game back to a snapshot
+ *    Input: gp, a game made by new_game() with the same court, tick rate,
+ *           balls and players as the one saved
+ *           buf, what game_save() wrote
+ *     Note: The game then plays on exactly as the saved one did. Draw it
+ *           into a clean frame (see ball_load()).
+ */
+void game_load(struct ppgame * gp, const unsigned char * buf)
+{
+    buf += clock_load(gp->clock, buf);
+    buf += paddle_load(gp->paddle, buf);
+    if(gp->left != NULL)
+        buf += paddle_load(gp->left, buf);
+    ball_load(gp->ball, buf);
+
+    return;
+}
+
+/*
+ *  game_end()
+ *  Purpose: free memory used by the game objects, and the game
+ *    Input: gp, the game; NULL is ignored
+ *   Method: Everything is in the arena, so one call gives it all back: an
+ *           arena the game made is freed, and one it was given is reset,
+ *           ready for the next game.
+ */
+void game_end(struct ppgame * gp)
+{
+    if(gp == NULL)
+        return;
+
+    if(gp->own_arena)
+        arena_free(gp->arena);
+    else
+        arena_reset(gp->arena);
+
+    return;
+}
@@ -0,0 +1,44 @@
+/*
+ * ==========================
+ *   FILE: ./game.h
+ * ==========================
+ * Purpose: Header file for game.c
+ */
+
+/* INCLUDES */
+#include <stdint.h>
+
+/* CONSTANTS */
+#define GAME_ON 0
+#define GAME_OVER 1
+#define GAME_QUIT 2         // the player (or a replay) stopped the game
+
+/* OPAQUE STRUCTS */
+struct pparena;
+struct ppclock;
+struct ppcourt;
+struct ppgame;
+
+/* EXTERNAL INTERFACE */
+struct ppgame * new_game(struct pparena *, int, int, int, int, int, int,
+                         uint64_t, int);
+int game_tick(struct ppgame *);
+const char * game_tick_name(struct ppgame *);
+int game_paddle(struct ppgame *, int);
+int game_left_paddle(struct ppgame *, int);
+int game_aim(struct ppgame *);
+int game_predict(struct ppgame *);
+int game_next_change(struct ppgame *);
+void game_draw(struct ppgame *);
+void game_redraw(struct ppgame *);
+void game_relayout(struct ppgame *, int, int, int, int);
+int game_balls_left(struct ppgame *);
+int game_balls_in_play(struct ppgame *);
+long game_hits(struct ppgame *, long *);
+int game_ball_positions(struct ppgame *, const int **, const int **);
+int game_paddle_rows(struct ppgame *, int, int *, int *);
+struct ppcourt * game_court(struct ppgame *);
+struct ppclock * game_clock(struct ppgame *);
+int game_save(struct ppgame *, unsigned char *);
+void game_load(struct ppgame *, const unsigned char *);
+void game_end(struct ppgame *);
\ No newline at end of file
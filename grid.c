@@ -0,0 +1,441 @@
+/*
+ * ===========================================================================
+ *   FILE: ./grid.c
+ * ===========================================================================
+ * Purpose: A uniform grid over the court, to find balls that share a spot
+ *          without checking every pair.
+ *
+ * Interface:
+ *      new_grid()          -- allocates an empty grid for up to n balls
+ *      grid_relayout()     -- fits the grid to a court that was resized
+ *      grid_clear()        -- unlinks every ball
+ *      grid_update()       -- relinks the balls that moved since last time
+ *      grid_next_pair()    -- returns the next pair of balls on one spot
+ *      grid_move()         -- follows a ball that changes slot
+ *      grid_save()         -- copies the grid into a snapshot
+ *      grid_load()         -- sets the grid back to a snapshot
+ *
+ * Internal functions:
+ *      cell_link()         -- add a ball to a cell's list
+ *      cell_unlink()       -- take a ball off its cell's list
+ *      cell_of()           -- which cell a position falls in
+ *      grid_fit()          -- size the cells to a court
+ *
+ * Notes:
+ *      The inside of the court is cut into square cells get_cell_size()
+ *      chars on a side (new_court() picks the size, see court.c). Each
+ *      cell keeps a list of the balls in it, linked through per-ball
+ *      'next' and 'prev' arrays in the same slot order as the ball arrays
+ *      in ball.c, so no memory is allocated after new_grid(). There is
+ *      room for MAX_CELLS heads whatever the court, so the grid can be
+ *      fitted again in place after the court is resized.
+ *
+ *      The grid is kept up to date incrementally: grid_update() compares
+ *      each ball's position with the one it last saw, and only a ball
+ *      that moved is relinked, and only if it crossed into a new cell.
+ *      The balls that moved are remembered, and they are the only ones
+ *      grid_next_pair() looks for company for: two balls that were
+ *      already on the same spot collided when they first met, so they
+ *      aren't turned round again every tick they stay together.
+ *
+ *      A pair is returned once, however many of the two moved, and only
+ *      while their directions and the ball slots are as they were at the
+ *      last grid_update(); resolving a pair must not move a ball, and
+ *      grid_move() must not be called until the pairs are used up.
+ */
+
+/* INCLUDES */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "court.h"
+#include "grid.h"
+#include "pong.h"
+
+/* CONSTANTS */
+#define GRID_ARRAYS 6       // int arrays kept per ball, see struct ppgrid
+#define START -2            // grid_next_pair(): start of a cell's list
+#define SAVED_ARRAYS 4      // next, prev, cell and key: see grid_save()
+
+/* GRID STRUCT */
+struct ppgrid {
+    int cols, rows, size;       // cells across and down; chars per side
+    int x0, y0;                 // court position of the first cell
+    int max;                    // balls the arrays have room for
+    int stamp;                  // bumped on each grid_update()
+    int nmoved;                 // balls in 'moved'
+    int it_m, it_b;             // grid_next_pair() progress
+    int * head;                 // first ball in each cell, or NOT_LINKED
+    int * next, * prev;         // neighbours in the cell's list
+    int * cell;                 // cell each ball is linked into
+    int * key;                  // position each ball was last seen at
+    int * mark;                 // 'stamp' of the last update it moved in
+    int * moved;                // balls that moved in the last update
+};
+
+/*
+ * ===========================================================================
+ * INTERNAL FUNCTIONS
+ * ===========================================================================
+ */
+static void cell_link(struct ppgrid *, int, int);
+static void cell_unlink(struct ppgrid *, int);
+static int cell_of(struct ppgrid *, int, int);
+static void grid_fit(struct ppgrid *, struct ppcourt *);
+
+/*
+ *  cell_link()
+ *  Purpose: Put ball i at the head of cell c's list
+ */
+void cell_link(struct ppgrid * gp, int i, int c)
+{
+    gp->cell[i] = c;
+    gp->prev[i] = NOT_LINKED;
+    gp->next[i] = gp->head[c];
+
+    if(gp->head[c] != NOT_LINKED)
+        gp->prev[gp->head[c]] = i;
+    gp->head[c] = i;
+
+    return;
+}
+
+/*
+ *  cell_unlink()
+ *  Purpose: Take ball i off whichever cell's list it is on, if any
+ */
+void cell_unlink(struct ppgrid * gp, int i)
+{
+    if(gp->cell[i] == NOT_LINKED)
+        return;
+
+    if(gp->prev[i] != NOT_LINKED)
+        gp->next[gp->prev[i]] = gp->next[i];
+    else
+        gp->head[gp->cell[i]] = gp->next[i];
+
+    if(gp->next[i] != NOT_LINKED)
+        gp->prev[gp->next[i]] = gp->prev[i];
+
+    gp->cell[i] = NOT_LINKED;
+    return;
+}
+
+/*
+ *  cell_of()
+ *  Purpose: Find the cell a court position falls in
+ *   Return: the cell's index; positions off the grid go in the nearest
+ *           cell, so a ball is always linked somewhere
+ */
+int cell_of(struct ppgrid * gp, int x, int y)
+{
+    int cx = (x - gp->x0) / gp->size, cy = (y - gp->y0) / gp->size;
+
+    if(x < gp->x0 || cx < 0)
+        cx = 0;
+    else if(cx >= gp->cols)
+        cx = gp->cols - 1;
+
+    if(y < gp->y0 || cy < 0)
+        cy = 0;
+    else if(cy >= gp->rows)
+        cy = gp->rows - 1;
+
+    return (cy * gp->cols) + cx;
+}
+
+/*
+ *  grid_fit()
+ *  Purpose: Lay the cells over the inside of a court
+ *     Note: new_court() keeps the cell count within MAX_CELLS.
+ */
+void grid_fit(struct ppgrid * gp, struct ppcourt * court)
+{
+    int size = get_cell_size(court);
+    int width = get_right_edge(court) - get_left_edge(court) - 1;
+    int height = get_bot_edge(court) - get_top_edge(court) - 1;
+
+    gp->cols = (width + size - 1) / size;
+    gp->rows = (height + size - 1) / size;
+    if(gp->cols < 1)
+        gp->cols = 1;
+    if(gp->rows < 1)
+        gp->rows = 1;
+
+    gp->size = size;
+    gp->x0 = get_left_edge(court) + 1;
+    gp->y0 = get_top_edge(court) + 1;
+
+    return;
+}
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  new_grid()
+ *  Purpose: Allocate a grid covering the inside of a court
+ *    Input: arena, to allocate from (see arena.c), or NULL for malloc()
+ *           court, the court the balls are in
+ *           max, the most balls it will ever hold
+ *   Return: a pointer to the empty grid
+ *     Note: The struct, the cell heads and the per-ball arrays are one
+ *           allocation.
+ *    Error: If malloc fails, close curses, print a message and exit.
+ */
+struct ppgrid * new_grid(struct pparena * arena, struct ppcourt * court,
+                         int max)
+{
+    struct ppgrid * gp;
+    int * p;
+
+    gp = arena_alloc(arena, sizeof(struct ppgrid) +
+                     (MAX_CELLS + (GRID_ARRAYS * max)) * sizeof(int));
+
+    if(gp == NULL)
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Couldn't allocate memory for the grid.\n");
+        exit(1);
+    }
+
+    grid_fit(gp, court);
+    gp->max = max;
+    gp->stamp = 0;
+
+    p = (int *) (gp + 1);
+    gp->head = p;   p += MAX_CELLS;
+    gp->next = p;   p += max;
+    gp->prev = p;   p += max;
+    gp->cell = p;   p += max;
+    gp->key = p;    p += max;
+    gp->mark = p;   p += max;
+    gp->moved = p;
+
+    grid_clear(gp);
+    return gp;
+}
+
+/*
+ *  grid_relayout()
+ *  Purpose: Fit the grid to its court again, after court_relayout()
+ *     Note: The grid is emptied, as by grid_clear(), so the next
+ *           grid_update() links every ball where it is now.
+ */
+void grid_relayout(struct ppgrid * gp, struct ppcourt * court)
+{
+    grid_fit(gp, court);
+    grid_clear(gp);
+
+    return;
+}
+
+/*
+ *  grid_clear()
+ *  Purpose: Empty the grid, as before a serve
+ *     Note: Every slot is forgotten, so the next grid_update() links all
+ *           the balls it is given, and counts them all as having moved.
+ */
+void grid_clear(struct ppgrid * gp)
+{
+    int i;
+
+    for(i = 0; i < gp->cols * gp->rows; i++)
+        gp->head[i] = NOT_LINKED;
+
+    for(i = 0; i < gp->max; i++)
+    {
+        gp->cell[i] = gp->key[i] = NOT_LINKED;
+        gp->mark[i] = 0;
+    }
+
+    gp->nmoved = 0;
+    gp->it_m = 0;
+    gp->it_b = START;
+
+    return;
+}
+
+/*
+ *  grid_update()
+ *  Purpose: Bring the grid up to date with where the balls are now
+ *    Input: gp, the grid
+ *           x, y, the ball positions, in slot order
+ *           n, how many balls are in play (slots 0 to n-1)
+ *   Return: how many balls moved since the last update
+ *     Note: Positions are keyed by row and column, so a ball that hasn't
+ *           moved costs one compare.
+ */
+int grid_update(struct ppgrid * gp, const int * x, const int * y, int n)
+{
+    int i, c, k, span = gp->cols * gp->size;
+
+    gp->stamp++;
+    gp->nmoved = 0;
+
+    for(i = 0; i < n; i++)
+    {
+        k = ((y[i] - gp->y0) * span) + (x[i] - gp->x0);
+        if(k == gp->key[i])
+            continue;
+
+        gp->key[i] = k;
+        c = cell_of(gp, x[i], y[i]);
+        if(c != gp->cell[i])
+        {
+            cell_unlink(gp, i);
+            cell_link(gp, i, c);
+        }
+
+        gp->mark[i] = gp->stamp;
+        gp->moved[gp->nmoved++] = i;
+    }
+
+    gp->it_m = 0;
+    gp->it_b = START;
+
+    return gp->nmoved;
+}
+
+/*
+ *  grid_next_pair()
+ *  Purpose: Find the next pair of balls on the same spot
+ *    Input: gp, the grid
+ *   Output: a, b, the slots of the two balls; 'a' is one that moved
+ *   Return: 1 if a pair was found, 0 once there are none left
+ *   Method: For each ball that moved, walk the other balls in its cell.
+ *           If both moved, the pair was already returned from the lower
+ *           slot's side (the moved list is in slot order), so it is
+ *           skipped from the higher one. Spots are compared by the keys
+ *           the last grid_update() saved, not the ball positions.
+ */
+int grid_next_pair(struct ppgrid * gp, int * a, int * b)
+{
+    int i, j;
+
+    for( ; gp->it_m < gp->nmoved; gp->it_m++, gp->it_b = START)
+    {
+        i = gp->moved[gp->it_m];
+        j = (gp->it_b == START) ? gp->head[gp->cell[i]] : gp->it_b;
+
+        for( ; j != NOT_LINKED; j = gp->next[j])
+        {
+            if(j == i || gp->key[j] != gp->key[i])
+                continue;
+            if(gp->mark[j] == gp->stamp && j < i)
+                continue;
+
+            gp->it_b = gp->next[j];
+            if(gp->it_b == NOT_LINKED)              // nothing left after j
+            {
+                gp->it_m++;
+                gp->it_b = START;
+            }
+
+            *a = i;
+            *b = j;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ *  grid_move()
+ *  Purpose: Follow the ball arrays when a ball is taken out of play
+ *    Input: gp, the grid
+ *           from, the slot of the ball being moved (the last in play)
+ *           to, the slot it moves into, whose ball is leaving
+ *     Note: Mirrors ball_remove() in ball.c. If from == to, the ball is
+ *           just unlinked.
+ */
+void grid_move(struct ppgrid * gp, int from, int to)
+{
+    cell_unlink(gp, to);
+    if(from == to)
+    {
+        gp->key[to] = NOT_LINKED;
+        return;
+    }
+
+    gp->cell[to] = gp->cell[from];
+    gp->key[to] = gp->key[from];
+    gp->mark[to] = gp->mark[from];
+    gp->prev[to] = gp->prev[from];
+    gp->next[to] = gp->next[from];
+
+    if(gp->cell[to] != NOT_LINKED)
+    {
+        if(gp->prev[to] != NOT_LINKED)
+            gp->next[gp->prev[to]] = to;
+        else
+            gp->head[gp->cell[to]] = to;
+
+        if(gp->next[to] != NOT_LINKED)
+            gp->prev[gp->next[to]] = to;
+    }
+
+    gp->cell[from] = gp->key[from] = NOT_LINKED;
+    return;
+}
+
+/*
+ *  grid_save()
+ *  Purpose: Copy the grid into a snapshot (see replay.c)
+ *    Input: gp, the grid
+ *           buf, where to copy it, or NULL just to ask the size
+ *   Return: the number of bytes it takes
+ *   Method: Which cell each ball is in, its neighbours there and the spot
+ *           it was last seen at are copied as they are, since they decide
+ *           which balls count as moved and the order pairs come out in.
+ *           The 'next', 'prev', 'cell' and 'key' arrays are side by side
+ *           (see new_grid()), so that is one copy. The cell heads can be
+ *           found again from them, and the marks only matter during one
+ *           update, so neither is saved.
+ */
+int grid_save(struct ppgrid * gp, unsigned char * buf)
+{
+    int size = SAVED_ARRAYS * gp->max * sizeof(int);
+
+    if(buf != NULL)
+        memcpy(buf, gp->next, size);
+
+    return size;
+}
+
+/*
+ *  grid_load()
+ *  Purpose: Set the grid back to a snapshot
+ *    Input: gp, a grid for the same court and number of balls
+ *           buf, what grid_save() wrote
+ *   Return: the number of bytes read
+ *     Note: A ball with no 'prev' is the head of its cell's list.
+ */
+int grid_load(struct ppgrid * gp, const unsigned char * buf)
+{
+    int i, size = SAVED_ARRAYS * gp->max * sizeof(int);
+
+    memcpy(gp->next, buf, size);
+
+    for(i = 0; i < gp->cols * gp->rows; i++)
+        gp->head[i] = NOT_LINKED;
+
+    for(i = 0; i < gp->max; i++)
+    {
+        gp->mark[i] = 0;
+        if(gp->cell[i] != NOT_LINKED && gp->prev[i] == NOT_LINKED)
+            gp->head[gp->cell[i]] = i;
+    }
+
+    gp->stamp = 0;
+    gp->nmoved = 0;
+    gp->it_m = 0;
+    gp->it_b = START;
+
+    return size;
+}
@@ -0,0 +1,24 @@
+/*
+ * ==========================
+ *   FILE: ./grid.h
+ * ==========================
+ * Purpose: Header file for grid.c
+ */
+
+/* CONSTANTS */
+#define NOT_LINKED -1
+
+/* OPAQUE STRUCTS */
+struct pparena;
+struct ppcourt;
+struct ppgrid;
+
+/* EXTERNAL INTERFACE */
+struct ppgrid * new_grid(struct pparena *, struct ppcourt *, int);
+void grid_relayout(struct ppgrid *, struct ppcourt *);
+void grid_clear(struct ppgrid *);
+int grid_update(struct ppgrid *, const int *, const int *, int);
+int grid_next_pair(struct ppgrid *, int *, int *);
+void grid_move(struct ppgrid *, int, int);
+int grid_save(struct ppgrid *, unsigned char *);
+int grid_load(struct ppgrid *, const unsigned char *);
\ No newline at end of file
@@ -0,0 +1,200 @@
+/*
+ * ==========================================================================
+ *   FILE: ./headless.c
+ * ==========================================================================
+ * Purpose: Play games of pong with no terminal, as fast as possible.
+ *
+ * Outline: pong-headless runs the same rules as pong (see game.c), but
+ *          with no curses, no screen and no ticker. Each game is stepped
+ *          tick by tick in a tight loop, with a simple computer player on
+ *          the paddle (see autoplay.c), and a summary of how long the games
+ *          lasted and how many ticks (and ball updates, one per ball in
+ *          play per tick) per second were simulated is printed at the end.
+ *          It is meant for soak and regression testing of the physics, and
+ *          for generating play without waiting on the wall clock. The
+ *          games are played one after another on one thread; pong-sim
+ *          (sim.c) plays the same games across all the cores.
+ *
+ *  Player: The player moves the paddle with a fixed chance each tick (-p,
+ *          as a percentage), towards the ball (-b for more than one) that
+ *          will reach it next. At 100 it never misses, so each game is
+ *          also capped at a number of ticks (-m). With -i it goes for
+ *          where that ball will meet the paddle instead, worked out in a
+ *          few operations from its velocity (see game_predict()).
+ *
+ *   Seeds: Every game has its own random number stream, drawn from the
+ *          seed (-r or --seed) and the game's number, so a run is the same
+ *          every time for the same seed.
+ *
+ *  Kernel: The balls are stepped by the best SIMD kernel this CPU has
+ *          (see ball_kernel.c). -k picks one by name instead; every kernel
+ *          must give the same summary for the same seed. A court and balls
+ *          that are one of the presets (preset.h) take the tick compiled
+ *          for it; -G makes them take the generic tick, which must give
+ *          the same summary too.
+ *
+ * Interface:
+ *      wrap_up()       -- called by the game objects on fatal errors
+ *
+ * Internal functions:
+ *      main()          -- run the games and print the summary
+ *      get_options()   -- read settings from the command line
+ *      elapsed()       -- seconds of CPU time since a start time
+ */
+
+/* INCLUDES */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "arena.h"
+#include "autoplay.h"
+#include "ball_kernel.h"
+#include "clock.h"
+#include "court.h"
+#include "pong.h"
+#include "preset.h"
+
+/* CONSTANTS */
+#define DFL_GAMES 1000      // games to play
+#define DFL_LINES 24        // size of the pretend terminal
+#define DFL_COLS 80
+#define DFL_SKILL 50        // % chance per tick the paddle moves
+#define DFL_MAX_TICKS (TICKS_PER_SEC * 60 * 60)     // an hour of play
+
+/* LOCAL VARIABLES -- SETTINGS */
+static int games = DFL_GAMES;
+static struct autoplay settings = {
+    DFL_LINES, DFL_COLS, 1, DFL_SKILL, 0, TICKS_PER_SEC, DFL_MAX_TICKS, 0
+};
+
+/*
+ * ===========================================================================
+ * INTERNAL FUNCTIONS
+ * ===========================================================================
+ */
+static void get_options(int, char **);
+static double elapsed(clock_t);
+
+/*
+ *  main()
+ *  Purpose: Play the requested number of games and summarize them
+ *    Input: argc, argv, the command line (see get_options())
+ *   Return: 0 on success, exit non-zero on error
+ */
+int main (int argc, char * argv[])
+{
+    struct autoplay_totals totals = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    struct pparena * arena;
+    clock_t start;
+    int i;
+
+    settings.seed = getpid();
+    get_options(argc, argv);
+
+    arena = new_arena(0);               // every game is played in it
+    start = clock();
+    for(i = 0; i < games; i++)
+        autoplay_game(&settings, i, arena, &totals);
+
+    autoplay_report(&settings, &totals, elapsed(start));
+    arena_free(arena);
+    return 0;
+}
+
+/*
+ *  get_options()
+ *  Purpose: Read settings from the command line
+ *    Input: argc, argv, as passed to main()
+ *   Method: -g games to play, -b balls in play per serve,
+ *           -H and -W the size of the pretend terminal,
+ *           -p the paddle's chance (0..100) of moving each tick, -m the
+ *           most ticks any one game may run, -r (or --seed) the seed for
+ *           the run, -k the ball kernel to use, -G the generic tick,
+ *           -i the player that predicts where the ball will be.
+ *    Error: On an unknown option or a bad value, or a kernel this CPU can't
+ *           run, print a usage message and exit.
+ */
+void get_options(int argc, char * argv[])
+{
+    static const struct option longopts[] = {
+        { "seed", required_argument, NULL, 'r' },
+        { NULL, 0, NULL, 0 }
+    };
+    struct autoplay * ap = &settings;
+    int opt, bad = 0;
+
+    while( (opt = getopt_long(argc, argv, "g:b:H:W:p:m:r:k:Gi", longopts,
+                              NULL)) != -1 )
+    {
+        if(opt == 'g')
+            games = atoi(optarg);
+        else if(opt == 'b')
+            ap->balls = atoi(optarg);
+        else if(opt == 'H')
+            ap->lines = atoi(optarg);
+        else if(opt == 'W')
+            ap->cols = atoi(optarg);
+        else if(opt == 'p')
+            ap->skill = atoi(optarg);
+        else if(opt == 'm')
+            ap->max_ticks = atol(optarg);
+        else if(opt == 'r')
+            ap->seed = strtoull(optarg, NULL, 0);
+        else if(opt == 'k')
+            bad = (ball_kernel_use(optarg) == -1);
+        else if(opt == 'G')
+            preset_use(0);
+        else if(opt == 'i')
+            ap->predict = 1;
+        else
+            bad = 1;
+    }
+
+    if( bad || optind < argc || games < 1 || ap->max_ticks < 1 ||
+        ap->balls < 1 || ap->balls > MAX_BALLS ||
+        ap->lines < MIN_LINES || ap->cols < MIN_COLS ||
+        ap->skill < 0 || ap->skill > 100 )
+    {
+        fprintf(stderr, "usage: %s [-g games] [-b balls] [-H lines] "
+                        "[-W cols] [-p skill%%] [-m max_ticks] [-r seed] "
+                        "[-k kernel] [-G] [-i]\n", argv[0]);
+        fprintf(stderr, "       (kernels: %s)\n", KERNEL_NAMES);
+        fprintf(stderr, "       (court must be at least %dx%d)\n",
+                        MIN_COLS, MIN_LINES);
+        exit(2);
+    }
+
+    return;
+}
+
+/*
+ *  elapsed()
+ *  Purpose: Measure CPU time used since start
+ *   Return: seconds, never less than a microsecond so it can be divided by
+ */
+double elapsed(clock_t start)
+{
+    double secs = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+    return (secs > 0.000001) ? secs : 0.000001;
+}
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  wrap_up()
+ *  Purpose: Get ready for a fatal error to exit
+ *     Note: The game objects call this when they can't allocate memory,
+ *           just as they do in pong. Here there is no terminal to reset,
+ *           and the games are freed when the process exits.
+ */
+void wrap_up()
+{
+    return;
+}
@@ -0,0 +1,826 @@
+/*
+ * ===========================================================================
+ *   FILE: ./net.c
+ * ===========================================================================
+ * Purpose: Play one game on two machines, a paddle each, over UDP.
+ *
+ * Interface:
+ *      net_host()          -- wait for the other player on a UDP port
+ *      net_join()          -- connect to a player waiting at host:port
+ *      net_fd()            -- the socket, to poll() on
+ *      net_wait()          -- agree on the game's settings with the peer
+ *      net_side()          -- which paddle this player has
+ *      net_attach()        -- the game the two are playing
+ *      net_move()          -- queue a move of this player's paddle
+ *      net_receive()       -- take in the peer's moves, fixing predictions
+ *      net_advance()       -- run the ticks that are due
+ *      net_get_stats()     -- how the connection is doing
+ *      net_close()         -- say goodbye to the peer and free it all
+ *
+ * Internal functions:
+ *      now_us()            -- microseconds on the monotonic clock
+ *      put16(), put32(), put64(), get16(), get32(), get64()
+ *                          -- little-endian numbers in a packet
+ *      send_packet()       -- send a packet to the peer
+ *      send_moves()        -- send the moves the peer hasn't acked
+ *      from_peer()         -- is a packet from the peer?
+ *      moves()             -- a player's moves for a tick
+ *      apply()             -- make one player's moves for a tick
+ *      step()              -- run one tick, saving the state before it
+ *      rollback()          -- go back to a tick and run forward again
+ *      take_moves()        -- handle a packet of the peer's moves
+ *
+ * Notes:
+ *      Both machines run the whole game. A game is decided by its seed and
+ *      the moves made each tick (see replay.c), so the only thing sent is
+ *      moves: once the host has picked the seed and court, each side
+ *      sends the other how many rows its paddle moved each tick, and as
+ *      long as both run the same ticks with the same moves, both see the
+ *      same game. The host has the right paddle, the one who joins the
+ *      left; each moves theirs with the usual keys.
+ *
+ *      Input delay: a move is made NET_DELAY ticks after the key is
+ *      pressed, on both machines. That gives it that long to reach the
+ *      peer before it is needed, and is well under a frame.
+ *
+ *      Rollback: the peer's moves usually arrive later than that (half
+ *      the round trip), so the game doesn't wait for them. It runs on,
+ *      predicting that the peer made no move, and keeps a snapshot
+ *      (game_save()) of the state before each tick. When the peer's
+ *      moves for a tick arrive and they weren't that prediction, the game
+ *      is put back to the snapshot before the first wrong tick and run
+ *      forward again with the real moves, all before the next frame. So
+ *      this player's paddle always answers at once, and the peer's shows
+ *      up where it really is within about half the round trip. The game
+ *      only ends once the peer's moves up to that tick are known, so a
+ *      prediction can never end it.
+ *
+ *      Limits: the game only runs MAX_AHEAD ticks past the last tick of
+ *      the peer's moves it has. Past that it waits (a stall), as it must,
+ *      having no snapshot to go back to. A side that runs ahead of the
+ *      other (it started first) also skips a tick now and then, so
+ *      neither has to roll back more than the round trip.
+ *
+ *      Packets: each one carries every move the peer hasn't acked yet,
+ *      so a lost packet costs nothing as long as the next one arrives.
+ *      They also carry a sequence number, to count losses, and a time
+ *      stamp the peer echoes back, to time the round trip. A move is a
+ *      signed char per tick; a packet is a few dozen bytes.
+ *
+ *      IPv4 only. Both players need the same build, as ever for replays.
+ */
+
+/* INCLUDES */
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "game.h"
+#include "net.h"
+#include "paddle.h"
+#include "pong.h"
+#include "replay.h"
+
+/* CONSTANTS */
+#define NET_DELAY 1         // ticks between a key and the move it makes
+#define RING 64             // ticks of moves kept, each side
+#define SNAPS 32            // snapshots kept, one per tick
+#define MAX_AHEAD 24        // most ticks run without the peer's moves
+#define MAX_MOVES 127       // most rows moved in one tick, either way
+#define SYNC_EVERY 8        // a side ahead skips at most 1 tick in this many
+#define HELLO_US 250000     // how often to say hello while joining
+#define PEER_TIMEOUT_US 5000000     // silence before the peer is gone
+#define BYE_COPIES 3        // goodbyes sent, in case some are lost
+
+#define NET_VERSION 2
+#define HELLO 1             // packet types: joining, with terminal size
+#define START 2             // host's reply: the game's settings
+#define MOVES 3             // moves, acks and time stamps
+#define BYE 4               // moves, and the sender has stopped
+
+#define HEAD_LEN 4          // 'P', 'N', version, type
+#define HELLO_LEN (HEAD_LEN + 4)
+#define START_LEN (HEAD_LEN + 21)
+#define MOVES_LEN (HEAD_LEN + 29)   // before the moves themselves
+#define MAX_PACKET (MOVES_LEN + RING)
+
+/* NET STRUCT */
+struct ppnet {
+    int fd;                     // the UDP socket
+    int hosting, side;          // host or not; RIGHT_SIDE or LEFT_SIDE
+    struct sockaddr_in peer;    // where the other player is
+    int have_peer, started, peer_gone;
+    int tick_rate;
+    unsigned char start[START_LEN];     // host: the START to resend
+    uint32_t last_hello;        // joining: when HELLO was last sent
+
+    struct ppgame * game;
+    unsigned char * snaps;      // SNAPS snapshots, tick k's at k % SNAPS
+    int snap_size;
+    int state;                  // the game's state after tick 'now'
+
+    long now;                   // ticks run, on predicted moves or not
+    long sealed;                // own moves are fixed for ticks < sealed
+    int pending;                // rows to move at tick 'sealed'
+    long known;                 // peer's moves are known for ticks < known
+    long acked;                 // peer has own moves for ticks < acked
+    long peer_now;              // peer's 'now' as of its last packet
+    signed char own[RING], theirs[RING];    // moves, tick k's at k % RING
+
+    uint32_t seq, max_seq;      // packets sent; highest one received
+    uint32_t stamp, stamp_at;   // peer's last time stamp, and when it came
+    uint32_t heard_at;          // when anything last came from the peer
+    struct net_stats stats;
+};
+
+/*
+ * ===========================================================================
+ * INTERNAL FUNCTIONS
+ * ===========================================================================
+ */
+static uint32_t now_us();
+static void put16(unsigned char *, int);
+static void put32(unsigned char *, uint32_t);
+static void put64(unsigned char *, uint64_t);
+static int get16(const unsigned char *);
+static uint32_t get32(const unsigned char *);
+static uint64_t get64(const unsigned char *);
+static void send_packet(struct ppnet *, const unsigned char *, int);
+static void send_moves(struct ppnet *, int);
+static int from_peer(struct ppnet *, const struct sockaddr_in *);
+static int moves(struct ppnet *, int, long);
+static int apply(struct ppgame *, int, int);
+static int step(struct ppnet *, long);
+static void rollback(struct ppnet *, long);
+static long take_moves(struct ppnet *, const unsigned char *, int);
+
+/*
+ *  now_us()
+ *  Purpose: Time things, in microseconds
+ *   Return: the monotonic clock, cut to 32 bits; differences of two are
+ *           right for about an hour, which is all a round trip needs
+ */
+uint32_t now_us()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) ((ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000));
+}
+
+/*
+ *  put16(), put32(), put64(), get16(), get32(), get64()
+ *  Purpose: Write and read numbers in a packet, low byte first, whatever
+ *           order the machine keeps them in
+ */
+void put16(unsigned char * p, int v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    return;
+}
+
+void put32(unsigned char * p, uint32_t v)
+{
+    put16(p, v & 0xffff);
+    put16(p + 2, v >> 16);
+    return;
+}
+
+void put64(unsigned char * p, uint64_t v)
+{
+    put32(p, (uint32_t) v);
+    put32(p + 4, (uint32_t) (v >> 32));
+    return;
+}
+
+int get16(const unsigned char * p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+uint32_t get32(const unsigned char * p)
+{
+    return (uint32_t) get16(p) | ((uint32_t) get16(p + 2) << 16);
+}
+
+uint64_t get64(const unsigned char * p)
+{
+    return (uint64_t) get32(p) | ((uint64_t) get32(p + 4) << 32);
+}
+
+/*
+ *  send_packet()
+ *  Purpose: Send a packet to the peer
+ *     Note: UDP may drop it anyway, so a failed send is not an error:
+ *           everything sent is sent again until the peer acks it.
+ */
+void send_packet(struct ppnet * np, const unsigned char * buf, int len)
+{
+    if( sendto(np->fd, buf, len, 0, (struct sockaddr *) &np->peer,
+               sizeof(np->peer)) == len )
+        np->stats.sent++;
+
+    return;
+}
+
+/*
+ *  send_moves()
+ *  Purpose: Send the peer every move of ours it hasn't acked
+ *    Input: np, the connection
+ *           type, MOVES, or BYE when this side has stopped
+ *   Method: The packet holds the moves for ticks acked .. sealed-1, the
+ *           tick this side is at, its ack of the peer's moves ('known'),
+ *           a time stamp, and the peer's last time stamp with how long it
+ *           was held here, so the peer can take the hold off the round
+ *           trip.
+ */
+void send_moves(struct ppnet * np, int type)
+{
+    unsigned char buf[MAX_PACKET];
+    uint32_t t = now_us();
+    long k, first = np->acked;
+    int count;
+
+    if(np->sealed - first > RING)
+        first = np->sealed - RING;
+    count = np->sealed - first;
+
+    buf[0] = 'P';
+    buf[1] = 'N';
+    buf[2] = NET_VERSION;
+    buf[3] = type;
+    put32(buf + 4, ++np->seq);
+    put32(buf + 8, t);
+    put32(buf + 12, np->stamp);
+    put32(buf + 16, np->stamp ? t - np->stamp_at : 0);
+    put32(buf + 20, np->now);
+    put32(buf + 24, np->known);
+    put32(buf + 28, first);
+    buf[32] = count;
+
+    for(k = first; k < np->sealed; k++)
+        buf[MOVES_LEN + (k - first)] = (unsigned char) np->own[k % RING];
+
+    send_packet(np, buf, MOVES_LEN + count);
+    return;
+}
+
+/*
+ *  from_peer()
+ *  Purpose: Check a packet came from the other player
+ *   Return: 1 if it did, or if there is no peer yet, otherwise 0
+ */
+int from_peer(struct ppnet * np, const struct sockaddr_in * from)
+{
+    return !np->have_peer ||
+           (from->sin_addr.s_addr == np->peer.sin_addr.s_addr &&
+            from->sin_port == np->peer.sin_port);
+}
+
+/*
+ *  moves()
+ *  Purpose: Look up a player's moves for a tick
+ *    Input: np, the connection
+ *           side, RIGHT_SIDE or LEFT_SIDE
+ *           k, the tick
+ *   Return: rows to move, negative for up; for the peer's side past what
+ *           has arrived, the prediction: no move
+ */
+int moves(struct ppnet * np, int side, long k)
+{
+    if(side == np->side)
+        return np->own[k % RING];
+
+    return (k < np->known) ? np->theirs[k % RING] : 0;
+}
+
+/*
+ *  apply()
+ *  Purpose: Move one paddle the rows it moved in a tick
+ *    Input: gp, the game
+ *           side, which paddle
+ *           n, the rows; negative for up
+ *   Return: GAME_ON, or GAME_OVER if a move lost the last ball
+ */
+int apply(struct ppgame * gp, int side, int n)
+{
+    int dir = (n < 0) ? PADDLE_UP : PADDLE_DOWN;
+    int state = GAME_ON;
+
+    for(n = abs(n); n > 0 && state == GAME_ON; n--)
+        state = (side == RIGHT_SIDE) ? game_paddle(gp, dir)
+                                     : game_left_paddle(gp, dir);
+
+    return state;
+}
+
+/*
+ *  step()
+ *  Purpose: Run tick k
+ *    Input: np, the connection; np->game is at the start of tick k
+ *           k, the tick
+ *   Return: the game's state after it
+ *   Method: Save the state, so the tick can be run again, then make the
+ *           right player's moves, then the left's, then run the tick: the
+ *           same order on both machines.
+ */
+int step(struct ppnet * np, long k)
+{
+    int state;
+
+    game_save(np->game, np->snaps + ((k % SNAPS) * np->snap_size));
+
+    state = apply(np->game, RIGHT_SIDE, moves(np, RIGHT_SIDE, k));
+    if(state == GAME_ON)
+        state = apply(np->game, LEFT_SIDE, moves(np, LEFT_SIDE, k));
+    if(state == GAME_ON)
+        state = game_tick(np->game);
+
+    return state;
+}
+
+/*
+ *  rollback()
+ *  Purpose: Go back to the start of tick k and run up to 'now' again
+ *    Input: np, the connection
+ *           k, the first tick that was run on a wrong prediction; no more
+ *           than SNAPS ticks ago
+ *     Note: If the game now ends sooner, 'now' comes back to that tick. If
+ *           it was predicted to end and now doesn't, it carries on from
+ *           'now' at the next net_advance().
+ */
+void rollback(struct ppnet * np, long k)
+{
+    long end = np->now;
+
+    game_load(np->game, np->snaps + ((k % SNAPS) * np->snap_size));
+
+    np->stats.rollbacks++;
+    np->stats.replayed += end - k;
+    if(end - k > np->stats.deepest)
+        np->stats.deepest = end - k;
+
+    for(np->state = GAME_ON, np->now = k;
+        np->now < end && np->state == GAME_ON; np->now++)
+        np->state = step(np, np->now);
+
+    return;
+}
+
+/*
+ *  take_moves()
+ *  Purpose: Handle a MOVES or BYE packet from the peer
+ *    Input: np, the connection
+ *           buf, len, the packet
+ *   Return: the first tick already run on a prediction that these moves
+ *           show was wrong, or -1 if there is none
+ *   Method: Count the packet, time the round trip from the echoed stamp,
+ *           note the peer's acks, then add the moves that follow on from
+ *           'known'. Ones already known are sent again in case of loss,
+ *           and are skipped; if the first is past 'known', some were lost
+ *           and the peer will send them again, so none are taken.
+ */
+long take_moves(struct ppnet * np, const unsigned char * buf, int len)
+{
+    uint32_t seq = get32(buf + 4), echo = get32(buf + 12);
+    uint32_t t = now_us();
+    long k, first = get32(buf + 28), last = first + buf[32];
+    long wrong = -1;
+    double rtt;
+
+    if(len < MOVES_LEN + buf[32] || buf[32] > RING)
+        return -1;
+
+    np->stats.received++;
+    if(seq > np->max_seq)
+        np->max_seq = seq;
+
+    if(echo != 0)
+    {
+        rtt = (double) (t - echo - get32(buf + 16)) / 1000;
+        if(np->stats.rtt < 0)
+            np->stats.rtt = np->stats.rtt_min = np->stats.rtt_max = rtt;
+        np->stats.rtt += (rtt - np->stats.rtt) / 8;      // as TCP does
+        if(rtt < np->stats.rtt_min)
+            np->stats.rtt_min = rtt;
+        if(rtt > np->stats.rtt_max)
+            np->stats.rtt_max = rtt;
+    }
+
+    np->stamp = get32(buf + 8);
+    np->stamp_at = t;
+    np->peer_now = get32(buf + 20);
+    if((long) get32(buf + 24) > np->acked)
+        np->acked = get32(buf + 24);
+
+    if(first > np->known || last <= np->known || last > np->now + RING / 2)
+        return -1;
+
+    for(k = np->known; k < last; k++)
+    {
+        np->theirs[k % RING] = (signed char) buf[MOVES_LEN + (k - first)];
+        if(k < np->now && np->theirs[k % RING] != 0 && wrong == -1)
+            wrong = k;
+    }
+    np->known = last;
+
+    return wrong;
+}
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  net_host()
+ *  Purpose: Get ready for another player to join
+ *    Input: port, the UDP port to wait on
+ *   Return: a pointer to the connection, with no peer yet (see net_wait())
+ *    Error: If the port can't be used or malloc fails, close curses,
+ *           print a message and exit.
+ */
+struct ppnet * net_host(const char * port)
+{
+    struct ppnet * np = calloc(1, sizeof(struct ppnet));
+    struct sockaddr_in addr;
+
+    if(np == NULL)
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Couldn't allocate memory for the network.\n");
+        exit(1);
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(atoi(port));
+
+    np->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if( np->fd == -1 || addr.sin_port == 0 ||
+        bind(np->fd, (struct sockaddr *) &addr, sizeof(addr)) == -1 )
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Can't wait on port %s: %s\n", port,
+                        strerror(errno));
+        exit(1);
+    }
+
+    fcntl(np->fd, F_SETFL, O_NONBLOCK);
+    np->hosting = 1;
+    np->side = RIGHT_SIDE;
+    np->stats.rtt = -1;
+    return np;
+}
+
+/*
+ *  net_join()
+ *  Purpose: Get ready to join a player waiting with net_host()
+ *    Input: where, "host:port"
+ *   Return: a pointer to the connection (see net_wait())
+ *    Error: If the address can't be found or used, or malloc fails, close
+ *           curses, print a message and exit.
+ */
+struct ppnet * net_join(const char * where)
+{
+    struct ppnet * np = calloc(1, sizeof(struct ppnet));
+    struct addrinfo hints, * res = NULL;
+    char host[256];
+    const char * colon = strrchr(where, ':');
+    int err = -1;
+
+    if(np == NULL)
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Couldn't allocate memory for the network.\n");
+        exit(1);
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    if(colon != NULL && colon - where < (long) sizeof(host))
+    {
+        memcpy(host, where, colon - where);
+        host[colon - where] = '\0';
+        err = getaddrinfo(host, colon + 1, &hints, &res);
+    }
+
+    if( err != 0 || (np->fd = socket(AF_INET, SOCK_DGRAM, 0)) == -1 )
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Can't join %s: %s\n", where,
+                        (colon == NULL) ? "expected host:port" :
+                        (err != 0) ? gai_strerror(err) : strerror(errno));
+        exit(1);
+    }
+
+    memcpy(&np->peer, res->ai_addr, sizeof(np->peer));
+    freeaddrinfo(res);
+
+    fcntl(np->fd, F_SETFL, O_NONBLOCK);
+    np->have_peer = 1;
+    np->side = LEFT_SIDE;
+    np->stats.rtt = -1;
+    return np;
+}
+
+/*
+ *  net_fd()
+ *  Purpose: Give the socket, for the main loop to poll() on
+ */
+int net_fd(struct ppnet * np)
+{
+    return np->fd;
+}
+
+/*
+ *  net_wait()
+ *  Purpose: Wait for the other player, and agree what game to play
+ *    Input: np, the connection
+ *           ip, the host's settings (seed, tick rate, balls, and this
+ *           terminal's size) or, joining, this terminal's size
+ *           timeout, the most milliseconds to wait
+ *   Output: ip, the settings for the game, the same on both sides: the
+ *           host's, on a court that fits both terminals
+ *   Return: 1 once the game can start, 0 if the time ran out first; call
+ *           it again (say, after checking the keyboard) until it is 1
+ *   Method: The joining side sends HELLO with its terminal size, again
+ *           every HELLO_US, until the host answers it with START. The
+ *           host answers the first HELLO, and any more that come later
+ *           (a START was lost) from net_receive().
+ */
+int net_wait(struct ppnet * np, struct replay_info * ip, int timeout)
+{
+    unsigned char buf[MAX_PACKET];
+    struct sockaddr_in from;
+    socklen_t flen;
+    struct pollfd pfd = { np->fd, POLLIN, 0 };
+    uint32_t t = now_us();
+    int len;
+
+    if(!np->hosting && (np->last_hello == 0 || t - np->last_hello >= HELLO_US))
+    {
+        buf[0] = 'P';
+        buf[1] = 'N';
+        buf[2] = NET_VERSION;
+        buf[3] = HELLO;
+        put16(buf + 4, ip->lines);
+        put16(buf + 6, ip->cols);
+        send_packet(np, buf, HELLO_LEN);
+        np->last_hello = t ? t : 1;
+    }
+
+    poll(&pfd, 1, timeout);
+
+    for(;;)
+    {
+        flen = sizeof(from);
+        len = recvfrom(np->fd, buf, sizeof(buf), 0,
+                       (struct sockaddr *) &from, &flen);
+        if(len == -1)
+            return 0;
+
+        if( len < HEAD_LEN || buf[0] != 'P' || buf[1] != 'N' ||
+            buf[2] != NET_VERSION || !from_peer(np, &from) )
+            continue;
+
+        if(np->hosting && buf[3] == HELLO && len >= HELLO_LEN)
+        {
+            np->peer = from;
+            np->have_peer = 1;
+
+            if(get16(buf + 4) < ip->lines)
+                ip->lines = get16(buf + 4);
+            if(get16(buf + 6) < ip->cols)
+                ip->cols = get16(buf + 6);
+
+            memcpy(np->start, buf, HEAD_LEN);
+            np->start[3] = START;
+            put64(np->start + 4, ip->seed);
+            put32(np->start + 12, ip->tick_rate);
+            put16(np->start + 16, ip->lines);
+            put16(np->start + 18, ip->cols);
+            put32(np->start + 20, ip->balls);
+            np->start[24] = NET_DELAY;
+            send_packet(np, np->start, START_LEN);
+            break;
+        }
+        else if(!np->hosting && buf[3] == START && len >= START_LEN &&
+                buf[24] == NET_DELAY)
+        {
+            ip->seed = get64(buf + 4);
+            ip->tick_rate = get32(buf + 12);
+            ip->lines = get16(buf + 16);
+            ip->cols = get16(buf + 18);
+            ip->balls = get32(buf + 20);
+            break;
+        }
+    }
+
+    np->started = 1;
+    np->tick_rate = ip->tick_rate;
+    np->heard_at = now_us();
+    return 1;
+}
+
+/*
+ *  net_side()
+ *  Purpose: Say which paddle this player has
+ *   Return: RIGHT_SIDE for the host, LEFT_SIDE for the one who joined
+ */
+int net_side(struct ppnet * np)
+{
+    return np->side;
+}
+
+/*
+ *  net_attach()
+ *  Purpose: Give the connection the game to play, fresh from new_game()
+ *           with the settings from net_wait() and two players
+ *    Error: If malloc fails, close curses, print a message and exit.
+ */
+void net_attach(struct ppnet * np, struct ppgame * gp)
+{
+    np->game = gp;
+    np->snap_size = game_save(gp, NULL);
+    np->snaps = malloc(SNAPS * np->snap_size);
+
+    if(np->snaps == NULL)
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Couldn't allocate memory for the network.\n");
+        exit(1);
+    }
+
+    np->state = GAME_ON;
+    np->sealed = NET_DELAY;             // no moves in the first ticks
+    return;
+}
+
+/*
+ *  net_move()
+ *  Purpose: Move this player's paddle, NET_DELAY ticks from now
+ *    Input: np, the connection
+ *           dir, PADDLE_UP or PADDLE_DOWN
+ */
+void net_move(struct ppnet * np, int dir)
+{
+    if(dir == PADDLE_UP && np->pending > -MAX_MOVES)
+        np->pending--;
+    else if(dir == PADDLE_DOWN && np->pending < MAX_MOVES)
+        np->pending++;
+
+    return;
+}
+
+/*
+ *  net_receive()
+ *  Purpose: Read everything the peer has sent, and fix the game if it
+ *           was run on a wrong prediction
+ *    Input: np, the connection
+ *           gp, the game (as given to net_attach())
+ *     Note: Call when the socket is readable. Every packet is read before
+ *           rolling back, so a burst of them costs one rollback at most.
+ */
+void net_receive(struct ppnet * np, struct ppgame * gp)
+{
+    unsigned char buf[MAX_PACKET];
+    struct sockaddr_in from;
+    socklen_t flen;
+    long k, wrong = -1;
+    int len;
+
+    for(;;)
+    {
+        flen = sizeof(from);
+        len = recvfrom(np->fd, buf, sizeof(buf), 0,
+                       (struct sockaddr *) &from, &flen);
+        if(len == -1)
+            break;
+
+        if( len < HEAD_LEN || buf[0] != 'P' || buf[1] != 'N' ||
+            buf[2] != NET_VERSION || !from_peer(np, &from) )
+            continue;
+
+        np->heard_at = now_us();
+        if(buf[3] == HELLO && np->hosting)
+            send_packet(np, np->start, START_LEN);      // START was lost
+        else if( (buf[3] == MOVES || buf[3] == BYE) && len >= MOVES_LEN )
+        {
+            k = take_moves(np, buf, len);
+            if(k != -1 && (wrong == -1 || k < wrong))
+                wrong = k;
+            if(buf[3] == BYE)
+                np->peer_gone = 1;
+        }
+    }
+
+    if(wrong != -1 && gp == np->game)
+        rollback(np, wrong);
+
+    return;
+}
+
+/*
+ *  net_advance()
+ *  Purpose: Run the ticks that are due, and tell the peer our moves
+ *    Input: np, the connection
+ *           gp, the game (as given to net_attach())
+ *           ticks, how many the ticker says are due
+ *   Return: GAME_ON; GAME_OVER once the game has ended on moves both
+ *           sides agree on; GAME_QUIT if the peer has gone (quit, or has
+ *           not been heard from for PEER_TIMEOUT_US)
+ *   Method: Each tick fixes this player's moves for the tick NET_DELAY
+ *           on, then runs the next one. A tick is skipped (a stall) when
+ *           the peer's moves are MAX_AHEAD ticks behind, or the peer
+ *           hasn't acked RING ticks of ours, or this side is ahead of the
+ *           peer by more than a couple of ticks (then only one in every
+ *           SYNC_EVERY, to ease back gently).
+ */
+int net_advance(struct ppnet * np, struct ppgame * gp, int ticks)
+{
+    long lead;
+    int due = ticks;
+
+    for( ; ticks > 0 && np->state == GAME_ON; ticks--)
+    {
+        lead = np->now - np->peer_now -
+               (long) (np->stats.rtt * np->tick_rate / 2000);
+
+        if( np->now - np->known >= MAX_AHEAD ||
+            np->sealed - np->acked >= RING - 1 ||
+            (lead > 2 && np->now % SYNC_EVERY == 0 && np->stats.rtt >= 0) )
+        {
+            np->stats.stalls++;
+            continue;
+        }
+
+        np->own[np->sealed % RING] = np->pending;
+        np->pending = 0;
+        np->sealed++;
+
+        np->state = step(np, np->now);
+        np->now++;
+    }
+
+    if(due > 0 || np->state != GAME_ON)     // stalled or not, so acks go
+        send_moves(np, MOVES);
+
+    if(np->state != GAME_ON && np->known >= np->now && gp == np->game)
+        return np->state;
+    if(np->peer_gone || now_us() - np->heard_at > PEER_TIMEOUT_US)
+        return GAME_QUIT;
+
+    return GAME_ON;
+}
+
+/*
+ *  net_get_stats()
+ *  Purpose: Report how the connection is doing
+ *   Output: sp, the counters; 'lost' counts packets the peer sent that
+ *           never arrived (late ones count as lost until they do)
+ */
+void net_get_stats(struct ppnet * np, struct net_stats * sp)
+{
+    *sp = np->stats;
+    sp->lost = (np->max_seq > np->stats.received) ?
+               np->max_seq - np->stats.received : 0;
+    return;
+}
+
+/*
+ *  net_close()
+ *  Purpose: Tell the peer this side has stopped, and free the connection
+ *    Input: np, the connection; NULL is ignored
+ *     Note: The goodbye carries the last of our moves, so a peer still
+ *           waiting on them to end the game can end it the same way.
+ */
+void net_close(struct ppnet * np)
+{
+    int i;
+
+    if(np == NULL)
+        return;
+
+    if(np->started && np->have_peer)
+        for(i = 0; i < BYE_COPIES; i++)
+            send_moves(np, BYE);
+
+    close(np->fd);
+    free(np->snaps);
+    free(np);
+    return;
+}
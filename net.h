@@ -0,0 +1,36 @@
+/*
+ * ==========================
+ *   FILE: ./net.h
+ * ==========================
+ * Purpose: Header file for net.c
+ */
+
+/* STRUCTS */
+struct net_stats {          // how a connection is doing
+    long sent, received;    // packets
+    long lost;              // packets that never arrived
+    double rtt;             // round trip, smoothed, in ms; -1 until known
+    double rtt_min, rtt_max;
+    long rollbacks;         // times a prediction was wrong
+    long replayed;          // ticks run again because of it
+    long deepest;           // most ticks run again at once
+    long stalls;            // ticks held back to wait for the peer
+};
+
+/* OPAQUE STRUCTS */
+struct ppgame;
+struct ppnet;
+struct replay_info;
+
+/* EXTERNAL INTERFACE */
+struct ppnet * net_host(const char *);
+struct ppnet * net_join(const char *);
+int net_fd(struct ppnet *);
+int net_wait(struct ppnet *, struct replay_info *, int);
+int net_side(struct ppnet *);
+void net_attach(struct ppnet *, struct ppgame *);
+void net_move(struct ppnet *, int);
+void net_receive(struct ppnet *, struct ppgame *);
+int net_advance(struct ppnet *, struct ppgame *, int);
+void net_get_stats(struct ppnet *, struct net_stats *);
+void net_close(struct ppnet *);
\ No newline at end of file
@@ -8,18 +8,32 @@
  *      new_paddle()        -- allocates memory and inits a new paddle
  *      paddle_up()         -- determines if room to move up, and does so
  *      paddle_down()       -- determines if room to move down, and does so
+ *      paddle_draw()       -- redraws the paddle if it moved since last drawn
+ *      paddle_redraw()     -- has the next paddle_draw() draw all of it
+ *      paddle_relayout()   -- fits the paddle to a resized court
  *      paddle_contact()    -- determines if ball is touching paddle
+ *      paddle_aim()        -- which way to move to cover a row
+ *      get_pad_top()       -- returns the top row of the paddle
+ *      get_pad_bot()       -- returns the bottom row of the paddle
+ *      paddle_save()       -- copy the paddle into a snapshot
+ *      paddle_load()       -- put the paddle back where a snapshot had it
+ *      paddle_use_size()   -- sets how much of the court paddles cover
  *
  * Internal functions:
- *      paddle_init()       -- initializes paddle's vars, and draws on screen
- *      draw_paddle()       -- draws full paddle from top-to-bottom
+ *      paddle_init()       -- initializes paddle's vars
  *
+ * Notes:
+ *      As with the ball, moving and drawing are separate. paddle_up() and
+ *      paddle_down() only change the paddle's position; paddle_draw() is
+ *      called once per frame to bring the screen up to date.
  */
 
 /* INCLUDES */
-#include <curses.h>
-#include <signal.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "frame.h"
 #include "paddle.h"
 #include "ball.h"
 #include "pong.h"
@@ -32,56 +46,43 @@
 struct pppaddle {
     char pad_char;                  // char to draw with
     int pad_top, pad_bot, pad_col;  // positions of paddle
+    int pad_side;                   // RIGHT_SIDE or LEFT_SIDE
     int pad_mintop, pad_maxbot;     // boundaries
+    int pad_drawn;                  // top row on screen, -1 if not drawn
 };
 
+/* LOCAL VARIABLES -- SETTINGS */
+static int size = PADDLE_SIZE;         // see paddle_use_size()
+
 /*
  * ===========================================================================
  * INTERNAL FUNCTIONS
  * ===========================================================================
  */
-static void draw_paddle();
-static void paddle_init(struct pppaddle *, int, int);
-
-/*
- *  draw_paddle()
- *  Purpose: Draw the paddle pointed to by pp
- *    Input: pp, pointer to a paddle struct
- *     Note: As mentioned in comments for new_paddle(), a MIN_LINES constant
- *           defined in pong.c ensures a minimum court height of 3, and
- *           therefore a paddle height of at least 1. No special cases are
- *           needed to print a paddle char where one might not exist.
- */
-void draw_paddle(struct pppaddle * pp)
-{
-    int i;
-
-    for(i = pp->pad_top; i <= pp->pad_bot; i++)
-        mvaddch(i, pp->pad_col, pp->pad_char);
-
-    park_cursor();
-    refresh();
-    return;
-}
+static void paddle_init(struct pppaddle *, struct ppcourt *, int, int, int);
 
 /*
  *  paddle_init()
- *  Purpose: instantiate a new paddle struct
+ *  Purpose: initialize a new paddle struct
  *    Input: pp, pointer to a paddle struct
+ *           court, the court the paddle plays in
  *           top, the starting (top) position of the paddle
  *           height, how tall the paddle is
+ *           side, RIGHT_SIDE or LEFT_SIDE, the column it stands in
  */
-void paddle_init(struct pppaddle * pp, int top, int height)
+void paddle_init(struct pppaddle * pp, struct ppcourt * court, int top,
+                 int height, int side)
 {
     pp->pad_char = DFL_SYMBOL;
-    pp->pad_mintop = BORDER;
-    pp->pad_maxbot = LINES - BORDER - 1;    // -1 because LINES are 0-indexed
+    pp->pad_mintop = get_top_edge(court);
+    pp->pad_maxbot = get_bot_edge(court);
 
-    pp->pad_col = get_right_edge();
+    pp->pad_side = side;
+    pp->pad_col = (side == LEFT_SIDE) ? get_left_edge(court)
+                                      : get_right_edge(court);
     pp->pad_top = top;
     pp->pad_bot = pp->pad_top + height - 1; // -1 because LINES are 0-indexed
-
-    draw_paddle(pp);
+    pp->pad_drawn = -1;                     // drawn on the first frame
 
     return;
 }
@@ -95,14 +96,21 @@ void paddle_init(struct pppaddle * pp, int top, int height)
 /*
  *  new_paddle()
  *  Purpose: instantiate a new paddle struct
+ *    Input: arena, to allocate from (see arena.c), or NULL for malloc()
+ *           court, the court the paddle plays in
+ *           side, RIGHT_SIDE for the usual paddle, or LEFT_SIDE for a
+ *           second player's, on the left edge of the court
  *   Return: a pointer to the paddle that was allocated and initialized
  *     Note: The window size will be at least 11 lines tall, making the
  *           court height at least 3 lines tall. This means paddle_height
- *           will always be 1 char or greater. See draw_paddle() for more.
+ *           will always be 1 char or greater. See paddle_draw() for more.
+ *     Note: The paddle is placed from the court's edges, not the screen
+ *           size, so it works the same with no screen at all.
  */
-struct pppaddle * new_paddle()
+struct pppaddle * new_paddle(struct pparena * arena, struct ppcourt * court,
+                             int side)
 {
-    struct pppaddle * paddle = malloc(sizeof(struct pppaddle));
+    struct pppaddle * paddle = arena_alloc(arena, sizeof(struct pppaddle));
 
     if(paddle == NULL)
     {
@@ -115,15 +123,16 @@ struct pppaddle * new_paddle()
     }
 
     // -1 for court height to exclude bottom row
-    int court_height = get_bot_edge() - get_top_edge() - 1;
+    int court_height = get_bot_edge(court) - get_top_edge(court) - 1;
 
-    // set paddle size to 1/3 the court size
-    int paddle_height = (court_height / 3);
+    // set paddle size to 1/3 the court size (1/size), at least one row
+    int paddle_height = (court_height >= size) ? (court_height / size) : 1;
 
     // set top of paddle to mid-point minus half the paddle height
-    int paddle_top = (LINES / 2) - (paddle_height / 2);
+    int paddle_top = ((get_top_edge(court) + get_bot_edge(court) + 1) / 2)
+                     - (paddle_height / 2);
 
-    paddle_init(paddle, paddle_top, paddle_height);
+    paddle_init(paddle, court, paddle_top, paddle_height, side);
     return paddle;
 }
 
@@ -132,21 +141,15 @@ struct pppaddle * new_paddle()
  *  Purpose: check the position of a paddle, and move up if space
  *    Input: pp, pointer to a paddle struct
  *   Method: Check if the top-most part of the paddle is at the border.
- *           If there is room to move, BLANK the bottom-most char and draw
- *           a new one at the new top value.
+ *           If there is room to move, shift the paddle up one row.
  */
 void paddle_up(struct pppaddle * pp)
 {
     // if moved by 1, would it be at 'mintop'?
     if( (pp->pad_top - 1) > pp->pad_mintop)
     {
-        mvaddch(pp->pad_bot, pp->pad_col, BLANK);
         --pp->pad_top;
         --pp->pad_bot;
-        mvaddch(pp->pad_top, pp->pad_col, DFL_SYMBOL);
-
-        park_cursor();
-        refresh();
     }
 }
 
@@ -155,22 +158,95 @@ void paddle_up(struct pppaddle * pp)
  *  Purpose: check the position of a paddle, and move down if space
  *    Input: pp, pointer to a paddle struct
  *   Method: Check if the bottom-most part of the paddle is at the border.
- *           If there is room to move, BLANK the top-most char and draw
- *           a new one at the new bottom value.
+ *           If there is room to move, shift the paddle down one row.
  */
 void paddle_down(struct pppaddle * pp)
 {
     // if moved by 1, would it be at 'maxbot'?
     if( (pp->pad_bot + 1) < pp->pad_maxbot)
     {
-        mvaddch(pp->pad_top, pp->pad_col, BLANK);
         ++pp->pad_top;
         ++pp->pad_bot;
-        mvaddch(pp->pad_bot, pp->pad_col, DFL_SYMBOL);
+    }
+}
 
-        park_cursor();
-        refresh();
+/*
+ *  paddle_draw()
+ *  Purpose: Draw the paddle pointed to by pp, if it has moved
+ *    Input: pp, pointer to a paddle struct
+ *   Method: Erase the rows of the old position that the paddle has left,
+ *           then print the paddle from top-to-bottom. Since the last frame
+ *           the paddle may have moved several rows, or back to where it
+ *           was, so it is compared against where it was drawn, not where
+ *           it was one move ago. Erasing puts back the frame's static
+ *           layer, in case the paddle stands in a wall's column.
+ *     Note: As mentioned in comments for new_paddle(), a MIN_LINES constant
+ *           defined in pong.c ensures a minimum court height of 3, and
+ *           therefore a paddle height of at least 1. No special cases are
+ *           needed to print a paddle char where one might not exist.
+ */
+void paddle_draw(struct pppaddle * pp)
+{
+    int i;
+    int height = pp->pad_bot - pp->pad_top;
+
+    if(pp->pad_drawn == pp->pad_top)
+        return;                             // nothing to do
+
+    if(pp->pad_drawn != -1)
+    {
+        for(i = pp->pad_drawn; i <= pp->pad_drawn + height; i++)
+            if(i < pp->pad_top || i > pp->pad_bot)
+                frame_erase(i, pp->pad_col);
     }
+
+    for(i = pp->pad_top; i <= pp->pad_bot; i++)
+        frame_put(i, pp->pad_col, pp->pad_char);
+
+    pp->pad_drawn = pp->pad_top;
+
+    return;
+}
+
+/*
+ *  paddle_redraw()
+ *  Purpose: Forget what was drawn of the paddle, after something was
+ *           drawn over it (such as print_court())
+ *    Input: pp, pointer to a paddle struct
+ */
+void paddle_redraw(struct pppaddle * pp)
+{
+    pp->pad_drawn = -1;
+    return;
+}
+
+/*
+ *  paddle_relayout()
+ *  Purpose: Fit the paddle to its court after court_relayout()
+ *    Input: pp, pointer to a paddle struct
+ *           court, the court it plays in, with its new walls
+ *   Method: The paddle is sized again, a third of the court (or as set,
+ *           see paddle_use_size()) as in new_paddle(), and its middle row
+ *           is put the same fraction of the way down as it was, then kept
+ *           off the walls.
+ *     Note: As with ball_relayout(), the screen is taken to have been
+ *           cleared, so the paddle is printed afresh on the next frame.
+ */
+void paddle_relayout(struct pppaddle * pp, struct ppcourt * court)
+{
+    int top = get_top_edge(court), bot = get_bot_edge(court);
+    int height = ((bot - top - 1) >= size) ? ((bot - top - 1) / size) : 1;
+    int mid = rescale((pp->pad_top + pp->pad_bot) / 2, pp->pad_mintop + 1,
+                      pp->pad_maxbot - 1, top + 1, bot - 1);
+    int pad_top = mid - (height / 2);
+
+    if(pad_top + height > bot)
+        pad_top = bot - height;
+    if(pad_top <= top)
+        pad_top = top + 1;
+
+    paddle_init(pp, court, pad_top, height, pp->pad_side);
+    return;
 }
 
 /*
@@ -191,3 +267,102 @@ int paddle_contact(int y, struct pppaddle * pp)
 
     return NO_CONTACT;
 }
+
+/*
+ *  paddle_aim()
+ *  Purpose: Work out which way a paddle must move to cover a row
+ *    Input: pp, pointer to a paddle struct
+ *           y, the row to cover
+ *   Return: PADDLE_UP if the row is above the paddle, PADDLE_DOWN if it is
+ *           below, or 0 if the paddle already covers it
+ */
+int paddle_aim(struct pppaddle * pp, int y)
+{
+    if(y < pp->pad_top)
+        return PADDLE_UP;
+    else if(y > pp->pad_bot)
+        return PADDLE_DOWN;
+
+    return 0;
+}
+
+/*
+ *  get_pad_top()
+ *  Purpose: Public function to access the top row of the paddle
+ *    Input: pp, pointer to a paddle struct
+ *   Return: The current value of 'pp->pad_top'
+ */
+int get_pad_top(struct pppaddle * pp)
+{
+    return pp->pad_top;
+}
+
+/*
+ *  get_pad_bot()
+ *  Purpose: Public function to access the bottom row of the paddle
+ *    Input: pp, pointer to a paddle struct
+ *   Return: The current value of 'pp->pad_bot'
+ */
+int get_pad_bot(struct pppaddle * pp)
+{
+    return pp->pad_bot;
+}
+
+/*
+ *  paddle_save()
+ *  Purpose: Copy the paddle's position into a snapshot (see replay.c)
+ *    Input: pp, pointer to a paddle struct
+ *           buf, where to copy it, or NULL just to ask the size
+ *   Return: the number of bytes it takes
+ *     Note: The column, size and boundaries come from the court, so only
+ *           the rows it covers are saved.
+ */
+int paddle_save(struct pppaddle * pp, unsigned char * buf)
+{
+    int state[2] = { pp->pad_top, pp->pad_bot };
+
+    if(buf != NULL)
+        memcpy(buf, state, sizeof(state));
+
+    return sizeof(state);
+}
+
+/*
+ *  paddle_load()
+ *  Purpose: Put the paddle back where a snapshot had it
+ *    Input: pp, pointer to a paddle struct on the same court
+ *           buf, what paddle_save() wrote
+ *   Return: the number of bytes read
+ *     Note: Where the paddle is shown is left alone, so the next frame
+ *           moves it on screen just as if it had moved there.
+ */
+int paddle_load(struct pppaddle * pp, const unsigned char * buf)
+{
+    int state[2];
+
+    memcpy(state, buf, sizeof(state));
+    pp->pad_top = state[0];
+    pp->pad_bot = state[1];
+
+    return sizeof(state);
+}
+
+/*
+ *  paddle_use_size()
+ *  Purpose: Set how tall paddles are, for every one made from now on
+ *    Input: n, the paddle covers 1/n of the court's height (at least one
+ *           row); 0 for the usual third
+ *   Return: 0, or -1 if n is less than 0
+ *     Note: For tuning how hard the game is, with no terminal (see
+ *           sweep.c). Not while any game is being played. A game with
+ *           paddles of another size plays out differently than pong, or a
+ *           recording, would have it.
+ */
+int paddle_use_size(int n)
+{
+    if(n < 0)
+        return -1;
+
+    size = (n == 0) ? PADDLE_SIZE : n;
+    return 0;
+}
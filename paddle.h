@@ -5,11 +5,29 @@
  * Purpose: Header file for paddle.c
  */
 
+/* CONSTANTS */
+#define PADDLE_UP -1
+#define PADDLE_DOWN 1
+#define RIGHT_SIDE 0        // which wall a paddle stands on
+#define LEFT_SIDE 1
+#define PADDLE_SIZE 3       // a paddle is 1/PADDLE_SIZE of the court's height
+
 /* OPAQUE STRUCT */
+struct pparena;
+struct ppcourt;
 struct pppaddle;
 
 /* EXTERNAL INTERFACE */
-struct pppaddle * new_paddle();
+struct pppaddle * new_paddle(struct pparena *, struct ppcourt *, int);
 void paddle_up(struct pppaddle *);
 void paddle_down(struct pppaddle *);
-int paddle_contact(int, struct pppaddle *);
\ No newline at end of file
+void paddle_draw(struct pppaddle *);
+void paddle_redraw(struct pppaddle *);
+void paddle_relayout(struct pppaddle *, struct ppcourt *);
+int paddle_contact(int, struct pppaddle *);
+int paddle_aim(struct pppaddle *, int);
+int get_pad_top(struct pppaddle *);
+int get_pad_bot(struct pppaddle *);
+int paddle_save(struct pppaddle *, unsigned char *);
+int paddle_load(struct pppaddle *, const unsigned char *);
+int paddle_use_size(int);
\ No newline at end of file
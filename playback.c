@@ -0,0 +1,313 @@
+/*
+ * ==========================================================================
+ *   FILE: ./playback.c
+ * ==========================================================================
+ * Purpose: Play back a recorded game of pong with no terminal, as fast as
+ *          possible, up to any tick.
+ *
+ * Outline: pong-replay reads a recording made with pong -w (see replay.c)
+ *          and plays it through the same rules (game.c) in a tight loop,
+ *          with no curses, no ticker and no waiting. It stops at the end
+ *          of the recording, or at the tick given with -t, and prints
+ *          where the game got to: the tick, the time on the game clock,
+ *          and the balls left and in play. -d also prints the screen as it
+ *          would have looked at that tick, drawn through a text backend.
+ *
+ *   Index: If the recording has an index of snapshots (written by pong -w,
+ *          or by -i here), -t starts from the last snapshot before that
+ *          tick instead of from tick 0, so only the ticks since it are
+ *          run, however late in a long game the tick is. -i plays the
+ *          recording from the start and writes a fresh index as it goes.
+ *
+ *   Check: Played to its end, a recording should stop at the very tick it
+ *          was recorded stopping at. If it stops anywhere else the game has
+ *          played out differently (the rules, or a ball kernel, changed
+ *          what a seed and a set of moves do), which is reported, and is
+ *          the exit status, so a set of recordings can be used as
+ *          regression tests. -k picks the ball kernel (see ball_kernel.c).
+ *
+ * Interface:
+ *      wrap_up()       -- called by the game objects on fatal errors
+ *
+ * Internal functions:
+ *      main()          -- play the recording and report where it got to
+ *      get_options()   -- read settings from the command line
+ *      dump_screen()   -- draw the game and print it as text
+ *      text_put()      -- the text backend: keep a changed cell
+ *      text_update(), text_open(), text_close() -- the rest of it
+ */
+
+/* INCLUDES */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "backend.h"
+#include "ball_kernel.h"
+#include "clock.h"
+#include "court.h"
+#include "frame.h"
+#include "game.h"
+#include "pong.h"
+#include "replay.h"
+
+/* CONSTANTS */
+#define DIVERGED 3          // exit status when the game didn't play out
+                            // as recorded
+
+/* LOCAL VARIABLES -- SETTINGS */
+static const char * path;           // the recording
+static long stop_tick = -1;         // -t: stop here, -1 to play it all
+static int dump = 0;                // -d: print the screen at the end
+static int make_index = 0;          // -i: write an index while playing
+
+/* LOCAL VARIABLES -- TEXT BACKEND */
+static char * screen;               // lines x cols chars, as drawn
+static int screen_cols;
+
+/*
+ * ===========================================================================
+ * INTERNAL FUNCTIONS
+ * ===========================================================================
+ */
+static void get_options(int, char **);
+static void dump_screen(struct ppgame *, const struct replay_info *);
+static void text_open(int, int, int);
+static void text_put(int, int, unsigned short);
+static long text_update();
+static void text_resize(int, int);
+static void text_close();
+
+static const struct backend text_backend = {
+    "text", text_open, text_put, text_update, text_resize, text_close
+};
+
+/*
+ *  main()
+ *  Purpose: Play the recording and report where the game got to
+ *    Input: argc, argv, the command line (see get_options())
+ *   Return: 0 if the game was played as far as asked (and, played to the
+ *           end, stopped where the recording did), DIVERGED if it stopped
+ *           anywhere else; exit non-zero on error
+ *   Method: The same order as the main loop in pong.c: before each tick
+ *           runs, make the moves recorded before it; after it, take a
+ *           snapshot if one is due and an index is being written.
+ */
+int main (int argc, char * argv[])
+{
+    struct replay_info info;
+    struct ppreplay * rp;
+    struct ppgame * game;
+    long ticks = 0, from, end;
+    int state = GAME_ON;
+
+    get_options(argc, argv);
+
+    if( (rp = replay_open(path, &info)) == NULL )
+    {
+        fprintf(stderr, "%s: %s: %s\n", argv[0], path,
+                        errno ? strerror(errno) : "not a pong recording");
+        exit(1);
+    }
+
+    if( info.lines < MIN_LINES || info.cols < MIN_COLS ||
+        info.balls < 1 || info.balls > MAX_BALLS || info.tick_rate < 1 )
+    {
+        fprintf(stderr, "%s: %s: bad recording settings\n", argv[0], path);
+        exit(1);
+    }
+
+    game = new_game(NULL, BORDER, info.cols - BORDER - 1,
+                    info.lines - BORDER - 1, BORDER, info.tick_rate,
+                    info.balls, info.seed, 1);
+
+    if( make_index && replay_index(rp, game) == -1 )
+    {
+        fprintf(stderr, "%s: %s index: %s\n", argv[0], path,
+                        strerror(errno));
+        exit(1);
+    }
+    else if(!make_index && stop_tick > 0)
+        ticks = replay_seek(rp, game, stop_tick);
+    from = ticks;
+
+    while( state == GAME_ON && (stop_tick < 0 || ticks < stop_tick) )
+    {
+        state = replay_play(rp, game, ticks);
+        if(state == GAME_ON)
+        {
+            state = game_tick(game);
+            ticks++;
+            if(state == GAME_ON)
+                replay_tick(rp, game, ticks);
+        }
+    }
+
+    printf("recording: %s  seed: %llu  court: %dx%d  balls: %d  "
+           "ticks/sec: %d\n", path, (unsigned long long) info.seed,
+           info.cols, info.lines, info.balls, info.tick_rate);
+    printf("tick: %ld  time: %.2d:%.2d  balls left: %d  in play: %d  "
+           "kernel: %s\n", ticks, get_mins(game_clock(game)),
+           get_secs(game_clock(game)), game_balls_left(game),
+           game_balls_in_play(game), ball_kernel_name());
+    if(from > 0)
+        printf("from the snapshot at tick %ld (%ld ticks run)\n", from,
+               ticks - from);
+
+    if(dump)
+        dump_screen(game, &info);
+
+    end = replay_end(rp);
+    if(state == GAME_ON)                // stopped at -t
+        state = 0;
+    else if(end == ticks)
+    {
+        printf("%s at tick %ld, as recorded\n",
+               (state == GAME_OVER) ? "game over" : "stopped", ticks);
+        state = 0;
+    }
+    else
+    {
+        if(end == -1)
+            printf("DIVERGED: stopped at tick %ld, but the recording "
+                   "goes on (or is cut short)\n", ticks);
+        else
+            printf("DIVERGED: stopped at tick %ld, but the recording "
+                   "ends at tick %ld\n", ticks, end);
+        state = DIVERGED;
+    }
+
+    game_end(game);
+    if( replay_close(rp, ticks) == -1 )
+    {
+        fprintf(stderr, "%s: %s index: couldn't write it all\n", argv[0],
+                        path);
+        exit(1);
+    }
+    return state;
+}
+
+/*
+ *  get_options()
+ *  Purpose: Read settings from the command line
+ *    Input: argc, argv, as passed to main()
+ *   Method: -t the tick to stop at (the moves before it are made, and
+ *           that many ticks run), -d print the screen there, -i write an
+ *           index of snapshots, -k the ball kernel to use; then the
+ *           recording to play.
+ *    Error: On an unknown option or a bad value, or a kernel this CPU can't
+ *           run, print a usage message and exit.
+ */
+void get_options(int argc, char * argv[])
+{
+    int opt, bad = 0;
+
+    while( (opt = getopt(argc, argv, "t:dik:")) != -1 )
+    {
+        if(opt == 't')
+            bad = ((stop_tick = atol(optarg)) < 0);
+        else if(opt == 'd')
+            dump = 1;
+        else if(opt == 'i')
+            make_index = 1;
+        else if(opt == 'k')
+            bad = (ball_kernel_use(optarg) == -1);
+        else
+            bad = 1;
+    }
+
+    if( bad || optind != argc - 1 )
+    {
+        fprintf(stderr, "usage: %s [-t tick] [-d] [-i] [-k kernel] "
+                        "recording\n", argv[0]);
+        fprintf(stderr, "       (kernels: %s)\n", KERNEL_NAMES);
+        exit(2);
+    }
+
+    path = argv[optind];
+    return;
+}
+
+/*
+ *  dump_screen()
+ *  Purpose: Print the screen as pong would have shown it, as text
+ *    Input: gp, the game
+ *           ip, the recording's settings, for the size of the screen
+ *     Note: The court and the game are drawn into a frame as in pong.c,
+ *           and the frame's one flush sends every cell to text_put().
+ *           Reverse-video cells lose their attribute.
+ *    Error: If malloc fails, print a message and exit.
+ */
+void dump_screen(struct ppgame * gp, const struct replay_info * ip)
+{
+    int y;
+
+    screen_cols = ip->cols;
+    if( (screen = malloc(ip->lines * ip->cols)) == NULL )
+    {
+        fprintf(stderr, "./pong-replay: Couldn't allocate memory for "
+                        "the screen.\n");
+        exit(1);
+    }
+    memset(screen, BLANK, ip->lines * ip->cols);
+
+    frame_init(ip->lines, ip->cols, &text_backend, 0);
+    game_redraw(gp);
+    frame_flush();
+
+    for(y = 0; y < ip->lines; y++)
+        printf("%.*s\n", ip->cols, screen + (y * ip->cols));
+
+    frame_end();
+    free(screen);
+    return;
+}
+
+/*
+ *  text_open(), text_put(), text_update(), text_resize(), text_close()
+ *  Purpose: A backend that keeps the chars drawn in 'screen'
+ *     Note: A replay is never resized, so text_resize() does nothing.
+ */
+void text_open(int lines, int cols, int count_bytes)
+{
+    return;
+}
+
+void text_put(int y, int x, unsigned short cell)
+{
+    screen[(y * screen_cols) + x] = CELL_CHAR(cell);
+    return;
+}
+
+long text_update()
+{
+    return 0;
+}
+
+void text_resize(int lines, int cols)
+{
+    return;
+}
+
+void text_close()
+{
+    return;
+}
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  wrap_up()
+ *  Purpose: Get ready for a fatal error to exit
+ *     Note: The game objects call this when they can't allocate memory,
+ *           just as they do in pong. Here there is no terminal to reset.
+ */
+void wrap_up()
+{
+    return;
+}
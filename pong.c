@@ -2,25 +2,118 @@
  * ==========================================================================
  *   FILE: ./pong.c
  * ==========================================================================
- * Purpose: Core logic to play a one-player pong game.
+ * Purpose: Core logic to play a pong game, alone or with a friend.
  *
  * Outline: The goal of the game is to last as long as you can. You get
  *          three balls before the game ends. To move the paddle up and
- *          down, press the 'k' and 'm' keys respectively. When the ball
- *          goes past the paddle, the game briefly pauses, then resets,
- *          serving the ball from a random position, with a random direction
- *          and speed.
+ *          down, press the 'k' and 'm' keys (or the arrow keys)
+ *          respectively. When the ball goes past the paddle, the game
+ *          briefly pauses, then resets, serving the ball from a random
+ *          position, with a random direction and speed (all drawn from
+ *          the seed, see -r). With -b, each serve puts several balls in
+ *          play at once; a serve is only lost when the last of them gets
+ *          past. ^L draws the whole screen again, if something else has
+ *          written over it. p pauses the game, and p again goes on.
+ *
+ *    Loop: All game work happens in main(). It waits in poll() on both
+ *          stdin and the ticker (see ticker.c), then drains any pending
+ *          keystrokes, runs however many game ticks are owed, and draws a
+ *          frame if one is due. The keys only add up how far the paddle
+ *          is to move; it moves that far once, just before the next tick,
+ *          so auto-repeat costs no more than a single key. Ticks run at a
+ *          fixed rate (-t) and frames at their own rate (-f), so a slow
+ *          terminal drops frames instead of slowing the game down. Nothing
+ *          is done in a signal handler, so paddle and ball updates can no
+ *          longer interleave.
+ *
+ *    Idle: The loop only wakes when there is something to run or draw.
+ *          Before each wait, the game says how many ticks away the first
+ *          that can change anything is (see game_next_change()): a ball
+ *          crossing into another cell, or the clock showing another second.
+ *          The ticks up to it are run all together when it is due, exactly
+ *          as they would have been one by one, and no frame is drawn in
+ *          between, since nothing moved. Paused, nothing wakes it but the
+ *          keys. A game played over the network, played back from a file
+ *          or watched by viewers wakes for every tick, as they go by ticks.
+ *
+ *  Replay: -w records the game to a file as it is played: the seed, the
+ *          court size and every paddle move with the tick it was made at
+ *          (see replay.c). -P plays a recording back at its own speed,
+ *          making the recorded moves instead of reading the keyboard (only
+ *          the quit key still works), and -S starts it at a later tick,
+ *          jumping to the nearest snapshot in the recording's index (also
+ *          written by -w) and running the ticks after it flat out.
+ *          pong-replay (playback.c) plays one back with no terminal, as
+ *          fast as it can, to any tick.
+ *
+ * Network: -H port waits for a second player, who joins with -C host:port
+ *          from another terminal or machine. The host has the right paddle
+ *          and the one who joins the left, both on the usual keys, and
+ *          they keep the balls in play together, sharing the lives and the
+ *          clock. Only the moves go over the network (see net.c); each side
+ *          runs the game itself, so a paddle answers its own keys at once.
+ *          A line under the court shows the round trip and packets lost,
+ *          and all the connection's counters are printed at the end.
+ *
+ * Viewers: -V port lets anyone watch the game live with pong-watch
+ *          host:port (see watch.c). After every pass of ticks, where the
+ *          balls and paddles are is sent to every viewer at once (see
+ *          spectate.c), so viewers cost the game next to nothing.
+ *
+ *  Resize: When the terminal is resized, the court is laid out again to fit
+ *          it (see game_relayout()): the balls and paddles keep their
+ *          places across and down it, and it is all redrawn once. Only the
+ *          SIGWINCH handler notices; main() does the work. A game whose
+ *          court was agreed or recorded (-w, -P, -H, -C) keeps it, since
+ *          the court decides how the game plays out, and so does any game
+ *          on a terminal made smaller than MIN_COLS x MIN_LINES: what
+ *          doesn't fit is just cut off until there is room again.
+ *
+ * Telemetry: -D shows, between the headers, how late the ticks ran (the
+ *          jitter), what the ticks and the frames took, and how long a key
+ *          took to reach the screen, over the last second. -T writes every
+ *          pass of ticks and every frame to a file, as CSV (or JSON for a
+ *          .json name), and -s sums them up at the end (see telemetry.c).
+ *
+ *  Scores: -K file logs how long the game lasted, with its seed and
+ *          settings, to a file of high scores that pong-sim -K logs to as
+ *          well (see scores.c), and the exit message says where it placed
+ *          among the best, or what the best is. Played-back games aren't
+ *          logged.
+ *
+ * Startup: -I times each phase of starting up, from the start of main() to
+ *          the first frame on the screen, and of closing down, from the end
+ *          of the game out of wrap_up(), and prints them at the end. -F
+ *          starts and stops as fast as it can, for scripts and kiosks that
+ *          run pong again and again: with curses output, the screen is
+ *          cleared by the first frame rather than a refresh of its own,
+ *          and at the end there is no two-second exit screen; the result
+ *          is printed on the terminal once curses has closed instead.
+ *
+ *  Output: Frames reach the terminal through a backend (backend.h): curses
+ *          by default, or with -o ansi, raw escape sequences in one write()
+ *          per frame (ansi_backend.c). Either way curses starts and stops
+ *          the terminal and reads the keys. With -R, either is written to
+ *          from a thread of its own (render.c): each frame hands it a
+ *          copy of the screen through a lock-free ring and goes on, so a
+ *          terminal that blocks for a while drops frames, and the ticks
+ *          keep their time.
  *
  * Objects: pong is written with object-oriented programming in mind. The key
  *          elements of the game exist in respective .c files, controlled by
  *          public (non-static) functions exposed in .h files. For pong, the
- *          objects include the ball and paddle, of which multiple can be
- *          instantiated (with further development, this could lead to a
- *          two-player, or multi-ball pong game). A separate object also
+ *          objects include the ball and paddle. The ball object holds
+ *          every ball in play (see ball.c), which is what multi-ball
+ *          builds on, and there is a second paddle for the two-player
+ *          game over the network. A separate object also
  *          exists for the clock, which keeps track (in minutes and seconds)
  *          how long the player has been playing. To keep the code modular,
  *          functions that exist to draw the court are also separated out
- *          into its own file.
+ *          into its own file. The rules that tie them together live in
+ *          game.c, which has no curses in it; this file adds the terminal,
+ *          keyboard and timing around it. A game (struct ppgame) owns its
+ *          own court, clock, paddle and balls, so this file just keeps a
+ *          pointer to the one being played.
  *
  *    Note: Some of the code (like the main loop) was copied and/or heavily
  *          inspired by code found in the assignment handout, or sample
@@ -28,141 +121,725 @@
  *          function for any further comments.
  *
  * Interface:
- *      alarm_handler() -- signal handler; used for ball movement
  *      wrap_up()       -- closes curses and ready to return to terminal
- *      park_cursor()   -- helper function to park cursor in bottom-right
  *
  * Internal functions:
- *      main()          -- loop of the game, blocking on keyboard input
+ *      main()          -- loop of the game, waiting on keyboard and ticker
+ *      get_options()   -- read settings from the command line
  *      set_up()        -- prepare the terminal to play, init structs and vars
- *      up_paddle()     -- wrapper to paddle function and check game state
- *      down_paddle()   -- wrapper to paddle function and check game state
+ *      read_keys()     -- drain pending keystrokes and add up the moves
+ *      toggle_pause()  -- pause the game, or go on with it
+ *      make_moves()    -- move the paddle as far as the keys added up to
+ *      play_ticks()    -- run the ticks that are due, and any replayed moves
+ *      render_frame()  -- draw everything that changed since the last frame
  *      is_min_size()   -- ensure the terminal is large enough to play
- *      is_next_round() -- see if there is another round to play, and do so
+ *      relayout()      -- fit the court to a resized terminal, and redraw
+ *      log_score()     -- log how long the game lasted, with -K
  *      exit_message()  -- print message about how player did when exiting
+ *      print_result()  -- print it after curses is closed instead, with -F
+ *      print_stats()   -- print the frame output counters, if asked for
+ *      print_telemetry() -- print how smoothly the game ran
+ *      print_render()  -- print what the render thread did with the frames
+ *      mark()          -- note when a phase of starting or closing ended
+ *      print_startup() -- print how long each phase took
  */
 
 /* INCLUDES */
 #include <stdio.h>
 #include <curses.h>
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
 #include <signal.h>
 #include <unistd.h>
 #include <stdlib.h>
-#include "alarmlib.h"
-#include "ball.h"
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include "backend.h"
 #include "clock.h"
 #include "court.h"
+#include "frame.h"
+#include "game.h"
+#include "net.h"
 #include "paddle.h"
 #include "pong.h"
+#include "render.h"
+#include "replay.h"
+#include "scores.h"
+#include "spectate.h"
+#include "telemetry.h"
+#include "ticker.h"
 
 /* CONSTANTS */
-#define MIN_LINES 11        // minimum terminal row size
-#define MIN_COLS 40         // minimum terminal column size
 #define EXIT_MSG_LEN 16     // to help center exit message
+#define QUIT_KEY 'Q'        // key to end the game early
+#define REDRAW_KEY ('L' & 037)  // ^L, to draw a garbled screen again
+#define PAUSE_KEY 'p'       // key to pause the game, and to go on
+#define PAUSE_MSG "PAUSED (p to play on)"
+#define MAX_RATE 1000       // highest tick or frame rate accepted
+#define MAX_MOVES 127       // most rows the keys can add up to, either way
+#define WAIT_MS 100         // how often to check the keys while waiting
+#define WAIT_MSG "Waiting for the other player (Q to give up)"
+#define MINUTE 60
+#define MAX_MARKS 32        // most phases -I times
+
+/* LOCAL VARIABLES -- SETTINGS */
+static int tick_rate = TICKS_PER_SEC;   // simulation ticks per second
+static int frame_rate = FRAMES_PER_SEC; // frames drawn per second
+static int show_stats = 0;              // print output counters at exit
+static int balls = 1;                   // balls in play per serve
+static unsigned long long seed;         // for the game's random numbers
+static const char * record_path;        // -w: record the game to this file
+static struct replay_info recorded;     // -P: what the recording was of
+static long start_tick = 0;             // -S: where to start playing it
+static const char * host_port;          // -H: wait for a player here
+static const char * join_addr;          // -C: join the player there
+static const char * view_port;          // -V: take viewers here
+static int show_hud = 0;                // -D: show the telemetry line
+static const char * telem_path;         // -T: export the telemetry here
+static const struct backend * backend = &curses_backend;    // -o: output
+static int render = 0;                  // -R: output from its own thread
+static const char * score_path;         // -K: log the result to this file
+static int show_startup = 0;            // -I: time starting up and closing
+static int fast = 0;                    // -F: start and stop without waits
+
+/* LOCAL VARIABLES -- REPLAY */
+static struct ppreplay * recorder;      // -w: the recording being made
+static struct ppreplay * playback;      // -P: the recording being played
+static long tick_count;                 // ticks the game has run
+
+/* LOCAL VARIABLES -- INPUT */
+static int moves;                       // rows to move at the next tick,
+                                        // negative for up
+static int paused;                      // 1 while the game is paused
+static int idle;                        // 1 to sleep through quiet ticks
+static long wakeups;                    // times the main loop woke
+
+/* LOCAL VARIABLES -- NETWORK */
+static struct ppnet * net;              // -H or -C: the other player
+static struct net_stats net_totals;     // how the connection went
+
+/* LOCAL VARIABLES -- VIEWERS */
+static struct ppspec * viewers;         // -V: watching the game
+static struct spec_stats view_totals;   // what they cost
+
+/* LOCAL VARIABLES -- TELEMETRY */
+static struct pptelem * telem;          // -D, -T or -s: timing the game
+static struct telem_stats telem_totals; // how smoothly it ran
+
+/* LOCAL VARIABLES -- SCORES */
+static struct ppscores * scores;        // -K: the results so far
+static long lasted;                     // seconds of play the game lasted
+static int rank;                        // where this game placed, from 1,
+                                        // or 0 if it isn't among the best
+static long best_secs;                  // the best result logged
+static long logged;                     // and how many there are
+
+/* LOCAL VARIABLES -- STARTUP */
+static struct {
+    const char * what;                  // the phase that just ended
+    long long at;                       // when, from telem_now()
+} marks[MAX_MARKS];                     // -I: main()'s start, then phases
+static int n_marks;
+
+/* LOCAL VARIABLES -- SIGNALS */
+static volatile sig_atomic_t resized;   // SIGWINCH since the last relayout
 
 /* LOCAL VARIABLES -- OBJECT INSTANCES */
-static struct pppaddle * paddle;
-static struct ppball * ball;
+static struct ppgame * game;            // the game being played
+static WINDOW * keys;                   // the window keys are read through
 
 /*
  * ===========================================================================
  * INTERNAL FUNCTIONS
  * ===========================================================================
  */
+static void get_options(int, char **);
 static void set_up();
-static void up_paddle();
-static void down_paddle();
+static int read_keys();
+static void toggle_pause();
+static int make_moves();
+static int play_ticks(long);
+static void render_frame();
 static void is_min_size();
-static void is_next_round();
+static void relayout();
+static int log_score();
 static void exit_message();
+static void print_result();
+static void print_stats();
+static void print_telemetry();
+static void print_render();
+static void mark(const char *);
+static void print_startup();
 static void resize_handler(int);
+static void wait_for_peer();
+static void draw_net_line();
 /*
  *  main()
  *  Purpose: Set the stage to play pong.
+ *    Input: argc, argv, the command line (see get_options())
  *   Method: Start by initializing all necessary variables and structs. Then,
- *           animate ball movement and block on keyboard input to move the
- *           paddle.
+ *           wait in poll() until either a key is pressed or the ticker
+ *           says a tick or frame is due. Keys are handled as soon as they
+ *           arrive, the game is advanced by as many ticks as are owed, and
+ *           then a frame is drawn if it is time for one.
  *   Return: 0 on success, exit non-zero on error. When fatal error occurs,
  *           function will call wrap_up() which will reset the terminal
  *           settings and call exit().
  *     Note: The structure is mostly copied from the assignment spec, with
  *           modifications to fit the object-oriented design of the program.
+ *     Note: poll() ignores an entry with a negative descriptor, so when the
+ *           ticker has no timerfd, the timeout from ticker_arm() wakes the
+ *           loop instead, and when there is no other player or no viewers
+ *           their entries are -1 too.
+ *     Note: With telemetry, each pass of ticks and each frame is timed
+ *           from just before it starts until it is done.
+ *     Note: When idle, before each wait the ticker is told how many ticks
+ *           it can sleep through (see Idle above). Not while moves are
+ *           waiting, or just after a key: a paddle that moves can change
+ *           what the ticks do, and a key may want a frame (^L, pause).
  */
-int main ()
+int main (int argc, char * argv[])
 {
-    int c;
+    struct pollfd fds[4];
+    int state = GAME_ON, frames = 0, err;
+    long ticks;
+    long long start;
+
+    mark("main");
+    get_options(argc, argv);
+    mark("options");
     set_up();
-    serve(ball);
+    if(start_tick > tick_count)         // -S: catch up to it at once
+        state = play_ticks(start_tick - tick_count);
+
+    fds[0].fd = STDIN_FILENO;           // keyboard
+    fds[0].events = POLLIN;
+    fds[1].fd = ticker_fd();            // game ticks
+    fds[1].events = POLLIN;
+    fds[2].fd = (net != NULL) ? net_fd(net) : -1;  // the other player
+    fds[2].events = POLLIN;
+    fds[3].fd = (viewers != NULL) ? spec_fd(viewers) : -1;
+    fds[3].events = POLLIN;
+    fds[0].revents = 0;
+    idle = (net == NULL && playback == NULL && viewers == NULL);
+
+    while( state == GAME_ON )
+    {
+        if(idle)
+            ticker_wake_after( (moves != 0 || (fds[0].revents & POLLIN)) ?
+                               1 : game_next_change(game) );
+
+        if( poll(fds, 4, ticker_arm()) == -1 && errno != EINTR )
+        {
+            wrap_up();
+            perror("./pong: poll");
+            exit(1);
+        }
+        wakeups++;
+
+        if(resized)                     // the terminal changed size
+            relayout();
 
-    while( get_balls_left(ball) >= 0 && (c = getch()) != 'Q')
+        if( fds[2].revents & POLLIN )
+            net_receive(net, game);
+
+        if( fds[3].revents & POLLIN )
+            spec_service(viewers);
+
+        if( fds[0].revents & POLLIN )
+            state = read_keys();
+
+        if( state == GAME_ON && (ticks = ticker_ticks_due()) > 0 )
+        {
+            start = telem_now();
+            state = play_ticks(ticks);
+            if(telem != NULL)
+                telem_ticks(telem, start, ticker_late(), ticks);
+            if(viewers != NULL)
+                spec_publish(viewers, game);
+        }
+
+        if( state == GAME_ON && ticker_frame_due() )
+        {
+            start = telem_now();
+            render_frame();
+            ticker_frame_done();
+            if(telem != NULL)
+                telem_frame(telem, start);
+            if(frames++ == 0)
+                mark("first frame");
+        }
+    }
+
+    mark("game over");
+
+    if(net != NULL)                     // let the other player know
+    {
+        net_get_stats(net, &net_totals);
+        net_close(net);
+        net = NULL;
+    }
+
+    if(viewers != NULL)                 // the viewers see the end too
     {
-        if(c == 'k')
-            up_paddle();
-        else if (c == 'm')
-            down_paddle();
+        spec_publish(viewers, game);
+        spec_get_stats(viewers, &view_totals);
+        spec_close(viewers);
+        viewers = NULL;
     }
 
+    if(telem != NULL)
+        telem_get_stats(telem, &telem_totals);
+
+    err = log_score();                  // on disk before it is shown
+    mark("score logged");
+    game_draw(game);                    // show the final state
     exit_message();
+    mark("exit screen");
     wrap_up();
+    if(fast)
+        print_result();
+    if(err == -1)
+        fprintf(stderr, "./pong: %s: couldn't log the result\n", score_path);
+    print_stats();
+    if(show_startup)
+        print_startup();
     return 0;
 }
 
+/*
+ *  get_options()
+ *  Purpose: Read settings from the command line
+ *    Input: argc, argv, as passed to main()
+ *   Method: -t sets the simulation rate in ticks per second, which also
+ *           sets the speed of the game. -f sets how many frames are drawn
+ *           per second. Both default to the constants in clock.h. -b puts
+ *           more than one ball in play at a time (multi-ball). -r (or
+ *           --seed) sets the seed for every random choice in the game, so
+ *           it can be played again; it defaults to the process ID. -s
+ *           prints what the frames cost in terminal output, and the seed,
+ *           at exit. -w records the game to a file, and -P plays one back,
+ *           with the seed, balls and tick rate it was recorded with,
+ *           from the tick given with -S. -H waits on a UDP port for a
+ *           second player, and -C joins one; the game is the host's seed,
+ *           balls and tick rate. -V takes viewers on a UDP port. -D
+ *           shows the telemetry line, and -T exports it to a file. -o
+ *           picks how frames reach the terminal: through curses (the
+ *           default) or as raw ANSI sequences (see ansi_backend.c). -R
+ *           has them written by a thread of their own (see render.c). -K
+ *           logs how long the game lasted to a file of high scores. -I
+ *           times starting up and closing down, and -F skips the waits in
+ *           both (see Startup above).
+ *    Error: On an unknown option, a rate outside 1..MAX_RATE, a ball
+ *           count outside 1..MAX_BALLS, an unknown -o backend, both -w
+ *           and -P, -H or -C with each other or with a recording, or -K
+ *           with -P, print a usage message and exit. If the -P file can't
+ *           be read, say why and exit. Curses has not been started yet.
+ */
+void get_options(int argc, char * argv[])
+{
+    static const struct option longopts[] = {
+        { "seed", required_argument, NULL, 'r' },
+        { NULL, 0, NULL, 0 }
+    };
+    const char * play_path = NULL;
+    int opt;
+
+    seed = getpid();
+    while( (opt = getopt_long(argc, argv, "b:t:f:r:sw:P:S:H:C:V:DRIFT:o:K:",
+                              longopts, NULL)) != -1 )
+    {
+        if(opt == 'b')
+            balls = atoi(optarg);
+        else if(opt == 'r')
+            seed = strtoull(optarg, NULL, 0);
+        else if(opt == 't')
+            tick_rate = atoi(optarg);
+        else if(opt == 'f')
+            frame_rate = atoi(optarg);
+        else if(opt == 's')
+            show_stats = 1;
+        else if(opt == 'w')
+            record_path = optarg;
+        else if(opt == 'P')
+            play_path = optarg;
+        else if(opt == 'S')
+            start_tick = atol(optarg);
+        else if(opt == 'H')
+            host_port = optarg;
+        else if(opt == 'C')
+            join_addr = optarg;
+        else if(opt == 'V')
+            view_port = optarg;
+        else if(opt == 'D')
+            show_hud = 1;
+        else if(opt == 'R')
+            render = 1;
+        else if(opt == 'K')
+            score_path = optarg;
+        else if(opt == 'I')
+            show_startup = 1;
+        else if(opt == 'F')
+            fast = 1;
+        else if(opt == 'T')
+            telem_path = optarg;
+        else if(opt == 'o' && strcmp(optarg, curses_backend.name) == 0)
+            backend = &curses_backend;
+        else if(opt == 'o' && strcmp(optarg, ansi_backend.name) == 0)
+            backend = &ansi_backend;
+        else
+            tick_rate = 0;              // force the usage message
+    }
+
+    if( play_path != NULL && record_path == NULL && tick_rate > 0 )
+    {
+        if( (playback = replay_open(play_path, &recorded)) == NULL )
+        {
+            fprintf(stderr, "./pong: %s: %s\n", play_path, errno ?
+                            strerror(errno) : "not a pong recording");
+            exit(1);
+        }
+
+        seed = recorded.seed;
+        balls = recorded.balls;
+        tick_rate = recorded.tick_rate;
+    }
+
+    if( tick_rate < 1 || tick_rate > MAX_RATE ||
+        frame_rate < 1 || frame_rate > MAX_RATE ||
+        balls < 1 || balls > MAX_BALLS || optind < argc ||
+        (play_path != NULL && record_path != NULL) || start_tick < 0 ||
+        (start_tick > 0 && play_path == NULL) ||
+        (host_port != NULL && join_addr != NULL) ||
+        ((host_port != NULL || join_addr != NULL) &&
+         (play_path != NULL || record_path != NULL)) ||
+        (score_path != NULL && play_path != NULL) )
+    {
+        fprintf(stderr, "usage: %s [-sDRIF] [-b balls] [-t ticks_per_sec] "
+                        "[-f frames_per_sec] [-r seed] [-V view_port]\n"
+                        "        [-T telemetry_file] [-o curses|ansi] "
+                        "[-K score_file]\n"
+                        "        [-w record_file | -P replay_file [-S tick] |"
+                        " -H port | -C host:port]\n",
+                        argv[0]);
+        exit(2);
+    }
+
+    return;
+}
+
 /*
  *  set_up()
  *  Purpose: Prepare terminal for the game
  *     Note: Some of the lines were copied from bounce2d.c. Most have been
  *           added, by me, to create/initialize objects for use in this file.
+ *     Note: A replay is laid out on a court the size it was recorded on,
+ *           since that decides how the game plays out, so the terminal
+ *           has to be at least that big.
+ *     Note: With -S, the game is set to the last snapshot before that
+ *           tick here, before anything is drawn; main() runs the rest.
+ *     Note: With -H or -C, the game waits here for the other player (see
+ *           wait_for_peer()), and is then laid out like a replay, from the
+ *           settings the two agreed on.
+ *     Note: With -R, the keys are read through a window of their own that
+ *           nothing is drawn in, since getch() refreshes the window it
+ *           reads through if it was drawn in, or touched (as newwin()
+ *           and resizeterm() leave it), and only the render thread may
+ *           write to the screen. stdscr is left to the render thread.
+ *     Note: With -K, the high scores are opened here, before the game
+ *           starts, so a file that can't be used is found out at once.
+ *    Error: If the recording or its index, the telemetry file or the high
+ *           scores can't be created, or the terminal is too small to play
+ *           a recording back, close curses, print a message and exit.
  */
 void set_up()
 {
     // Set up terminal
     initscr();                          // turn on curses
     is_min_size();                      // check screen size
+    if(fast && backend == &curses_backend)
+        wnoutrefresh(stdscr);           // the first frame clears it
+    else
+        refresh();                      // clear it now, not at the 1st getch
     noecho();                           // turn off echo
     cbreak();                           // turn off buffering
-    srand(getpid());                    // seed rand() generator
+    keys = render ? newwin(1, 1, 0, 0) : stdscr;
+    untouchwin(keys);                   // or the 1st getch() refreshes it
+    nodelay(keys, TRUE);                // getch() returns ERR when drained
+    keypad(keys, TRUE);                 // arrow keys as KEY_UP, KEY_DOWN
+    mark("curses");
+
+    // Track what is on screen, and show it through the chosen backend,
+    // from a thread of its own with -R
+    if(render)
+        render_use(backend);
+    frame_init(LINES, COLS, render ? &render_backend : backend, show_stats);
+    mark("frame");
+
+    // Recording, or playing back
+    if(playback == NULL)
+        recorded = (struct replay_info) { seed, tick_rate, LINES, COLS, balls };
+    if(host_port != NULL || join_addr != NULL)
+    {
+        wait_for_peer();
+        mark("peer");
+    }
+    else if(LINES < recorded.lines || COLS < recorded.cols)
+    {
+        wrap_up();
+        fprintf(stderr, "The recording needs a terminal of at least %dx%d. "
+                        "Please resize and try again.\n",
+                        recorded.cols, recorded.lines);
+        exit(1);
+    }
+
+    if( record_path != NULL &&
+        (recorder = replay_create(record_path, &recorded)) == NULL )
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: %s: %s\n", record_path, strerror(errno));
+        exit(1);
+    }
 
     // Court dimensions
     int top = BORDER;
-    int right = COLS - BORDER - 1;      // -1 because 0-indexed
-    int bot = LINES - BORDER - 1;       // -1 because 0-indexed
+    int right = recorded.cols - BORDER - 1;     // -1 because 0-indexed
+    int bot = recorded.lines - BORDER - 1;      // -1 because 0-indexed
     int left = BORDER;
 
     // Initialize objects
-    court_init(top, right, bot, left);  // init a court
-    paddle = new_paddle();              // create a paddle
-    ball = new_ball();                  // create a ball
-    clock_init();                       // init the clock
-    print_court(NUM_BALLS);             // print court
+    game = new_game(NULL, top, right, bot, left, tick_rate, balls, seed,
+                    (net != NULL) ? 2 : 1);
+    if(net != NULL)
+        net_attach(net, game);
+    mark("game");
+    if( recorder != NULL && replay_index(recorder, game) == -1 )
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: %s index: %s\n", record_path,
+                        strerror(errno));
+        exit(1);
+    }
+    if(playback != NULL && start_tick > 0)
+        tick_count = replay_seek(playback, game, start_tick);
+    if(view_port != NULL)
+        viewers = new_spec(view_port);
+    if( (show_hud || show_stats || telem_path != NULL) &&
+        (telem = new_telem(telem_path)) == NULL )
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: %s: %s\n", telem_path, strerror(errno));
+        exit(1);
+    }
+    if( score_path != NULL && (scores = scores_open(score_path)) == NULL )
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: %s: %s\n", score_path, errno ?
+                        strerror(errno) : "not a pong score file");
+        exit(1);
+    }
+    mark("files");
+    print_court(game_court(game), game_clock(game), NUM_BALLS);
+    mark("court");
 
     // Signal handling
     signal(SIGINT, SIG_IGN);            // ignore SIGINT
-    signal(SIGWINCH, resize_handler);   // check if still min dimensions
-    signal(SIGALRM, alarm_handler);     // setup ALRM handler
-    set_ticker(1000 / TICKS_PER_SEC);   // send an ALRM per tick
+    signal(SIGWINCH, resize_handler);   // lay the court out again
+
+    // Game ticks and frames
+    ticker_start(tick_rate, frame_rate);
+    mark("ticker");
 
     return;
 }
 
 /*
- *  up_paddle()
- *  Purpose: Move the paddle up and check if it made contact with ball
+ *  read_keys()
+ *  Purpose: Handle every keystroke waiting on stdin
+ *   Return: GAME_QUIT if the player asked to quit, otherwise GAME_ON
+ *   Method: Each paddle key only adds a row up or down to 'moves'; nothing
+ *           moves until make_moves(), just before the next tick. So a burst
+ *           of auto-repeated keys (or an up cancelled by a down) costs one
+ *           move, and one check for lost balls, per row the paddle really
+ *           goes, however many keys there were.
+ *     Note: With nodelay() set, getch() returns ERR once the input is
+ *           drained instead of blocking, so every key waiting is handled in
+ *           one pass round the main loop. keypad() turns the arrow keys'
+ *           escape sequences into KEY_UP and KEY_DOWN.
+ *     Note: With -P, the paddle keys are ignored; the recording moves it.
+ *           ^L works whatever the game, and changes nothing in it: the
+ *           frame just sends the whole screen again (frame_repaint()).
+ *     Note: With another player, a move goes to the network, which adds
+ *           them up the same way and makes them on both sides at the same
+ *           tick. The game can't be paused then: the other side plays on.
+ *     Note: While paused, only the pause key, ^L and Q do anything.
  */
-void up_paddle()
+int read_keys()
 {
-    paddle_up(paddle);
-    is_next_round();
+    int c, dir;
+
+    while( (c = wgetch(keys)) != ERR )
+    {
+        if(c == QUIT_KEY)
+        {
+            if(recorder != NULL)
+                replay_event(recorder, tick_count, REPLAY_QUIT);
+            return GAME_QUIT;
+        }
+        else if(c == REDRAW_KEY)
+        {
+            frame_repaint();            // sent again on the next frame
+            if(paused)
+                render_frame();         // and there are none while paused
+            continue;
+        }
+        else if(c == PAUSE_KEY && net == NULL)
+        {
+            toggle_pause();
+            continue;
+        }
+        else if(paused)
+            continue;                   // the paddle stays put meanwhile
+        else if( (c == 'k' || c == KEY_UP) && playback == NULL )
+            dir = PADDLE_UP;
+        else if( (c == 'm' || c == KEY_DOWN) && playback == NULL )
+            dir = PADDLE_DOWN;
+        else
+            continue;                   // not a key for this game
+
+        if(telem != NULL)
+            telem_input(telem);
+        if(net != NULL)
+            net_move(net, dir);
+        else if(moves + dir >= -MAX_MOVES && moves + dir <= MAX_MOVES)
+            moves += dir;
+    }
+
+    return GAME_ON;
+}
+
+/*
+ *  toggle_pause()
+ *  Purpose: Pause the game, or go on with it
+ *   Method: Paused, the ticker hands out no ticks and no frames (see
+ *           ticker_pause()), so the main loop sleeps until a key comes.
+ *           The message goes over the court at once, and every frame drawn
+ *           meanwhile (after a resize, or ^L) draws it again. On going on,
+ *           the court is printed again over it, and a frame is due at once.
+ *     Note: No tick runs while paused, so the clock stops, and a recording
+ *           or a replay (-w, -P) plays out the same either way.
+ */
+void toggle_pause()
+{
+    paused = !paused;
+    ticker_pause(paused);
+
+    if(paused)
+        render_frame();
+    else
+        game_redraw(game);
+
     return;
 }
 
 /*
- *  down_paddle()
- *  Purpose: Move the paddle down and check if it made contact with ball
+ *  make_moves()
+ *  Purpose: Move the paddle as far as the keys since the last tick added
+ *           up to
+ *   Return: GAME_OVER if a move lost the last ball, otherwise GAME_ON
+ *     Note: The paddle moves a row at a time, as it always has, so that
+ *           a game plays out the same however its moves were coalesced.
+ *           With -w, each row is recorded with the ticks run so far, and
+ *           -P makes them again at that tick, just as here.
  */
-void down_paddle()
+int make_moves()
 {
-    paddle_down(paddle);
-    is_next_round();
+    int dir = (moves < 0) ? PADDLE_UP : PADDLE_DOWN;
+    int state = GAME_ON;
+
+    for( ; moves != 0 && state == GAME_ON; moves -= dir)
+    {
+        if(recorder != NULL)
+            replay_event(recorder, tick_count,
+                         (dir == PADDLE_UP) ? REPLAY_UP : REPLAY_DOWN);
+        state = game_paddle(game, dir);
+    }
+
+    moves = 0;
+    return state;
+}
+
+/*
+ *  play_ticks()
+ *  Purpose: Run the game ticks that are owed
+ *    Input: ticks, how many the ticker says are due
+ *   Return: GAME_ON, or GAME_OVER or GAME_QUIT if the game stopped
+ *     Note: The moves the keys added up to are made before the first of
+ *           them. With -P, the moves recorded before each tick are made
+ *           just before it runs, which is where make_moves() made them.
+ *           With -w, a snapshot for the index is taken after it, when one
+ *           is due.
+ *     Note: With another player, the network runs them (see net.c), and
+ *           may run fewer, or more again, to keep the two sides in step.
+ */
+int play_ticks(long ticks)
+{
+    int state = GAME_ON;
+
+    if(net != NULL)
+        return net_advance(net, game, ticks);
+
+    if(ticks > 0 && moves != 0)
+        state = make_moves();
+
+    for( ; ticks > 0 && state == GAME_ON; ticks-- )
+    {
+        if(playback != NULL)
+            state = replay_play(playback, game, tick_count);
+
+        if(state == GAME_ON)
+        {
+            state = game_tick(game);
+            tick_count++;
+            if(state == GAME_ON)
+                replay_tick(recorder, game, tick_count);
+        }
+    }
+
+    return state;
+}
+
+/*
+ *  render_frame()
+ *  Purpose: Bring the screen up to date with the game
+ *   Method: Any number of ticks (including none) may have run since the
+ *           last frame. The ball and paddle redraw themselves only if they
+ *           have moved. The two headers are reprinted every frame; the
+ *           frame only treats the chars that changed as damage, so most
+ *           frames they cost nothing. All of it then goes to the terminal
+ *           in a single frame_flush().
+ *     Note: With -D, the samples so far are taken out of the telemetry's
+ *           ring first, so the line shown is up to date.
+ *     Note: While paused, the message goes over the middle of the court.
+ */
+void render_frame()
+{
+    struct ppcourt * court = game_court(game);
+
+    game_draw(game);
+    if(net != NULL)
+        draw_net_line();
+    if(telem != NULL)
+        telem_drain(telem);
+    if(show_hud)
+        print_hud(court, telem_hud(telem));
+    if(paused)
+        frame_print_standout((get_top_edge(court) + get_bot_edge(court)) / 2,
+                             (get_left_edge(court) + get_right_edge(court) -
+                              (int) strlen(PAUSE_MSG)) / 2, PAUSE_MSG);
+    frame_flush();
     return;
 }
 
@@ -186,45 +863,163 @@ void is_min_size()
 }
 
 /*
- *  is_next_round()
- *  Purpose: After ball or paddle movement, see if it is LOSE. If yes,
- *           start a new round.
+ *  relayout()
+ *  Purpose: Fit the game to the terminal after it was resized, and show it
+ *   Method: Read the new size from the terminal, size the frame (and
+ *           curses) to it, which clears the screen (for the ANSI backend,
+ *           only the frame does: stdscr is left untouched, or the next
+ *           getch() would clear it behind the frame), then move the court's
+ *           walls to where set_up() would have put them on a terminal this
+ *           size, and the balls and paddles with them. Then draw it all
+ *           again from the court up (game_redraw()) and show the frame.
+ *     Note: The court stays as it was if it can't be moved (see Resize
+ *           above), or if the size can't be read.
  */
-void is_next_round()
+void relayout()
 {
-    if( bounce_or_lose(ball, paddle) == LOSE)
-    {
-        if(get_balls_left(ball) > 0)    //more balls left
-        {
-            serve(ball);                // start again
-        }
-        else                            // no more balls
-        {
-            exit_message();             // print final time
-            wrap_up();                  // clean up...
-            exit(0);                    // ...and quit
-        }
-    }
+    struct winsize ws;
+    int lines, cols;
+
+    resized = 0;
+    if( ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1 || ws.ws_row == 0 ||
+        ws.ws_col == 0 )
+        return;
+
+    lines = ws.ws_row;
+    cols = ws.ws_col;
+    if(render)
+        render_sync();                      // nothing else is in curses now
+    resizeterm(lines, cols);                // curses reads keys at this size
+    if(keys != stdscr)
+        untouchwin(keys);                   // only the render thread draws
+    if(backend != &curses_backend)
+        untouchwin(stdscr);                 // or getch() clears the screen
+    frame_resize(lines, cols);
+
+    if( recorder == NULL && playback == NULL && net == NULL &&
+        lines >= MIN_LINES && cols >= MIN_COLS )
+        game_relayout(game, BORDER, cols - BORDER - 1, lines - BORDER - 1,
+                      BORDER);
+
+    game_redraw(game);
+    render_frame();
 
     return;
 }
 
 /*
  *  resize_handler()
- *  Purpose: On window size change, exit the program and output error message.
+ *  Purpose: On window size change, note it for main() to deal with
+ *     Note: Nothing else is safe to do here; see relayout().
  */
 void resize_handler(int s)
 {
-    wrap_up();
-    fprintf(stderr, "Please don't resize once the game has started.\n");
-    exit(3);
+    resized = 1;
+    return;
+}
+
+/*
+ *  wait_for_peer()
+ *  Purpose: Wait until the other player is there and the two agree on a
+ *           game: the host's seed, balls and tick rate, on a court that
+ *           fits both terminals
+ *   Output: recorded, seed, balls and tick_rate, set to what was agreed
+ *    Error: If the player gives up with the quit key, close curses, say
+ *           so and exit.
+ */
+void wait_for_peer()
+{
+    int y = LINES / 2;
+    int x = (COLS - (int) strlen(WAIT_MSG)) / 2;
+
+    net = (host_port != NULL) ? net_host(host_port) : net_join(join_addr);
+
+    frame_print(y, (x > 0) ? x : 0, "%s", WAIT_MSG);
+    frame_flush();
 
+    while( !net_wait(net, &recorded, WAIT_MS) )
+        if(wgetch(keys) == QUIT_KEY)
+        {
+            wrap_up();
+            fprintf(stderr, "./pong: gave up waiting for the other player\n");
+            exit(1);
+        }
+
+    frame_print(y, (x > 0) ? x : 0, "%*s", (int) strlen(WAIT_MSG), "");
+    seed = recorded.seed;
+    balls = recorded.balls;
+    tick_rate = recorded.tick_rate;
     return;
 }
 
+/*
+ *  draw_net_line()
+ *  Purpose: Show how the connection is doing, under the court
+ *     Note: Like the headers, it is printed every frame, and only costs
+ *           anything when a number in it changes.
+ */
+void draw_net_line()
+{
+    struct ppcourt * court = game_court(game);
+    struct net_stats st;
+
+    net_get_stats(net, &st);
+    frame_print(get_bot_edge(court) + 2, get_left_edge(court),
+                "%s paddle  rtt %4.0f ms  lost %-5ld  rollbacks %-6ld",
+                (net_side(net) == RIGHT_SIDE) ? "right" : "left",
+                (st.rtt > 0) ? st.rtt : 0.0, st.lost, st.rollbacks);
+    return;
+}
+
+/*
+ *  log_score()
+ *  Purpose: Note how long the game lasted, and with -K, log it, with its
+ *           seed and settings, and see where it places among the best
+ *   Output: lasted, and with -K, rank, best_secs and logged, for
+ *           exit_message()
+ *   Return: 0, or -1 if it could not be written
+ *     Note: The log is closed here, which writes the result and syncs it,
+ *           so it is on disk before the game says how it did.
+ */
+int log_score()
+{
+    struct score sc;
+    const struct score * best;
+    int err;
+
+    lasted = (get_mins(game_clock(game)) * MINUTE) +
+             get_secs(game_clock(game));
+    if(scores == NULL)
+        return 0;
+
+    memset(&sc, 0, sizeof(sc));
+    sc.when = time(NULL);
+    sc.seed = seed;
+    sc.secs = lasted;
+    sc.lines = recorded.lines;
+    sc.cols = recorded.cols;
+    sc.balls = balls;
+    sc.tick_rate = tick_rate;
+    sc.who = SCORE_PLAYER;
+
+    rank = scores_add(scores, &sc);
+    logged = scores_count(scores);
+    if(scores_top(scores, &best) > 0)
+        best_secs = best[0].secs;
+
+    err = scores_close(scores);
+    scores = NULL;
+    return err;
+}
+
 /*
  *  exit_message()
  *  Purpose: Display the final 'score'
+ *     Note: With -K, under it goes where it placed among the best, or
+ *           what the best is.
+ *     Note: With -F, nothing is shown and nothing waited for; the result
+ *           is printed once curses is closed (print_result()), where it
+ *           stays on the screen after pong has gone.
  */
 void exit_message()
 {
@@ -232,12 +1027,20 @@ void exit_message()
     int y = (LINES / 2);
     int x = (COLS / 2) - (EXIT_MSG_LEN / 2);
 
+    if(fast)
+        return;
+
     // Print time in reverse-text
-    standout();
-    mvprintw(y, x, "You lasted %.2d:%.2d", get_mins(), get_secs());
-    standend();
-    park_cursor();
-    refresh();
+    frame_print_standout(y, x, "You lasted %.2d:%.2d",
+                         get_mins(game_clock(game)), get_secs(game_clock(game)));
+    if(score_path != NULL && rank > 0)
+        frame_print(y + 1, x, "Best #%d of %ld", rank, logged);
+    else if(score_path != NULL)
+        frame_print(y + 1, x, "Best is %.2ld:%.2ld", best_secs / MINUTE,
+                    best_secs % MINUTE);
+    frame_flush();
+    if(render)
+        render_sync();                      // on the screen, not on its way
 
     // Keep it on screen for 2 seconds
     sleep(2);
@@ -245,61 +1048,207 @@ void exit_message()
 }
 
 /*
- * ===========================================================================
- * EXTERNAL INTERFACE
- * ===========================================================================
+ *  print_result()
+ *  Purpose: With -F, print what exit_message() would have shown, to stdout
+ *     Note: Called after wrap_up(), so curses is closed and stdout is the
+ *           terminal's own screen again.
  */
+void print_result()
+{
+    printf("You lasted %.2ld:%.2ld", lasted / MINUTE, lasted % MINUTE);
+    if(score_path != NULL && rank > 0)
+        printf("  Best #%d of %ld", rank, logged);
+    else if(score_path != NULL)
+        printf("  Best is %.2ld:%.2ld", best_secs / MINUTE,
+               best_secs % MINUTE);
+    printf("\n");
+    return;
+}
 
 /*
- *  alarm_handler()
- *  Purpose: Handle SIGALRMs
- *    Input: s, the type of signal received
- *   Method: Ignore any SIGALRMs received while in the handler. Then,
- *           update the clock, move the ball, and call is_next_round()
- *           which will check bounce_or_lose().
- *     Note: This handler calls a few functions which do quite a bit of
- *           processing. This may lead to a race condition with the
- *           paddle movement, and is not handled in this version. For
- *           more, see the Plan document which discusses a potential
- *           solution to this problem.
+ *  print_stats()
+ *  Purpose: With -s, report what the frames cost in terminal output, and
+ *           always, with another player, how the connection went
+ *     Note: Called after wrap_up(), so curses is closed and stderr is the
+ *           terminal again.
  */
-void alarm_handler(int s)
+void print_stats()
 {
-    signal( SIGALRM , SIG_IGN );        // don't get caught
+    struct frame_stats st;
+    struct net_stats * np = &net_totals;
+    long n;
 
-    clock_tick();                       // update clock
-    ball_move(ball);                    // move ball
-    is_next_round();                    // check bounce_or_lose()
+    if(host_port != NULL || join_addr != NULL)
+    {
+        fprintf(stderr, "packets sent: %ld  received: %ld  lost: %ld\n",
+                        np->sent, np->received, np->lost);
+        fprintf(stderr, "rtt: %.1f ms (least %.1f, most %.1f)\n",
+                        np->rtt, np->rtt_min, np->rtt_max);
+        fprintf(stderr, "rollbacks: %ld (%ld ticks run again, most %ld)  "
+                        "stalls: %ld\n", np->rollbacks, np->replayed,
+                        np->deepest, np->stalls);
+    }
+
+    if(!show_stats)
+        return;
+
+    frame_get_stats(&st);
+    n = (st.frames > 0) ? st.frames : 1;
+
+    fprintf(stderr, "frames: %ld  refreshes: %ld\n", st.frames, st.refreshes);
+    fprintf(stderr, "cells touched: %ld  changed: %ld (%.1f per frame)\n",
+                    st.cells_touched, st.cells_changed,
+                    (double) st.cells_changed / n);
+    fprintf(stderr, "tty bytes: %ld (%.1f per frame, most %ld)\n",
+                    st.bytes, (double) st.bytes / n, st.max_bytes);
+    fprintf(stderr, "wakeups: %ld for %ld ticks (%s)\n", wakeups, tick_count,
+                    idle ? "idle between changes" : "every tick");
+    if(render)
+        print_render();
+    fprintf(stderr, "seed: %llu\n", seed);
 
-    signal(SIGALRM, alarm_handler);     // re-enable handler
+    print_telemetry();
 
+    if(view_port != NULL)
+    {
+        fprintf(stderr, "viewers: %ld (most %ld)  frames: %ld (%ld key)\n",
+                        view_totals.viewers, view_totals.most_viewers,
+                        view_totals.frames, view_totals.keys);
+        fprintf(stderr, "viewer packets: %ld  bytes: %ld  sendmmsg calls: "
+                        "%ld  dropped: %ld\n", view_totals.packets,
+                        view_totals.bytes, view_totals.syscalls,
+                        view_totals.dropped);
+    }
     return;
 }
 
 /*
- *  park_cursor()
- *  Purpose: Helper function to park the cursor in lower-right of screen
+ *  print_telemetry()
+ *  Purpose: With -s, report how smoothly the game ran: how late the ticks
+ *           were, what the ticks and frames took, and the lag from a key
+ *           to the screen
+ *     Note: Called after wrap_up(), from the totals taken before it.
  */
-void park_cursor()
+void print_telemetry()
 {
-    move(LINES - 1, COLS - 1);
+    struct telem_stats * tp = &telem_totals;
+
+    fprintf(stderr, "passes: %ld  ticks: %ld  samples dropped: %ld\n",
+                    tp->passes, tp->ticks, tp->dropped);
+    fprintf(stderr, "tick jitter: %.2f ms p50, %.2f p99, %.2f most\n",
+                    tp->late_p50, tp->late_p99, tp->late_max);
+    fprintf(stderr, "sim: %.3f ms a tick (most %.2f a pass)\n",
+                    tp->sim_mean, tp->sim_max);
+    fprintf(stderr, "render: %.3f ms a frame (%.2f p99, %.2f most)\n",
+                    tp->render_mean, tp->render_p99, tp->render_max);
+    fprintf(stderr, "input to photon: %.2f ms (%.2f p99, %.2f most, "
+                    "%ld keys)\n", tp->lag_mean, tp->lag_p99, tp->lag_max,
+                    tp->inputs);
     return;
 }
 
+/*
+ *  print_render()
+ *  Purpose: With -s and -R, report how many frames the render thread
+ *           showed, and how many it never got to
+ *     Note: Called after wrap_up(), once the thread has stopped.
+ */
+void print_render()
+{
+    struct render_stats rs;
+
+    render_get_stats(&rs);
+    fprintf(stderr, "render thread: %ld frames shown of %ld handed over  "
+                    "skipped: %ld  ring full: %ld\n", rs.shown, rs.handed,
+                    rs.skipped, rs.ring_full);
+    return;
+}
+
+/*
+ *  mark()
+ *  Purpose: Note the time a phase of starting up or closing down ended
+ *    Input: what, the phase
+ *     Note: Always done, since -I isn't known until the options are read,
+ *           and it costs a clock read. Past MAX_MARKS they are dropped.
+ */
+void mark(const char * what)
+{
+    if(n_marks == MAX_MARKS)
+        return;
+
+    marks[n_marks].what = what;
+    marks[n_marks++].at = telem_now();
+    return;
+}
+
+/*
+ *  print_startup()
+ *  Purpose: With -I, report how long each phase of starting up and of
+ *           closing down took, and the time to the first frame
+ *   Method: Each phase is timed from the mark before it; the first mark
+ *           is the start of main(). Closing is timed from the end of the
+ *           game.
+ *     Note: With -R, the first frame is timed to when it was handed to
+ *           the render thread, not when the terminal took it.
+ */
+void print_startup()
+{
+    long long first = 0, over = 0;
+    int i;
+
+    for(i = 1; i < n_marks; i++)
+    {
+        if(strcmp(marks[i].what, "first frame") == 0)
+            first = marks[i].at;
+        else if(strcmp(marks[i].what, "game over") == 0)
+            over = marks[i].at;
+    }
+
+    fprintf(stderr, "startup: %.3f ms to the first frame  closing: %.3f ms\n",
+                    (first - marks[0].at) / 1e6,
+                    (marks[n_marks - 1].at - over) / 1e6);
+    for(i = 1; i < n_marks; i++)
+        if(strcmp(marks[i].what, "game over") != 0)
+            fprintf(stderr, "  %-14s %9.3f ms\n", marks[i].what,
+                            (marks[i].at - marks[i - 1].at) / 1e6);
+    return;
+}
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
 /*
  *  wrap_up()
  *  Purpose: free memory, stop ticker, close curses
+ *     Note: A recording is finished here, so it ends at the last tick
+ *           played however the game stopped.
  */
 void wrap_up()
 {
-    if(paddle)                              // if paddle was malloc'ed
-        free(paddle);                       // free it
-
-    if(ball)                                // if ball was malloc'ed
-        free(ball);                         // free it
-
-    set_ticker(0);                          // stop ticker
+    game_end(game);                         // free the game objects
+    game = NULL;
+    ticker_stop();                          // stop ticker
+    mark("game freed");
+    frame_end();                            // free the frame
+    mark("frame freed");
     endwin();                               // close curses
+    mark("curses closed");
+    if( replay_close(recorder, tick_count) == -1 )
+        fprintf(stderr, "./pong: the recording may be incomplete\n");
+    recorder = NULL;
+    replay_close(playback, tick_count);
+    playback = NULL;
+    net_close(net);                         // the other player is left
+    net = NULL;
+    spec_close(viewers);                    // and the viewers
+    viewers = NULL;
+    if( telem_close(telem) == -1 )
+        fprintf(stderr, "./pong: %s: %s\n", telem_path, strerror(errno));
+    telem = NULL;
+    mark("files closed");
 
     return;
 }
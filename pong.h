@@ -10,6 +10,4 @@
 #define	BLANK ' '
 
 /* EXTERNAL INTERFACE - HELPER FUNCTIONS */
-void alarm_handler(int);
-void wrap_up();
-void park_cursor();
\ No newline at end of file
+void wrap_up();
\ No newline at end of file
@@ -0,0 +1,225 @@
+/*
+ * ===========================================================================
+ *   FILE: ./pool.c
+ * ===========================================================================
+ * Purpose: Keep a set of worker threads that play runs of games with the
+ *          computer player (see autoplay.c), one run after another.
+ *
+ * Interface:
+ *      new_pool()          -- start the workers, waiting for a run
+ *      pool_run()          -- play a run of games on them, and add it up
+ *      pool_free()         -- stop the workers and free the pool
+ *
+ * Internal functions:
+ *      worker()            -- play each run's games until there are none left
+ *
+ * Notes:
+ *      The workers are started once and wait between runs, so a tool that
+ *      plays many runs (sweep.c, one per set of settings) pays for the
+ *      threads once, and every worker keeps its own arena (see arena.c)
+ *      from run to run: after the first game a worker makes, no run asks
+ *      malloc() for anything. pong-sim (sim.c) is a pool with one run.
+ *
+ *      A worker takes the next game number with one atomic add, plays it,
+ *      and adds it to totals on its own stack; those are merged into the
+ *      run's totals once, when it runs out of games. Game g always plays
+ *      out the same for the same settings and seed, and totals come out
+ *      the same in any order (see autoplay_merge()), so a run adds up the
+ *      same however many workers there are and whichever plays which game.
+ *
+ *      pool_run() hands a run out and waits for every worker to finish it,
+ *      under the pool's lock, so whatever is set process-wide between runs
+ *      (ball_kernel_use(), preset_use(), ball_use_delay(),
+ *      paddle_use_size()) is seen by every worker for the whole of the
+ *      next run. Nothing must be changed while a run is going.
+ */
+
+/* INCLUDES */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "autoplay.h"
+#include "ball_kernel.h"
+#include "pool.h"
+#include "pong.h"
+
+/* POOL STRUCT */
+struct pppool {
+    int workers;
+    pthread_t * threads;
+    pthread_mutex_t lock;           // guards everything below but next_game
+    pthread_cond_t start;           // a run was handed out, or quit set
+    pthread_cond_t done;            // the last worker finished a run
+    int runs;                       // runs handed out so far
+    int busy;                       // workers still playing this run
+    int quit;                       // 1 once the workers are to stop
+    const struct autoplay * ap;     // this run's settings
+    int games;                      // and how many games it is
+    long * secs;                    // where to put each game's length, or NULL
+    int next_game;                  // next game to hand out; atomic
+    struct autoplay_totals totals;  // what the workers that finished played
+};
+
+/*
+ * ===========================================================================
+ * INTERNAL FUNCTIONS
+ * ===========================================================================
+ */
+static void * worker(void *);
+
+/*
+ *  worker()
+ *  Purpose: Wait for a run, play its games until all have been handed out,
+ *           and wait for the next, until the pool is freed
+ *    Input: arg, the pool
+ *   Return: NULL
+ *     Note: Each worker plays all its games in an arena of its own, so
+ *           the workers never share memory or wait on malloc()'s locks.
+ */
+void * worker(void * arg)
+{
+    struct pppool * pool = arg;
+    struct pparena * arena = new_arena(0);
+    struct autoplay_totals totals;
+    long secs;
+    int seen = 0, g;
+
+    pthread_mutex_lock(&pool->lock);
+    for(;;)
+    {
+        while(pool->runs == seen && !pool->quit)
+            pthread_cond_wait(&pool->start, &pool->lock);
+        if(pool->quit)
+            break;
+        seen = pool->runs;
+        pthread_mutex_unlock(&pool->lock);
+
+        memset(&totals, 0, sizeof(totals));
+        while( (g = __atomic_fetch_add(&pool->next_game, 1,
+                                       __ATOMIC_RELAXED)) < pool->games )
+        {
+            secs = autoplay_game(pool->ap, g, arena, &totals);
+            if(pool->secs != NULL)
+                pool->secs[g] = secs;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        autoplay_merge(&pool->totals, &totals);
+        if(--pool->busy == 0)
+            pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    arena_free(arena);
+    return NULL;
+}
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  new_pool()
+ *  Purpose: Start a pool of workers, waiting for a run
+ *    Input: workers, how many threads, from 1 to MAX_WORKERS
+ *   Return: the pool
+ *     Note: The ball kernel is picked here, before any worker starts, so
+ *           the workers only ever read the choice.
+ *    Error: If malloc fails, or a thread can't be started, print a message
+ *           and exit.
+ */
+struct pppool * new_pool(int workers)
+{
+    struct pppool * pool = calloc(1, sizeof(struct pppool));
+    int i, err;
+
+    if(pool != NULL)
+        pool->threads = calloc(workers, sizeof(pthread_t));
+
+    if(pool == NULL || pool->threads == NULL)
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Couldn't allocate memory for the workers.\n");
+        exit(1);
+    }
+
+    ball_kernel_name();
+    pool->workers = workers;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for(i = 0; i < workers; i++)
+        if( (err = pthread_create(&pool->threads[i], NULL, worker,
+                                  pool)) != 0 )
+        {
+            wrap_up();
+            fprintf(stderr, "./pong: pthread_create: %s\n", strerror(err));
+            exit(1);
+        }
+
+    return pool;
+}
+
+/*
+ *  pool_run()
+ *  Purpose: Play a run of games on the pool's workers, and add them up
+ *    Input: pool, the pool
+ *           ap, the settings for the run
+ *           games, how many games: game 0 to games-1
+ *   Output: tp, set to what the games added up to
+ *           secs, if not NULL, secs[g] set to how long game g lasted, in
+ *           whole seconds of play; it must have room for 'games'
+ *   Method: The run is handed to every worker at once, then pool_run()
+ *           waits until the last has merged its totals.
+ */
+void pool_run(struct pppool * pool, const struct autoplay * ap, int games,
+              struct autoplay_totals * tp, long * secs)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->ap = ap;
+    pool->games = games;
+    pool->secs = secs;
+    pool->next_game = 0;
+    memset(&pool->totals, 0, sizeof(pool->totals));
+    pool->busy = pool->workers;
+    pool->runs++;
+    pthread_cond_broadcast(&pool->start);
+
+    while(pool->busy > 0)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    *tp = pool->totals;
+    pthread_mutex_unlock(&pool->lock);
+
+    return;
+}
+
+/*
+ *  pool_free()
+ *  Purpose: Stop the workers, and free the pool
+ *    Input: pool, a pool with no run going
+ */
+void pool_free(struct pppool * pool)
+{
+    int i;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for(i = 0; i < pool->workers; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    free(pool->threads);
+    free(pool);
+
+    return;
+}
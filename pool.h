@@ -0,0 +1,20 @@
+/*
+ * ==========================
+ *   FILE: ./pool.h
+ * ==========================
+ * Purpose: Header file for pool.c
+ */
+
+/* CONSTANTS */
+#define MAX_WORKERS 1024
+
+/* OPAQUE STRUCTS */
+struct autoplay;
+struct autoplay_totals;
+struct pppool;
+
+/* EXTERNAL INTERFACE */
+struct pppool * new_pool(int);
+void pool_run(struct pppool *, const struct autoplay *, int,
+              struct autoplay_totals *, long *);
+void pool_free(struct pppool *);
\ No newline at end of file
@@ -0,0 +1,123 @@
+/*
+ * ===========================================================================
+ *   FILE: ./preset.c
+ * ===========================================================================
+ * Purpose: Name the game's common settings, and say when a game is being
+ *          played with one of them.
+ *
+ * Interface:
+ *      preset_find()       -- look a preset up by name
+ *      preset_match()      -- which preset a court and its balls are, if any
+ *      preset_name()       -- the name of a preset, or "generic"
+ *      preset_use()        -- turn the presets' own ticks on or off
+ *
+ * Notes:
+ *      A preset is a court size, a number of balls per serve and a number
+ *      of players that games are often played with (see PRESETS in
+ *      preset.h). For each one, ball.c compiles a tick of its own with
+ *      those as constants, so the walls it checks against, whether any
+ *      balls can collide, and whether there is a second paddle are all
+ *      folded in by the compiler; every other game takes the generic
+ *      tick, which reads them from the court. A game picks its tick when
+ *      its balls are made, or its court is laid out again, by asking
+ *      preset_match() whether it is one of these.
+ *
+ *      Both ticks always play the same game, so which one runs is never
+ *      recorded anywhere. preset_use(0) makes every game after it take the
+ *      generic tick, to compare the two (pong-bench, pong-headless -G).
+ */
+
+/* INCLUDES */
+#include <string.h>
+#include "court.h"
+#include "preset.h"
+
+/* LOCAL VARIABLES */
+#define PRESET_ENTRY(name, lines, cols, balls, players) \
+    { #name, lines, cols, balls, players },
+
+static const struct preset presets[] = {
+    PRESETS(PRESET_ENTRY)
+};
+
+#define NUM_PRESETS ((int) (sizeof(presets) / sizeof(presets[0])))
+
+static int enabled = 1;             // presets' own ticks may be picked
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  preset_find()
+ *  Purpose: Look a preset up by name
+ *    Input: name, one of PRESET_NAMES
+ *   Return: the preset, or NULL if there is none by that name
+ */
+const struct preset * preset_find(const char * name)
+{
+    int i;
+
+    for(i = 0; i < NUM_PRESETS; i++)
+        if(strcmp(presets[i].name, name) == 0)
+            return &presets[i];
+
+    return NULL;
+}
+
+/*
+ *  preset_match()
+ *  Purpose: Find the preset a game's court and balls are set up as
+ *    Input: top, right, bot, left, the rows and columns of the walls
+ *           balls, balls in play per serve
+ *           players, 1 or 2
+ *   Return: the preset's place in PRESETS, or -1 if it is none of them,
+ *           or preset_use() turned them off
+ *     Note: A preset's court is where set_up() in pong puts it on a
+ *           terminal that size.
+ */
+int preset_match(int top, int right, int bot, int left, int balls,
+                 int players)
+{
+    const struct preset * p;
+    int i;
+
+    if(!enabled)
+        return -1;
+
+    for(i = 0; i < NUM_PRESETS; i++)
+    {
+        p = &presets[i];
+        if( top == BORDER && left == BORDER &&
+            right == p->cols - BORDER - 1 && bot == p->lines - BORDER - 1 &&
+            balls == p->balls && players == p->players )
+            return i;
+    }
+
+    return -1;
+}
+
+/*
+ *  preset_name()
+ *  Purpose: Name a preset by its place in PRESETS
+ *    Input: i, as preset_match() returns it
+ *   Return: its name, or "generic" for -1
+ */
+const char * preset_name(int i)
+{
+    return (i >= 0 && i < NUM_PRESETS) ? presets[i].name : "generic";
+}
+
+/*
+ *  preset_use()
+ *  Purpose: Turn the presets' own ticks on or off, for games made after
+ *    Input: on, 0 for every game to take the generic tick
+ *     Note: Games already made keep the tick they have.
+ */
+void preset_use(int on)
+{
+    enabled = on;
+    return;
+}
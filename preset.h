@@ -0,0 +1,35 @@
+/*
+ * ==========================
+ *   FILE: ./preset.h
+ * ==========================
+ * Purpose: Header file for preset.c, and the list of presets
+ */
+
+/* CONSTANTS */
+#define PRESET_NAMES "classic, multi, two, headless"
+
+/*
+ * Every preset, as X(name, lines, cols, balls, players): the size of the
+ * terminal (which sets the court, BORDER in from its edges), the balls
+ * each serve puts in play, and 1 or 2 paddles. ball.c compiles a tick of
+ * its own for each, with these as constants.
+ */
+#define PRESETS(X) \
+    X(classic,  24, 80,   1, 1)     /* pong on a standard terminal */      \
+    X(multi,    24, 80,   8, 1)     /* pong -b 8 */                        \
+    X(two,      24, 80,   1, 2)     /* pong -H or -C, two players */       \
+    X(headless, 24, 80, 100, 1)     /* pong-bench, and soak runs */
+
+/* STRUCTS */
+struct preset {
+    const char * name;
+    int lines, cols;        // size of the terminal
+    int balls;              // balls in play per serve
+    int players;            // paddles: 1, or 2 for one on the left too
+};
+
+/* EXTERNAL INTERFACE */
+const struct preset * preset_find(const char *);
+int preset_match(int, int, int, int, int, int);
+const char * preset_name(int);
+void preset_use(int);
\ No newline at end of file
@@ -0,0 +1,405 @@
+/*
+ * ===========================================================================
+ *   FILE: ./render.c
+ * ===========================================================================
+ * Purpose: Send the frames to the terminal from a thread of their own, so
+ *          the game never waits on the tty.
+ *
+ * Interface:
+ *      render_backend      -- backend operations, see backend.h
+ *      render_use()        -- pick the backend the thread sends frames to
+ *      render_sync()       -- wait until every frame handed over is shown
+ *      render_get_stats()  -- copy out what the thread did
+ *
+ * Internal functions:
+ *      rb_open()           -- open the real backend and start the thread
+ *      rb_put()            -- note a changed cell in the screen being drawn
+ *      rb_update()         -- hand a copy of that screen to the thread
+ *      rb_resize()         -- wait for the thread, then size it all again
+ *      rb_close()          -- show what is left, stop the thread, close
+ *      alloc()             -- allocate the ring and both screens, blank
+ *      hand_over()         -- copy the screen into the ring, if there's room
+ *      draw()              -- the thread: show the latest frame handed over
+ *      show()              -- send the cells of a frame that changed
+ *
+ * Notes:
+ *      render_backend sits between the frame (frame.c) and a real backend,
+ *      curses or ansi, which only the render thread writes through. The
+ *      game's thread keeps drawing into the frame as it always has, and
+ *      frame_flush() hands the cells that changed to rb_put() as usual.
+ *      Those go into 'drawn', a whole screen of cells that only the game's
+ *      thread touches, and rb_update() copies all of it into the next slot
+ *      of a ring: an immutable picture of the screen, as of that frame. A
+ *      frame costs the game a memcpy() of the screen, however long the
+ *      terminal then takes to take it.
+ *
+ *      Ring: RING_SLOTS pictures, with one writer (the game's thread) and
+ *      one reader (the render thread), as the telemetry ring is (see
+ *      telemetry.c): the writer only moves the head and the reader only
+ *      the tail, each published with a release store and read with an
+ *      acquire load, so no lock is taken. The reader takes only the latest
+ *      picture, skipping any older ones, and compares it with 'shown',
+ *      what it sent before, so that a picture is always whole whatever was
+ *      skipped, and a slow terminal drops frames, never ticks. It holds
+ *      the slot until it is done, moving the tail past it after, so the
+ *      writer may fill every other slot meanwhile; a frame that finds them
+ *      all full is not handed over, and counted, and the next frame hands
+ *      over the screen with its cells in it too. A semaphore wakes the
+ *      thread for each frame, and another says each was shown to
+ *      render_sync(), so neither thread spins.
+ *
+ *      A resize, or a repaint (^L, frame_repaint()), is rare, and it is
+ *      done on the game's thread with the render thread idle: rb_resize()
+ *      waits for the ring to drain, then resizes the real backend and
+ *      starts all the screens blank again. Anything else that has to touch
+ *      curses while the game runs (resizeterm(), in pong.c) calls
+ *      render_sync() first, for the same reason. What curses does for the
+ *      keys has to leave the screen alone as well; see set_up() in pong.c.
+ *
+ *      The bytes the real backend writes are added up on the render thread
+ *      and handed back to the frame by the next rb_update(), so the frame's
+ *      byte counters (-s) still add up, a frame or so late.
+ */
+
+/* INCLUDES */
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "backend.h"
+#include "pong.h"
+#include "render.h"
+
+/* CONSTANTS */
+#define RING_SLOTS 4            // pictures of the screen; a power of 2
+
+/* RENDER STATE */
+static const struct backend * be = &curses_backend; // what shows the frames
+static int lines, cols;         // size of the screen
+static unsigned short * ring;   // RING_SLOTS pictures of the screen
+static unsigned short * drawn;  // game's thread: the screen as drawn so far
+static unsigned short * shown;  // render thread: the screen as last sent
+static unsigned head;           // next slot to fill; only the game moves it
+static unsigned tail;           // slots the render thread is done with
+static int owed;                // a frame was not handed over: ring full
+static int running;             // the render thread has been started
+static int quit;                // set, then 'ready' posted, to stop it
+static pthread_t thread;
+static sem_t ready;             // posted for each frame handed over
+static sem_t done;              // posted for each frame taken and shown
+static long bytes;              // written by 'be', not yet handed back
+static struct render_stats stats;
+
+/*
+ * ===========================================================================
+ * INTERNAL FUNCTIONS
+ * ===========================================================================
+ */
+static void rb_open(int, int, int);
+static void rb_put(int, int, unsigned short);
+static long rb_update();
+static void rb_resize(int, int);
+static void rb_close();
+static void alloc(int, int);
+static void hand_over();
+static void * draw(void *);
+static void show(const unsigned short *);
+
+/*
+ *  rb_open()
+ *  Purpose: Open the real backend, and start the render thread
+ *    Input: l, c, the size of the screen
+ *           count_bytes, passed on to the real backend
+ *     Note: The thread is started with every signal blocked, so SIGWINCH
+ *           always interrupts the main loop's poll(), as it did before
+ *           there was a thread.
+ *    Error: If memory can't be allocated, or the thread can't be started,
+ *           close curses, print a message and exit.
+ */
+void rb_open(int l, int c, int count_bytes)
+{
+    sigset_t all, old;
+    int err;
+
+    be->open(l, c, count_bytes);
+    alloc(l, c);
+    sem_init(&ready, 0, 0);
+    sem_init(&done, 0, 0);
+
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    err = pthread_create(&thread, NULL, draw, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if(err != 0)
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: pthread_create: %s\n", strerror(err));
+        exit(1);
+    }
+
+    running = 1;
+    return;
+}
+
+/*
+ *  rb_put()
+ *  Purpose: Put a changed cell into the screen being drawn
+ *    Input: y, x, the row and column
+ *           cell, the cell
+ */
+void rb_put(int y, int x, unsigned short cell)
+{
+    drawn[(y * cols) + x] = cell;
+    return;
+}
+
+/*
+ *  rb_update()
+ *  Purpose: Hand the screen as drawn to the render thread
+ *   Return: the bytes the real backend has written since the last call,
+ *           for earlier frames, or 0 if it doesn't count them
+ */
+long rb_update()
+{
+    hand_over();
+    return __atomic_exchange_n(&bytes, 0, __ATOMIC_RELAXED);
+}
+
+/*
+ *  rb_resize()
+ *  Purpose: Clear the screen for a new size, or the same size again
+ *    Input: l, c, the size
+ *   Method: Wait until the render thread has shown all it was handed and
+ *           is waiting for more; then it touches nothing, so the real
+ *           backend is resized from here, and the ring and both screens
+ *           allocated again, blank, as the frame's are.
+ */
+void rb_resize(int l, int c)
+{
+    render_sync();
+    be->resize(l, c);
+    alloc(l, c);
+
+    return;
+}
+
+/*
+ *  rb_close()
+ *  Purpose: Show whatever is left, stop the render thread, and close the
+ *           real backend
+ *     Note: wrap_up() may be called on the render thread, if the real
+ *           backend fails there; it is not waited for then, since that is
+ *           the thread that would be waiting.
+ */
+void rb_close()
+{
+    if( running && !pthread_equal(pthread_self(), thread) )
+    {
+        render_sync();
+        __atomic_store_n(&quit, 1, __ATOMIC_RELEASE);
+        sem_post(&ready);
+        pthread_join(thread, NULL);
+        running = 0;
+        sem_destroy(&ready);
+        sem_destroy(&done);
+    }
+
+    be->close();
+    free(ring);
+    ring = drawn = shown = NULL;
+
+    return;
+}
+
+/*
+ *  alloc()
+ *  Purpose: Allocate the ring and both screens, blank
+ *    Input: l, c, the size of the screen
+ *     Note: Only called with the render thread idle (or not started).
+ *    Error: If memory can't be allocated, close curses, print a message
+ *           and exit.
+ */
+void alloc(int l, int c)
+{
+    int i, cells = l * c;
+
+    free(ring);
+    lines = l;
+    cols = c;
+    ring = malloc((RING_SLOTS + 2) * cells * sizeof(unsigned short));
+
+    if(ring == NULL)
+    {
+        owed = 0;                           // nothing to hand over
+        wrap_up();
+        fprintf(stderr, "./pong: Couldn't allocate memory for the frames.\n");
+        exit(1);
+    }
+
+    drawn = ring + (RING_SLOTS * cells);
+    shown = drawn + cells;
+    for(i = 0; i < (RING_SLOTS + 2) * cells; i++)
+        ring[i] = BLANK;
+
+    owed = 0;
+    return;
+}
+
+/*
+ *  hand_over()
+ *  Purpose: Copy the screen as drawn into the next slot of the ring, and
+ *           wake the render thread
+ *     Note: While the ring isn't full, the slot filled is never the one
+ *           the render thread is showing: the tail stays behind that slot
+ *           until it is done with it.
+ */
+void hand_over()
+{
+    int cells = lines * cols;
+
+    if(head - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) == RING_SLOTS)
+    {
+        stats.ring_full++;
+        owed = 1;
+        return;
+    }
+
+    memcpy(ring + ((head & (RING_SLOTS - 1)) * cells), drawn,
+           cells * sizeof(unsigned short));
+    __atomic_store_n(&head, head + 1, __ATOMIC_RELEASE);
+    stats.handed++;
+    owed = 0;
+    sem_post(&ready);
+
+    return;
+}
+
+/*
+ *  draw()
+ *  Purpose: The render thread: show the latest frame each time one is
+ *           handed over, until told to stop
+ *   Return: NULL
+ *     Note: Woken once per frame, it may find several waiting, or none
+ *           (it took them on an earlier wake); only the latest is shown.
+ */
+void * draw(void * arg)
+{
+    unsigned h;
+
+    for(;;)
+    {
+        sem_wait(&ready);
+        if(__atomic_load_n(&quit, __ATOMIC_ACQUIRE))
+            break;
+
+        h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+        if(h == tail)
+            continue;
+
+        stats.skipped += h - tail - 1;
+        show(ring + (((h - 1) & (RING_SLOTS - 1)) * lines * cols));
+        __atomic_store_n(&tail, h, __ATOMIC_RELEASE);
+        sem_post(&done);
+    }
+
+    return NULL;
+}
+
+/*
+ *  show()
+ *  Purpose: Send the real backend the cells of a picture that differ from
+ *           what it was sent before, then have it update once
+ *    Input: pic, the picture
+ *   Method: A row that matches is passed over with one memcmp().
+ */
+void show(const unsigned short * pic)
+{
+    int y, x, i, changed = 0;
+
+    for(y = 0; y < lines; y++)
+    {
+        i = y * cols;
+        if(memcmp(pic + i, shown + i, cols * sizeof(*pic)) == 0)
+            continue;
+
+        for(x = 0; x < cols; x++, i++)
+            if(pic[i] != shown[i])
+            {
+                be->put(y, x, pic[i]);
+                shown[i] = pic[i];
+                changed++;
+            }
+    }
+
+    if(changed > 0)
+        __atomic_fetch_add(&bytes, be->update(), __ATOMIC_RELAXED);
+    stats.shown++;
+
+    return;
+}
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  render_use()
+ *  Purpose: Choose the backend the render thread shows the frames through
+ *    Input: real, curses_backend or ansi_backend
+ *     Note: To be called before render_backend is opened (frame_init()).
+ */
+void render_use(const struct backend * real)
+{
+    be = real;
+    return;
+}
+
+/*
+ *  render_sync()
+ *  Purpose: Wait until the render thread has shown every frame handed to
+ *           it, including one the ring had no room for, and is idle
+ *   Method: Until the tail is up to the head, wait for the thread to say
+ *           it showed a frame. Posts left from frames nobody waited for
+ *           are taken first, so they don't end the wait early.
+ *     Note: Does nothing if the render thread isn't running. Called only
+ *           from the game's thread.
+ */
+void render_sync()
+{
+    if(!running)
+        return;
+
+    for(;;)
+    {
+        while(sem_trywait(&done) == 0)
+            ;
+        if(owed)
+            hand_over();
+        if( !owed && __atomic_load_n(&tail, __ATOMIC_ACQUIRE) == head )
+            break;
+        sem_wait(&done);
+    }
+
+    return;
+}
+
+/*
+ *  render_get_stats()
+ *  Purpose: Public function to access what the render thread did
+ *    Input: sp, pointer to a struct to copy the counters into
+ *     Note: Only exact once the thread has stopped (frame_end()).
+ */
+void render_get_stats(struct render_stats * sp)
+{
+    *sp = stats;
+    return;
+}
+
+const struct backend render_backend = {
+    "render", rb_open, rb_put, rb_update, rb_resize, rb_close
+};
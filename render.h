@@ -0,0 +1,22 @@
+/*
+ * ==========================
+ *   FILE: ./render.h
+ * ==========================
+ * Purpose: Header file for render.c
+ */
+
+/* STRUCTS */
+struct render_stats {       // what the render thread did with the frames
+    long handed;            // frames handed to it
+    long shown;             // frames it sent to the screen
+    long skipped;           // frames a later one replaced before it got there
+    long ring_full;         // frames not handed over: it was too far behind
+};
+
+/* OPAQUE STRUCTS */
+struct backend;
+
+/* EXTERNAL INTERFACE */
+void render_use(const struct backend *);
+void render_sync();
+void render_get_stats(struct render_stats *);
\ No newline at end of file
@@ -0,0 +1,638 @@
+/*
+ * ===========================================================================
+ *   FILE: ./replay.c
+ * ===========================================================================
+ * Purpose: Record a game to a file as it is played, and play it back,
+ *          from the start or from any tick.
+ *
+ * Interface:
+ *      replay_create()     -- start recording a game to a file
+ *      replay_event()      -- record one move
+ *      replay_close()      -- end the recording, or the playback
+ *      replay_open()       -- open a recording (and its index) to play back
+ *      replay_play()       -- make the moves recorded for one tick
+ *      replay_end()        -- the tick the recording ends at, once reached
+ *      replay_index()      -- start writing snapshots to an index
+ *      replay_tick()       -- write a snapshot, if one is due
+ *      replay_seek()       -- jump to the last snapshot before a tick
+ *
+ * Internal functions:
+ *      put_varint()        -- write a number in as few bytes as it needs
+ *      get_varint()        -- read one back
+ *      read_event()        -- read ahead to the next recorded move
+ *      index_name()        -- the index file that goes with a recording
+ *      map_file()          -- map a whole file into memory to read it
+ *      snapshot_size()     -- bytes in each snapshot of a game
+ *      open_index()        -- map a recording's index, if it has a good one
+ *
+ * Notes:
+ *      A game is decided by its seed (which every random choice is drawn
+ *      from, see rng.c), the size of the court, and the player's moves,
+ *      so that is all a recording holds: no screen output at all. The same
+ *      recording played back on the same code always plays out the same
+ *      game, tick for tick, which is what makes it useful for chasing a
+ *      bug a player ran into.
+ *
+ *      Format: the magic "PPRP" and a version byte, then the seed, tick
+ *      rate, lines, columns and balls per serve as varints. After that
+ *      each move is one varint, (ticks since the last move << 2) | event,
+ *      where the event is REPLAY_UP, REPLAY_DOWN or REPLAY_QUIT, and the
+ *      last is REPLAY_END at the tick the game stopped. A varint is 7 bits
+ *      a byte, low bits first, with the top bit set on all but the last
+ *      byte, so a move made within 31 ticks of the last one (well over
+ *      half a second at the default rate) takes a single byte.
+ *
+ *      A move is recorded with the number of ticks run before it was
+ *      made, and played back just before the next tick runs, which is
+ *      where the main loop in pong.c makes it.
+ *
+ *   Index: Playing a long game back from tick 0 to look at something late
+ *      in it means running every tick before it. So next to the recording
+ *      (the same name, with INDEX_SUFFIX) there can be an index: a header,
+ *      then a snapshot of the whole game state (game_save()) every
+ *      SNAP_TICKS ticks, each with where in the recording the moves after
+ *      it start. Every snapshot is the same size, so the one for any tick
+ *      is found with a division, and replay_seek() only has to run the
+ *      ticks since it. pong -w writes the index as the game is played;
+ *      pong-replay -i writes one for a recording that has none.
+ *
+ *      Both files are read with mmap(): a recording is parsed straight
+ *      out of the mapping, and seeking in the index touches only the
+ *      pages of the one snapshot used, however long the game was.
+ *
+ *      Snapshots are in the machine's own byte order and struct layout
+ *      (see game_save()), and the header says which, along with the seed
+ *      and the snapshot size. An index that doesn't match is ignored, and
+ *      playback just starts from tick 0. A last snapshot cut short (the
+ *      game died writing it) is ignored too.
+ */
+
+/* INCLUDES */
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "game.h"
+#include "paddle.h"
+#include "pong.h"
+#include "replay.h"
+
+/* CONSTANTS */
+#define MAGIC "PPRP"
+#define MAGIC_LEN 4
+#define REPLAY_VERSION 2
+#define EVENT_BITS 2        // low bits of a move that hold the event
+#define EVENT_MASK 3
+#define VARINT_MAX 10       // bytes in the longest 64-bit varint
+
+#define INDEX_SUFFIX ".idx"
+#define INDEX_MAGIC "PPIX"
+#define INDEX_VERSION 2
+#define BYTE_ORDER_MARK 0x01020304
+#define SNAP_TICKS 3000     // ticks between snapshots: a minute at 50/sec
+#define SNAP_ALIGN 8        // snapshot size is rounded up to this
+
+/* INDEX STRUCTS */
+struct index_head {         // at the start of an index
+    char magic[MAGIC_LEN];
+    uint32_t version;
+    uint32_t order;         // BYTE_ORDER_MARK, as this machine stores it
+    uint32_t every;         // ticks between snapshots
+    uint64_t seed;          // of the recording it goes with
+    uint64_t size;          // bytes in each snapshot, with its snap_head
+};
+
+struct snap_head {          // before each snapshot's game state
+    int64_t tick;           // ticks run when it was taken
+    int64_t at;             // offset in the recording of the next move
+    int64_t base;           // tick that move's delta counts from
+};
+
+/* REPLAY STRUCT */
+struct ppreplay {
+    int writing;            // recording, not playing back
+    long tick;              // writing: tick of the last move written;
+                            // reading: tick of the next move
+    int ev;                 // reading: the next move, already read
+    long base;              // reading: the tick before that move
+    size_t at, pos;         // reading: where it starts, and next byte;
+                            // writing: bytes written ('pos')
+    FILE * fp;              // writing: the recording
+    const unsigned char * map;  // reading: the recording, mapped
+    size_t len;                 // and its size
+    uint64_t seed;
+    char * ix_name;         // the index file that goes with it
+
+    FILE * ix_fp;           // writing an index: the file
+    unsigned char * snap;   // and room for one snapshot
+    const unsigned char * ix_map;   // reading an index: the file, mapped
+    size_t ix_len;                  // its size
+    long ix_count;                  // whole snapshots in it
+    size_t snap_size;       // bytes in a snapshot, with its snap_head
+};
+
+/*
+ * ===========================================================================
+ * INTERNAL FUNCTIONS
+ * ===========================================================================
+ */
+static void put_varint(struct ppreplay *, uint64_t);
+static int get_varint(struct ppreplay *, uint64_t *);
+static void read_event(struct ppreplay *);
+static char * index_name(const char *);
+static const unsigned char * map_file(const char *, size_t *);
+static size_t snapshot_size(struct ppgame *);
+static void open_index(struct ppreplay *, struct ppgame *);
+
+/*
+ *  put_varint()
+ *  Purpose: Write v to the recording, 7 bits a byte, low bits first
+ */
+void put_varint(struct ppreplay * rp, uint64_t v)
+{
+    while(v >= 0x80)
+    {
+        putc((int) (v & 0x7f) | 0x80, rp->fp);
+        v >>= 7;
+        rp->pos++;
+    }
+    putc((int) v, rp->fp);
+    rp->pos++;
+
+    return;
+}
+
+/*
+ *  get_varint()
+ *  Purpose: Read a number written by put_varint() from the mapping
+ *   Output: vp, the number
+ *   Return: 0 on success, -1 at the end of the file or if it is too long
+ */
+int get_varint(struct ppreplay * rp, uint64_t * vp)
+{
+    uint64_t v = 0;
+    int c, i;
+
+    for(i = 0; i < VARINT_MAX && rp->pos < rp->len; i++)
+    {
+        c = rp->map[rp->pos++];
+        v |= (uint64_t) (c & 0x7f) << (7 * i);
+        if( !(c & 0x80) )
+        {
+            *vp = v;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ *  read_event()
+ *  Purpose: Read the next move into rp->tick and rp->ev
+ *     Note: Once REPLAY_END (or REPLAY_BAD) is read, nothing more is, and
+ *           rp->tick stays where the recording stopped.
+ */
+void read_event(struct ppreplay * rp)
+{
+    uint64_t v;
+
+    if(rp->ev == REPLAY_END || rp->ev == REPLAY_BAD)
+        return;
+
+    rp->base = rp->tick;
+    rp->at = rp->pos;
+    if( get_varint(rp, &v) == -1 )
+    {
+        rp->ev = REPLAY_BAD;
+        return;
+    }
+
+    rp->tick += (long) (v >> EVENT_BITS);
+    rp->ev = (int) (v & EVENT_MASK);
+    return;
+}
+
+/*
+ *  index_name()
+ *  Purpose: Name the index file for a recording
+ *   Return: the name, malloc'ed; the caller frees it
+ *    Error: If malloc fails, close curses, print a message and exit.
+ */
+char * index_name(const char * path)
+{
+    char * name = malloc(strlen(path) + sizeof(INDEX_SUFFIX));
+
+    if(name == NULL)
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Couldn't allocate memory for a replay.\n");
+        exit(1);
+    }
+
+    strcpy(name, path);
+    strcat(name, INDEX_SUFFIX);
+    return name;
+}
+
+/*
+ *  map_file()
+ *  Purpose: Map a whole file into memory, read-only
+ *   Output: lenp, the size of the file
+ *   Return: the mapping, or NULL if it can't be opened or mapped, or is
+ *           empty (errno says why, or is 0)
+ *     Note: The file can be closed once it is mapped.
+ */
+const unsigned char * map_file(const char * path, size_t * lenp)
+{
+    struct stat st;
+    void * map = MAP_FAILED;
+    int fd = open(path, O_RDONLY);
+
+    if(fd == -1)
+        return NULL;
+
+    if( fstat(fd, &st) == 0 )
+    {
+        errno = 0;
+        if(st.st_size > 0)
+            map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+
+    if(map == MAP_FAILED)
+        return NULL;
+
+    *lenp = st.st_size;
+    return map;
+}
+
+/*
+ *  snapshot_size()
+ *  Purpose: Size the snapshots of a game
+ *   Return: the bytes in one, with its snap_head, rounded up so every
+ *           snap_head in the index is aligned
+ */
+size_t snapshot_size(struct ppgame * gp)
+{
+    size_t n = sizeof(struct snap_head) + game_save(gp, NULL);
+
+    return (n + SNAP_ALIGN - 1) / SNAP_ALIGN * SNAP_ALIGN;
+}
+
+/*
+ *  open_index()
+ *  Purpose: Map the index that goes with a recording, if it is usable
+ *    Input: rp, the recording
+ *           gp, the game it is played back into, to size the snapshots
+ *     Note: With no index, or one for another recording, machine or build
+ *           (see the notes at the top), rp->ix_map stays NULL.
+ */
+void open_index(struct ppreplay * rp, struct ppgame * gp)
+{
+    const struct index_head * hp;
+
+    rp->snap_size = snapshot_size(gp);
+    if( (rp->ix_map = map_file(rp->ix_name, &rp->ix_len)) == NULL )
+        return;
+
+    hp = (const struct index_head *) rp->ix_map;
+    if( rp->ix_len < sizeof(struct index_head) ||
+        memcmp(hp->magic, INDEX_MAGIC, MAGIC_LEN) != 0 ||
+        hp->version != INDEX_VERSION || hp->order != BYTE_ORDER_MARK ||
+        hp->seed != rp->seed || hp->every < 1 ||
+        hp->size != rp->snap_size )
+    {
+        munmap((void *) rp->ix_map, rp->ix_len);
+        rp->ix_map = NULL;
+        return;
+    }
+
+    rp->ix_count = (rp->ix_len - sizeof(struct index_head)) / hp->size;
+    return;
+}
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  replay_create()
+ *  Purpose: Start recording a game
+ *    Input: path, the file to write; it is replaced if it exists
+ *           ip, what the game was started with
+ *   Return: a pointer to the recording, or NULL if the file can't be
+ *           opened (errno says why)
+ *    Error: If malloc fails, close curses, print a message and exit.
+ */
+struct ppreplay * replay_create(const char * path,
+                                const struct replay_info * ip)
+{
+    struct ppreplay * rp;
+    FILE * fp = fopen(path, "wb");
+
+    if(fp == NULL)
+        return NULL;
+
+    if( (rp = calloc(1, sizeof(struct ppreplay))) == NULL )
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Couldn't allocate memory for a replay.\n");
+        exit(1);
+    }
+
+    rp->fp = fp;
+    rp->writing = 1;
+    rp->ev = REPLAY_END;
+    rp->seed = ip->seed;
+    rp->ix_name = index_name(path);
+
+    fwrite(MAGIC, 1, MAGIC_LEN, fp);
+    putc(REPLAY_VERSION, fp);
+    rp->pos = MAGIC_LEN + 1;
+    put_varint(rp, ip->seed);
+    put_varint(rp, ip->tick_rate);
+    put_varint(rp, ip->lines);
+    put_varint(rp, ip->cols);
+    put_varint(rp, ip->balls);
+
+    return rp;
+}
+
+/*
+ *  replay_event()
+ *  Purpose: Record a move
+ *    Input: rp, the recording
+ *           tick, how many ticks had run when it was made; never less
+ *           than for the move before
+ *           ev, REPLAY_UP, REPLAY_DOWN or REPLAY_QUIT
+ *     Note: Writes go through stdio, so a move costs a byte or two in a
+ *           buffer and no system call.
+ */
+void replay_event(struct ppreplay * rp, long tick, int ev)
+{
+    put_varint(rp, ((uint64_t) (tick - rp->tick) << EVENT_BITS) | ev);
+    rp->tick = tick;
+
+    return;
+}
+
+/*
+ *  replay_close()
+ *  Purpose: Finish a recording, or a playback, and free it
+ *    Input: rp, the recording; NULL is ignored
+ *           tick, when recording, how many ticks the game ran for
+ *   Return: 0, or -1 if the recording or its index could not all be
+ *           written
+ */
+int replay_close(struct ppreplay * rp, long tick)
+{
+    int err = 0;
+
+    if(rp == NULL)
+        return 0;
+
+    if(rp->writing)
+    {
+        replay_event(rp, tick, REPLAY_END);
+        if( ferror(rp->fp) || fclose(rp->fp) == EOF )
+            err = 1;
+    }
+    else
+        munmap((void *) rp->map, rp->len);
+
+    if(rp->ix_fp != NULL && (ferror(rp->ix_fp) || fclose(rp->ix_fp) == EOF))
+        err = 1;
+    if(rp->ix_map != NULL)
+        munmap((void *) rp->ix_map, rp->ix_len);
+
+    free(rp->ix_name);
+    free(rp->snap);
+    free(rp);
+
+    return err ? -1 : 0;
+}
+
+/*
+ *  replay_open()
+ *  Purpose: Open a recording to play it back
+ *    Input: path, the file written by replay_create()
+ *   Output: ip, what the game was started with
+ *   Return: a pointer to the recording, at its first move, or NULL if the
+ *           file can't be opened or isn't a recording (errno is 0 then)
+ *     Note: The index isn't looked at until replay_seek().
+ *    Error: If malloc fails, close curses, print a message and exit.
+ */
+struct ppreplay * replay_open(const char * path, struct replay_info * ip)
+{
+    struct ppreplay * rp;
+    uint64_t v[4];
+    int i;
+
+    if( (rp = calloc(1, sizeof(struct ppreplay))) == NULL )
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Couldn't allocate memory for a replay.\n");
+        exit(1);
+    }
+
+    if( (rp->map = map_file(path, &rp->len)) == NULL )
+    {
+        free(rp);
+        return NULL;
+    }
+
+    rp->pos = MAGIC_LEN + 1;
+    if( rp->len < rp->pos || memcmp(rp->map, MAGIC, MAGIC_LEN) != 0 ||
+        rp->map[MAGIC_LEN] != REPLAY_VERSION ||
+        get_varint(rp, &ip->seed) == -1 )
+        i = 0;
+    else
+        for(i = 0; i < 4; i++)
+            if( get_varint(rp, &v[i]) == -1 || v[i] > INT_MAX )
+                break;
+
+    if(i < 4)
+    {
+        munmap((void *) rp->map, rp->len);
+        free(rp);
+        errno = 0;
+        return NULL;
+    }
+
+    ip->tick_rate = (int) v[0];
+    ip->lines = (int) v[1];
+    ip->cols = (int) v[2];
+    ip->balls = (int) v[3];
+
+    rp->seed = ip->seed;
+    rp->ix_name = index_name(path);
+    rp->ev = REPLAY_UP;                 // anything but END or BAD
+    read_event(rp);
+
+    return rp;
+}
+
+/*
+ *  replay_play()
+ *  Purpose: Make the moves recorded before a tick
+ *    Input: rp, the recording
+ *           gp, the game it is played back into
+ *           tick, how many ticks have run; call before each one
+ *   Return: GAME_ON to run the tick, GAME_OVER if a paddle move lost the
+ *           last ball, or GAME_QUIT if the player quit here or the
+ *           recording has run out
+ */
+int replay_play(struct ppreplay * rp, struct ppgame * gp, long tick)
+{
+    int state = GAME_ON;
+
+    while(state == GAME_ON && rp->tick <= tick)
+    {
+        if(rp->ev == REPLAY_END || rp->ev == REPLAY_BAD)
+            return GAME_QUIT;
+        else if(rp->ev == REPLAY_QUIT)
+            state = GAME_QUIT;
+        else if(rp->ev == REPLAY_UP)
+            state = game_paddle(gp, PADDLE_UP);
+        else
+            state = game_paddle(gp, PADDLE_DOWN);
+
+        read_event(rp);
+    }
+
+    return state;
+}
+
+/*
+ *  replay_end()
+ *  Purpose: Tell where the recorded game stopped
+ *    Input: rp, the recording
+ *   Return: the tick of REPLAY_END, once every move before it has been
+ *           played, otherwise -1 (moves are left, or the file is cut short)
+ *     Note: A game played back to its end should stop at this tick too.
+ */
+long replay_end(struct ppreplay * rp)
+{
+    return (rp->ev == REPLAY_END) ? rp->tick : -1;
+}
+
+/*
+ *  replay_index()
+ *  Purpose: Start writing an index of snapshots for a recording
+ *    Input: rp, the recording, being made or played back from the start
+ *           gp, the game being recorded, at tick 0
+ *   Return: 0, or -1 if the index can't be created (errno says why)
+ *     Note: The index is written next to the recording, replacing any
+ *           there. Call replay_tick() after every tick to fill it.
+ *    Error: If malloc fails, close curses, print a message and exit.
+ */
+int replay_index(struct ppreplay * rp, struct ppgame * gp)
+{
+    struct index_head head;
+
+    if( (rp->ix_fp = fopen(rp->ix_name, "wb")) == NULL )
+        return -1;
+
+    rp->snap_size = snapshot_size(gp);
+    if( (rp->snap = calloc(1, rp->snap_size)) == NULL )
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Couldn't allocate memory for a replay.\n");
+        exit(1);
+    }
+
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, INDEX_MAGIC, MAGIC_LEN);
+    head.version = INDEX_VERSION;
+    head.order = BYTE_ORDER_MARK;
+    head.every = SNAP_TICKS;
+    head.seed = rp->seed;
+    head.size = rp->snap_size;
+    fwrite(&head, sizeof(head), 1, rp->ix_fp);
+
+    return 0;
+}
+
+/*
+ *  replay_tick()
+ *  Purpose: Write a snapshot to the index, if one is due
+ *    Input: rp, the recording; NULL, or one with no index, is ignored
+ *           gp, the game
+ *           tick, how many ticks have run, counting the one just run
+ *     Note: Call after each tick, before any moves made at 'tick'. The
+ *           snapshot goes with the first move not yet recorded (or not
+ *           yet played, reading back), which is where replay_seek() will
+ *           carry on from.
+ */
+void replay_tick(struct ppreplay * rp, struct ppgame * gp, long tick)
+{
+    struct snap_head * sp;
+
+    if(rp == NULL || rp->ix_fp == NULL || tick % SNAP_TICKS != 0)
+        return;
+
+    sp = (struct snap_head *) rp->snap;
+    sp->tick = tick;
+    sp->at = rp->writing ? (int64_t) rp->pos : (int64_t) rp->at;
+    sp->base = rp->writing ? rp->tick : rp->base;
+    game_save(gp, rp->snap + sizeof(struct snap_head));
+
+    fwrite(rp->snap, rp->snap_size, 1, rp->ix_fp);
+    return;
+}
+
+/*
+ *  replay_seek()
+ *  Purpose: Skip a playback ahead to the last snapshot at or before a tick
+ *    Input: rp, the recording, just opened
+ *           gp, the game it is played back into, fresh from new_game()
+ *           tick, the tick wanted
+ *   Return: the tick the game and the recording are now at, to carry on
+ *           playing from; 0 if there is no usable index or no snapshot
+ *           that early (then neither is touched)
+ *   Method: Snapshot k was taken at tick (k + 1) * every, so the one
+ *           wanted is found by dividing, with no search. The game state is
+ *           loaded from it and the recording carries on from the move it
+ *           points at.
+ */
+long replay_seek(struct ppreplay * rp, struct ppgame * gp, long tick)
+{
+    const struct index_head * hp;
+    const struct snap_head * sp;
+    long k;
+
+    if(rp->ix_map == NULL)
+        open_index(rp, gp);
+    if(rp->ix_map == NULL)
+        return 0;
+
+    hp = (const struct index_head *) rp->ix_map;
+    k = (tick / (long) hp->every) - 1;
+    if(k >= rp->ix_count)
+        k = rp->ix_count - 1;
+    if(k < 0)
+        return 0;
+
+    sp = (const struct snap_head *) (rp->ix_map + sizeof(struct index_head) +
+                                     (k * hp->size));
+    if( sp->tick != (k + 1) * (long) hp->every ||
+        sp->at < 0 || (size_t) sp->at > rp->len )
+        return 0;
+
+    game_load(gp, (const unsigned char *) (sp + 1));
+
+    rp->pos = sp->at;
+    rp->tick = sp->base;
+    rp->ev = REPLAY_UP;
+    read_event(rp);
+
+    return sp->tick;
+}
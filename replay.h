@@ -0,0 +1,39 @@
+/*
+ * ==========================
+ *   FILE: ./replay.h
+ * ==========================
+ * Purpose: Header file for replay.c
+ */
+
+/* INCLUDES */
+#include <stdint.h>
+
+/* CONSTANTS */
+#define REPLAY_BAD -1       // the file is cut short or garbled
+#define REPLAY_UP 0         // paddle up a row
+#define REPLAY_DOWN 1       // paddle down a row
+#define REPLAY_QUIT 2       // the player quit
+#define REPLAY_END 3        // the recording stops here
+
+/* STRUCTS */
+struct replay_info {        // what the game was started with
+    uint64_t seed;          // seed for the game's random numbers
+    int tick_rate;          // game ticks per second
+    int lines, cols;        // size of the terminal, which sets the court
+    int balls;              // balls in play per serve
+};
+
+/* OPAQUE STRUCTS */
+struct ppgame;
+struct ppreplay;
+
+/* EXTERNAL INTERFACE */
+struct ppreplay * replay_create(const char *, const struct replay_info *);
+void replay_event(struct ppreplay *, long, int);
+int replay_close(struct ppreplay *, long);
+struct ppreplay * replay_open(const char *, struct replay_info *);
+int replay_play(struct ppreplay *, struct ppgame *, long);
+long replay_end(struct ppreplay *);
+int replay_index(struct ppreplay *, struct ppgame *);
+void replay_tick(struct ppreplay *, struct ppgame *, long);
+long replay_seek(struct ppreplay *, struct ppgame *, long);
\ No newline at end of file
@@ -0,0 +1,123 @@
+/*
+ * ===========================================================================
+ *   FILE: ./rng.c
+ * ===========================================================================
+ * Purpose: A small, fast, seedable random number generator, with as many
+ *          independent streams as the game needs.
+ *
+ * Interface:
+ *      rng_seed()          -- start a stream from a seed
+ *      rng_next()          -- next 32 random bits from a stream
+ *      rng_range()         -- a random number between a min and max
+ *      rng_seed_from()     -- draw a 64-bit seed for another generator
+ *
+ * Notes:
+ *      This is PCG32 (O'Neill, "PCG: A Family of Simple Fast
+ *      Space-Efficient Statistically Good Algorithms for Random Number
+ *      Generation", pcg-random.org): a 64-bit LCG whose output is
+ *      scrambled by an xorshift and a state-dependent rotate. Its state
+ *      is two words and a step is a multiply, an add and a few shifts.
+ *
+ *      Unlike rand(), there is no hidden global state. Every generator is
+ *      a struct pprng owned by whoever uses it, so each ball, each game
+ *      and each computer player can have its own, and two of them never
+ *      get in each other's way (or need a lock). The same seed and
+ *      stream always give the same numbers, on any machine, which is what
+ *      makes a game repeatable.
+ *
+ *      Streams: PCG's increment picks one of 2^63 sequences that never
+ *      overlap, so rng_seed() takes a stream number as well as a seed,
+ *      and things seeded from one game seed are told apart by stream.
+ */
+
+/* INCLUDES */
+#include "rng.h"
+
+/* CONSTANTS */
+#define PCG_MULT 6364136223846793005ULL
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  rng_seed()
+ *  Purpose: Start a generator at the beginning of one stream
+ *    Input: rp, the generator
+ *           seed, where in the sequence to start
+ *           stream, which sequence; different streams are independent
+ *     Note: This is the seeding procedure from the PCG paper.
+ */
+void rng_seed(struct pprng * rp, uint64_t seed, uint64_t stream)
+{
+    rp->state = 0;
+    rp->inc = (stream << 1) | 1;
+    rng_next(rp);
+    rp->state += seed;
+    rng_next(rp);
+
+    return;
+}
+
+/*
+ *  rng_next()
+ *  Purpose: Step a generator
+ *    Input: rp, the generator
+ *   Return: 32 random bits
+ */
+uint32_t rng_next(struct pprng * rp)
+{
+    uint64_t old = rp->state;
+    uint32_t xorshifted, rot;
+
+    rp->state = (old * PCG_MULT) + rp->inc;
+    xorshifted = (uint32_t) (((old >> 18) ^ old) >> 27);
+    rot = (uint32_t) (old >> 59);
+
+    return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+/*
+ *  rng_range()
+ *  Purpose: generate a random number between min and max
+ *    Input: rp, the generator
+ *           min, the lowest possible value
+ *           max, one more than the highest possible value
+ *   Return: the randomly generated number, min <= n < max, or min if the
+ *           range is empty (max <= min)
+ *   Method: Throw away the few draws that would make the low values come
+ *           up more often than the rest (unlike rand() % n), then reduce.
+ *     Note: An empty range takes nothing from the stream. A range of one
+ *           still does, so the games' streams stay in step as they were.
+ */
+int rng_range(struct pprng * rp, int min, int max)
+{
+    uint32_t bound, threshold, r;
+
+    if(max <= min)
+        return min;
+
+    bound = (uint32_t) (max - min);
+    threshold = (-bound) % bound;
+
+    do
+        r = rng_next(rp);
+    while(r < threshold);
+
+    return (int) (r % bound) + min;
+}
+
+/*
+ *  rng_seed_from()
+ *  Purpose: Draw a seed for another generator from this one
+ *    Input: rp, the generator
+ *   Return: 64 random bits
+ */
+uint64_t rng_seed_from(struct pprng * rp)
+{
+    uint64_t high = rng_next(rp);
+
+    return (high << 32) | rng_next(rp);
+}
@@ -0,0 +1,21 @@
+/*
+ * ==========================
+ *   FILE: ./rng.h
+ * ==========================
+ * Purpose: Header file for rng.c
+ */
+
+/* INCLUDES */
+#include <stdint.h>
+
+/* STRUCTS */
+struct pprng {
+    uint64_t state;         // where the stream is
+    uint64_t inc;           // which stream it is; always odd
+};
+
+/* EXTERNAL INTERFACE */
+void rng_seed(struct pprng *, uint64_t, uint64_t);
+uint32_t rng_next(struct pprng *);
+int rng_range(struct pprng *, int, int);
+uint64_t rng_seed_from(struct pprng *);
\ No newline at end of file
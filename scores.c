@@ -0,0 +1,512 @@
+/*
+ * ===========================================================================
+ *   FILE: ./scores.c
+ * ===========================================================================
+ * Purpose: Keep every game's result in a log on disk, and the best of them
+ *          at hand.
+ *
+ * Interface:
+ *      scores_open()       -- open (or start) a log, and load its best
+ *      scores_add()        -- log a result, and place it among the best
+ *      scores_top()        -- the best results, best first
+ *      scores_count()      -- how many results the log holds
+ *      scores_close()      -- write what is left, and close the log
+ *
+ * Internal functions:
+ *      suffixed()          -- the name of a file that goes with a log
+ *      trim()              -- cut off a record cut short at the end
+ *      place()             -- put a result in the best-of list, if it is
+ *      fold()              -- place a run of logged results
+ *      load_top()          -- map the best-of file, if it is a good one
+ *      save_top()          -- write the best-of file again
+ *      catch_up()          -- place what others logged since we looked
+ *      flush()             -- write the waiting results, then sync
+ *
+ * Notes:
+ *      Log: a header (the magic "PPSC", a version, a byte order mark and
+ *      the size of a record), then one struct score per game, appended
+ *      and never changed. The records are in the machine's own byte order
+ *      and layout, as the replay index's snapshots are (see replay.c); a
+ *      log from another machine or build is refused, rather than misread.
+ *
+ *      Results are kept in memory as they are added, and written in
+ *      batches of SCORE_BATCH with one write() and one fdatasync() each,
+ *      and whatever is left at scores_close(). So pong-sim can log
+ *      millions of games without a sync each, and pong, which logs only
+ *      one, syncs it before it says goodbye.
+ *
+ *  Best-of: next to the log (the same name, with TOP_SUFFIX) is a small
+ *      file with the SCORE_TOP best results in it, best first, and how
+ *      much of the log they were taken from. scores_open() maps it and
+ *      only reads the records logged after that, so opening a log costs
+ *      the same however long it is. The file is only a cache: it is
+ *      written again (a new file renamed over the old, so it is never
+ *      seen half-written) whenever results are logged, and if it is
+ *      missing, out of date or garbled, the log is read through once to
+ *      make it again. A longer wait is the worst a lost one costs.
+ *
+ *      Ties go to the result logged first, so a score has to be beaten to
+ *      move down the list.
+ *
+ *      More than one program may log to the same file at once (pong and a
+ *      pong-sim run, say). The log is locked (flock()) while it is read or
+ *      written, and each batch is appended whole; before writing, whatever
+ *      the others logged since is placed too, so the best-of file written
+ *      covers all of the log it claims to.
+ */
+
+/* INCLUDES */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "pong.h"
+#include "scores.h"
+
+/* CONSTANTS */
+#define MAGIC "PPSC"
+#define MAGIC_LEN 4
+#define SCORES_VERSION 1
+#define BYTE_ORDER_MARK 0x01020304
+#define SCORE_BATCH 4096    // results written, and synced, at a time
+
+#define TOP_SUFFIX ".top"
+#define TOP_MAGIC "PPST"
+#define TMP_SUFFIX ".tmp"
+
+/* FILE STRUCTS */
+struct log_head {           // at the start of a log
+    char magic[MAGIC_LEN];
+    uint32_t version;
+    uint32_t order;         // BYTE_ORDER_MARK, as this machine stores it
+    uint32_t size;          // bytes in each record
+};
+
+struct top_file {           // the whole of a best-of file
+    char magic[MAGIC_LEN];
+    uint32_t version;
+    uint32_t order;
+    uint32_t count;         // results in best, up to SCORE_TOP
+    uint64_t covered;       // bytes of the log they were taken from
+    struct score best[SCORE_TOP];
+};
+
+/* SCORES STRUCT */
+struct ppscores {
+    int fd;                 // the log, opened to append
+    char * top_name;        // the best-of file that goes with it
+    char * tmp_name;        // and the name it is written under first
+    off_t end;              // bytes of the log placed in 'best'
+    struct score best[SCORE_TOP];
+    int count;              // results in best
+    long logged;            // results in the log, and in 'batch'
+    struct score * batch;   // results not yet written
+    int waiting;            // how many
+    int err;                // a write or sync failed
+};
+
+/*
+ * ===========================================================================
+ * INTERNAL FUNCTIONS
+ * ===========================================================================
+ */
+static char * suffixed(const char *, const char *);
+static off_t trim(int, off_t);
+static int place(struct ppscores *, const struct score *);
+static void fold(struct ppscores *, const struct score *, long);
+static void load_top(struct ppscores *, off_t);
+static void save_top(struct ppscores *);
+static void catch_up(struct ppscores *, off_t);
+static void flush(struct ppscores *);
+
+/*
+ *  suffixed()
+ *  Purpose: Name a file that goes with a log
+ *    Input: path, the log
+ *           suffix, what to add to it
+ *   Return: the name, malloc'ed; the caller frees it
+ *    Error: If malloc fails, close curses, print a message and exit.
+ */
+char * suffixed(const char * path, const char * suffix)
+{
+    char * name = malloc(strlen(path) + strlen(suffix) + 1);
+
+    if(name == NULL)
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Couldn't allocate memory for the scores.\n");
+        exit(1);
+    }
+
+    strcpy(name, path);
+    strcat(name, suffix);
+    return name;
+}
+
+/*
+ *  trim()
+ *  Purpose: Cut a record cut short (a program died writing it) off the
+ *           end of a log, so the next one appended starts where a record
+ *           should
+ *    Input: fd, the log, locked
+ *           size, its size now, at least a header
+ *   Return: the size of the log's whole records, with the header
+ *     Note: If it can't be cut, the part record is still never read.
+ */
+off_t trim(int fd, off_t size)
+{
+    off_t whole = size - (size - sizeof(struct log_head)) %
+                         (off_t) sizeof(struct score);
+
+    if(whole != size)
+        ftruncate(fd, whole);
+
+    return whole;
+}
+
+/*
+ *  place()
+ *  Purpose: Put a result in the best-of list, if it belongs there
+ *    Input: sp, the scores
+ *           rp, the result
+ *   Return: where it went, from 1 (the best), or 0 if it isn't among them
+ *     Note: It goes after every result that lasted as long, so ties go to
+ *           the one placed first.
+ */
+int place(struct ppscores * sp, const struct score * rp)
+{
+    int i;
+
+    for(i = 0; i < sp->count && sp->best[i].secs >= rp->secs; i++)
+        ;
+    if(i == SCORE_TOP)
+        return 0;
+
+    if(sp->count < SCORE_TOP)
+        sp->count++;
+    memmove(&sp->best[i + 1], &sp->best[i],
+            (sp->count - i - 1) * sizeof(struct score));
+    sp->best[i] = *rp;
+
+    return i + 1;
+}
+
+/*
+ *  fold()
+ *  Purpose: Place a run of results read from the log
+ *    Input: sp, the scores
+ *           rp, n, the results
+ *   Method: Most results are no better than the worst of a full list,
+ *           so that is checked first, and costs one compare.
+ */
+void fold(struct ppscores * sp, const struct score * rp, long n)
+{
+    for( ; n > 0; n--, rp++)
+        if( sp->count < SCORE_TOP ||
+            rp->secs > sp->best[SCORE_TOP - 1].secs )
+            place(sp, rp);
+
+    return;
+}
+
+/*
+ *  load_top()
+ *  Purpose: Take the best results from the best-of file, if it is good
+ *    Input: sp, the scores
+ *           size, the size the log is now
+ *   Output: sp->best and sp->count, and sp->end, how much of the log they
+ *           cover; with no good file, an empty list covering only the
+ *           log's header
+ *     Note: A file covering more of the log than there is, or not ending
+ *           on a record, was made for some other log, and is ignored.
+ */
+void load_top(struct ppscores * sp, off_t size)
+{
+    const struct top_file * tp = MAP_FAILED;
+    struct stat st;
+    int fd = open(sp->top_name, O_RDONLY);
+
+    sp->count = 0;
+    sp->end = sizeof(struct log_head);
+    if(fd == -1)
+        return;
+
+    if( fstat(fd, &st) == 0 && st.st_size == sizeof(struct top_file) )
+        tp = mmap(NULL, sizeof(struct top_file), PROT_READ, MAP_PRIVATE,
+                  fd, 0);
+    close(fd);
+    if(tp == MAP_FAILED)
+        return;
+
+    if( memcmp(tp->magic, TOP_MAGIC, MAGIC_LEN) == 0 &&
+        tp->version == SCORES_VERSION && tp->order == BYTE_ORDER_MARK &&
+        tp->count <= SCORE_TOP && tp->covered >= sizeof(struct log_head) &&
+        tp->covered <= (uint64_t) size &&
+        (tp->covered - sizeof(struct log_head)) % sizeof(struct score) == 0 )
+    {
+        memcpy(sp->best, tp->best, sizeof(sp->best));
+        sp->count = tp->count;
+        sp->end = tp->covered;
+    }
+
+    munmap((void *) tp, sizeof(struct top_file));
+    return;
+}
+
+/*
+ *  save_top()
+ *  Purpose: Write the best-of file again, covering the log up to sp->end
+ *     Note: Called with the log locked, so no one else renames another
+ *           over it meanwhile. If it can't be written, nothing is lost:
+ *           the next scores_open() just reads more of the log.
+ */
+void save_top(struct ppscores * sp)
+{
+    struct top_file tf;
+    int fd = open(sp->tmp_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if(fd == -1)
+        return;
+
+    memset(&tf, 0, sizeof(tf));
+    memcpy(tf.magic, TOP_MAGIC, MAGIC_LEN);
+    tf.version = SCORES_VERSION;
+    tf.order = BYTE_ORDER_MARK;
+    tf.count = sp->count;
+    tf.covered = sp->end;
+    memcpy(tf.best, sp->best, sizeof(tf.best));
+
+    if( write(fd, &tf, sizeof(tf)) != sizeof(tf) )
+    {
+        close(fd);
+        unlink(sp->tmp_name);
+        return;
+    }
+
+    close(fd);
+    rename(sp->tmp_name, sp->top_name);
+    return;
+}
+
+/*
+ *  catch_up()
+ *  Purpose: Place the results logged after sp->end, by anyone
+ *    Input: sp, the scores
+ *           size, the size the log is now
+ *   Method: Map the log and read it from sp->end on; only the pages of
+ *           the records read are touched, however long it is.
+ */
+void catch_up(struct ppscores * sp, off_t size)
+{
+    const unsigned char * map;
+    long n = (size - sp->end) / (off_t) sizeof(struct score);
+
+    if(n <= 0)
+        return;
+
+    map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, sp->fd, 0);
+    if(map == MAP_FAILED)
+        return;
+
+    fold(sp, (const struct score *) (map + sp->end), n);
+    sp->end += n * sizeof(struct score);
+
+    munmap((void *) map, size);
+    return;
+}
+
+/*
+ *  flush()
+ *  Purpose: Write the results waiting in the batch to the log, sync it,
+ *           and write the best-of file to match
+ *   Method: With the log locked, first place whatever anyone else logged
+ *           since we last looked, so the best-of file covers it too, then
+ *           append the batch in one write() and sync it before the best-of
+ *           file claims it. The batch was placed as it was added.
+ *     Note: A failed write or sync is remembered, for scores_close().
+ */
+void flush(struct ppscores * sp)
+{
+    struct stat st;
+    size_t len = sp->waiting * sizeof(struct score);
+    ssize_t n;
+
+    if(sp->waiting == 0)
+        return;
+
+    flock(sp->fd, LOCK_EX);
+    if( fstat(sp->fd, &st) == 0 )
+        catch_up(sp, trim(sp->fd, st.st_size));
+
+    n = write(sp->fd, sp->batch, len);
+    if( n != (ssize_t) len || fdatasync(sp->fd) == -1 )
+        sp->err = 1;
+    else
+    {
+        sp->end += len;
+        save_top(sp);
+    }
+
+    flock(sp->fd, LOCK_UN);
+    sp->waiting = 0;
+    return;
+}
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  scores_open()
+ *  Purpose: Open a log of results to add to, starting it if it is new,
+ *           and load the best of it
+ *    Input: path, the log
+ *   Return: a pointer to the scores, or NULL if the file can't be opened
+ *           or is not a log of this machine's results (errno says why,
+ *           or is 0)
+ *   Method: Load the best-of file, place whatever was logged after it was
+ *           written, and if that was anything, write it again, so the
+ *           next open has less to read.
+ *    Error: If malloc fails, close curses, print a message and exit.
+ */
+struct ppscores * scores_open(const char * path)
+{
+    struct ppscores * sp;
+    struct log_head head;
+    struct stat st;
+    off_t whole;
+    int fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+
+    if(fd == -1)
+        return NULL;
+
+    flock(fd, LOCK_EX);
+    memset(&head, 0, sizeof(head));
+    if( fstat(fd, &st) == 0 && st.st_size == 0 )
+    {
+        memcpy(head.magic, MAGIC, MAGIC_LEN);
+        head.version = SCORES_VERSION;
+        head.order = BYTE_ORDER_MARK;
+        head.size = sizeof(struct score);
+        if( write(fd, &head, sizeof(head)) != sizeof(head) )
+        {
+            close(fd);
+            return NULL;
+        }
+        st.st_size = sizeof(head);
+    }
+    else if( pread(fd, &head, sizeof(head), 0) != sizeof(head) )
+        memset(&head, 0, sizeof(head));
+
+    errno = 0;
+    if( st.st_size < (off_t) sizeof(head) ||
+        memcmp(head.magic, MAGIC, MAGIC_LEN) != 0 ||
+        head.version != SCORES_VERSION || head.order != BYTE_ORDER_MARK ||
+        head.size != sizeof(struct score) )
+    {
+        close(fd);
+        return NULL;
+    }
+
+    if( (sp = calloc(1, sizeof(struct ppscores))) == NULL ||
+        (sp->batch = malloc(SCORE_BATCH * sizeof(struct score))) == NULL )
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Couldn't allocate memory for the scores.\n");
+        exit(1);
+    }
+
+    sp->fd = fd;
+    sp->top_name = suffixed(path, TOP_SUFFIX);
+    sp->tmp_name = suffixed(sp->top_name, TMP_SUFFIX);
+
+    whole = trim(fd, st.st_size);
+    load_top(sp, whole);
+    if(sp->end < whole)
+    {
+        catch_up(sp, whole);
+        save_top(sp);
+    }
+    sp->logged = (whole - sizeof(head)) / sizeof(struct score);
+
+    flock(fd, LOCK_UN);
+    return sp;
+}
+
+/*
+ *  scores_add()
+ *  Purpose: Log a game's result, and place it among the best
+ *    Input: sp, the scores
+ *           rp, the result
+ *   Return: its place in the best-of list, from 1, or 0 if it isn't in it
+ *     Note: It is written with the next full batch, or at scores_close().
+ *           Its place is among the results this program knows of: those
+ *           in the log when it was opened, and those it added since.
+ */
+int scores_add(struct ppscores * sp, const struct score * rp)
+{
+    int rank = place(sp, rp);
+
+    sp->batch[sp->waiting++] = *rp;
+    sp->logged++;
+    if(sp->waiting == SCORE_BATCH)
+        flush(sp);
+
+    return rank;
+}
+
+/*
+ *  scores_top()
+ *  Purpose: Public function to access the best results
+ *    Input: sp, the scores
+ *   Output: bestp, set to the list, best first
+ *   Return: how many are in it, up to SCORE_TOP
+ */
+int scores_top(struct ppscores * sp, const struct score ** bestp)
+{
+    *bestp = sp->best;
+    return sp->count;
+}
+
+/*
+ *  scores_count()
+ *  Purpose: Public function to access how many results have been logged
+ *   Return: the results in the log when it was opened, plus those added
+ */
+long scores_count(struct ppscores * sp)
+{
+    return sp->logged;
+}
+
+/*
+ *  scores_close()
+ *  Purpose: Write the results still waiting, close the log and free it
+ *    Input: sp, the scores; NULL is ignored
+ *   Return: 0, or -1 if any result could not be written and synced
+ */
+int scores_close(struct ppscores * sp)
+{
+    int err;
+
+    if(sp == NULL)
+        return 0;
+
+    flush(sp);
+    if(close(sp->fd) == -1)
+        sp->err = 1;
+    err = sp->err;
+
+    free(sp->top_name);
+    free(sp->tmp_name);
+    free(sp->batch);
+    free(sp);
+
+    return err ? -1 : 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * ==========================
+ *   FILE: ./scores.h
+ * ==========================
+ * Purpose: Header file for scores.c
+ */
+
+/* INCLUDES */
+#include <stdint.h>
+
+/* CONSTANTS */
+#define SCORE_TOP 10        // results kept in the best-of list
+#define SCORE_PLAYER 0      // played by a person (pong)
+#define SCORE_COMPUTER 1    // played by the computer player (pong-sim)
+
+/* STRUCTS */
+struct score {              // one game's result, as it is logged
+    int64_t when;           // time() the game ended
+    uint64_t seed;          // the game's seed; for the computer, the run's
+    uint32_t game;          // which game of that run; 0 for a person
+    uint32_t secs;          // how long it lasted, in seconds of play
+    uint16_t lines, cols;   // size of the terminal, which sets the court
+    uint16_t balls;         // balls in play per serve
+    uint16_t tick_rate;     // game ticks per second
+    uint16_t who;           // SCORE_PLAYER or SCORE_COMPUTER
+    uint16_t skill;         // the computer player's skill; 0 for a person
+    uint32_t spare;         // 0, so the record has no loose padding
+};
+
+/* OPAQUE STRUCTS */
+struct ppscores;
+
+/* EXTERNAL INTERFACE */
+struct ppscores * scores_open(const char *);
+int scores_add(struct ppscores *, const struct score *);
+int scores_top(struct ppscores *, const struct score **);
+long scores_count(struct ppscores *);
+int scores_close(struct ppscores *);
\ No newline at end of file
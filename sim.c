@@ -0,0 +1,284 @@
+/*
+ * ==========================================================================
+ *   FILE: ./sim.c
+ * ==========================================================================
+ * Purpose: Play a large batch of independent games of pong on every core.
+ *
+ * Outline: pong-sim plays the same games as pong-headless (see
+ *          autoplay.c), with the same computer player, settings and seeds,
+ *          but spreads them over a pool of worker threads (-j, by default
+ *          one per online CPU; see pool.c). At the end the games are added
+ *          up and the same summary is printed, along with how long the run
+ *          took on the wall clock and how much CPU time that was.
+ *
+ *  Scores: -K logs every game's result to a file of high scores, as pong
+ *          -K does (see scores.c), with the run's seed and the game's
+ *          number, so any of them can be played again. They are written
+ *          in batches once the run is over, and the best so far is
+ *          printed with the summary.
+ *
+ * Workers: Each game is a struct ppgame of its own, with its own court,
+ *          clock, paddle, balls and random number streams, so the workers
+ *          share nothing while they play. A worker takes the next game
+ *          number with one atomic add, plays it, and adds the result to
+ *          totals on its own stack; the totals are merged once, when the
+ *          games run out. Since game g always plays out the same for
+ *          the same seed, the summary is the same as pong-headless gives,
+ *          however many workers there are and whichever plays which game.
+ *
+ * Interface:
+ *      wrap_up()       -- called by the game objects on fatal errors
+ *
+ * Internal functions:
+ *      main()          -- start the workers, wait, print the summary
+ *      get_options()   -- read settings from the command line
+ *      log_scores()    -- log every game's result, with -K
+ *      now()           -- seconds on the monotonic clock
+ */
+
+/* INCLUDES */
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "autoplay.h"
+#include "ball_kernel.h"
+#include "clock.h"
+#include "court.h"
+#include "pong.h"
+#include "pool.h"
+#include "preset.h"
+#include "scores.h"
+
+/* CONSTANTS */
+#define DFL_GAMES 10000     // games to play
+#define DFL_LINES 24        // size of the pretend terminal
+#define DFL_COLS 80
+#define DFL_SKILL 50        // % chance per tick the paddle moves
+#define DFL_MAX_TICKS (TICKS_PER_SEC * 60 * 60)     // an hour of play
+#define MINUTE 60
+
+/* LOCAL VARIABLES -- SETTINGS */
+static int games = DFL_GAMES;
+static int workers = 0;             // 0 until set: one per online CPU
+static const char * score_path;     // -K: log the results to this file
+static struct autoplay settings = {
+    DFL_LINES, DFL_COLS, 1, DFL_SKILL, 0, TICKS_PER_SEC, DFL_MAX_TICKS, 0
+};
+
+/*
+ * ===========================================================================
+ * INTERNAL FUNCTIONS
+ * ===========================================================================
+ */
+static void get_options(int, char **);
+static void log_scores(const long *);
+static double now();
+
+/*
+ *  main()
+ *  Purpose: Play the requested number of games and summarize them
+ *    Input: argc, argv, the command line (see get_options())
+ *   Return: 0 on success, exit non-zero on error
+ */
+int main (int argc, char * argv[])
+{
+    struct autoplay_totals totals;
+    struct pppool * pool;
+    clock_t cpu_start;
+    double start, wall, cpu;
+    long * secs = NULL;
+
+    settings.seed = getpid();
+    get_options(argc, argv);
+
+    if( score_path != NULL && (secs = malloc(games * sizeof(long))) == NULL )
+    {
+        fprintf(stderr, "./pong: Couldn't allocate memory for the scores.\n");
+        exit(1);
+    }
+
+    pool = new_pool(workers);
+    start = now();
+    cpu_start = clock();
+    pool_run(pool, &settings, games, &totals, secs);
+    wall = now() - start;
+    cpu = (double) (clock() - cpu_start) / CLOCKS_PER_SEC;
+    if(wall < 0.000001)
+        wall = 0.000001;
+
+    autoplay_report(&settings, &totals, wall);
+    printf("workers: %d  wall: %.3fs  cpu: %.3fs (%.1fx)\n",
+           workers, wall, cpu, cpu / wall);
+    if(secs != NULL)
+        log_scores(secs);
+
+    pool_free(pool);
+    free(secs);
+    return 0;
+}
+
+/*
+ *  get_options()
+ *  Purpose: Read settings from the command line
+ *    Input: argc, argv, as passed to main()
+ *   Method: As for pong-headless (-g, -b, -H, -W, -p, -m, -r/--seed, -k,
+ *           -G, -i), plus -j, the number of worker threads, and -K, a file
+ *           to log the results to.
+ *    Error: On an unknown option or a bad value, or a kernel this CPU can't
+ *           run, print a usage message and exit.
+ */
+void get_options(int argc, char * argv[])
+{
+    static const struct option longopts[] = {
+        { "seed", required_argument, NULL, 'r' },
+        { NULL, 0, NULL, 0 }
+    };
+    struct autoplay * ap = &settings;
+    int opt, bad = 0;
+
+    while( (opt = getopt_long(argc, argv, "g:j:b:H:W:p:m:r:k:GiK:", longopts,
+                              NULL)) != -1 )
+    {
+        if(opt == 'g')
+            games = atoi(optarg);
+        else if(opt == 'j')
+            workers = atoi(optarg);
+        else if(opt == 'b')
+            ap->balls = atoi(optarg);
+        else if(opt == 'H')
+            ap->lines = atoi(optarg);
+        else if(opt == 'W')
+            ap->cols = atoi(optarg);
+        else if(opt == 'p')
+            ap->skill = atoi(optarg);
+        else if(opt == 'm')
+            ap->max_ticks = atol(optarg);
+        else if(opt == 'r')
+            ap->seed = strtoull(optarg, NULL, 0);
+        else if(opt == 'k')
+            bad = (ball_kernel_use(optarg) == -1);
+        else if(opt == 'G')
+            preset_use(0);
+        else if(opt == 'i')
+            ap->predict = 1;
+        else if(opt == 'K')
+            score_path = optarg;
+        else
+            bad = 1;
+    }
+
+    if(workers == 0)
+        workers = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if(workers > games)
+        workers = games;
+
+    if( bad || optind < argc || games < 1 || ap->max_ticks < 1 ||
+        workers < 1 || workers > MAX_WORKERS ||
+        ap->balls < 1 || ap->balls > MAX_BALLS ||
+        ap->lines < MIN_LINES || ap->cols < MIN_COLS ||
+        ap->skill < 0 || ap->skill > 100 )
+    {
+        fprintf(stderr, "usage: %s [-g games] [-j workers] [-b balls] "
+                        "[-H lines] [-W cols] [-p skill%%] [-m max_ticks] "
+                        "[-r seed] [-k kernel] [-G] [-i] "
+                        "[-K score_file]\n", argv[0]);
+        fprintf(stderr, "       (kernels: %s)\n", KERNEL_NAMES);
+        fprintf(stderr, "       (court must be at least %dx%d)\n",
+                        MIN_COLS, MIN_LINES);
+        exit(2);
+    }
+
+    return;
+}
+
+/*
+ *  log_scores()
+ *  Purpose: Log every game of the run to the high scores, and print the
+ *           best of them
+ *    Input: secs, how long each game lasted, in seconds of play
+ *    Error: If the file can't be opened or written, say so and exit.
+ */
+void log_scores(const long * secs)
+{
+    struct ppscores * sp = scores_open(score_path);
+    const struct score * best;
+    struct score sc;
+    int g;
+
+    if(sp == NULL)
+    {
+        fprintf(stderr, "./pong: %s: %s\n", score_path, errno ?
+                        strerror(errno) : "not a pong score file");
+        exit(1);
+    }
+
+    memset(&sc, 0, sizeof(sc));
+    sc.when = time(NULL);
+    sc.seed = settings.seed;
+    sc.lines = settings.lines;
+    sc.cols = settings.cols;
+    sc.balls = settings.balls;
+    sc.tick_rate = settings.tick_rate;
+    sc.who = SCORE_COMPUTER;
+    sc.skill = settings.skill;
+
+    for(g = 0; g < games; g++)
+    {
+        sc.game = g;
+        sc.secs = secs[g];
+        scores_add(sp, &sc);
+    }
+
+    scores_top(sp, &best);              // at least the games just added
+    printf("scores: %d logged to %s, %ld in all  best: %.2u:%.2u", games,
+           score_path, scores_count(sp), best[0].secs / MINUTE,
+           best[0].secs % MINUTE);
+    if(best[0].who == SCORE_COMPUTER)
+        printf(" (seed %llu, game %u)", (unsigned long long) best[0].seed,
+               best[0].game);
+    printf("\n");
+
+    if(scores_close(sp) == -1)
+    {
+        fprintf(stderr, "./pong: %s: couldn't log the results\n",
+                        score_path);
+        exit(1);
+    }
+
+    return;
+}
+
+/*
+ *  now()
+ *  Purpose: Read the monotonic clock
+ *   Return: the time in seconds, from some fixed point in the past
+ */
+double now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  wrap_up()
+ *  Purpose: Get ready for a fatal error to exit
+ *     Note: The game objects call this when they can't allocate memory.
+ *           Other workers may still be playing, so nothing is freed here;
+ *           the process is about to exit.
+ */
+void wrap_up()
+{
+    return;
+}
@@ -0,0 +1,701 @@
+/*
+ * ===========================================================================
+ *   FILE: ./spectate.c
+ * ===========================================================================
+ * Purpose: Show a game as it is played to any number of viewers, over UDP.
+ *
+ * Interface:
+ *      new_spec()          -- take viewers on a UDP port
+ *      spec_fd()           -- a descriptor to poll() on for viewer traffic
+ *      spec_service()      -- add and drop viewers, and finish sending
+ *      spec_publish()      -- send every viewer where everything is now
+ *      spec_get_stats()    -- what serving the viewers has cost
+ *      spec_close()        -- tell the viewers the game is over, and free
+ *
+ * Internal functions:
+ *      now_us()            -- microseconds on the monotonic clock
+ *      put16(), put32()    -- little-endian numbers in a packet
+ *      hash()              -- where in the address table to look first
+ *      find_viewer()       -- look up a viewer by address
+ *      rehash()            -- rebuild the address table
+ *      add_viewer()        -- start sending to a viewer
+ *      drop_viewer()       -- stop sending to one
+ *      take_requests()     -- read what the viewers have sent
+ *      encode()            -- turn the game's state into this frame's packets
+ *      fan_out()           -- send the frame to every viewer
+ *      arm()               -- ask epoll to say when the socket has room
+ *
+ * Notes:
+ *      A viewer (pong-watch, see watch.c) joins by sending SPEC_WATCH to
+ *      the port, and says it again every SPEC_WATCH_US to stay on; one not
+ *      heard from for VIEWER_TIMEOUT_US is dropped. After every pass of
+ *      ticks, pong calls spec_publish(), which sends each viewer where the
+ *      balls and paddles are, the clock and the balls left.
+ *
+ *      Frames: every viewer gets the same packets. They are made once per
+ *      frame, however many viewers there are, and then sent to each with
+ *      sendmmsg(), up to SPEC_BATCH viewers per call, from one buffer.
+ *      The only thing done per viewer is the kernel's copy, so a game can
+ *      be watched by thousands. A frame is one packet per SPEC_CHUNK balls
+ *      in play, each of which a viewer can use without the others.
+ *
+ *      Deltas: a ball moves at most a step each way per tick, so most
+ *      frames send, for each ball, which of the 9 ways it moved since the
+ *      frame before: 4 bits, two balls a byte. A ball that jumped (one
+ *      in play was taken out and the last put in its place, or a pass of
+ *      ticks ran several) has SPEC_ESCAPE, and its column and row follow
+ *      the 4 bit codes. Every KEY_EVERY frames, and whenever balls are
+ *      served, a key frame sends every column and row instead. (Balls
+ *      going out of play only shorten the arrays, so a delta still does.)
+ *      A viewer that missed a delta packet (or has just joined) only
+ *      misses those balls until the next key frame comes, about half a
+ *      second at most.
+ *
+ *      Packets are a SPEC_HEAD_LEN byte header (see spectate.h) and then
+ *      the balls, all numbers little-endian. With a thousand balls in
+ *      play, a delta frame is some 600 bytes, against 4000 for a key.
+ *
+ *      epoll: viewer traffic and the socket having room again come to one
+ *      epoll descriptor, which the main loop polls with everything else.
+ *      When the socket's buffer fills part way through a frame, the rest
+ *      is sent once there is room (EPOLLOUT), unless the next frame is
+ *      made first: the packets not sent are counted as dropped, and the
+ *      viewers left out wait for a key frame.
+ */
+
+/* INCLUDES */
+#define _GNU_SOURCE         // for sendmmsg()
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "clock.h"
+#include "court.h"
+#include "game.h"
+#include "paddle.h"
+#include "pong.h"
+#include "spectate.h"
+
+/* CONSTANTS */
+#define MAX_CHUNKS ((MAX_BALLS + SPEC_CHUNK - 1) / SPEC_CHUNK)
+#define MAX_VIEWERS 65536
+#define SPEC_BATCH 1024     // most messages the kernel takes in one call
+#define KEY_EVERY 25        // frames between key frames
+#define SWEEP_EVERY 64      // frames between looking for silent viewers
+#define VIEWER_TIMEOUT_US (5 * SPEC_WATCH_US)
+#define FIRST_VIEWERS 64    // room made for viewers at first
+#define SNDBUF_BYTES (4 << 20)      // socket buffer asked for, for bursts
+#define END_COPIES 3        // game over packets sent, in case some are lost
+
+/* SPECTATE STRUCT */
+struct ppspec {
+    int fd, ep;                 // the UDP socket, and the epoll set
+    int armed;                  // waiting on EPOLLOUT
+
+    struct sockaddr_in * addr;  // the viewers' addresses
+    uint32_t * heard;           // when each was last heard from
+    struct mmsghdr * msgs;      // one per viewer, all sending 'iov'
+    int count, cap;
+    int * slots;                // viewer + 1 by address hash; 0 free,
+    int nslots, tombs;          // or -1 for one dropped
+
+    unsigned char * out;        // this frame's packets, SPEC_MAX_PACKET apart
+    int lens[MAX_CHUNKS];
+    int chunks;
+    int next_chunk, next_viewer;    // how far fan_out() has got
+    struct iovec iov;           // the packet being sent
+
+    uint32_t seq;               // frames made
+    int * px, * py;             // where the balls were in the last frame
+    int prev_count, prev_cap;
+
+    struct spec_stats stats;
+};
+
+/*
+ * ===========================================================================
+ * INTERNAL FUNCTIONS
+ * ===========================================================================
+ */
+static uint32_t now_us();
+static void put16(unsigned char *, int);
+static void put32(unsigned char *, uint32_t);
+static uint32_t hash(const struct sockaddr_in *);
+static int * find_viewer(struct ppspec *, const struct sockaddr_in *);
+static void rehash(struct ppspec *, int);
+static void add_viewer(struct ppspec *, const struct sockaddr_in *);
+static void drop_viewer(struct ppspec *, int *);
+static void take_requests(struct ppspec *);
+static void encode(struct ppspec *, struct ppgame *);
+static void fan_out(struct ppspec *);
+static void arm(struct ppspec *, int);
+
+/*
+ *  now_us()
+ *  Purpose: Time the viewers, in microseconds
+ *   Return: the monotonic clock, cut to 32 bits (see net.c)
+ */
+uint32_t now_us()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) ((ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000));
+}
+
+/*
+ *  put16(), put32()
+ *  Purpose: Write numbers in a packet, low byte first
+ */
+void put16(unsigned char * p, int v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    return;
+}
+
+void put32(unsigned char * p, uint32_t v)
+{
+    put16(p, v & 0xffff);
+    put16(p + 2, v >> 16);
+    return;
+}
+
+/*
+ *  hash()
+ *  Purpose: Spread viewers' addresses over the address table
+ *   Return: a number to mask to the table's size
+ */
+uint32_t hash(const struct sockaddr_in * a)
+{
+    return (a->sin_addr.s_addr * 2654435761u) ^ (a->sin_port * 40503u);
+}
+
+/*
+ *  find_viewer()
+ *  Purpose: Look up a viewer by the address it sends from
+ *    Input: sp, the spectators
+ *           a, the address
+ *   Return: its slot in the table, holding its index + 1, or NULL if it
+ *           isn't watching
+ *   Method: Open addressing, stepping on past dropped slots (-1) until a
+ *           free one (0) shows the address isn't there.
+ */
+int * find_viewer(struct ppspec * sp, const struct sockaddr_in * a)
+{
+    int i, * s;
+
+    for(i = hash(a) & (sp->nslots - 1); sp->slots[i] != 0;
+        i = (i + 1) & (sp->nslots - 1))
+    {
+        s = &sp->slots[i];
+        if( *s > 0 && sp->addr[*s - 1].sin_addr.s_addr == a->sin_addr.s_addr &&
+            sp->addr[*s - 1].sin_port == a->sin_port )
+            return s;
+    }
+
+    return NULL;
+}
+
+/*
+ *  rehash()
+ *  Purpose: Rebuild the address table, with no dropped slots left in it
+ *    Input: sp, the spectators
+ *           nslots, the new size; a power of two, over twice 'count'
+ *    Error: If malloc fails, close curses, print a message and exit.
+ */
+void rehash(struct ppspec * sp, int nslots)
+{
+    int i, j, * slots = calloc(nslots, sizeof(int));
+
+    if(slots == NULL)
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Couldn't allocate memory for viewers.\n");
+        exit(1);
+    }
+
+    for(i = 0; i < sp->count; i++)
+    {
+        for(j = hash(&sp->addr[i]) & (nslots - 1); slots[j] != 0;
+            j = (j + 1) & (nslots - 1))
+            ;
+        slots[j] = i + 1;
+    }
+
+    free(sp->slots);
+    sp->slots = slots;
+    sp->nslots = nslots;
+    sp->tombs = 0;
+    return;
+}
+
+/*
+ *  add_viewer()
+ *  Purpose: Start sending frames to a viewer
+ *    Input: sp, the spectators
+ *           a, its address; not watching already
+ *     Note: Past MAX_VIEWERS, a viewer is turned away by being ignored.
+ *    Error: If malloc fails, close curses, print a message and exit.
+ */
+void add_viewer(struct ppspec * sp, const struct sockaddr_in * a)
+{
+    int i, cap = sp->cap;
+
+    if(sp->count == MAX_VIEWERS)
+        return;
+
+    if(sp->count == cap)                // room for twice as many
+    {
+        cap = (cap > 0) ? cap * 2 : FIRST_VIEWERS;
+        sp->addr = realloc(sp->addr, cap * sizeof(*sp->addr));
+        sp->heard = realloc(sp->heard, cap * sizeof(*sp->heard));
+        sp->msgs = realloc(sp->msgs, cap * sizeof(*sp->msgs));
+        if(sp->addr == NULL || sp->heard == NULL || sp->msgs == NULL)
+        {
+            wrap_up();
+            fprintf(stderr, "./pong: Couldn't allocate memory for viewers.\n");
+            exit(1);
+        }
+
+        memset(sp->msgs, 0, cap * sizeof(*sp->msgs));
+        for(i = 0; i < cap; i++)        // the addresses have moved
+        {
+            sp->msgs[i].msg_hdr.msg_name = &sp->addr[i];
+            sp->msgs[i].msg_hdr.msg_namelen = sizeof(*sp->addr);
+            sp->msgs[i].msg_hdr.msg_iov = &sp->iov;
+            sp->msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        sp->cap = cap;
+    }
+
+    if( (sp->count + 1 + sp->tombs) * 2 > sp->nslots )
+        rehash(sp, (sp->count + 1) * 4 > sp->nslots ? sp->nslots * 2
+                                                   : sp->nslots);
+
+    for(i = hash(a) & (sp->nslots - 1); sp->slots[i] > 0;
+        i = (i + 1) & (sp->nslots - 1))
+        ;
+    if(sp->slots[i] == -1)
+        sp->tombs--;
+
+    sp->addr[sp->count] = *a;
+    sp->heard[sp->count] = now_us();
+    sp->slots[i] = ++sp->count;
+
+    sp->stats.viewers = sp->count;
+    if(sp->count > sp->stats.most_viewers)
+        sp->stats.most_viewers = sp->count;
+    return;
+}
+
+/*
+ *  drop_viewer()
+ *  Purpose: Stop sending frames to a viewer
+ *    Input: sp, the spectators
+ *           s, its slot, from find_viewer()
+ *   Method: The last viewer takes its place in the arrays, so they stay
+ *           packed for sendmmsg(), and its slot is pointed at the new place.
+ */
+void drop_viewer(struct ppspec * sp, int * s)
+{
+    int i = *s - 1, last = sp->count - 1;
+
+    *s = -1;
+    sp->tombs++;
+
+    if(i != last)
+    {
+        sp->addr[i] = sp->addr[last];
+        sp->heard[i] = sp->heard[last];
+        sp->count--;
+        *find_viewer(sp, &sp->addr[i]) = i + 1;
+    }
+    else
+        sp->count--;
+
+    sp->stats.viewers = sp->count;
+    return;
+}
+
+/*
+ *  take_requests()
+ *  Purpose: Read everything the viewers have sent: joining, staying on,
+ *           or leaving
+ */
+void take_requests(struct ppspec * sp)
+{
+    unsigned char buf[SPEC_HEAD_LEN];
+    struct sockaddr_in from;
+    socklen_t flen;
+    int len, * s;
+
+    for(;;)
+    {
+        flen = sizeof(from);
+        len = recvfrom(sp->fd, buf, sizeof(buf), 0,
+                       (struct sockaddr *) &from, &flen);
+        if(len == -1)
+            break;
+
+        if( len < 4 || buf[0] != 'P' || buf[1] != 'S' ||
+            buf[2] != SPEC_VERSION || from.sin_family != AF_INET )
+            continue;
+
+        s = find_viewer(sp, &from);
+        if(buf[3] == SPEC_WATCH && s != NULL)
+            sp->heard[*s - 1] = now_us();
+        else if(buf[3] == SPEC_WATCH)
+            add_viewer(sp, &from);
+        else if(buf[3] == SPEC_LEAVE && s != NULL)
+            drop_viewer(sp, s);
+    }
+
+    return;
+}
+
+/*
+ *  encode()
+ *  Purpose: Turn where everything is into this frame's packets
+ *    Input: sp, the spectators
+ *           gp, the game
+ *   Method: The header is made once and copied to each packet. A key
+ *           packet then has each ball's column and row, two bytes each. A
+ *           delta packet has a 4 bit code for each (3 * (dx + 1) + dy + 1,
+ *           or SPEC_ESCAPE), then the column and row of each escaped one.
+ *    Error: If malloc fails, close curses, print a message and exit.
+ */
+void encode(struct ppspec * sp, struct ppgame * gp)
+{
+    struct ppcourt * court = game_court(gp);
+    const int * x, * y;
+    int count = game_ball_positions(gp, &x, &y);
+    int key = (sp->seq % KEY_EVERY == 0 || count > sp->prev_count);
+    int c, i, n, dx, dy, code, top, bot;
+    unsigned char * p, * esc;
+
+    sp->chunks = (count > 0) ? (count + SPEC_CHUNK - 1) / SPEC_CHUNK : 1;
+    p = sp->out;
+
+    p[0] = 'P';
+    p[1] = 'S';
+    p[2] = SPEC_VERSION;
+    put32(p + SPEC_AT_SEQ, sp->seq);
+    put16(p + SPEC_AT_COURT, get_top_edge(court));
+    put16(p + SPEC_AT_COURT + 2, get_right_edge(court));
+    put16(p + SPEC_AT_COURT + 4, get_bot_edge(court));
+    put16(p + SPEC_AT_COURT + 6, get_left_edge(court));
+    put16(p + SPEC_AT_MINS, get_mins(game_clock(gp)));
+    p[SPEC_AT_SECS] = get_secs(game_clock(gp));
+    p[SPEC_AT_LIVES] = game_balls_left(gp);
+    for(i = 0; i < 2; i++)
+    {
+        if( game_paddle_rows(gp, (i == 0) ? RIGHT_SIDE : LEFT_SIDE,
+                             &top, &bot) == -1 )
+            top = bot = SPEC_NO_PAD;
+        put16(p + SPEC_AT_PADS + (i * 4), top);
+        put16(p + SPEC_AT_PADS + (i * 4) + 2, bot);
+    }
+    put32(p + SPEC_AT_COUNT, count);
+
+    for(c = 0; c < sp->chunks; c++)
+    {
+        p = sp->out + (c * SPEC_MAX_PACKET);
+        if(c > 0)
+            memcpy(p, sp->out, SPEC_HEAD_LEN);
+
+        n = (count - (c * SPEC_CHUNK) < SPEC_CHUNK) ? count - (c * SPEC_CHUNK)
+                                                    : SPEC_CHUNK;
+        p[3] = key ? SPEC_KEY : SPEC_DELTA;
+        put32(p + SPEC_AT_FIRST, c * SPEC_CHUNK);
+        put16(p + SPEC_AT_N, n);
+
+        esc = p + SPEC_HEAD_LEN;
+        if(!key)                        // codes first, escapes after
+        {
+            memset(esc, 0, (n + 1) / 2);
+            esc += (n + 1) / 2;
+        }
+
+        for(i = c * SPEC_CHUNK; i < (c * SPEC_CHUNK) + n; i++)
+        {
+            dx = x[i] - (key ? 0 : sp->px[i]);
+            dy = y[i] - (key ? 0 : sp->py[i]);
+            code = (!key && dx >= -1 && dx <= 1 && dy >= -1 && dy <= 1) ?
+                   (3 * (dx + 1)) + dy + 1 : SPEC_ESCAPE;
+
+            if(!key)                    // two to a byte, low half first
+                p[SPEC_HEAD_LEN + ((i - (c * SPEC_CHUNK)) / 2)] |=
+                    code << (4 * ((i - (c * SPEC_CHUNK)) & 1));
+            if(code == SPEC_ESCAPE)
+            {
+                put16(esc, x[i]);
+                put16(esc + 2, y[i]);
+                esc += 4;
+            }
+        }
+        sp->lens[c] = esc - p;
+    }
+
+    if(count > sp->prev_cap)            // remember them for the next delta
+    {
+        sp->prev_cap = count;
+        sp->px = realloc(sp->px, count * sizeof(int));
+        sp->py = realloc(sp->py, count * sizeof(int));
+        if(sp->px == NULL || sp->py == NULL)
+        {
+            wrap_up();
+            fprintf(stderr, "./pong: Couldn't allocate memory for viewers.\n");
+            exit(1);
+        }
+    }
+    memcpy(sp->px, x, count * sizeof(int));
+    memcpy(sp->py, y, count * sizeof(int));
+    sp->prev_count = count;
+
+    sp->seq++;
+    sp->stats.frames++;
+    sp->stats.keys += key;
+    return;
+}
+
+/*
+ *  fan_out()
+ *  Purpose: Send this frame's packets to every viewer, or as many as the
+ *           socket has room for
+ *   Method: Packet by packet, point the shared iovec at it and hand the
+ *           kernel SPEC_BATCH viewers at a time. If the socket fills, note
+ *           how far it got and wait for EPOLLOUT. A viewer the packet
+ *           can't go to at all is skipped.
+ */
+void fan_out(struct ppspec * sp)
+{
+    int n, r;
+
+    for( ; sp->next_chunk < sp->chunks; sp->next_chunk++, sp->next_viewer = 0)
+    {
+        sp->iov.iov_base = sp->out + (sp->next_chunk * SPEC_MAX_PACKET);
+        sp->iov.iov_len = sp->lens[sp->next_chunk];
+
+        while(sp->next_viewer < sp->count)
+        {
+            n = sp->count - sp->next_viewer;
+            if(n > SPEC_BATCH)
+                n = SPEC_BATCH;
+
+            r = sendmmsg(sp->fd, sp->msgs + sp->next_viewer, n, 0);
+            sp->stats.syscalls++;
+
+            if(r == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                arm(sp, 1);
+                return;
+            }
+            else if(r == -1)
+            {
+                sp->stats.dropped++;
+                r = 1;
+            }
+            else
+            {
+                sp->stats.packets += r;
+                sp->stats.bytes += (long) r * sp->iov.iov_len;
+            }
+            sp->next_viewer += r;
+        }
+    }
+
+    arm(sp, 0);
+    return;
+}
+
+/*
+ *  arm()
+ *  Purpose: Ask epoll to say when the socket has room again, or stop
+ *    Input: sp, the spectators
+ *           on, 1 to wait for room, 0 not to
+ */
+void arm(struct ppspec * sp, int on)
+{
+    struct epoll_event ev;
+
+    if(sp->armed == on)
+        return;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | (on ? EPOLLOUT : 0);
+    epoll_ctl(sp->ep, EPOLL_CTL_MOD, sp->fd, &ev);
+    sp->armed = on;
+    return;
+}
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  new_spec()
+ *  Purpose: Take viewers for the game on a UDP port
+ *    Input: port, the port
+ *   Return: a pointer to the spectators, with none yet
+ *    Error: If the port can't be used or malloc fails, close curses,
+ *           print a message and exit.
+ */
+struct ppspec * new_spec(const char * port)
+{
+    struct ppspec * sp = calloc(1, sizeof(struct ppspec));
+    struct sockaddr_in addr;
+    struct epoll_event ev;
+    int size = SNDBUF_BYTES;
+
+    if(sp == NULL || (sp->out = malloc(MAX_CHUNKS * SPEC_MAX_PACKET)) == NULL)
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Couldn't allocate memory for viewers.\n");
+        exit(1);
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(atoi(port));
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+
+    sp->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sp->ep = epoll_create1(0);
+    if( sp->fd == -1 || sp->ep == -1 || addr.sin_port == 0 ||
+        bind(sp->fd, (struct sockaddr *) &addr, sizeof(addr)) == -1 ||
+        epoll_ctl(sp->ep, EPOLL_CTL_ADD, sp->fd, &ev) == -1 )
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Can't take viewers on port %s: %s\n", port,
+                        strerror(errno));
+        exit(1);
+    }
+
+    fcntl(sp->fd, F_SETFL, O_NONBLOCK);
+    setsockopt(sp->fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    rehash(sp, FIRST_VIEWERS * 2);
+    return sp;
+}
+
+/*
+ *  spec_fd()
+ *  Purpose: Give the epoll descriptor, for the main loop to poll() on; it
+ *           is readable when spec_service() has something to do
+ */
+int spec_fd(struct ppspec * sp)
+{
+    return sp->ep;
+}
+
+/*
+ *  spec_service()
+ *  Purpose: Take in viewers joining, staying on and leaving, and send the
+ *           rest of a frame the socket had no room for
+ */
+void spec_service(struct ppspec * sp)
+{
+    struct epoll_event ev;
+
+    if(epoll_wait(sp->ep, &ev, 1, 0) != 1)
+        return;
+
+    if(ev.events & EPOLLIN)
+        take_requests(sp);
+    if(ev.events & EPOLLOUT)
+        fan_out(sp);
+
+    return;
+}
+
+/*
+ *  spec_publish()
+ *  Purpose: Send every viewer where everything in the game is now
+ *    Input: sp, the spectators
+ *           gp, the game
+ *     Note: Every SWEEP_EVERY frames, viewers that have gone quiet are
+ *           dropped first.
+ */
+void spec_publish(struct ppspec * sp, struct ppgame * gp)
+{
+    uint32_t t = now_us();
+    int i;
+
+    if(sp->next_chunk < sp->chunks)     // the last frame never all went
+        sp->stats.dropped += ((long) (sp->chunks - sp->next_chunk) *
+                              sp->count) - sp->next_viewer;
+
+    if(sp->seq % SWEEP_EVERY == 0)
+        for(i = sp->count - 1; i >= 0; i--)
+            if(t - sp->heard[i] > VIEWER_TIMEOUT_US)
+                drop_viewer(sp, find_viewer(sp, &sp->addr[i]));
+
+    encode(sp, gp);
+    sp->next_chunk = 0;
+    sp->next_viewer = 0;
+    fan_out(sp);
+    return;
+}
+
+/*
+ *  spec_get_stats()
+ *  Purpose: Report what serving the viewers has cost
+ */
+void spec_get_stats(struct ppspec * sp, struct spec_stats * st)
+{
+    *st = sp->stats;
+    return;
+}
+
+/*
+ *  spec_close()
+ *  Purpose: Tell the viewers the game is over, and free the spectators
+ *    Input: sp, the spectators; NULL is ignored
+ *     Note: The game over packet is the header of the last frame, so it
+ *           has the final time and balls left. It is sent as far as the
+ *           socket has room, without waiting.
+ */
+void spec_close(struct ppspec * sp)
+{
+    int i, n;
+
+    if(sp == NULL)
+        return;
+
+    if(sp->seq > 0)
+    {
+        sp->out[3] = SPEC_END;
+        put16(sp->out + SPEC_AT_N, 0);
+        sp->iov.iov_base = sp->out;
+        sp->iov.iov_len = SPEC_HEAD_LEN;
+
+        for(i = 0; i < END_COPIES; i++)
+            for(n = 0; n < sp->count; n += SPEC_BATCH)
+                sendmmsg(sp->fd, sp->msgs + n, (sp->count - n < SPEC_BATCH) ?
+                         sp->count - n : SPEC_BATCH, 0);
+    }
+
+    close(sp->ep);
+    close(sp->fd);
+    free(sp->addr);
+    free(sp->heard);
+    free(sp->msgs);
+    free(sp->slots);
+    free(sp->out);
+    free(sp->px);
+    free(sp->py);
+    free(sp);
+    return;
+}
@@ -0,0 +1,56 @@
+/*
+ * ==========================
+ *   FILE: ./spectate.h
+ * ==========================
+ * Purpose: Header file for spectate.c, and the packets it shares with
+ *          watch.c
+ */
+
+/* CONSTANTS */
+#define SPEC_VERSION 1
+#define SPEC_WATCH 1        // viewer to game: watching, or still watching
+#define SPEC_LEAVE 2        // viewer to game: stopped watching
+#define SPEC_KEY 3          // game to viewer: where some balls are
+#define SPEC_DELTA 4        // game to viewer: how far they moved since
+#define SPEC_END 5          // game to viewer: the game is over
+
+#define SPEC_AT_SEQ 4       // u32, frame number
+#define SPEC_AT_COURT 8     // u16 x 4, top, right, bot and left edges
+#define SPEC_AT_MINS 16     // u16, the clock
+#define SPEC_AT_SECS 18     // u8
+#define SPEC_AT_LIVES 19    // u8, balls left
+#define SPEC_AT_PADS 20     // u16 x 4, top and bottom rows of the right
+                            // paddle, then the left (SPEC_NO_PAD if none)
+#define SPEC_AT_COUNT 28    // u32, balls in play
+#define SPEC_AT_FIRST 32    // u32, first ball in this packet
+#define SPEC_AT_N 36        // u16, balls in this packet
+#define SPEC_HEAD_LEN 38    // then the balls (see spectate.c)
+
+#define SPEC_CHUNK 300      // most balls in one packet
+#define SPEC_MAX_PACKET (SPEC_HEAD_LEN + (SPEC_CHUNK + 1) / 2 \
+                         + SPEC_CHUNK * 4)    // a delta, every ball escaped
+#define SPEC_ESCAPE 15      // a ball that moved more than one step
+#define SPEC_NO_PAD 0xffff
+#define SPEC_WATCH_US 1000000       // how often a viewer says it is there
+
+/* STRUCTS */
+struct spec_stats {         // what serving the viewers has cost
+    long viewers;           // watching now
+    long most_viewers;
+    long frames, keys;      // frames made; of those, key frames
+    long packets, bytes;    // sent, to all viewers together
+    long syscalls;          // sendmmsg() calls it took
+    long dropped;           // packets not sent: the socket was full
+};
+
+/* OPAQUE STRUCTS */
+struct ppgame;
+struct ppspec;
+
+/* EXTERNAL INTERFACE */
+struct ppspec * new_spec(const char *);
+int spec_fd(struct ppspec *);
+void spec_service(struct ppspec *);
+void spec_publish(struct ppspec *, struct ppgame *);
+void spec_get_stats(struct ppspec *, struct spec_stats *);
+void spec_close(struct ppspec *);
\ No newline at end of file
@@ -0,0 +1,396 @@
+/*
+ * ==========================================================================
+ *   FILE: ./sweep.c
+ * ==========================================================================
+ * Purpose: Play the same batch of games over a grid of settings, to tune
+ *          how hard the game is.
+ *
+ * Outline: pong-sweep takes a list of values for each setting: the size
+ *          of the pretend terminal (-H, -W), the balls per serve (-b), the
+ *          slowest ball speed (-d, ticks a cell; MAX_DELAY in pong), the
+ *          paddle's size (-s, 1/n of the court; a third in pong), the tick
+ *          rate (-t) and the computer player's skill (-p). Each list is
+ *          values with commas between, as in -d 6,8,10,12. Every
+ *          combination is played as one run of the same games (-g) with
+ *          the computer player (see autoplay.c), and gets one row of a
+ *          table: how long the games lasted (the mean, and the median,
+ *          90th and 99th percentiles), how many hit the cap (-m, in
+ *          seconds of play), and how many times the paddle sent each ball
+ *          back before it was lost. -c prints CSV instead.
+ *
+ * Workers: The runs are played one after another on one pool of worker
+ *          threads (-j, by default one per online CPU; see pool.c), which
+ *          is started once for the whole sweep: between runs the workers
+ *          wait, keeping their arenas, and the settings for the next run
+ *          are made then. Each game's length is written to its own slot of
+ *          one array, so the percentiles come from every game and the
+ *          workers never share anything but the game count.
+ *
+ *   Seeds: Every run plays its games from the same seed (-r), so two rows
+ *          differ only by their settings, not by luck. Rows are the same
+ *          every time for the same seed, as in pong-headless.
+ *
+ *    Note: The balls' speeds and the player's chance of moving are both
+ *          per tick, so the tick rate doesn't change how a game plays out
+ *          in ticks, only how long that is in seconds: a faster game for
+ *          someone at the keyboard.
+ *
+ * Interface:
+ *      wrap_up()       -- called by the game objects on fatal errors
+ *
+ * Internal functions:
+ *      main()          -- play every combination of settings, report each
+ *      get_options()   -- read settings from the command line
+ *      get_list()      -- read a list of values for one setting
+ *      usage()         -- print a usage message and exit
+ *      report()        -- print one run's row
+ *      cmp_long()      -- order game lengths for qsort()
+ *      now()           -- seconds on the monotonic clock
+ */
+
+/* INCLUDES */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "autoplay.h"
+#include "ball.h"
+#include "ball_kernel.h"
+#include "clock.h"
+#include "court.h"
+#include "paddle.h"
+#include "pong.h"
+#include "pool.h"
+#include "preset.h"
+
+/* CONSTANTS */
+#define DFL_GAMES 1000      // games per run
+#define DFL_LINES 24        // size of the pretend terminal
+#define DFL_COLS 80
+#define DFL_SKILL 50        // % chance per tick the paddle moves
+#define DFL_MAX_SECS (60 * 60)  // an hour of play
+#define MAX_VALUES 32       // most values in one list
+#define NUM_LISTS 7
+
+/* STRUCTS */
+struct list {
+    int n;                  // values in the list
+    int v[MAX_VALUES];
+};
+
+/* LOCAL VARIABLES -- SETTINGS */
+static int games = DFL_GAMES;
+static int workers = 0;             // 0 until set: one per online CPU
+static long max_secs = DFL_MAX_SECS;
+static int predict = 0;
+static int csv = 0;
+static uint64_t seed;
+
+/* LOCAL VARIABLES -- THE GRID, LAST VARYING FASTEST */
+static struct list lists[NUM_LISTS] = {
+    { 1, { DFL_LINES } },
+    { 1, { DFL_COLS } },
+    { 1, { 1 } },               // balls
+    { 1, { MAX_DELAY } },
+    { 1, { PADDLE_SIZE } },
+    { 1, { TICKS_PER_SEC } },
+    { 1, { DFL_SKILL } }
+};
+
+enum { LINES, COLS, BALLS, DELAY, PADDLE, RATE, SKILL };
+
+/*
+ * ===========================================================================
+ * INTERNAL FUNCTIONS
+ * ===========================================================================
+ */
+static void get_options(int, char **);
+static int get_list(struct list *, const char *, int, int);
+static void usage(const char *);
+static void report(const struct autoplay *, const int *,
+                   const struct autoplay_totals *, long *);
+static int cmp_long(const void *, const void *);
+static double now();
+
+/*
+ *  main()
+ *  Purpose: Play a run of games for every combination of settings, and
+ *           print a row for each
+ *    Input: argc, argv, the command line (see get_options())
+ *   Return: 0 on success, exit non-zero on error
+ *   Method: Run k takes, from each list, value k / (the product of the
+ *           lengths of the lists after it) % its own length, so the last
+ *           list (the skill) varies fastest and the first (the lines)
+ *           slowest. The ball and paddle settings are process-wide, so
+ *           they are made between runs, while the pool is idle.
+ */
+int main (int argc, char * argv[])
+{
+    struct autoplay_totals totals, all = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    struct autoplay ap;
+    struct pppool * pool;
+    long * secs;
+    double start, wall;
+    int runs = 1, k, i, div, v[NUM_LISTS];
+
+    seed = getpid();
+    get_options(argc, argv);
+
+    for(i = 0; i < NUM_LISTS; i++)
+        runs *= lists[i].n;
+
+    secs = malloc(games * sizeof(long));
+    if(secs == NULL)
+    {
+        fprintf(stderr, "%s: Couldn't allocate memory for the results.\n",
+                        argv[0]);
+        exit(1);
+    }
+
+    if(csv)
+        printf("lines,cols,balls,delay,paddle,rate,skill,player,games,"
+               "capped,mean_secs,p50_secs,p90_secs,p99_secs,"
+               "returns_per_ball\n");
+    else
+        printf("%5s %5s %5s %5s %6s %5s %5s %7s %7s %8s %6s %6s %6s "
+               "%8s\n", "lines", "cols", "balls", "delay", "paddle", "rate",
+               "skill", "games", "capped", "mean", "p50", "p90", "p99",
+               "returns");
+
+    pool = new_pool(workers);
+    start = now();
+    for(k = 0; k < runs; k++)
+    {
+        for(i = NUM_LISTS - 1, div = 1; i >= 0; div *= lists[i].n, i--)
+            v[i] = lists[i].v[(k / div) % lists[i].n];
+
+        ap.lines = v[LINES];
+        ap.cols = v[COLS];
+        ap.balls = v[BALLS];
+        ap.skill = v[SKILL];
+        ap.predict = predict;
+        ap.tick_rate = v[RATE];
+        ap.max_ticks = max_secs * v[RATE];
+        ap.seed = seed;
+        ball_use_delay(v[DELAY]);
+        paddle_use_size(v[PADDLE]);
+
+        pool_run(pool, &ap, games, &totals, secs);
+        report(&ap, v, &totals, secs);
+        autoplay_merge(&all, &totals);
+    }
+    wall = now() - start;
+    if(wall < 0.000001)
+        wall = 0.000001;
+    pool_free(pool);
+
+    if(!csv)
+        printf("runs: %d  games: %ld  ticks: %ld in %.3fs (%.0f ticks/sec)"
+               "  workers: %d  %s kernel\n", runs, all.games, all.ticks,
+               wall, all.ticks / wall, workers, ball_kernel_name());
+
+    free(secs);
+    return 0;
+}
+
+/*
+ *  get_options()
+ *  Purpose: Read settings from the command line
+ *    Input: argc, argv, as passed to main()
+ *   Method: Lists of values for -H and -W, the size of the pretend
+ *           terminal, -b balls per serve, -d the slowest speed, in ticks a
+ *           cell (DELAY_LEAST to DELAY_LIMIT), -s the paddle's size, as
+ *           1/s of the court, -t ticks per second and -p the player's
+ *           skill; then -g games per run, -j the number of worker
+ *           threads, -m the most seconds of play any one game may run, -r
+ *           (or --seed) the seed, -k the ball kernel, -G the generic tick,
+ *           -i the player that predicts where the ball will be, and -c for
+ *           CSV.
+ *    Error: On an unknown option or a bad value, or a kernel this CPU can't
+ *           run, print a usage message and exit.
+ */
+void get_options(int argc, char * argv[])
+{
+    static const struct option longopts[] = {
+        { "seed", required_argument, NULL, 'r' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt, bad = 0;
+
+    while( (opt = getopt_long(argc, argv, "H:W:b:d:s:t:p:g:j:m:r:k:Gic",
+                              longopts, NULL)) != -1 )
+    {
+        if(opt == 'H')
+            bad |= get_list(&lists[LINES], optarg, MIN_LINES, 10000);
+        else if(opt == 'W')
+            bad |= get_list(&lists[COLS], optarg, MIN_COLS, 10000);
+        else if(opt == 'b')
+            bad |= get_list(&lists[BALLS], optarg, 1, MAX_BALLS);
+        else if(opt == 'd')
+            bad |= get_list(&lists[DELAY], optarg, DELAY_LEAST,
+                            DELAY_LIMIT);
+        else if(opt == 's')
+            bad |= get_list(&lists[PADDLE], optarg, 1, 1000);
+        else if(opt == 't')
+            bad |= get_list(&lists[RATE], optarg, 1, 10000);
+        else if(opt == 'p')
+            bad |= get_list(&lists[SKILL], optarg, 0, 100);
+        else if(opt == 'g')
+            games = atoi(optarg);
+        else if(opt == 'j')
+            workers = atoi(optarg);
+        else if(opt == 'm')
+            max_secs = atol(optarg);
+        else if(opt == 'r')
+            seed = strtoull(optarg, NULL, 0);
+        else if(opt == 'k')
+            bad |= (ball_kernel_use(optarg) == -1);
+        else if(opt == 'G')
+            preset_use(0);
+        else if(opt == 'i')
+            predict = 1;
+        else if(opt == 'c')
+            csv = 1;
+        else
+            bad = 1;
+    }
+
+    if(workers == 0)
+        workers = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if(workers > games)
+        workers = games;
+
+    if( bad || optind < argc || games < 1 || max_secs < 1 ||
+        workers < 1 || workers > MAX_WORKERS )
+        usage(argv[0]);
+
+    return;
+}
+
+/*
+ *  get_list()
+ *  Purpose: Read a list of values, with commas between, for one setting
+ *    Input: lp, the list to fill in; what was in it is replaced
+ *           arg, the values
+ *           lo, hi, the least and most any value may be
+ *   Return: 0, or 1 if a value isn't a number from lo to hi, or there
+ *           are more than MAX_VALUES of them
+ */
+int get_list(struct list * lp, const char * arg, int lo, int hi)
+{
+    char * end;
+    long n;
+
+    lp->n = 0;
+    do
+    {
+        n = strtol(arg, &end, 10);
+        if(end == arg || n < lo || n > hi || lp->n == MAX_VALUES ||
+           (*end != ',' && *end != '\0'))
+            return 1;
+
+        lp->v[lp->n++] = (int) n;
+        arg = end + 1;
+    }
+    while(*end == ',');
+
+    return 0;
+}
+
+/*
+ *  usage()
+ *  Purpose: Print a usage message and exit
+ *    Input: name, the program's name
+ */
+void usage(const char * name)
+{
+    fprintf(stderr, "usage: %s [-H lines,...] [-W cols,...] [-b balls,...] "
+                    "[-d delay,...]\n"
+                    "       [-s paddle,...] [-t ticks_per_sec,...] "
+                    "[-p skill%%,...] [-g games]\n"
+                    "       [-j workers] [-m max_secs] [-r seed] "
+                    "[-k kernel] [-G] [-i] [-c]\n", name);
+    fprintf(stderr, "       (kernels: %s; delays: %d to %d)\n",
+            KERNEL_NAMES, DELAY_LEAST, DELAY_LIMIT);
+    fprintf(stderr, "       (court must be at least %dx%d)\n",
+                    MIN_COLS, MIN_LINES);
+    exit(2);
+}
+
+/*
+ *  report()
+ *  Purpose: Print one run's row, in the table or as a CSV line
+ *    Input: ap, the settings the run was played with
+ *           v, the value it took from each list
+ *           tp, what its games added up to
+ *           secs, how long each game lasted; sorted here
+ */
+void report(const struct autoplay * ap, const int * v,
+            const struct autoplay_totals * tp, long * secs)
+{
+    double mean = (double) tp->secs / games;
+    double returns = (tp->served > 0) ? (double) tp->hits / tp->served : 0;
+    long p50, p90, p99;
+
+    qsort(secs, games, sizeof(long), cmp_long);
+    p50 = secs[games / 2];
+    p90 = secs[(int) ((games - 1) * 0.90)];
+    p99 = secs[(int) ((games - 1) * 0.99)];
+
+    if(csv)
+        printf("%d,%d,%d,%d,%d,%d,%d,%s,%ld,%ld,%.1f,%ld,%ld,%ld,%.2f\n",
+               v[LINES], v[COLS], v[BALLS], v[DELAY], v[PADDLE], v[RATE],
+               v[SKILL], ap->predict ? "predict" : "chase", tp->games,
+               tp->capped, mean, p50, p90, p99, returns);
+    else
+        printf("%5d %5d %5d %5d %6d %5d %5d %7ld %7ld %8.1f %6ld %6ld "
+               "%6ld %8.2f\n", v[LINES], v[COLS], v[BALLS], v[DELAY],
+               v[PADDLE], v[RATE], v[SKILL], tp->games, tp->capped, mean,
+               p50, p90, p99, returns);
+    fflush(stdout);
+
+    return;
+}
+
+/*
+ *  cmp_long()
+ *  Purpose: Order two game lengths, for qsort()
+ */
+int cmp_long(const void * a, const void * b)
+{
+    long x = *(const long *) a, y = *(const long *) b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+ *  now()
+ *  Purpose: Read the monotonic clock
+ *   Return: the time in seconds, from some fixed point in the past
+ */
+double now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  wrap_up()
+ *  Purpose: Get ready for a fatal error to exit
+ *     Note: The game objects call this when they can't allocate memory.
+ *           Other workers may still be playing, so nothing is freed here;
+ *           the process is about to exit.
+ */
+void wrap_up()
+{
+    return;
+}
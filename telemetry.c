@@ -0,0 +1,511 @@
+/*
+ * ===========================================================================
+ *   FILE: ./telemetry.c
+ * ===========================================================================
+ * Purpose: Measure how smoothly the game really runs: when its ticks ran
+ *          against when they were due, and what the ticks, the frames and
+ *          the trip from a key to the screen cost.
+ *
+ * Interface:
+ *      new_telem()         -- start measuring, and exporting to a file
+ *      telem_now()         -- the monotonic clock in nanoseconds
+ *      telem_input()       -- a paddle key was read
+ *      telem_ticks()       -- a pass of ticks has run
+ *      telem_frame()       -- a frame has gone to the terminal
+ *      telem_drain()       -- take the samples out of the ring
+ *      telem_hud()         -- a line about the last second, to show
+ *      telem_get_stats()   -- sum up the whole game
+ *      telem_close()       -- finish the export, and free
+ *
+ * Internal functions:
+ *      push()              -- put a sample in the ring
+ *      fold()              -- add a sample to the sums, the line and the file
+ *      write_sample()      -- add one to the export
+ *      add_hist()          -- count a time in a histogram
+ *      percentile()        -- read a percentile back out of one
+ *
+ * Notes:
+ *      The main loop times each pass of ticks and each frame, and hands
+ *      them over as samples: a pass has when it started, how late its
+ *      first tick was against the schedule (its jitter, from
+ *      ticker_late()), how many ticks it ran and how long they took, and a
+ *      frame has how long it took to draw and flush. A paddle key is
+ *      stamped when it is read; it is made in the next pass of ticks, and
+ *      seen on the screen at the end of the frame after that, which is
+ *      when its input-to-photon lag is taken. Each tick of a pass was due
+ *      one tick period after the one before it, so any tick's own
+ *      timestamp follows from the pass's.
+ *
+ *      Ring: samples go into a ring of RING_SIZE, with one writer (the
+ *      main loop) and one reader (telem_drain()). The writer only moves
+ *      the head and the reader only the tail, each published with a
+ *      release store and read by the other with an acquire load, so no
+ *      lock is needed if the two are ever on different threads. A sample
+ *      that finds the ring full is dropped and counted, rather than make
+ *      the game wait. pong drains it every frame.
+ *
+ *      Drained samples go into histograms (HIST_NS wide buckets) for the
+ *      percentiles at the end, into the sums for the line shown on the
+ *      court (with -D), which is redone every second, and, if a file was
+ *      given, out to it: CSV, or JSON if its name ends in .json, with the
+ *      summary at the end.
+ */
+
+/* INCLUDES */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pong.h"
+#include "telemetry.h"
+
+/* CONSTANTS */
+#define RING_SIZE 4096              // samples not yet drained (power of 2)
+#define HIST_NS 10000               // histogram buckets are 10 us wide
+#define HIST_BUCKETS 10000          // 100 ms; the last holds all above
+#define HUD_LEN 48
+#define NS_PER_SEC 1000000000LL
+#define NS_PER_MS 1e6
+
+#define TICKS 0                     // kinds of sample
+#define FRAME 1
+#define LATE 0                      // histograms
+#define RENDER 1
+#define LAG 2
+
+/* STRUCTS */
+struct sample {
+    long long t;            // when it started, on the monotonic clock
+    long long late;         // TICKS: how late the first tick ran
+    long long work;         // how long the ticks, or the frame, took
+    long long lag;          // FRAME: key to screen, or -1 if no key
+    int kind;
+    int ticks;              // TICKS: how many ran
+};
+
+/* TELEMETRY STRUCT */
+struct pptelem {
+    // the ring
+    struct sample ring[RING_SIZE];
+    unsigned head;          // next to write; only push() moves it
+    unsigned tail;          // next to read; only telem_drain() moves it
+    long dropped;
+
+    // the writer's own: keys not on the screen yet
+    long long key_at;       // first key read since the last pass, or 0
+    long long made_at;      // first key made since the last frame, or 0
+
+    // the reader's own
+    long long start;        // the first sample's time, 0 in the export
+    FILE * out;             // the export, or NULL
+    int json;
+    long written;           // samples in it
+
+    // the last second, and the line made of the one before
+    long long win_start, win_late, win_sim, win_render, win_lag;
+    long win_ticks, win_frames;
+    char hud[HUD_LEN];
+
+    // the whole game
+    long passes, ticks, frames, inputs;
+    long long late_max, sim_total, sim_max;
+    long long render_total, render_max, lag_total, lag_max;
+    unsigned hist[3][HIST_BUCKETS];
+};
+
+/*
+ * ===========================================================================
+ * INTERNAL FUNCTIONS
+ * ===========================================================================
+ */
+static void push(struct pptelem *, const struct sample *);
+static void fold(struct pptelem *, const struct sample *);
+static void write_sample(struct pptelem *, const struct sample *);
+static void add_hist(unsigned *, long long);
+static double percentile(const unsigned *, long, double, long long);
+
+/*
+ *  push()
+ *  Purpose: Hand a sample to the reader
+ *    Input: tp, the telemetry
+ *           sp, the sample
+ *   Method: The slot is filled before the new head is published, so the
+ *           reader never sees a half-written sample.
+ */
+void push(struct pptelem * tp, const struct sample * sp)
+{
+    unsigned head = tp->head;
+
+    if(head - __atomic_load_n(&tp->tail, __ATOMIC_ACQUIRE) == RING_SIZE)
+    {
+        __atomic_fetch_add(&tp->dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    tp->ring[head & (RING_SIZE - 1)] = *sp;
+    __atomic_store_n(&tp->head, head + 1, __ATOMIC_RELEASE);
+    return;
+}
+
+/*
+ *  fold()
+ *  Purpose: Add one drained sample to everything made from them
+ *    Input: tp, the telemetry
+ *           sp, the sample
+ *     Note: The line for the court is made from the samples of a whole
+ *           second when the first sample after it comes in, so it says
+ *           the same thing for a second at a time.
+ */
+void fold(struct pptelem * tp, const struct sample * sp)
+{
+    char lag[16] = "-";
+
+    if(tp->start == 0)
+        tp->start = tp->win_start = sp->t;
+
+    if(sp->t - tp->win_start >= NS_PER_SEC)
+    {
+        if(tp->win_lag > 0)
+            snprintf(lag, sizeof(lag), "%.0f", tp->win_lag / NS_PER_MS);
+        snprintf(tp->hud, HUD_LEN, "jit %.1f sim %.2f drw %.2f lag %s ms",
+                 tp->win_late / NS_PER_MS,
+                 tp->win_ticks ? tp->win_sim / NS_PER_MS / tp->win_ticks : 0,
+                 tp->win_frames ? tp->win_render / NS_PER_MS / tp->win_frames
+                                : 0, lag);
+        tp->win_start = sp->t;
+        tp->win_late = tp->win_sim = tp->win_render = tp->win_lag = 0;
+        tp->win_ticks = tp->win_frames = 0;
+    }
+
+    if(sp->kind == TICKS)
+    {
+        tp->passes++;
+        tp->ticks += sp->ticks;
+        tp->sim_total += sp->work;
+        if(sp->work > tp->sim_max)
+            tp->sim_max = sp->work;
+        if(sp->late > tp->late_max)
+            tp->late_max = sp->late;
+        add_hist(tp->hist[LATE], sp->late);
+
+        tp->win_ticks += sp->ticks;
+        tp->win_sim += sp->work;
+        if(sp->late > tp->win_late)
+            tp->win_late = sp->late;
+    }
+    else
+    {
+        tp->frames++;
+        tp->render_total += sp->work;
+        if(sp->work > tp->render_max)
+            tp->render_max = sp->work;
+        add_hist(tp->hist[RENDER], sp->work);
+
+        tp->win_frames++;
+        tp->win_render += sp->work;
+
+        if(sp->lag >= 0)
+        {
+            tp->inputs++;
+            tp->lag_total += sp->lag;
+            if(sp->lag > tp->lag_max)
+                tp->lag_max = sp->lag;
+            add_hist(tp->hist[LAG], sp->lag);
+            if(sp->lag > tp->win_lag)
+                tp->win_lag = sp->lag;
+        }
+    }
+
+    if(tp->out != NULL)
+        write_sample(tp, sp);
+
+    return;
+}
+
+/*
+ *  write_sample()
+ *  Purpose: Add one sample to the export
+ *    Input: tp, the telemetry, with a file open
+ *           sp, the sample
+ *     Note: Times are in nanoseconds, from the first sample. A CSV line
+ *           leaves empty what a kind of sample doesn't have; a JSON object
+ *           leaves it out.
+ */
+void write_sample(struct pptelem * tp, const struct sample * sp)
+{
+    long long t = sp->t - tp->start;
+
+    if(!tp->json && sp->kind == TICKS)
+        fprintf(tp->out, "ticks,%lld,%d,%lld,%lld,,\n", t, sp->ticks,
+                sp->late, sp->work);
+    else if(!tp->json && sp->lag < 0)
+        fprintf(tp->out, "frame,%lld,,,,%lld,\n", t, sp->work);
+    else if(!tp->json)
+        fprintf(tp->out, "frame,%lld,,,,%lld,%lld\n", t, sp->work, sp->lag);
+    else if(sp->kind == TICKS)
+        fprintf(tp->out, "%s\n{\"kind\":\"ticks\",\"time_ns\":%lld,"
+                "\"ticks\":%d,\"late_ns\":%lld,\"sim_ns\":%lld}",
+                tp->written ? "," : "", t, sp->ticks, sp->late, sp->work);
+    else
+    {
+        fprintf(tp->out, "%s\n{\"kind\":\"frame\",\"time_ns\":%lld,"
+                "\"render_ns\":%lld", tp->written ? "," : "", t, sp->work);
+        if(sp->lag >= 0)
+            fprintf(tp->out, ",\"lag_ns\":%lld", sp->lag);
+        fputc('}', tp->out);
+    }
+
+    tp->written++;
+    return;
+}
+
+/*
+ *  add_hist()
+ *  Purpose: Count a time in its bucket
+ *    Input: hist, HIST_BUCKETS counts
+ *           ns, the time
+ */
+void add_hist(unsigned * hist, long long ns)
+{
+    long long i = (ns > 0) ? ns / HIST_NS : 0;
+
+    hist[(i < HIST_BUCKETS) ? i : HIST_BUCKETS - 1]++;
+    return;
+}
+
+/*
+ *  percentile()
+ *  Purpose: Find a percentile of what was counted
+ *    Input: hist, HIST_BUCKETS counts
+ *           n, how many were counted in all
+ *           p, the fraction (0.5 for the median)
+ *           max, the largest counted, in nanoseconds
+ *   Return: milliseconds, to the top of the bucket it falls in (or the
+ *           largest, if that is less); 0 if nothing was counted
+ */
+double percentile(const unsigned * hist, long n, double p, long long max)
+{
+    long want = (long) (p * n), seen = 0;
+    long long top;
+    int i;
+
+    if(n == 0)
+        return 0;
+
+    for(i = 0; i < HIST_BUCKETS - 1; i++)
+        if( (seen += hist[i]) > want )
+            break;
+
+    top = (long long) (i + 1) * HIST_NS;
+    return ((top < max) ? top : max) / NS_PER_MS;
+}
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  new_telem()
+ *  Purpose: Start measuring
+ *    Input: path, a file to export the samples to, or NULL for none
+ *   Return: the telemetry, or NULL (with errno set) if the file can't be
+ *           created
+ *    Error: If there isn't the memory, close curses, print a message and
+ *           exit.
+ */
+struct pptelem * new_telem(const char * path)
+{
+    struct pptelem * tp = calloc(1, sizeof(struct pptelem));
+    size_t len;
+
+    if(tp == NULL)
+    {
+        wrap_up();
+        fprintf(stderr, "./pong: Couldn't allocate memory for telemetry.\n");
+        exit(1);
+    }
+
+    strcpy(tp->hud, "jit - sim - drw - lag - ms");
+    if(path == NULL)
+        return tp;
+
+    if( (tp->out = fopen(path, "w")) == NULL )
+    {
+        free(tp);
+        return NULL;
+    }
+
+    len = strlen(path);
+    tp->json = (len >= 5 && strcmp(path + len - 5, ".json") == 0);
+    if(tp->json)
+        fputs("{\"samples\":[", tp->out);
+    else
+        fputs("kind,time_ns,ticks,late_ns,sim_ns,render_ns,lag_ns\n",
+              tp->out);
+
+    return tp;
+}
+
+/*
+ *  telem_now()
+ *  Purpose: Read the monotonic clock, for timing a pass or a frame
+ *   Return: the current time, in nanoseconds
+ */
+long long telem_now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * NS_PER_SEC) + ts.tv_nsec;
+}
+
+/*
+ *  telem_input()
+ *  Purpose: Note that a paddle key has been read
+ *     Note: Only the first key before a pass of ticks is timed; the rest
+ *           are made at the same tick, and seen in the same frame.
+ */
+void telem_input(struct pptelem * tp)
+{
+    if(tp->key_at == 0)
+        tp->key_at = telem_now();
+    return;
+}
+
+/*
+ *  telem_ticks()
+ *  Purpose: Record a pass of ticks
+ *    Input: tp, the telemetry
+ *           start, when the pass started (telem_now())
+ *           late, how late its first tick ran, in nanoseconds
+ *           ticks, how many ticks it ran
+ *     Note: Any key read before the pass has now been made.
+ */
+void telem_ticks(struct pptelem * tp, long long start, long long late,
+                 int ticks)
+{
+    struct sample s = { start, late, telem_now() - start, -1, TICKS, ticks };
+
+    if(tp->key_at != 0 && tp->made_at == 0)
+        tp->made_at = tp->key_at;
+    tp->key_at = 0;
+
+    push(tp, &s);
+    return;
+}
+
+/*
+ *  telem_frame()
+ *  Purpose: Record a frame, which is now on the screen
+ *    Input: tp, the telemetry
+ *           start, when drawing it started (telem_now())
+ */
+void telem_frame(struct pptelem * tp, long long start)
+{
+    long long end = telem_now();
+    struct sample s = { start, 0, end - start, -1, FRAME, 0 };
+
+    if(tp->made_at != 0)
+        s.lag = end - tp->made_at;
+    tp->made_at = 0;
+
+    push(tp, &s);
+    return;
+}
+
+/*
+ *  telem_drain()
+ *  Purpose: Take every sample waiting in the ring, and add them up
+ */
+void telem_drain(struct pptelem * tp)
+{
+    unsigned tail = tp->tail;
+    unsigned head = __atomic_load_n(&tp->head, __ATOMIC_ACQUIRE);
+
+    for( ; tail != head; tail++)
+        fold(tp, &tp->ring[tail & (RING_SIZE - 1)]);
+
+    __atomic_store_n(&tp->tail, tail, __ATOMIC_RELEASE);
+    return;
+}
+
+/*
+ *  telem_hud()
+ *  Purpose: A line to show how the last second went
+ *   Return: the most jitter, the mean time per tick and per frame, and the
+ *           most lag, all in milliseconds
+ */
+const char * telem_hud(struct pptelem * tp)
+{
+    return tp->hud;
+}
+
+/*
+ *  telem_get_stats()
+ *  Purpose: Sum up the whole game so far
+ *    Input: tp, the telemetry
+ *   Output: st, filled in
+ */
+void telem_get_stats(struct pptelem * tp, struct telem_stats * st)
+{
+    telem_drain(tp);
+
+    st->passes = tp->passes;
+    st->ticks = tp->ticks;
+    st->frames = tp->frames;
+    st->inputs = tp->inputs;
+    st->dropped = __atomic_load_n(&tp->dropped, __ATOMIC_RELAXED);
+
+    st->late_p50 = percentile(tp->hist[LATE], tp->passes, 0.5, tp->late_max);
+    st->late_p99 = percentile(tp->hist[LATE], tp->passes, 0.99,
+                              tp->late_max);
+    st->late_max = tp->late_max / NS_PER_MS;
+    st->sim_mean = tp->ticks ? tp->sim_total / NS_PER_MS / tp->ticks : 0;
+    st->sim_max = tp->sim_max / NS_PER_MS;
+    st->render_mean = tp->frames ? tp->render_total / NS_PER_MS / tp->frames
+                                 : 0;
+    st->render_p99 = percentile(tp->hist[RENDER], tp->frames, 0.99,
+                                tp->render_max);
+    st->render_max = tp->render_max / NS_PER_MS;
+    st->lag_mean = tp->inputs ? tp->lag_total / NS_PER_MS / tp->inputs : 0;
+    st->lag_p99 = percentile(tp->hist[LAG], tp->inputs, 0.99, tp->lag_max);
+    st->lag_max = tp->lag_max / NS_PER_MS;
+
+    return;
+}
+
+/*
+ *  telem_close()
+ *  Purpose: Finish the export with the summary, and free the telemetry
+ *    Input: tp, the telemetry, or NULL for none
+ *   Return: 0, or -1 (with errno set) if the export couldn't be written
+ */
+int telem_close(struct pptelem * tp)
+{
+    struct telem_stats st;
+    int err = 0;
+
+    if(tp == NULL)
+        return 0;
+
+    telem_get_stats(tp, &st);
+    if(tp->out != NULL && tp->json)
+        fprintf(tp->out, "\n],\"summary\":{\"passes\":%ld,\"ticks\":%ld,"
+                "\"frames\":%ld,\"inputs\":%ld,\"dropped\":%ld,"
+                "\"late_ms\":{\"p50\":%.3f,\"p99\":%.3f,\"max\":%.3f},"
+                "\"sim_ms\":{\"mean\":%.4f,\"max\":%.3f},"
+                "\"render_ms\":{\"mean\":%.4f,\"p99\":%.3f,\"max\":%.3f},"
+                "\"lag_ms\":{\"mean\":%.3f,\"p99\":%.3f,\"max\":%.3f}}}\n",
+                st.passes, st.ticks, st.frames, st.inputs, st.dropped,
+                st.late_p50, st.late_p99, st.late_max, st.sim_mean,
+                st.sim_max, st.render_mean, st.render_p99, st.render_max,
+                st.lag_mean, st.lag_p99, st.lag_max);
+
+    if(tp->out != NULL && (ferror(tp->out) | fclose(tp->out)) != 0)
+        err = -1;
+
+    free(tp);
+    return err;
+}
@@ -0,0 +1,31 @@
+/*
+ * ==========================
+ *   FILE: ./telemetry.h
+ * ==========================
+ * Purpose: Header file for telemetry.c
+ */
+
+/* STRUCTS */
+struct telem_stats {        // the whole game, in milliseconds
+    long passes, ticks;     // passes of ticks, and the ticks in them
+    long frames, inputs;    // frames drawn; keys seen on screen
+    long dropped;           // samples lost to a full ring
+    double late_p50, late_p99, late_max;        // tick jitter
+    double sim_mean, sim_max;                   // per tick, per pass
+    double render_mean, render_p99, render_max; // per frame
+    double lag_mean, lag_p99, lag_max;          // input to photon
+};
+
+/* OPAQUE STRUCTS */
+struct pptelem;
+
+/* EXTERNAL INTERFACE */
+struct pptelem * new_telem(const char *);
+long long telem_now();
+void telem_input(struct pptelem *);
+void telem_ticks(struct pptelem *, long long, long long, int);
+void telem_frame(struct pptelem *, long long);
+void telem_drain(struct pptelem *);
+const char * telem_hud(struct pptelem *);
+void telem_get_stats(struct pptelem *, struct telem_stats *);
+int telem_close(struct pptelem *);
\ No newline at end of file
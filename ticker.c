@@ -0,0 +1,361 @@
+/*
+ * ===========================================================================
+ *   FILE: ./ticker.c
+ * ===========================================================================
+ * Purpose: Schedule fixed-length game ticks, and frames, without signals.
+ *
+ * Interface:
+ *      ticker_start()      -- start ticking at a tick rate and a frame rate
+ *      ticker_fd()         -- descriptor that is readable when work is due
+ *      ticker_arm()        -- set the next wake-up, return a poll() timeout
+ *      ticker_ticks_due()  -- number of simulation ticks to run right now
+ *      ticker_frame_due()  -- whether it is time to draw a frame
+ *      ticker_frame_done() -- mark a frame drawn, skipping any it overran
+ *      ticker_late()       -- how late the last ticks handed out are running
+ *      ticker_wake_after() -- sleep through ticks in which nothing changes
+ *      ticker_pause()      -- stop, or start, handing out ticks and frames
+ *      ticker_stop()       -- stop the ticker and release its descriptor
+ *
+ * Internal functions:
+ *      now_ns()            -- read the monotonic clock in nanoseconds
+ *
+ * Notes:
+ *      The ticker is file-scoped to ticker.c. Simulation and drawing run on
+ *      two separate clocks. Real time is added to an accumulator, and one
+ *      tick is owed for each tick period it holds, so the game runs at the
+ *      same speed however often frames are drawn. If the process was
+ *      descheduled, the owed ticks are run back-to-back to catch up (up to
+ *      MAX_CATCHUP_MS worth). Frames have their own deadline; when drawing
+ *      one takes so long that later deadlines have already passed, those
+ *      frames are skipped rather than queued, so a slow terminal costs
+ *      smoothness rather than game speed.
+ *
+ *      On Linux the wake-ups come from a timerfd, so the main loop can wait
+ *      on it and on stdin with a single poll(). Where a timerfd can't be
+ *      created, ticker_fd() returns -1 (which poll() ignores) and the value
+ *      from ticker_arm() is used as the poll() timeout instead.
+ *
+ *      Idle: a game can say that the next few ticks will change nothing
+ *      but where the balls are within their cells (see game_next_change()),
+ *      and ticker_wake_after() lets the ticker sleep through them: it wakes
+ *      once the first tick that can change something is due, and hands
+ *      out all of them then. Every tick is still run, in the same order,
+ *      so the game plays out exactly as if it woke for each; only the
+ *      wake-ups in which there was nothing to do, or draw, are saved. A
+ *      frame is only woken for while some ticks have run since the last.
+ *      Paused (ticker_pause()), it doesn't wake at all, and the time spent
+ *      paused is owed to nothing.
+ */
+
+/* INCLUDES */
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/timerfd.h>
+#endif
+#include "ticker.h"
+
+/* CONSTANTS */
+#define NS_PER_MS       1000000LL
+#define NS_PER_SEC      1000000000LL
+#define MAX_CATCHUP_MS  250             // most real time made up at once
+
+/* TICKER STRUCT */
+struct ticker {
+    int fd;                 // timerfd, or -1 when using poll() timeouts
+    long long tick_period;  // nanoseconds per simulation tick
+    long long frame_period; // nanoseconds per frame
+    long long max_acc;      // cap on the accumulator
+    long long acc;          // time owed to the simulation
+    long long last;         // when the accumulator was last topped up
+    long long next_frame;   // deadline of the next frame
+    long long late;         // how long ago the last ticks' first fell due
+    int wake_after;         // ticks to wait for; more than 1 when idle
+    int undrawn;            // 1 if ticks have run since the last frame
+    int paused;             // 1 while no ticks or frames are handed out
+};
+
+static struct ticker ticker = { -1 };
+
+/*
+ * ===========================================================================
+ * INTERNAL FUNCTIONS
+ * ===========================================================================
+ */
+static long long now_ns();
+
+/*
+ *  now_ns()
+ *  Purpose: Read the monotonic clock
+ *   Return: the current time, in nanoseconds
+ */
+long long now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * NS_PER_SEC) + ts.tv_nsec;
+}
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  ticker_start()
+ *  Purpose: Start scheduling ticks and frames
+ *    Input: tick_rate, simulation ticks per second
+ *           frame_rate, frames drawn per second
+ *   Return: 0 on success, -1 if either rate is not positive
+ *     Note: The accumulator always holds at least one tick's worth, so
+ *           even a tick rate slower than 1000 / MAX_CATCHUP_MS can run.
+ *     Note: Failing to create the timerfd is not an error; the ticker
+ *           quietly falls back to poll() timeouts.
+ */
+int ticker_start(int tick_rate, int frame_rate)
+{
+    if(tick_rate <= 0 || frame_rate <= 0)
+        return -1;
+
+    ticker.tick_period = NS_PER_SEC / tick_rate;
+    ticker.frame_period = NS_PER_SEC / frame_rate;
+
+    ticker.max_acc = MAX_CATCHUP_MS * NS_PER_MS;
+    if(ticker.max_acc < ticker.tick_period)
+        ticker.max_acc = ticker.tick_period;
+
+    ticker.acc = 0;
+    ticker.last = now_ns();
+    ticker.next_frame = ticker.last;        // draw straight away
+    ticker.wake_after = 1;
+    ticker.undrawn = 0;
+    ticker.paused = 0;
+
+#ifdef __linux__
+    ticker.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+#endif
+
+    return 0;
+}
+
+/*
+ *  ticker_fd()
+ *  Purpose: Public function to access the ticker's descriptor
+ *   Return: a descriptor to poll() for POLLIN, or -1 if there is none
+ */
+int ticker_fd()
+{
+    return ticker.fd;
+}
+
+/*
+ *  ticker_arm()
+ *  Purpose: Arrange to wake up when the next tick or frame is due
+ *   Return: the timeout to pass to poll(); -1 (wait forever) when the
+ *           timerfd has been armed to wake poll() itself
+ *   Method: The next tick is due once the accumulator has gained the rest
+ *           of a tick period; when idle, the rest of as many periods as
+ *           ticker_wake_after() was given. Whichever of that and the frame
+ *           deadline comes first is the wake-up, except that an idle ticker
+ *           only wakes for a frame if ticks have run since the last one. A
+ *           timerfd is set to that absolute time; otherwise the time left is
+ *           rounded up to milliseconds so poll() doesn't return just before
+ *           the deadline and spin.
+ *     Note: Paused, the timerfd is disarmed and -1 returned, so poll()
+ *           waits for the keyboard alone.
+ */
+int ticker_arm()
+{
+    long long wake, left;
+
+    wake = ticker.last + ((ticker.wake_after * ticker.tick_period) -
+                          ticker.acc);
+    if( ticker.next_frame < wake &&
+        (ticker.wake_after == 1 || ticker.undrawn) )
+        wake = ticker.next_frame;
+
+#ifdef __linux__
+    if(ticker.fd != -1)
+    {
+        struct itimerspec its = { { 0, 0 }, { 0, 0 } };
+
+        its.it_value.tv_sec = wake / NS_PER_SEC;
+        its.it_value.tv_nsec = wake % NS_PER_SEC;
+        if(its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0)
+            its.it_value.tv_nsec = 1;       // zero would disarm the timer
+        if(ticker.paused)
+            its.it_value.tv_sec = its.it_value.tv_nsec = 0;  // disarm it
+
+        if(timerfd_settime(ticker.fd, TFD_TIMER_ABSTIME, &its, NULL) == 0)
+            return -1;
+
+        close(ticker.fd);                   // couldn't arm it, so
+        ticker.fd = -1;                     // use timeouts from now on
+    }
+#endif
+
+    if(ticker.paused)
+        return -1;
+
+    left = wake - now_ns();
+    if(left <= 0)
+        return 0;
+
+    return (int) ((left + NS_PER_MS - 1) / NS_PER_MS);
+}
+
+/*
+ *  ticker_ticks_due()
+ *  Purpose: Work out how many simulation ticks to run now
+ *   Return: the number of ticks owed; 0 if none are due yet
+ *   Method: Add the real time since the last call to the accumulator,
+ *           capped at MAX_CATCHUP_MS (plus the ticks slept through when
+ *           idle), and take out one tick period for each whole tick it
+ *           holds. Whatever is left over carries on to the next call, so
+ *           the tick rate doesn't drift.
+ *     Note: When idle, the ticks are only late from when the one that was
+ *           waited for fell due; those before it were meant to wait.
+ */
+int ticker_ticks_due()
+{
+    long long now, max_acc;
+    int n;
+
+    if(ticker.tick_period == 0 || ticker.paused)    // not started, or paused
+        return 0;
+
+#ifdef __linux__
+    if(ticker.fd != -1)
+    {
+        uint64_t count;                     // clear the wake-up, if any
+
+        if(read(ticker.fd, &count, sizeof(count)) != sizeof(count))
+            count = 0;
+    }
+#endif
+
+    now = now_ns();
+    ticker.acc += now - ticker.last;
+    ticker.last = now;
+
+    max_acc = ticker.max_acc + ((ticker.wake_after - 1) * ticker.tick_period);
+    if(ticker.acc > max_acc)                // too far behind to catch up
+        ticker.acc = max_acc;
+
+    n = (int) (ticker.acc / ticker.tick_period);
+    ticker.acc -= n * ticker.tick_period;
+    if(n >= ticker.wake_after)
+        ticker.late = ticker.acc +
+                      ((n - ticker.wake_after) * ticker.tick_period);
+    else if(n > 0)
+        ticker.late = 0;                    // woken early, for the keys
+    if(n > 0)
+        ticker.undrawn = 1;
+
+    return n;
+}
+
+/*
+ *  ticker_frame_due()
+ *  Purpose: Check whether the next frame's deadline has come
+ *   Return: 1 if a frame should be drawn now, 0 if not, or if paused
+ */
+int ticker_frame_due()
+{
+    return ticker.frame_period != 0 && !ticker.paused &&
+           now_ns() >= ticker.next_frame;
+}
+
+/*
+ *  ticker_frame_done()
+ *  Purpose: Move the frame deadline on after a frame has been drawn
+ *   Return: the number of frames skipped because drawing ran late
+ *   Method: Normally the deadline moves forward one frame period. If the
+ *           frame took so long that one or more later deadlines have
+ *           already gone by, skip ahead to the first deadline still in
+ *           the future instead of trying to draw the missed frames.
+ */
+int ticker_frame_done()
+{
+    long long now = now_ns();
+    int skipped = 0;
+
+    ticker.undrawn = 0;
+    ticker.next_frame += ticker.frame_period;
+    if(ticker.next_frame <= now)
+    {
+        skipped = (int) ((now - ticker.next_frame) / ticker.frame_period) + 1;
+        ticker.next_frame += skipped * ticker.frame_period;
+    }
+
+    return skipped;
+}
+
+/*
+ *  ticker_late()
+ *  Purpose: Say how late the ticks last handed out are being run
+ *   Return: nanoseconds since the first of them fell due, as of the call
+ *           to ticker_ticks_due() that owed them
+ *     Note: What the accumulator has left over is how long ago the last of
+ *           them fell due, and each before it fell due one tick period
+ *           earlier. Time dropped by the MAX_CATCHUP_MS cap isn't counted.
+ */
+long long ticker_late()
+{
+    return ticker.late;
+}
+
+/*
+ *  ticker_wake_after()
+ *  Purpose: Let the ticker sleep until a number of ticks are due
+ *    Input: ticks, how many ticks away the first one that can change
+ *           anything is (see game_next_change()); 1, to wake for every
+ *           tick, as the ticker does until told otherwise
+ *     Note: Taken by the next ticker_arm() and ticker_ticks_due(), so it
+ *           is to be said again before every wait. A key, or anything else
+ *           that wakes poll(), still gets any ticks owed by then.
+ */
+void ticker_wake_after(int ticks)
+{
+    ticker.wake_after = (ticks > 1) ? ticks : 1;
+    return;
+}
+
+/*
+ *  ticker_pause()
+ *  Purpose: Stop handing out ticks and frames, or start again
+ *    Input: paused, 1 to stop, 0 to go on
+ *     Note: On going on, the time spent paused is dropped, as is any
+ *           part of a tick that was owed, and a frame is due at once.
+ */
+void ticker_pause(int paused)
+{
+    if(!paused && ticker.paused)
+    {
+        ticker.acc = 0;
+        ticker.last = now_ns();
+        ticker.next_frame = ticker.last;
+    }
+
+    ticker.paused = paused;
+    return;
+}
+
+/*
+ *  ticker_stop()
+ *  Purpose: Stop the ticker and close the timerfd, if there is one
+ */
+void ticker_stop()
+{
+    if(ticker.fd != -1)
+        close(ticker.fd);
+
+    ticker.fd = -1;
+    ticker.tick_period = 0;
+    ticker.frame_period = 0;
+
+    return;
+}
@@ -0,0 +1,18 @@
+/*
+ * ==========================
+ *   FILE: ./ticker.h
+ * ==========================
+ * Purpose: Header file for ticker.c
+ */
+
+/* EXTERNAL INTERFACE */
+int ticker_start(int, int);
+int ticker_fd();
+int ticker_arm();
+int ticker_ticks_due();
+int ticker_frame_due();
+int ticker_frame_done();
+long long ticker_late();
+void ticker_wake_after(int);
+void ticker_pause(int);
+void ticker_stop();
\ No newline at end of file
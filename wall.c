@@ -0,0 +1,608 @@
+/*
+ * ==========================================================================
+ *   FILE: ./wall.c
+ * ==========================================================================
+ * Purpose: Play a wall of games of pong side by side in one terminal.
+ *
+ * Outline: pong-wall plays -n games at once, each on a tile of the screen
+ *          of its own, with the computer player (as in autoplay.c) on
+ *          every paddle: a tournament, or a wall of monitors, to watch.
+ *          Each game is a struct ppgame with its own court, laid out in
+ *          its tile as pong would lay it out on a terminal that size, and
+ *          its own paddle, balls and clock. When a game is over its tile
+ *          shows how long it lasted; once all are over, or on Q, a summary
+ *          of the games is printed.
+ *
+ *   Tiles: As many tiles across as will fit, MIN_COLS wide or more, and
+ *          as many rows of them as the games need; each takes an equal
+ *          share of the screen, so a terminal has room for at most
+ *          (COLS / MIN_COLS) * (LINES / MIN_LINES) games. After a resize
+ *          the tiles are worked out again and every court moved into its
+ *          new one (see game_relayout()), as pong moves its court.
+ *
+ *  Player: Each tick, every paddle moves one row towards the ball with a
+ *          fixed chance (-p, as a percentage), or towards where the ball
+ *          will meet it with -i. Every game has its own random number
+ *          stream, drawn from the seed (-r) and the game's number, for
+ *          the game and for its player.
+ *
+ * Interface:
+ *      wrap_up()       -- closes curses; called on fatal errors too
+ *
+ * Internal functions:
+ *      main()          -- play the games on one ticker until all are over
+ *      get_options()   -- read settings from the command line
+ *      set_up()        -- prepare the terminal, and set up every game
+ *      lay_out()       -- work out the tiles for a size of screen
+ *      place()         -- put a game's court in its tile
+ *      play_ticks()    -- run every game still going for some ticks
+ *      end_game()      -- note a game is over, and say so on its tile
+ *      draw_frame()    -- draw what changed in every game, and show it
+ *      next_change()   -- ticks until anything can change in any game
+ *      relayout()      -- tile a resized terminal again
+ *      print_summary() -- print how long each game lasted
+ *      print_stats()   -- print the frame's counters (-s)
+ *      resize_handler()-- note that the terminal changed size
+ *
+ * Notes:
+ *      One ticker (ticker.c) drives all of the games, as it drives pong's
+ *      one: each pass of ticks runs every game still going that many
+ *      ticks, one game after another, so a game's objects stay in the
+ *      cache for all of its ticks. The games are allocated one after the
+ *      other in one arena, and none is freed until the end.
+ *
+ *      Every game draws into the one frame (frame.c), which sends only
+ *      the cells that changed, all in one update per frame, so what a
+ *      frame costs goes with how much moved, not with how many games
+ *      there are. A game that is over isn't drawn again at all, and the
+ *      walls of every court are in the frame's static layer.
+ */
+
+/* INCLUDES */
+#include <curses.h>
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include "arena.h"
+#include "backend.h"
+#include "clock.h"
+#include "court.h"
+#include "frame.h"
+#include "game.h"
+#include "pong.h"
+#include "rng.h"
+#include "ticker.h"
+
+/* CONSTANTS */
+#define QUIT_KEY 'Q'
+#define DFL_GAMES 4         // games to play
+#define DFL_SKILL 50        // % chance per tick the paddle moves
+#define MAX_RATE 1000       // highest tick or frame rate accepted
+#define MINUTE 60
+#define END_MSG_LEN 12      // to help center how long a game lasted
+
+/* STRUCTS */
+struct tile {
+    struct ppgame * game;
+    struct pprng player;    // decides when the paddle moves
+    int state;              // GAME_ON until the game is over
+    long secs;              // how long it lasted, once it is over
+    int y, x, h, w;         // top row, left column, and size of the tile
+};
+
+/* LOCAL VARIABLES -- SETTINGS */
+static int games = DFL_GAMES;
+static int skill = DFL_SKILL;
+static int predict;
+static int balls = 1;
+static int tick_rate = TICKS_PER_SEC;
+static int frame_rate = FRAMES_PER_SEC;
+static unsigned long long seed;
+static int show_stats;
+static const struct backend * backend = &curses_backend;    // -o: output
+
+/* LOCAL VARIABLES -- GAMES */
+static struct pparena * arena;      // every game is allocated in it
+static struct tile * tiles;
+static int playing;                 // games not over yet
+static long tick_count;
+static volatile sig_atomic_t resized;
+
+/*
+ * ===========================================================================
+ * INTERNAL FUNCTIONS
+ * ===========================================================================
+ */
+static void get_options(int, char **);
+static void set_up();
+static int lay_out(int, int);
+static void place(struct tile *);
+static void play_ticks(long);
+static void end_game(struct tile *);
+static void draw_frame();
+static int next_change();
+static void relayout();
+static void print_summary();
+static void print_stats();
+static void resize_handler(int);
+
+/*
+ *  main()
+ *  Purpose: Play the games side by side until all of them are over
+ *    Input: argc, argv, the command line (see get_options())
+ *   Return: 0 on success, exit non-zero on error
+ *   Method: As pong's main loop: wait in poll() on the keyboard and the
+ *           ticker, run every game the ticks owed, then draw a frame if
+ *           one is due. Q stops every game still going. As pong does, the
+ *           ticker sleeps through the ticks in which no game can change.
+ */
+int main(int argc, char * argv[])
+{
+    struct pollfd fds[2];
+    long ticks;
+    int quit = 0, c;
+
+    get_options(argc, argv);
+    set_up();
+
+    fds[0].fd = STDIN_FILENO;
+    fds[0].events = POLLIN;
+    fds[1].fd = ticker_fd();
+    fds[1].events = POLLIN;
+
+    while( !quit && playing > 0 )
+    {
+        ticker_wake_after(next_change());
+        if( poll(fds, 2, ticker_arm()) == -1 && errno != EINTR )
+        {
+            wrap_up();
+            perror("pong-wall: poll");
+            exit(1);
+        }
+
+        if(resized)
+            relayout();
+
+        if( fds[0].revents & POLLIN )
+            while( (c = getch()) != ERR )
+                quit |= (c == QUIT_KEY);
+
+        if( !quit && (ticks = ticker_ticks_due()) > 0 )
+            play_ticks(ticks);
+
+        if( ticker_frame_due() )
+        {
+            draw_frame();
+            ticker_frame_done();
+        }
+    }
+
+    draw_frame();                       // every tile's final state
+    if(playing == 0)
+        sleep(2);
+
+    wrap_up();
+    print_summary();
+    print_stats();
+    return 0;
+}
+
+/*
+ *  get_options()
+ *  Purpose: Read settings from the command line
+ *    Input: argc, argv, as passed to main()
+ *   Method: -n games to play, -b balls in play per serve, -p the
+ *           paddles' chance (0..100) of moving each tick, -i the player
+ *           that predicts where the ball will be, -t and -f the tick and
+ *           frame rates, -r (or --seed) the seed, -o how frames reach the
+ *           terminal, as in pong, and -s the frame's counters at the end.
+ *    Error: On an unknown option or a bad value, print a usage message
+ *           and exit. Whether the games fit is found out in set_up().
+ */
+void get_options(int argc, char * argv[])
+{
+    static const struct option longopts[] = {
+        { "seed", required_argument, NULL, 'r' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt, bad = 0;
+
+    seed = getpid();
+    while( (opt = getopt_long(argc, argv, "n:b:p:it:f:r:o:s", longopts,
+                              NULL)) != -1 )
+    {
+        if(opt == 'n')
+            games = atoi(optarg);
+        else if(opt == 'b')
+            balls = atoi(optarg);
+        else if(opt == 'p')
+            skill = atoi(optarg);
+        else if(opt == 'i')
+            predict = 1;
+        else if(opt == 't')
+            tick_rate = atoi(optarg);
+        else if(opt == 'f')
+            frame_rate = atoi(optarg);
+        else if(opt == 'r')
+            seed = strtoull(optarg, NULL, 0);
+        else if(opt == 's')
+            show_stats = 1;
+        else if(opt == 'o' && strcmp(optarg, curses_backend.name) == 0)
+            backend = &curses_backend;
+        else if(opt == 'o' && strcmp(optarg, ansi_backend.name) == 0)
+            backend = &ansi_backend;
+        else
+            bad = 1;
+    }
+
+    if( bad || optind < argc || games < 1 || balls < 1 ||
+        balls > MAX_BALLS || skill < 0 || skill > 100 ||
+        tick_rate < 1 || tick_rate > MAX_RATE ||
+        frame_rate < 1 || frame_rate > MAX_RATE )
+    {
+        fprintf(stderr, "usage: %s [-is] [-n games] [-b balls] "
+                        "[-p skill%%] [-t ticks_per_sec]\n"
+                        "        [-f frames_per_sec] [-r seed] "
+                        "[-o curses|ansi]\n", argv[0]);
+        exit(2);
+    }
+
+    return;
+}
+
+/*
+ *  set_up()
+ *  Purpose: Prepare the terminal, and set up and draw every game
+ *     Note: Game g is seeded, and its player too, from stream g of the
+ *           seed, as autoplay_game() seeds game g of a run.
+ *    Error: If the games don't all fit on the screen, close curses, print
+ *           a message and exit.
+ */
+void set_up()
+{
+    struct tile * tp;
+    int g;
+
+    initscr();
+    refresh();                          // clear it now, not at the 1st getch
+    noecho();
+    cbreak();
+    nodelay(stdscr, TRUE);
+
+    tiles = calloc(games, sizeof(struct tile));
+    if(tiles == NULL)
+    {
+        wrap_up();
+        fprintf(stderr, "pong-wall: Couldn't allocate memory for the "
+                        "games.\n");
+        exit(1);
+    }
+
+    if( lay_out(LINES, COLS) == -1 )
+    {
+        wrap_up();
+        fprintf(stderr, "A %dx%d terminal holds at most %d games of at "
+                        "least %dx%d. Please resize and try again.\n",
+                        COLS, LINES, (COLS / MIN_COLS) * (LINES / MIN_LINES),
+                        MIN_COLS, MIN_LINES);
+        exit(1);
+    }
+
+    frame_init(LINES, COLS, backend, show_stats);
+    arena = new_arena(0);
+
+    for(g = 0; g < games; g++)
+    {
+        tp = &tiles[g];
+        rng_seed(&tp->player, seed, g);
+        tp->game = new_game(arena, tp->y + BORDER, tp->x + tp->w - BORDER - 1,
+                            tp->y + tp->h - BORDER - 1, tp->x + BORDER,
+                            tick_rate, balls, rng_seed_from(&tp->player), 1);
+        tp->state = GAME_ON;
+        game_redraw(tp->game);
+    }
+    playing = games;
+    frame_flush();
+
+    signal(SIGINT, SIG_IGN);
+    signal(SIGWINCH, resize_handler);
+    ticker_start(tick_rate, frame_rate);
+
+    return;
+}
+
+/*
+ *  lay_out()
+ *  Purpose: Work out every game's tile for a screen of a given size
+ *    Input: lines, cols, the size of the screen
+ *   Return: 0, or -1 if the games don't fit, and the tiles are left as
+ *           they were
+ *   Method: As many tiles across as fit at MIN_COLS wide, up to the number
+ *           of games, and as many rows as it takes; the screen is shared
+ *           out evenly between them.
+ */
+int lay_out(int lines, int cols)
+{
+    int across = cols / MIN_COLS, down, g;
+
+    if(across > games)
+        across = games;
+    if(across < 1)
+        return -1;
+
+    down = (games + across - 1) / across;
+    if(down > lines / MIN_LINES)
+        return -1;
+
+    for(g = 0; g < games; g++)
+    {
+        tiles[g].h = lines / down;
+        tiles[g].w = cols / across;
+        tiles[g].y = (g / across) * tiles[g].h;
+        tiles[g].x = (g % across) * tiles[g].w;
+    }
+
+    return 0;
+}
+
+/*
+ *  place()
+ *  Purpose: Move a game's court to its tile, and draw the game again
+ *    Input: tp, the tile
+ *     Note: A game that is over shows how long it lasted again too.
+ */
+void place(struct tile * tp)
+{
+    game_relayout(tp->game, tp->y + BORDER, tp->x + tp->w - BORDER - 1,
+                  tp->y + tp->h - BORDER - 1, tp->x + BORDER);
+    game_redraw(tp->game);
+    if(tp->state != GAME_ON)
+        end_game(tp);
+
+    return;
+}
+
+/*
+ *  play_ticks()
+ *  Purpose: Run every game still going for a number of ticks
+ *    Input: ticks, how many
+ *   Method: Each tick, the player may move the paddle, as in
+ *           autoplay_game(), and then the game ticks. A game runs all of
+ *           its ticks before the next game starts on them.
+ */
+void play_ticks(long ticks)
+{
+    struct tile * tp;
+    long t;
+    int g;
+
+    for(g = 0; g < games; g++)
+    {
+        tp = &tiles[g];
+        if(tp->state != GAME_ON)
+            continue;
+
+        for(t = 0; t < ticks && tp->state == GAME_ON; t++)
+        {
+            if( rng_range(&tp->player, 0, 100) < skill )
+                tp->state = game_paddle(tp->game, predict ?
+                                        game_predict(tp->game) :
+                                        game_aim(tp->game));
+            if(tp->state == GAME_ON)
+                tp->state = game_tick(tp->game);
+        }
+
+        if(tp->state != GAME_ON)
+        {
+            game_draw(tp->game);        // its final state, under the time
+            end_game(tp);
+            playing--;
+        }
+    }
+
+    tick_count += ticks;
+    return;
+}
+
+/*
+ *  end_game()
+ *  Purpose: Note how long a game that is over lasted, and show it on the
+ *           game's tile
+ *    Input: tp, the tile
+ *     Note: The message is drawn over the game, and stays: the game is
+ *           never drawn again unless the tiles move.
+ */
+void end_game(struct tile * tp)
+{
+    struct ppclock * cp = game_clock(tp->game);
+
+    tp->secs = (get_mins(cp) * MINUTE) + get_secs(cp);
+    frame_print_standout(tp->y + (tp->h / 2),
+                         tp->x + ((tp->w - END_MSG_LEN) / 2),
+                         "Lasted %.2ld:%.2ld", tp->secs / MINUTE,
+                         tp->secs % MINUTE);
+    return;
+}
+
+/*
+ *  draw_frame()
+ *  Purpose: Draw whatever changed in every game still going, and show all
+ *           of it in one update
+ */
+void draw_frame()
+{
+    int g;
+
+    for(g = 0; g < games; g++)
+        if(tiles[g].state == GAME_ON)
+            game_draw(tiles[g].game);
+
+    frame_flush();
+    return;
+}
+
+/*
+ *  next_change()
+ *  Purpose: Say how many ticks away the first that can change anything in
+ *           any game still going is
+ *   Return: the least game_next_change() of them, and 1 at most when none
+ *           are going
+ *   Method: game_next_change() leaves the paddles to the caller, so a game
+ *           whose player would move its paddle (-p above 0, and the paddle
+ *           not on the ball's row yet) needs the next tick. One whose
+ *           paddle is on the row already doesn't: the row the player aims
+ *           for only changes as the balls do, when game_next_change() has
+ *           the game woken anyway.
+ */
+int next_change()
+{
+    struct ppgame * gp;
+    int g, n, soonest = 0;
+
+    for(g = 0; g < games; g++)
+    {
+        if(tiles[g].state != GAME_ON)
+            continue;
+
+        gp = tiles[g].game;
+        if( skill > 0 && (predict ? game_predict(gp) : game_aim(gp)) != 0 )
+            n = 1;
+        else
+            n = game_next_change(gp);
+        if(n < soonest || soonest == 0)
+            soonest = n;
+    }
+
+    return (soonest > 0) ? soonest : 1;
+}
+
+/*
+ *  relayout()
+ *  Purpose: Tile the screen again when the terminal has changed size
+ *   Method: As relayout() in pong: curses and the frame take the new size,
+ *           and each court is moved into its new tile and drawn again. If
+ *           the games no longer fit, the courts stay where they were, cut
+ *           short by the screen, until it is big enough again.
+ */
+void relayout()
+{
+    struct winsize ws;
+    int g;
+
+    resized = 0;
+    if( ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1 || ws.ws_row == 0 ||
+        ws.ws_col == 0 )
+        return;
+
+    resizeterm(ws.ws_row, ws.ws_col);
+    if(backend != &curses_backend)
+        untouchwin(stdscr);             // or getch() clears the screen
+    frame_resize(ws.ws_row, ws.ws_col);
+    lay_out(ws.ws_row, ws.ws_col);
+
+    for(g = 0; g < games; g++)
+        place(&tiles[g]);
+    frame_flush();
+
+    return;
+}
+
+/*
+ *  print_summary()
+ *  Purpose: Print how long each game lasted, and which lasted longest
+ *     Note: A game stopped with Q shows how long it had lasted so far.
+ */
+void print_summary()
+{
+    struct tile * tp;
+    struct ppclock * cp;
+    int g, best = 0;
+
+    printf("games: %d (%d over)  balls: %d  seed: %llu  player: %s, "
+           "%d%%\n", games, games - playing, balls, seed,
+           predict ? "predict" : "chase", skill);
+
+    for(g = 0; g < games; g++)
+    {
+        tp = &tiles[g];
+        if(tp->state == GAME_ON)
+        {
+            cp = game_clock(tp->game);
+            tp->secs = (get_mins(cp) * MINUTE) + get_secs(cp);
+        }
+        printf("game %d: %.2ld:%.2ld%s\n", g, tp->secs / MINUTE,
+               tp->secs % MINUTE, (tp->state == GAME_ON) ? " (stopped)" : "");
+        if(tp->secs > tiles[best].secs)
+            best = g;
+    }
+
+    printf("longest: game %d, %.2ld:%.2ld\n", best, tiles[best].secs / MINUTE,
+           tiles[best].secs % MINUTE);
+    return;
+}
+
+/*
+ *  print_stats()
+ *  Purpose: With -s, print what the frame sent to the terminal, to stderr
+ */
+void print_stats()
+{
+    struct frame_stats st;
+    long n;
+
+    if(!show_stats)
+        return;
+
+    frame_get_stats(&st);
+    n = (st.frames > 0) ? st.frames : 1;
+
+    fprintf(stderr, "ticks: %ld  games: %d\n", tick_count, games);
+    fprintf(stderr, "frames: %ld  refreshes: %ld\n", st.frames, st.refreshes);
+    fprintf(stderr, "cells touched: %ld  changed: %ld (%.1f per frame)\n",
+                    st.cells_touched, st.cells_changed,
+                    (double) st.cells_changed / n);
+    fprintf(stderr, "tty bytes: %ld (%.1f per frame, most %ld)\n",
+                    st.bytes, (double) st.bytes / n, st.max_bytes);
+
+    return;
+}
+
+/*
+ *  resize_handler()
+ *  Purpose: Note that the terminal changed size; main() does the work
+ *    Input: s, the signal
+ */
+void resize_handler(int s)
+{
+    resized = 1;
+    return;
+}
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  wrap_up()
+ *  Purpose: Stop the ticker and close curses, ready to return to the
+ *           terminal
+ *     Note: The game objects call this when they can't allocate memory,
+ *           just as they do in pong. The games are freed when the process
+ *           exits.
+ */
+void wrap_up()
+{
+    ticker_stop();
+    frame_end();
+    endwin();
+
+    return;
+}
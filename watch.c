@@ -0,0 +1,529 @@
+/*
+ * ==========================================================================
+ *   FILE: ./watch.c
+ * ==========================================================================
+ * Purpose: Watch a game of pong as it is played, from another terminal.
+ *
+ * Outline: pong-watch host:port shows the game that a pong started with
+ *          -V port is playing, live, as it looks on the player's screen.
+ *          It joins by sending a packet to the port, and keeps saying it
+ *          is there; pong sends back where the balls and paddles are, the
+ *          clock and the balls left, after every pass of ticks (see
+ *          spectate.c). Nothing is played here: the viewer only draws what
+ *          it is sent, so it can join at any time, and a game can have any
+ *          number of viewers. Q stops watching. When the game ends, the
+ *          final time is shown, as pong shows it.
+ *
+ *  Frames: Most packets say how each ball moved since the frame before; a
+ *          key frame, every half second or so, says where each one is. The
+ *          balls are sent in blocks, and a block is only moved on from a
+ *          frame this viewer has the one before of, so a lost packet (or
+ *          joining late) leaves those balls where they were, or unshown,
+ *          until the next key frame.
+ *
+ *  Output: -o ansi draws with raw escape sequences instead of through
+ *          curses, as pong -o ansi does (see ansi_backend.c).
+ *
+ * Interface:
+ *      wrap_up()       -- closes curses; called on fatal errors too
+ *
+ * Internal functions:
+ *      main()          -- wait on the keyboard and the game's packets
+ *      set_up()        -- prepare the terminal and join the game
+ *      lay_out()       -- set up the court from the first packet
+ *      follow_court()  -- move the court when the game's has moved
+ *      take_packet()   -- bring what is known up to date from a packet
+ *      draw_frame()    -- draw what changed into the frame, and show it
+ *      say()           -- send the game a packet
+ *      now_us()        -- microseconds on the monotonic clock
+ *      get16(), get32() -- little-endian numbers in a packet
+ */
+
+/* INCLUDES */
+#include <curses.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "backend.h"
+#include "clock.h"
+#include "court.h"
+#include "frame.h"
+#include "paddle.h"
+#include "pong.h"
+#include "spectate.h"
+
+/* CONSTANTS */
+#define QUIT_KEY 'Q'
+#define BALL_SYMBOL 'O'     // as ball.c draws them
+#define MAX_CHUNKS ((MAX_BALLS + SPEC_CHUNK - 1) / SPEC_CHUNK)
+#define WAIT_MSG "Waiting for the game (Q to give up)"
+#define END_MSG_LEN 16      // to help center the final time
+
+/* LOCAL VARIABLES -- CONNECTION */
+static const char * where;              // host:port of the game
+static int fd = -1;                     // the UDP socket
+static struct sockaddr_in game_addr;    // where the game is sent from
+
+/* LOCAL VARIABLES -- WHAT IS KNOWN */
+static struct ppcourt * court;          // NULL until the first packet
+static struct ppclock * timer;
+static struct pppaddle * paddles[2];    // right, and left if two play
+static uint32_t seq;                    // frame of the latest header
+static int mins, secs, lives;
+static int pads[2][2];                  // each paddle's top and bottom rows
+static int * x, * y;                    // where the balls in play are
+static int count, cap;
+static uint32_t have[MAX_CHUNKS];       // frame + 1 each block is from, or 0
+static int ended, dirty;
+
+/* LOCAL VARIABLES -- SCREEN */
+static const struct backend * backend = &curses_backend;    // -o: output
+static int * x_drawn, * y_drawn;        // where the balls were drawn
+static int drawn;
+
+/*
+ * ===========================================================================
+ * INTERNAL FUNCTIONS
+ * ===========================================================================
+ */
+static void set_up();
+static void lay_out(const unsigned char *);
+static void follow_court(const unsigned char *);
+static void take_packet(const unsigned char *, int);
+static void draw_frame();
+static void say(int);
+static uint32_t now_us();
+static int get16(const unsigned char *);
+static uint32_t get32(const unsigned char *);
+
+/*
+ *  main()
+ *  Purpose: Watch the game at the address given
+ *    Input: argc, argv, the command line: [-o backend] host:port
+ *   Return: 0 on success, exit non-zero on error
+ *   Method: Wait in poll() on the keyboard and the socket, up to a frame's
+ *           time. Take in every packet waiting, draw a frame if anything
+ *           changed, say we are still watching when that is due, and stop
+ *           on the quit key or once the game is over.
+ */
+int main(int argc, char * argv[])
+{
+    unsigned char buf[SPEC_MAX_PACKET];
+    struct pollfd fds[2];
+    struct sockaddr_in from;
+    socklen_t flen;
+    uint32_t said = 0;
+    int len, quit = 0, opt;
+
+    while( (opt = getopt(argc, argv, "o:")) != -1 )
+        if(opt == 'o' && strcmp(optarg, ansi_backend.name) == 0)
+            backend = &ansi_backend;
+        else if(opt != 'o' || strcmp(optarg, curses_backend.name) != 0)
+            argc = 0;                   // force the usage message
+
+    if(optind != argc - 1)
+    {
+        fprintf(stderr, "usage: %s [-o curses|ansi] host:port\n", argv[0]);
+        exit(2);
+    }
+    where = argv[optind];
+    set_up();
+
+    fds[0].fd = STDIN_FILENO;
+    fds[0].events = POLLIN;
+    fds[1].fd = fd;
+    fds[1].events = POLLIN;
+
+    while( !quit && !ended )
+    {
+        if(said == 0 || now_us() - said >= SPEC_WATCH_US)
+        {
+            say(SPEC_WATCH);
+            said = now_us() | 1;
+        }
+
+        if( poll(fds, 2, 1000 / FRAMES_PER_SEC) == -1 && errno != EINTR )
+        {
+            wrap_up();
+            perror("pong-watch: poll");
+            exit(1);
+        }
+
+        if( fds[0].revents & POLLIN )
+            while( (len = getch()) != ERR )
+                quit |= (len == QUIT_KEY);
+
+        if( fds[1].revents & POLLIN )
+            for(;;)
+            {
+                flen = sizeof(from);
+                len = recvfrom(fd, buf, sizeof(buf), 0,
+                               (struct sockaddr *) &from, &flen);
+                if(len == -1)
+                    break;
+                if( from.sin_addr.s_addr == game_addr.sin_addr.s_addr &&
+                    from.sin_port == game_addr.sin_port )
+                    take_packet(buf, len);
+            }
+
+        if(dirty)
+            draw_frame();
+    }
+
+    if(ended)                           // show the final time, as pong does
+    {
+        frame_print_standout(LINES / 2, (COLS / 2) - (END_MSG_LEN / 2),
+                             "They lasted %.2d:%.2d", mins, secs);
+        frame_flush();
+        sleep(2);
+    }
+    else
+        say(SPEC_LEAVE);
+
+    wrap_up();
+    return 0;
+}
+
+/*
+ *  set_up()
+ *  Purpose: Prepare the terminal, and find the game
+ *    Error: If the address can't be found, close curses, print a message
+ *           and exit.
+ */
+void set_up()
+{
+    struct addrinfo hints, * res = NULL;
+    const char * colon = strrchr(where, ':');
+    char host[256];
+    int err = -1;
+
+    initscr();
+    refresh();                          // clear it now, not at the 1st getch
+    noecho();
+    cbreak();
+    nodelay(stdscr, TRUE);
+    frame_init(LINES, COLS, backend, 0);
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    if(colon != NULL && colon - where < (long) sizeof(host))
+    {
+        memcpy(host, where, colon - where);
+        host[colon - where] = '\0';
+        err = getaddrinfo(host, colon + 1, &hints, &res);
+    }
+
+    if( err != 0 || (fd = socket(AF_INET, SOCK_DGRAM, 0)) == -1 )
+    {
+        wrap_up();
+        fprintf(stderr, "pong-watch: Can't find %s: %s\n", where,
+                        (colon == NULL) ? "expected host:port" :
+                        (err != 0) ? gai_strerror(err) : strerror(errno));
+        exit(1);
+    }
+
+    memcpy(&game_addr, res->ai_addr, sizeof(game_addr));
+    freeaddrinfo(res);
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+
+    frame_print(LINES / 2, (COLS - (int) strlen(WAIT_MSG)) / 2, WAIT_MSG);
+    frame_flush();
+    return;
+}
+
+/*
+ *  lay_out()
+ *  Purpose: Set up the court, clock and paddles from the first packet
+ *    Input: buf, the packet
+ *    Error: If the terminal is too small for the game's court, close
+ *           curses, print a message and exit.
+ */
+void lay_out(const unsigned char * buf)
+{
+    int top = get16(buf + SPEC_AT_COURT);
+    int right = get16(buf + SPEC_AT_COURT + 2);
+    int bot = get16(buf + SPEC_AT_COURT + 4);
+    int left = get16(buf + SPEC_AT_COURT + 6);
+    int two = (get16(buf + SPEC_AT_PADS + 4) != SPEC_NO_PAD);
+
+    if(LINES < bot + BORDER + 1 || COLS < right + BORDER + 1)
+    {
+        wrap_up();
+        fprintf(stderr, "The game needs a terminal of at least %dx%d. "
+                        "Please resize and try again.\n",
+                        right + BORDER + 1, bot + BORDER + 1);
+        exit(1);
+    }
+
+    frame_print(LINES / 2, (COLS - (int) strlen(WAIT_MSG)) / 2, "%*s",
+                (int) strlen(WAIT_MSG), "");
+
+    court = new_court(NULL, top, right, bot, left, two ? 2 : 1);
+    timer = new_clock(NULL, TICKS_PER_SEC);
+    paddles[0] = new_paddle(NULL, court, RIGHT_SIDE);
+    if(two)
+        paddles[1] = new_paddle(NULL, court, LEFT_SIDE);
+
+    print_court(court, timer, buf[SPEC_AT_LIVES]);
+    return;
+}
+
+/*
+ *  follow_court()
+ *  Purpose: Move the court to where the game's is now, if it has moved
+ *    Input: buf, a packet from the latest frame
+ *   Method: The game's terminal was resized (see relayout() in pong.c).
+ *           The screen is cleared, the walls and paddles are moved, and
+ *           the court is printed again; the balls and paddles show where
+ *           the packets put them on the next frame.
+ *     Note: Unlike lay_out(), a court too big for this terminal is just
+ *           cut off.
+ */
+void follow_court(const unsigned char * buf)
+{
+    int top = get16(buf + SPEC_AT_COURT);
+    int right = get16(buf + SPEC_AT_COURT + 2);
+    int bot = get16(buf + SPEC_AT_COURT + 4);
+    int left = get16(buf + SPEC_AT_COURT + 6);
+    int side;
+
+    if( top == get_top_edge(court) && right == get_right_edge(court) &&
+        bot == get_bot_edge(court) && left == get_left_edge(court) )
+        return;
+
+    frame_resize(LINES, COLS);
+    court_relayout(court, top, right, bot, left);
+    for(side = 0; side < 2; side++)
+        if(paddles[side] != NULL)
+            paddle_relayout(paddles[side], court);
+    drawn = 0;
+
+    print_court(court, timer, buf[SPEC_AT_LIVES]);
+    return;
+}
+
+/*
+ *  take_packet()
+ *  Purpose: Bring what is known about the game up to date from a packet
+ *    Input: buf, len, the packet
+ *   Method: The header is taken if it is from the latest frame yet, and
+ *           the court is moved if the game's has. A key block is always
+ *           taken; if the number of balls in play has changed, every other
+ *           block is out of date and is dropped. A delta block is only
+ *           used on the frame before it; balls going out of play just
+ *           leave fewer.
+ *    Error: If malloc fails, close curses, print a message and exit.
+ */
+void take_packet(const unsigned char * buf, int len)
+{
+    uint32_t s = get32(buf + SPEC_AT_SEQ);
+    int total, first, n, c, i, code;
+    const unsigned char * esc;
+
+    if( len < SPEC_HEAD_LEN || buf[0] != 'P' || buf[1] != 'S' ||
+        buf[2] != SPEC_VERSION )
+        return;
+
+    total = get32(buf + SPEC_AT_COUNT);
+    first = get32(buf + SPEC_AT_FIRST);
+    n = get16(buf + SPEC_AT_N);
+    if( total > MAX_BALLS || n > SPEC_CHUNK || first % SPEC_CHUNK != 0 ||
+        first + n > total )
+        return;
+
+    if(court == NULL)
+    {
+        lay_out(buf);
+        seq = s;
+    }
+
+    if((int32_t) (s - seq) >= 0)        // the latest frame yet
+    {
+        seq = s;
+        follow_court(buf);
+        mins = get16(buf + SPEC_AT_MINS);
+        secs = buf[SPEC_AT_SECS];
+        lives = buf[SPEC_AT_LIVES];
+        for(i = 0; i < 4; i++)
+            pads[i / 2][i % 2] = get16(buf + SPEC_AT_PADS + (i * 2));
+        ended |= (buf[3] == SPEC_END);
+        dirty = 1;
+    }
+
+    c = first / SPEC_CHUNK;
+    if(buf[3] == SPEC_KEY && len >= SPEC_HEAD_LEN + (n * 4))
+    {
+        if(total != count)              // balls came or went: start again
+        {
+            if(total > cap)
+            {
+                cap = total;
+                x = realloc(x, cap * sizeof(int));
+                y = realloc(y, cap * sizeof(int));
+                x_drawn = realloc(x_drawn, cap * sizeof(int));
+                y_drawn = realloc(y_drawn, cap * sizeof(int));
+                if(x == NULL || y == NULL || x_drawn == NULL || y_drawn == NULL)
+                {
+                    wrap_up();
+                    fprintf(stderr, "pong-watch: Couldn't allocate memory "
+                                    "for the balls.\n");
+                    exit(1);
+                }
+            }
+            memset(have, 0, sizeof(have));
+            count = total;
+        }
+
+        for(i = 0; i < n; i++)
+        {
+            x[first + i] = get16(buf + SPEC_HEAD_LEN + (i * 4));
+            y[first + i] = get16(buf + SPEC_HEAD_LEN + (i * 4) + 2);
+        }
+        have[c] = s + 1;
+    }
+    else if(buf[3] == SPEC_DELTA && total <= count && have[c] == s &&
+            have[c] != 0 && len >= SPEC_HEAD_LEN + ((n + 1) / 2))
+    {
+        count = total;                  // balls went out of play
+        esc = buf + SPEC_HEAD_LEN + ((n + 1) / 2);
+        for(i = 0; i < n; i++)
+        {
+            code = (buf[SPEC_HEAD_LEN + (i / 2)] >> (4 * (i & 1))) & 0x0f;
+            if(code != SPEC_ESCAPE)
+            {
+                x[first + i] += (code / 3) - 1;
+                y[first + i] += (code % 3) - 1;
+            }
+            else if(esc + 4 <= buf + len)
+            {
+                x[first + i] = get16(esc);
+                y[first + i] = get16(esc + 2);
+                esc += 4;
+            }
+            else                        // cut short: wait for a key frame
+                break;
+        }
+        have[c] = (i == n) ? s + 1 : 0;
+    }
+
+    return;
+}
+
+/*
+ *  draw_frame()
+ *  Purpose: Draw what is known of the game, and show it
+ *   Method: As game_draw() does: the paddles (which only redraw if they
+ *           moved), then the balls, blanking where they were first, then
+ *           the headers. Balls in a block not yet heard of aren't shown.
+ *     Note: The paddles and clock are set from the packets with
+ *           paddle_load() and clock_load(), in the form their _save()
+ *           functions write.
+ */
+void draw_frame()
+{
+    int rows[2], time[3] = { mins, secs, 0 };
+    int i, side;
+
+    if(court == NULL)
+        return;
+
+    for(side = 0; side < 2; side++)
+        if(paddles[side] != NULL && pads[side][0] != SPEC_NO_PAD)
+        {
+            rows[0] = pads[side][0];
+            rows[1] = pads[side][1];
+            paddle_load(paddles[side], (unsigned char *) rows);
+            paddle_draw(paddles[side]);
+        }
+
+    for(i = 0; i < drawn; i++)
+        frame_erase(y_drawn[i], x_drawn[i]);
+    for(i = 0, drawn = 0; i < count; i++)
+        if(have[i / SPEC_CHUNK] != 0)
+        {
+            frame_put(y[i], x[i], BALL_SYMBOL);
+            x_drawn[drawn] = x[i];
+            y_drawn[drawn++] = y[i];
+        }
+
+    clock_load(timer, (unsigned char *) time);
+    print_time(court, timer);
+    print_balls(court, lives);
+
+    frame_flush();
+    dirty = 0;
+    return;
+}
+
+/*
+ *  say()
+ *  Purpose: Send the game a packet: SPEC_WATCH or SPEC_LEAVE
+ *     Note: If it is lost, the next one will do.
+ */
+void say(int type)
+{
+    unsigned char buf[4] = { 'P', 'S', SPEC_VERSION, type };
+
+    sendto(fd, buf, sizeof(buf), 0, (struct sockaddr *) &game_addr,
+           sizeof(game_addr));
+    return;
+}
+
+/*
+ *  now_us()
+ *  Purpose: Time the packets sent, in microseconds
+ */
+uint32_t now_us()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) ((ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000));
+}
+
+/*
+ *  get16(), get32()
+ *  Purpose: Read numbers in a packet, low byte first
+ */
+int get16(const unsigned char * p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+uint32_t get32(const unsigned char * p)
+{
+    return (uint32_t) get16(p) | ((uint32_t) get16(p + 2) << 16);
+}
+
+/*
+ * ===========================================================================
+ * EXTERNAL INTERFACE
+ * ===========================================================================
+ */
+
+/*
+ *  wrap_up()
+ *  Purpose: Close curses and the socket, ready to return to the terminal
+ *     Note: The court, clock and paddles call this when they can't
+ *           allocate memory, just as they do in pong.
+ */
+void wrap_up()
+{
+    frame_end();
+    endwin();
+    if(fd != -1)
+        close(fd);
+    fd = -1;
+
+    return;
+}